@@ -57,6 +57,7 @@ CALLIN_LIST = {
 	"UnitCmdDone",
 	"UnitPreDamaged",
 	"UnitDamaged",
+	"UnitDamagedBatch",
 	"UnitStunned",
 	"UnitTaken",
 	"UnitGiven",
@@ -94,6 +95,7 @@ CALLIN_LIST = {
 
 	-- projectile callins
 	"ProjectileCreated",
+	"ProjectileCreatedBatch",
 	"ProjectileDestroyed",
 
 	-- shield callins
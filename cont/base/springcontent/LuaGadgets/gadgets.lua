@@ -1525,6 +1525,26 @@ function gadgetHandler:UnitDamaged(
   end
 end
 
+function gadgetHandler:UnitDamagedBatch(
+  count,
+  unitIDs,
+  unitDefIDs,
+  unitTeams,
+  damages,
+  paralyzers,
+  weaponDefIDs,
+  projectileIDs,
+  attackerIDs,
+  attackerDefIDs,
+  attackerTeams
+)
+  for _,g in r_ipairs(self.UnitDamagedBatchList) do
+    g:UnitDamagedBatch(count, unitIDs, unitDefIDs, unitTeams,
+                       damages, paralyzers, weaponDefIDs, projectileIDs,
+                       attackerIDs, attackerDefIDs, attackerTeams)
+  end
+end
+
 function gadgetHandler:UnitStunned(unitID, unitDefID, unitTeam, stunned)
   for _,g in r_ipairs(self.UnitStunnedList) do
     g:UnitStunned(unitID, unitDefID, unitTeam, stunned)
@@ -1768,6 +1788,12 @@ function gadgetHandler:ProjectileCreated(proID, proOwnerID, proWeaponDefID)
   end
 end
 
+function gadgetHandler:ProjectileCreatedBatch(count, proIDs, proOwnerIDs, proWeaponDefIDs)
+  for _,g in r_ipairs(self.ProjectileCreatedBatchList) do
+    g:ProjectileCreatedBatch(count, proIDs, proOwnerIDs, proWeaponDefIDs)
+  end
+end
+
 function gadgetHandler:ProjectileDestroyed(proID)
   for _,g in r_ipairs(self.ProjectileDestroyedList) do
     g:ProjectileDestroyed(proID)
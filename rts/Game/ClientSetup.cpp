@@ -77,4 +77,5 @@ void ClientSetup::LoadFromStartScript(const std::string& setup)
 
 	file.GetDef(saveFile, "", "GAME\\SaveFile");
 	file.GetDef(demoFile, "", "GAME\\DemoFile");
+	file.GetDef(demoStartFrame, "0", "GAME\\DemoStartFrame");
 }
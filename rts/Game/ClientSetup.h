@@ -19,6 +19,14 @@ public:
 	std::string saveFile;
 	std::string demoFile;
 
+	//! frame demo playback should start out from, using the latest keyframe
+	//! at or before it (if the demo has any)
+	int demoStartFrame = 0;
+
+	//! if non-empty, the demo is replayed as fast as it can be simulated
+	//! and per-frame statistics are written to this file (--replay-stats)
+	std::string replayStatsFile;
+
 	//! if this client is not the server player, the IP address we connect to
 	//! if this client is the server player, the IP address that other players connect to
 	std::string hostIP;
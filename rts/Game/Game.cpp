@@ -8,12 +8,14 @@
 #include "Camera.h"
 #include "CameraHandler.h"
 #include "ChatMessage.h"
+#include "ClientSetup.h"
 #include "CommandMessage.h"
 #include "ConsoleHistory.h"
 #include "GameHelper.h"
 #include "GameSetup.h"
 #include "GlobalUnsynced.h"
 #include "LoadScreen.h"
+#include "ReplayStatsWriter.h"
 #include "SelectedUnitsHandler.h"
 #include "WaitCommandsAI.h"
 #include "WordCompletion.h"
@@ -122,6 +124,7 @@
 #include "System/SpringMath.h"
 #include "System/FileSystem/FileSystem.h"
 #include "System/LoadSave/LoadSaveHandler.h"
+#include "System/LoadSave/CregLoadSaveHandler.h"
 #include "System/LoadSave/DemoRecorder.h"
 #include "System/Log/ILog.h"
 #include "System/Platform/Misc.h"
@@ -213,6 +216,7 @@ CR_REG_METADATA(CGame, (
 	CR_IGNORED(jobDispatcher),
 	CR_IGNORED(worldDrawer),
 	CR_IGNORED(saveFileHandler),
+	CR_IGNORED(replayStats),
 	CR_IGNORED(gameInputReceiver),
 
 	// Post Load
@@ -255,6 +259,11 @@ CGame::CGame(const std::string& mapFileName, const std::string& modFileName, ILo
 	ParseInputTextGeometry("default");
 	ParseInputTextGeometry(configHandler->GetString("InputTextGeo"));
 
+	if (gameServer != nullptr && gameServer->IsFastReplay()) {
+		replayStats = std::make_unique<CReplayStatsWriter>(gameServer->GetClientSetup()->replayStatsFile);
+		replayStats->WriteHeader(gameSetup->demoName, gameSetup->mapName, gameSetup->modName);
+	}
+
 	// clear left-over receivers in case we reloaded
 	gameCommandConsole.ResetState();
 
@@ -1689,6 +1698,9 @@ void CGame::SimFrame() {
 	gs->frameNum += 1;
 #ifdef SYNC_HISTORY
 	CSyncChecker::NewGameFrame();
+#endif
+#ifdef SYNCCHECK
+	CSyncChecker::NewSimFrame();
 #endif
 	lastFrameTime = spring_gettime();
 	// This is not very ideal, as the timeoffset of each new draw frame is also calculated from this
@@ -1756,6 +1768,7 @@ void CGame::SimFrame() {
 			if (luaGCControl == 0)
 				eventHandler.CollectGarbage(false);
 
+			SCOPED_SYNC_SUBSYSTEM(SYNC_SUBSYSTEM_LUA);
 			eventHandler.GameFrame(gs->frameNum);
 		}
 
@@ -1763,10 +1776,22 @@ void CGame::SimFrame() {
 		readMap->Update();
 		smoothGround.UpdateSmoothMesh();
 		mapDamage->Update();
-		unitHandler.Update();
-		pathManager->Update();
-		projectileHandler.Update();
-		featureHandler.Update();
+		{
+			SCOPED_SYNC_SUBSYSTEM(SYNC_SUBSYSTEM_UNITS);
+			unitHandler.Update();
+		}
+		{
+			SCOPED_SYNC_SUBSYSTEM(SYNC_SUBSYSTEM_PATH);
+			pathManager->Update();
+		}
+		{
+			SCOPED_SYNC_SUBSYSTEM(SYNC_SUBSYSTEM_PROJECTILES);
+			projectileHandler.Update();
+		}
+		{
+			SCOPED_SYNC_SUBSYSTEM(SYNC_SUBSYSTEM_FEATURES);
+			featureHandler.Update();
+		}
 		{
 			/* The default GAME_SPEED is 30, which doesn't divide 1000 well,
 			 * so scripts will perceive 990ms per second. But this is fine,
@@ -1777,12 +1802,16 @@ void CGame::SimFrame() {
 			static constexpr int tickMs = 1000 / GAME_SPEED;
 
 			SCOPED_TIMER("Sim::Script");
+			SCOPED_SYNC_SUBSYSTEM(SYNC_SUBSYSTEM_SCRIPTS);
 			unitScriptEngine->Tick(tickMs);
 
 			unitHandler.UpdatePostAnimation();
 		}
 		envResHandler.Update();
-		losHandler->Update();
+		{
+			SCOPED_SYNC_SUBSYSTEM(SYNC_SUBSYSTEM_LOS);
+			losHandler->Update();
+		}
 		// dead ghosts have to be updated in sim, after los,
 		// to make sure they represent the current knowledge correctly.
 		// should probably be split from drawer
@@ -1812,7 +1841,8 @@ void CGame::SimFrame() {
 		// multiply by 0.5 to give unsynced code some execution time (50% of our sleep-budget)
 		const float msecSleepTime = (msecMaxSimFrameTime - msecDifSimFrameTime) * 0.5f;
 
-		if (msecSleepTime > 0.0f) {
+		// fast replays are paced by nothing but the sim itself
+		if (msecSleepTime > 0.0f && replayStats == nullptr) {
 			spring_sleep(spring_msecs(msecSleepTime));
 		}
 	}
@@ -1826,6 +1856,24 @@ void CGame::SimFrame() {
 }
 
 
+void CGame::SaveDemoKeyFrame()
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	CDemoRecorder* recorder = clientNet->GetDemoRecorder();
+
+	if (!recorder->IsValid() || !recorder->WantKeyFrame(gs->frameNum))
+		return;
+
+	SCOPED_TIMER("Game::SaveDemoKeyFrame");
+
+	CCregLoadSaveHandler keyFrameHandler;
+	keyFrameHandler.SaveInfo(gameSetup->mapName, gameSetup->modName);
+
+	// blocks until the state is serialized and compressed, see DemoKeyFrameInterval
+	recorder->AddKeyFrame(gs->frameNum, [&](std::ostream& oss) { return keyFrameHandler.SaveKeyFrame(oss); });
+}
+
+
 void CGame::GameEnd(const std::vector<unsigned char>& winningAllyTeams, bool timeout)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
@@ -1857,6 +1905,9 @@ void CGame::GameEnd(const std::vector<unsigned char>& winningAllyTeams, bool tim
 	gameOver = true;
 	eventHandler.GameOver(winningAllyTeams);
 
+	if (replayStats != nullptr)
+		replayStats->WriteGameOver(gs->frameNum, winningAllyTeams);
+
 	CEndGameBox::Create(winningAllyTeams);
 #ifdef    HEADLESS
 	CTimeProfiler::GetInstance().PrintProfilingInfo();
@@ -4,6 +4,7 @@
 #define _GAME_H
 
 #include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -18,6 +19,7 @@
 class LuaParser;
 class ILoadSaveHandler;
 class ChatMessage;
+class CReplayStatsWriter;
 
 
 class CGame : public CGameController
@@ -146,6 +148,7 @@ private:
 	void UpdateNumQueuedSimFrames();
 	void UpdateNetMessageProcessingTimeLeft();
 	void SimFrame();
+	void SaveDemoKeyFrame();
 	void StartPlaying();
 
 public:
@@ -223,6 +226,9 @@ private:
 	/// for reloading the savefile
 	ILoadSaveHandler* saveFileHandler;
 
+	/// non-null while fast-forwarding a demo for --replay-stats
+	std::unique_ptr<CReplayStatsWriter> replayStats;
+
 	CGameInputReceiver gameInputReceiver;
 
 	std::atomic<bool> loadDone = {false};
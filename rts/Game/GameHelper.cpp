@@ -40,6 +40,8 @@
 #include "System/EventHandler.h"
 #include "System/SpringMath.h"
 #include "System/Sound/ISoundChannels.h"
+#include "System/Threading/ThreadPool.h"
+#include "System/TimeProfiler.h"
 
 #include "System/Misc/TracyDefs.h"
 
@@ -58,6 +60,12 @@ void CGameHelper::Init()
 
 void CGameHelper::Kill()
 {
+	autoTargetWeapons.clear();
+	autoTargetCandidates.clear();
+
+	batchedExplosions.clear();
+	flushedExplosions.clear();
+	batchExplosions = false;
 }
 
 void CGameHelper::Update()
@@ -84,7 +92,6 @@ void CGameHelper::Update()
 	waitingDamages[wdIdx].clear();
 }
 
-
 //////////////////////////////////////////////////////////////////////
 // Explosions/Damage
 //////////////////////////////////////////////////////////////////////
@@ -105,37 +112,37 @@ float CGameHelper::CalcImpulseScale(const DamageArray& damages, const float expD
 	return std::clamp(rawImpulseScale, -MAX_EXPLOSION_IMPULSE, MAX_EXPLOSION_IMPULSE);
 }
 
-void CGameHelper::DoExplosionDamage(
-	CUnit* unit,
-	CUnit* owner,
+/**
+ * Damage falloff and impulse of an explosion at <expPos> for one object;
+ * returns false if the object is out of range. Does not modify any state,
+ * so it is safe to call from worker threads if <lhp> is null.
+ */
+template<typename T>
+static bool CalcExplosionDamage(
+	const T* obj,
+	const LocalModelPiece* lhp,
+	const LocalModelPiece* distPiece,
 	const float3& expPos,
 	const float expRadius,
-	const float expSpeed,
 	const float expEdgeEffect,
-	const bool ignoreOwner,
 	const DamageArray& damages,
-	const int weaponDefID,
-	const int projectileID
+	float3& expImpulse,
+	float& expDist,
+	float& expDistanceMod
 ) {
-	RECOIL_DETAILED_TRACY_ZONE;
-	assert(unit != nullptr);
-
-	if (ignoreOwner && (unit == owner))
-		return;
-
-	const LocalModelPiece* lhp = unit->GetLastHitPiece(gs->frameNum);
-	const CollisionVolume* vol = unit->GetCollisionVolume(lhp);
+	const CollisionVolume* vol = obj->GetCollisionVolume(lhp);
 
 	const float3& lhpPos = (lhp != nullptr && vol == lhp->GetCollisionVolume())? lhp->GetAbsolutePos(): ZeroVector;
-	const float3& volPos = vol->GetWorldSpacePos(unit, lhpPos);
+	const float3& volPos = vol->GetWorldSpacePos(obj, lhpPos);
 
 	// linear damage falloff with distance
-	const float expDist = (expRadius != 0.0f) ? vol->GetPointSurfaceDistance(unit, lhp, expPos) : 0.0f;
+	expDist = (expRadius != 0.0f) ? vol->GetPointSurfaceDistance(obj, distPiece, expPos) : 0.0f;
+
 	const float expRim = expDist * expEdgeEffect;
 
 	// return early if (distance > radius)
 	if (expDist > expRadius)
-		return;
+		return false;
 
 	// expEdgeEffect should be in [0, 1], so expRadius >= expDist >= expDist*expEdgeEffect
 	assert(expRadius >= expRim);
@@ -145,11 +152,11 @@ void CGameHelper::DoExplosionDamage(
 
 	// avoid float calculations when not needed, these can introduce
 	// tiny errors where a unit then survives on 0.0001 health
-	const float expDistanceMod = expEdgeEffect == 1.0f || expDist < 1.0f
+	expDistanceMod = expEdgeEffect == 1.0f || expDist < 1.0f
 		? 1.0f
 		: (expRadius + 0.001f - expDist) / (expRadius + 0.001f - expRim)
 	;
-	const float modImpulseScale = CalcImpulseScale(damages, expDistanceMod);
+	const float modImpulseScale = CGameHelper::CalcImpulseScale(damages, expDistanceMod);
 
 	// NOTE: if an explosion occurs right underneath a
 	// unit's map footprint, it might cause damage even
@@ -159,8 +166,53 @@ void CGameHelper::DoExplosionDamage(
 	// include units that should not be touched)
 
 	const float3 impulseDir = (volPos - expPos).SafeNormalize();
-	const float3 expImpulse = impulseDir * modImpulseScale;
 
+	expImpulse = impulseDir * modImpulseScale;
+	return true;
+}
+
+void CGameHelper::DoExplosionDamage(
+	CUnit* unit,
+	CUnit* owner,
+	const float3& expPos,
+	const float expRadius,
+	const float expSpeed,
+	const float expEdgeEffect,
+	const bool ignoreOwner,
+	const DamageArray& damages,
+	const int weaponDefID,
+	const int projectileID
+) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	assert(unit != nullptr);
+
+	if (ignoreOwner && (unit == owner))
+		return;
+
+	const LocalModelPiece* lhp = unit->GetLastHitPiece(gs->frameNum);
+
+	float3 expImpulse;
+	float expDist = 0.0f;
+	float expDistanceMod = 0.0f;
+
+	if (!CalcExplosionDamage(unit, lhp, lhp, expPos, expRadius, expEdgeEffect, damages, expImpulse, expDist, expDistanceMod))
+		return;
+
+	ApplyExplosionDamage(unit, owner, expImpulse, expDist, expDistanceMod, expSpeed, damages, weaponDefID, projectileID);
+}
+
+void CGameHelper::ApplyExplosionDamage(
+	CUnit* unit,
+	CUnit* owner,
+	const float3& expImpulse,
+	const float expDist,
+	const float expDistanceMod,
+	const float expSpeed,
+	const DamageArray& damages,
+	const int weaponDefID,
+	const int projectileID
+) {
+	RECOIL_DETAILED_TRACY_ZONE;
 	DamageArray expDamages = damages * expDistanceMod;
 
 	if (expDist < (expSpeed * DIRECT_EXPLOSION_DAMAGE_SPEED_SCALE)) {
@@ -186,33 +238,18 @@ void CGameHelper::DoExplosionDamage(
 	assert(feature != nullptr);
 
 	const LocalModelPiece* lhp = feature->GetLastHitPiece(gs->frameNum);
-	const CollisionVolume* vol = feature->GetCollisionVolume(lhp);
 
-	const float3& lhpPos = (lhp != nullptr && vol == lhp->GetCollisionVolume())? lhp->GetAbsolutePos(): ZeroVector;
-	const float3& volPos = vol->GetWorldSpacePos(feature, lhpPos);
-
-	const float expDist = (expRadius != 0.0f) ? vol->GetPointSurfaceDistance(feature, nullptr, expPos) : 0.0f;
-	const float expRim = expDist * expEdgeEffect;
+	float3 expImpulse;
+	float expDist = 0.0f;
+	float expDistanceMod = 0.0f;
 
-	if (expDist > expRadius)
+	if (!CalcExplosionDamage(feature, lhp, nullptr, expPos, expRadius, expEdgeEffect, damages, expImpulse, expDist, expDistanceMod))
 		return;
 
-	assert(expRadius >= expRim);
-
-	const float expDistanceMod = expEdgeEffect == 1.0f || expDist < 1.0f
-		? 1.0f
-		: (expRadius + 0.001f - expDist) / (expRadius + 0.001f - expRim)
-	;
-	const float modImpulseScale = CalcImpulseScale(damages, expDistanceMod);
-
-	const float3 impulseDir = (volPos - expPos).SafeNormalize();
-	const float3 expImpulse = impulseDir * modImpulseScale;
-
 	feature->DoDamage(damages * expDistanceMod, expImpulse, owner, weaponDefID, projectileID);
 }
 
 
-
 void CGameHelper::DamageObjectsInExplosionRadius(
 	const CExplosionParams& params,
 	const float expRad,
@@ -248,7 +285,164 @@ void CGameHelper::DamageObjectsInExplosionRadius(
 	featureCache.resize(oldNumFeatures);
 }
 
-void CGameHelper::Explosion(const CExplosionParams& params) {
+void CGameHelper::DamageObjectsInExplosionRadius(
+	const CExplosionParams& params,
+	const float expRad,
+	const int weaponDefID,
+	const std::vector<ExplosionHit>& hits
+) {
+	RECOIL_DETAILED_TRACY_ZONE;
+
+	// same order as the serial version: units first, then features
+	for (const ExplosionHit& hit: hits) {
+		if (hit.unit == nullptr)
+			continue;
+
+		if (hit.deferred) {
+			DoExplosionDamage(hit.unit, params.owner, params.pos, expRad, params.explosionSpeed, params.edgeEffectiveness, params.ignoreOwner, params.damages, weaponDefID, params.projectileID);
+			continue;
+		}
+
+		ApplyExplosionDamage(hit.unit, params.owner, hit.impulse, hit.expDist, hit.expDistanceMod, params.explosionSpeed, params.damages, weaponDefID, params.projectileID);
+	}
+
+	for (const ExplosionHit& hit: hits) {
+		if (hit.feature == nullptr)
+			continue;
+
+		if (hit.deferred) {
+			DoExplosionDamage(hit.feature, params.owner, params.pos, expRad, params.edgeEffectiveness, params.damages, weaponDefID, params.projectileID);
+			continue;
+		}
+
+		hit.feature->DoDamage(params.damages * hit.expDistanceMod, hit.impulse, params.owner, weaponDefID, params.projectileID);
+	}
+}
+
+void CGameHelper::GatherExplosionHits(const BatchedExplosion& be, std::vector<ExplosionHit>& hits, int thread)
+{
+	const float damageAOE = std::max(1.0f, be.damageAreaOfEffect);
+
+	QuadFieldQuery qfQuery;
+	qfQuery.threadOwner = thread;
+	quadField.GetUnitsAndFeaturesColVol(qfQuery, be.pos, damageAOE, false);
+
+	hits.clear();
+	hits.reserve(qfQuery.units->size() + qfQuery.features->size());
+
+	ExplosionHit hit;
+
+	for (CUnit* unit: *qfQuery.units) {
+		if (be.ignoreOwner && (unit == be.owner))
+			continue;
+
+		hit = {unit, nullptr, ZeroVector, 0.0f, 0.0f, unit->GetLastHitPiece(gs->frameNum) != nullptr};
+
+		if (!hit.deferred && !CalcExplosionDamage(unit, nullptr, nullptr, be.pos, damageAOE, be.edgeEffectiveness, be.damages, hit.impulse, hit.expDist, hit.expDistanceMod))
+			continue;
+
+		hits.push_back(hit);
+	}
+
+	for (CFeature* feature: *qfQuery.features) {
+		hit = {nullptr, feature, ZeroVector, 0.0f, 0.0f, feature->GetLastHitPiece(gs->frameNum) != nullptr};
+
+		if (!hit.deferred && !CalcExplosionDamage(feature, nullptr, nullptr, be.pos, damageAOE, be.edgeEffectiveness, be.damages, hit.impulse, hit.expDist, hit.expDistanceMod))
+			continue;
+
+		hits.push_back(hit);
+	}
+}
+
+void CGameHelper::QueueExplosion(const CExplosionParams& params)
+{
+	if (!batchExplosions) {
+		Explosion(params);
+		return;
+	}
+
+	// damages is only a reference, and might point to a buffer
+	// shared between all (dynamic-damage) weapons; copy it out
+	batchedExplosions.push_back({
+		.pos                = params.pos,
+		.dir                = params.dir,
+		.damages            = params.damages,
+		.weaponDef          = params.weaponDef,
+		.owner              = params.owner,
+		.hitUnit            = params.hitObject.GetTyped<CUnit>(),
+		.hitFeature         = params.hitObject.GetTyped<CFeature>(),
+		.hitWeapon          = params.hitObject.GetTyped<CWeapon>(),
+		.craterAreaOfEffect = params.craterAreaOfEffect,
+		.damageAreaOfEffect = params.damageAreaOfEffect,
+		.edgeEffectiveness  = params.edgeEffectiveness,
+		.explosionSpeed     = params.explosionSpeed,
+		.gfxMod             = params.gfxMod,
+		.impactOnly         = params.impactOnly,
+		.ignoreOwner        = params.ignoreOwner,
+		.damageGround       = params.damageGround,
+		.projectileID       = params.projectileID,
+		.hits               = {}
+	});
+}
+
+void CGameHelper::BeginExplosionBatch()
+{
+	assert(batchedExplosions.empty());
+	batchExplosions = modInfo.explosionDamageMT;
+}
+
+void CGameHelper::FlushExplosionBatch()
+{
+	SCOPED_TIMER("Sim::GameHelper::FlushExplosionBatch");
+
+	// anything exploding from here on (e.g. units killed by the batch)
+	// goes off immediately, as before
+	batchExplosions = false;
+
+	if (batchedExplosions.empty())
+		return;
+
+	std::swap(flushedExplosions, batchedExplosions);
+
+	// collecting the objects in range and their falloff is read-only, so
+	// the explosions can be processed in parallel; applying the damage is
+	// not, that happens below in the order the explosions were queued
+	for_mt_chunk(0, flushedExplosions.size(), [this](const int i) {
+		BatchedExplosion& be = flushedExplosions[i];
+
+		if (be.impactOnly)
+			return;
+
+		GatherExplosionHits(be, be.hits, ThreadPool::GetThreadNum());
+	});
+
+	for (const BatchedExplosion& be: flushedExplosions) {
+		const CExplosionParams params = {
+			.pos                  = be.pos,
+			.dir                  = be.dir,
+			.damages              = be.damages,
+			.weaponDef            = be.weaponDef,
+			.owner                = be.owner,
+			.hitObject            = ExplosionHitObject(be.hitUnit, be.hitFeature, be.hitWeapon),
+			.craterAreaOfEffect   = be.craterAreaOfEffect,
+			.damageAreaOfEffect   = be.damageAreaOfEffect,
+			.edgeEffectiveness    = be.edgeEffectiveness,
+			.explosionSpeed       = be.explosionSpeed,
+			.gfxMod               = be.gfxMod,
+			.maxGroundDeformation = 0.0f,
+			.impactOnly           = be.impactOnly,
+			.ignoreOwner          = be.ignoreOwner,
+			.damageGround         = be.damageGround,
+			.projectileID         = be.projectileID
+		};
+
+		Explosion(params, &be.hits);
+	}
+
+	flushedExplosions.clear();
+}
+
+void CGameHelper::Explosion(const CExplosionParams& params, const std::vector<ExplosionHit>* hits) {
 	RECOIL_DETAILED_TRACY_ZONE;
 	const DamageArray& damages = params.damages;
 
@@ -301,7 +495,11 @@ void CGameHelper::Explosion(const CExplosionParams& params) {
 			);
 		}
 	} else {
-		DamageObjectsInExplosionRadius(params, damageAOE, weaponDefID);
+		if (hits != nullptr) {
+			DamageObjectsInExplosionRadius(params, damageAOE, weaponDefID, *hits);
+		} else {
+			DamageObjectsInExplosionRadius(params, damageAOE, weaponDefID);
+		}
 
 		// deform the map if the explosion was above-ground
 		// (but had large enough radius to touch the ground)
@@ -655,46 +853,167 @@ namespace {
 
 
 
-size_t CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* avoidUnit, std::vector<std::pair<float, CUnit*>>& targets)
-{
-	const CUnit*  weaponOwner = weapon->owner;
-	const CUnit* lastAttacker = ((weaponOwner->lastAttackFrame + 200) <= gs->frameNum) ? weaponOwner->lastAttacker : nullptr;
+// [0] := default, [1,2,3,4,5,6] := target is {avoidee, in bad category, crashing, last attacker, paralyzed, outside unboosted range}
+static constexpr float tgtPriorityMults[] = {1.0f, 10.0f, 100.0f, 1000.0f, 0.5f, 4.0f, 100000.0f};
 
-	const      WeaponDef* weaponDef = weapon->weaponDef;
-	const DynDamageArray* weaponDmg = weapon->damages;
+namespace {
+	// per-weapon constants of the target priority computation
+	struct WeaponTargetParams {
+		WeaponTargetParams(const CWeapon* weapon) {
+			const      WeaponDef* weaponDef = weapon->weaponDef;
+			const DynDamageArray* weaponDmg = weapon->damages;
+
+			ownerPos = weapon->owner->pos;
+			aimPosHeight = weapon->aimFromPos.y;
+			minMapHeight = std::max(0.0f, readMap->GetCurrMinHeight());
+
+			// how much damage the weapon deals over 1 second
+			secDamage = weaponDmg->GetDefault() * weapon->salvoSize / weapon->reloadTime * GAME_SPEED;
+			heightMod = weaponDef->heightmod;
+
+			worldMainDir = weapon->weaponDir;
+			weaponAimAdjustPriority = weapon->weaponAimAdjustPriority;
+
+			baseRange = weapon->range;
+			rangeBoost = weapon->autoTargetRangeBoost;
+			// find theoretical maximum range based on height above lowest point on map
+			// scanRadius = weapon->GetRange2D(rangeBoost, (minMapHeight - aimPosHeight) * heightMod);
+			scanRadius = baseRange + rangeBoost + (aimPosHeight - minMapHeight) * heightMod;
+
+			paralyzer = (weaponDmg->paralyzeDamageTime != 0);
+		}
 
-	const float3& ownerPos = weaponOwner->pos;
-	const float3 testPos;
+		float3 ownerPos;
+		float3 worldMainDir;
 
-	const float aimPosHeight = weapon->aimFromPos.y;
-	const float minMapHeight = std::max(0.0f, readMap->GetCurrMinHeight());
+		float aimPosHeight;
+		float minMapHeight;
+		float secDamage;
+		float heightMod;
+		float weaponAimAdjustPriority;
+		float baseRange;
+		float rangeBoost;
+		float scanRadius;
 
-	// how much damage the weapon deals over 1 second
-	const float secDamage = weaponDmg->GetDefault() * weapon->salvoSize / weapon->reloadTime * GAME_SPEED;
-	const float heightMod = weaponDef->heightmod;
+		bool paralyzer;
+	};
 
-	const float3 worldMainDir = weapon->weaponDir;
-	const float weaponAimAdjustPriority = weapon->weaponAimAdjustPriority;
+	// part of the target priority that does not call into scripts or Lua;
+	// returns false if <targetUnit> can not be targeted at all
+	bool GatherWeaponTarget(
+		const CWeapon* weapon,
+		const CUnit* avoidUnit,
+		const WeaponTargetParams& params,
+		CUnit* targetUnit,
+		CGameHelper::WeaponTargetCandidate& candidate
+	) {
+		const float3 testPos;
+
+		if (!weapon->TestTarget(testPos, SWeaponTarget(targetUnit)))
+			return false;
+
+		const unsigned short targetLOSState = targetUnit->losStatus[weapon->owner->allyteam];
+
+		float targetPriority = tgtPriorityMults[(targetUnit == avoidUnit) * 1];
+		float3 targetPos;
+
+		if (targetLOSState & LOS_INLOS) {
+			targetPos = targetUnit->aimPos;
+		} else if (targetLOSState & LOS_INRADAR) {
+			targetPos = weapon->GetUnitPositionWithError(targetUnit);
+			targetPriority *= tgtPriorityMults[1];
+		} else {
+			return false;
+		}
 
-	const float  baseRange = weapon->range;
-	const float rangeBoost = weapon->autoTargetRangeBoost;
-	// find theoretical maximum range based on height above lowest point on map
-	// const float scanRadius = weapon->GetRange2D(rangeBoost, (minMapHeight - aimPosHeight) * heightMod);
-	const float scanRadius = baseRange + rangeBoost + (aimPosHeight - minMapHeight) * heightMod;
+		const float modRange = weapon->GetRange2D(params.rangeBoost, (targetPos.y - params.aimPosHeight) * params.heightMod);
+		const float sqDist2D = params.ownerPos.SqDistance2D(targetPos);
 
-	// [0] := default, [1,2,3,4,5,6] := target is {avoidee, in bad category, crashing, last attacker, paralyzed, outside unboosted range}
-	constexpr float tgtPriorityMults[] = {1.0f, 10.0f, 100.0f, 1000.0f, 0.5f, 4.0f, 100000.0f};
+		if (sqDist2D > Square(modRange))
+			return false;
 
-	const bool paralyzer = (weaponDmg->paralyzeDamageTime != 0);
+		const float3 worldTargetDir = (targetPos - params.ownerPos).SafeNormalize();
+		const float angleOffset =  (1.f - params.worldMainDir.dot(worldTargetDir));
+		const float angleMod = angleOffset * params.weaponAimAdjustPriority + 1.f;
+
+		// Strengthen focus towards the front, desire should weaken quadratically rather
+		// than linearly otherwise target distance can too easily cause units to choose a
+		// target that requires turning around to fire at.
+		const float angleMul = angleMod*angleMod;
+
+		const float dist2D = math::sqrt(sqDist2D);
+		const float rangeMul = (dist2D * weapon->weaponDef->proximityPriority + modRange * 0.4f + 100.0f);
+		const float damageMul = std::max(0.0001f, weapon->damages->Get(targetUnit->armorType) * targetUnit->curArmorMultiple);
+
+		targetPriority *= angleMul;
+		targetPriority *= rangeMul;
+		targetPriority *= tgtPriorityMults[(dist2D > params.baseRange) * 6];
+
+		if (targetLOSState & LOS_INLOS) {
+			targetPriority *= (params.secDamage + targetUnit->health);
+
+			if (params.paralyzer && targetUnit->paralyzeDamage > (modInfo.paralyzeOnMaxHealth? targetUnit->maxHealth: targetUnit->health))
+				targetPriority *= tgtPriorityMults[5];
+
+			// TargetWeight calls into the unit script, applied by ScoreWeaponTarget
+		} else {
+			targetPriority *= (params.secDamage + 10000.0f);
+		}
+
+		candidate = {targetUnit, targetPriority, damageMul, targetLOSState};
+		return true;
+	}
+
+	// applies the script- and Lua-dependent terms to a gathered candidate;
+	// returns false if AllowWeaponTarget rejected it
+	bool ScoreWeaponTarget(
+		const CWeapon* weapon,
+		const CUnit* lastAttacker,
+		const CGameHelper::WeaponTargetCandidate& candidate,
+		float& targetPriority
+	) {
+		CUnit* targetUnit = candidate.unit;
+
+		targetPriority = candidate.priority;
+
+		if ((candidate.losStatus & LOS_INLOS) && weapon->hasTargetWeight)
+			targetPriority *= weapon->TargetWeight(targetUnit);
+
+		if (candidate.losStatus & LOS_PREVLOS) {
+			targetPriority /= (candidate.damageMul * targetUnit->power);
+			targetPriority *= tgtPriorityMults[((targetUnit->category & weapon->badTargetCategory) != 0) * 2];
+			targetPriority *= tgtPriorityMults[(targetUnit->IsCrashing()) * 3];
+			targetPriority *= tgtPriorityMults[(targetUnit == lastAttacker) * 4];
+		}
+
+		return (eventHandler.AllowWeaponTarget(weapon->owner->id, targetUnit->id, weapon->weaponNum, weapon->weaponDef->id, &targetPriority));
+	}
+
+	const CUnit* GetRecentAttacker(const CUnit* weaponOwner) {
+		return (((weaponOwner->lastAttackFrame + 200) <= gs->frameNum) ? weaponOwner->lastAttacker : nullptr);
+	}
+
+	void SortWeaponTargets(std::vector<std::pair<float, CUnit*>>& targets) {
+		std::stable_sort(targets.begin(), targets.end(), [](const std::pair<float, CUnit*>& a, const std::pair<float, CUnit*>& b) { return (a.first < b.first); });
+	}
+}
+
+size_t CGameHelper::GatherWeaponTargets(const CWeapon* weapon, const CUnit* avoidUnit, std::vector<WeaponTargetCandidate>& candidates, int thread)
+{
+	const CUnit* weaponOwner = weapon->owner;
+	const WeaponTargetParams params(weapon);
 
-	// copy on purpose since the below calls lua
 	QuadFieldQuery qfQuery;
-	quadField.GetQuads(qfQuery, ownerPos, scanRadius);
+	qfQuery.threadOwner = thread;
+	quadField.GetQuads(qfQuery, params.ownerPos, params.scanRadius);
 
-	targets.clear();
-	targets.reserve(32);
+	candidates.clear();
+	candidates.reserve(32);
 
-	const int tempNum = gs->GetTempNum();
+	// per-thread tempNum, this can run concurrently for many weapons
+	const int tempNum = gs->GetMtTempNum(thread);
+
+	WeaponTargetCandidate candidate;
 
 	for (int t = 0; t < teamHandler.ActiveAllyTeams(); ++t) {
 		if (teamHandler.Ally(weaponOwner->allyteam, t))
@@ -704,72 +1023,81 @@ size_t CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* av
 			const std::vector<CUnit*>& allyTeamUnits = quadField.GetQuad(qi).teamUnits[t];
 
 			for (CUnit* targetUnit: allyTeamUnits) {
-				if (targetUnit->tempNum == tempNum)
+				if (targetUnit->mtTempNum[thread] == tempNum)
 					continue;
 
-				targetUnit->tempNum = tempNum;
+				targetUnit->mtTempNum[thread] = tempNum;
 
-				if (!weapon->TestTarget(testPos, SWeaponTarget(targetUnit)))
+				if (!GatherWeaponTarget(weapon, avoidUnit, params, targetUnit, candidate))
 					continue;
 
-				const unsigned short targetLOSState = targetUnit->losStatus[weaponOwner->allyteam];
+				candidates.push_back(candidate);
+			}
+		}
+	}
 
-				float targetPriority = tgtPriorityMults[(targetUnit == avoidUnit) * 1];
-				float3 targetPos;
+	return (candidates.size());
+}
 
-				if (targetLOSState & LOS_INLOS) {
-					targetPos = targetUnit->aimPos;
-				} else if (targetLOSState & LOS_INRADAR) {
-					targetPos = weapon->GetUnitPositionWithError(targetUnit);
-					targetPriority *= tgtPriorityMults[1];
-				} else {
-					continue;
-				}
+size_t CGameHelper::ScoreWeaponTargets(const CWeapon* weapon, const std::vector<WeaponTargetCandidate>& candidates, std::vector<std::pair<float, CUnit*>>& targets)
+{
+	const CUnit* lastAttacker = GetRecentAttacker(weapon->owner);
 
-				const float modRange = weapon->GetRange2D(rangeBoost, (targetPos.y - aimPosHeight) * heightMod);
-				const float sqDist2D = ownerPos.SqDistance2D(targetPos);
+	targets.clear();
+	targets.reserve(candidates.size());
 
-				if (sqDist2D > Square(modRange))
-					continue;
+	for (const WeaponTargetCandidate& candidate: candidates) {
+		float targetPriority = 0.0f;
 
-				const float3 worldTargetDir = (targetPos - ownerPos).SafeNormalize();
-				const float angleOffset =  (1.f - worldMainDir.dot(worldTargetDir));
-				const float angleMod = angleOffset * weaponAimAdjustPriority + 1.f;
+		if (!ScoreWeaponTarget(weapon, lastAttacker, candidate, targetPriority))
+			continue;
 
-				// Strengthen focus towards the front, desire should weaken quadratically rather
-				// than linearly otherwise target distance can too easily cause units to choose a
-				// target that requires turning around to fire at.
-				const float angleMul = angleMod*angleMod;
+		targets.emplace_back(targetPriority, candidate.unit);
+	}
 
-				const float dist2D = math::sqrt(sqDist2D);
-				const float rangeMul = (dist2D * weaponDef->proximityPriority + modRange * 0.4f + 100.0f);
-				const float damageMul = std::max(0.0001f, weaponDmg->Get(targetUnit->armorType) * targetUnit->curArmorMultiple);
+	SortWeaponTargets(targets);
+	return (targets.size());
+}
 
-				targetPriority *= angleMul;
-				targetPriority *= rangeMul;
-				targetPriority *= tgtPriorityMults[(dist2D > baseRange) * 6];
+size_t CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* avoidUnit, std::vector<std::pair<float, CUnit*>>& targets)
+{
+	const CUnit* weaponOwner = weapon->owner;
+	const CUnit* lastAttacker = GetRecentAttacker(weaponOwner);
 
-				if (targetLOSState & LOS_INLOS) {
-					targetPriority *= (secDamage + targetUnit->health);
+	const WeaponTargetParams params(weapon);
 
-					if (paralyzer && targetUnit->paralyzeDamage > (modInfo.paralyzeOnMaxHealth? targetUnit->maxHealth: targetUnit->health))
-						targetPriority *= tgtPriorityMults[5];
+	// copy on purpose since the below calls lua
+	QuadFieldQuery qfQuery;
+	quadField.GetQuads(qfQuery, params.ownerPos, params.scanRadius);
 
-					if (weapon->hasTargetWeight)
-						targetPriority *= weapon->TargetWeight(targetUnit);
+	targets.clear();
+	targets.reserve(32);
 
-				} else {
-					targetPriority *= (secDamage + 10000.0f);
-				}
+	const int tempNum = gs->GetTempNum();
 
-				if (targetLOSState & LOS_PREVLOS) {
-					targetPriority /= (damageMul * targetUnit->power);
-					targetPriority *= tgtPriorityMults[((targetUnit->category & weapon->badTargetCategory) != 0) * 2];
-					targetPriority *= tgtPriorityMults[(targetUnit->IsCrashing()) * 3];
-					targetPriority *= tgtPriorityMults[(targetUnit == lastAttacker) * 4];
-				}
+	WeaponTargetCandidate candidate;
+
+	// scores every candidate as soon as it is found, so that script and Lua
+	// callins see the same state as they did before UpdateWeaponAutoTargets
+	for (int t = 0; t < teamHandler.ActiveAllyTeams(); ++t) {
+		if (teamHandler.Ally(weaponOwner->allyteam, t))
+			continue;
+
+		for (const int qi: *qfQuery.quads) {
+			const std::vector<CUnit*>& allyTeamUnits = quadField.GetQuad(qi).teamUnits[t];
+
+			for (CUnit* targetUnit: allyTeamUnits) {
+				if (targetUnit->tempNum == tempNum)
+					continue;
+
+				targetUnit->tempNum = tempNum;
+
+				if (!GatherWeaponTarget(weapon, avoidUnit, params, targetUnit, candidate))
+					continue;
+
+				float targetPriority = 0.0f;
 
-				const bool allowTarget = eventHandler.AllowWeaponTarget(weaponOwner->id, targetUnit->id, weapon->weaponNum, weaponDef->id, &targetPriority);
+				const bool allowTarget = ScoreWeaponTarget(weapon, lastAttacker, candidate, targetPriority);
 
 				// Lua call may have changed tempNum, so needs to be set again
 				targetUnit->tempNum = tempNum;
@@ -782,11 +1110,55 @@ size_t CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* av
 		}
 	}
 
-	std::stable_sort(targets.begin(), targets.end(), [](const std::pair<float, CUnit*>& a, const std::pair<float, CUnit*>& b) { return (a.first < b.first); });
+	SortWeaponTargets(targets);
 	return (targets.size());
 }
 
 
+void CGameHelper::QueueWeaponAutoTarget(CWeapon* weapon)
+{
+	autoTargetWeapons.push_back(weapon);
+}
+
+void CGameHelper::UpdateWeaponAutoTargets()
+{
+	ZoneScoped;
+
+	if (autoTargetWeapons.empty())
+		return;
+
+	if (autoTargetCandidates.size() < autoTargetWeapons.size())
+		autoTargetCandidates.resize(autoTargetWeapons.size());
+
+	{
+		ZoneScopedN("Sim::Unit::AutoTarget::Gather");
+
+		// no Lua or script callins happen here, see GatherWeaponTargets
+		for_mt(0, autoTargetWeapons.size(), [this](const int i) {
+			const CWeapon* weapon = autoTargetWeapons[i];
+			GatherWeaponTargets(weapon, weapon->GetAutoTargetAvoidUnit(), autoTargetCandidates[i], ThreadPool::GetThreadNum());
+		});
+	}
+	{
+		ZoneScopedN("Sim::Unit::AutoTarget::Assign");
+
+		// assign in queueing order, identical on all clients
+		for (size_t i = 0; i < autoTargetWeapons.size(); i++) {
+			CWeapon* weapon = autoTargetWeapons[i];
+
+			// owner might have been killed by an earlier assignment's callins
+			if (weapon->owner->isDead)
+				continue;
+
+			ScoreWeaponTargets(weapon, autoTargetCandidates[i], targetPairs);
+			weapon->PickAutoTarget(targetPairs);
+		}
+	}
+
+	autoTargetWeapons.clear();
+}
+
+
 
 CUnit* CGameHelper::GetClosestUnit(const float3& pos, float searchRadius)
 {
@@ -878,7 +1250,6 @@ size_t CGameHelper::GetEnemyUnitsNoLosTest(const float3& pos, float searchRadius
 	return (found.size());
 }
 
-
 //////////////////////////////////////////////////////////////////////
 // Miscellaneous (i.e. not yet categorized)
 //////////////////////////////////////////////////////////////////////
@@ -209,8 +209,29 @@ public:
 		bool synced = false
 	);
 
+	struct WeaponTargetCandidate {
+		WeaponTargetCandidate() = default;
+		WeaponTargetCandidate(CUnit* u, float p, float d, unsigned short s): unit(u), priority(p), damageMul(d), losStatus(s) {}
+
+		CUnit* unit = nullptr;
+		// priority before the script- and Lua-dependent terms are applied
+		float priority = 0.0f;
+		float damageMul = 0.0f;
+		unsigned short losStatus = 0;
+	};
+
+	/// thread-safe part of target generation (no callins), run on <thread>
+	static size_t GatherWeaponTargets(const CWeapon* weapon, const CUnit* avoidUnit, std::vector<WeaponTargetCandidate>& candidates, int thread);
+	/// finishes the priorities of gathered candidates (calls into scripts and Lua), must run serially
+	static size_t ScoreWeaponTargets(const CWeapon* weapon, const std::vector<WeaponTargetCandidate>& candidates, std::vector<std::pair<float, CUnit*>>& targets);
+	/// gathers and scores in one pass, each candidate's callins run before the next one is looked at
 	static size_t GenerateWeaponTargets(const CWeapon* weapon, const CUnit* avoidUnit, std::vector<std::pair<float, CUnit*>>& targets);
 
+	/// defers target generation for <weapon> to the next UpdateWeaponAutoTargets call
+	void QueueWeaponAutoTarget(CWeapon* weapon);
+	/// gathers candidates for all queued weapons in parallel, then assigns targets in queueing order
+	void UpdateWeaponAutoTargets();
+
 	void Init();
 	void Kill();
 	void Update();
@@ -241,7 +262,70 @@ public:
 	);
 
 	void DamageObjectsInExplosionRadius(const CExplosionParams& params, const float expRad, const int weaponDefID);
-	void Explosion(const CExplosionParams& params);
+	void Explosion(const CExplosionParams& params) { Explosion(params, nullptr); }
+
+	/// runs Explosion right away, or defers it to FlushExplosionBatch while a batch is open
+	void QueueExplosion(const CExplosionParams& params);
+	/// starts deferring QueueExplosion calls, if the explosionDamageMT modrule is set
+	void BeginExplosionBatch();
+	/// gathers the damage of all deferred explosions in parallel, then runs them in queueing order
+	void FlushExplosionBatch();
+
+private:
+	struct ExplosionHit {
+		CUnit* unit;
+		CFeature* feature;
+
+		float3 impulse;
+		float expDist;
+		float expDistanceMod;
+
+		// last-hit piece matrices are updated lazily (not thread-safe),
+		// these are handled by DoExplosionDamage during the flush instead
+		bool deferred;
+	};
+
+	struct BatchedExplosion {
+		float3 pos;
+		float3 dir;
+		DamageArray damages;
+		const WeaponDef* weaponDef;
+
+		CUnit* owner;
+		CUnit* hitUnit;
+		CFeature* hitFeature;
+		CWeapon* hitWeapon;
+
+		float craterAreaOfEffect;
+		float damageAreaOfEffect;
+		float edgeEffectiveness;
+		float explosionSpeed;
+		float gfxMod;
+
+		bool impactOnly;
+		bool ignoreOwner;
+		bool damageGround;
+
+		uint32_t projectileID;
+
+		std::vector<ExplosionHit> hits;
+	};
+
+	void Explosion(const CExplosionParams& params, const std::vector<ExplosionHit>* hits);
+	void DamageObjectsInExplosionRadius(const CExplosionParams& params, const float expRad, const int weaponDefID, const std::vector<ExplosionHit>& hits);
+	static void GatherExplosionHits(const BatchedExplosion& be, std::vector<ExplosionHit>& hits, int thread);
+
+	void ApplyExplosionDamage(
+		CUnit* unit,
+		CUnit* owner,
+		const float3& expImpulse,
+		const float expDist,
+		const float expDistanceMod,
+		const float expSpeed,
+		const DamageArray& damages,
+		const int weaponDefID,
+		const int projectileID
+	);
 
 private:
 	struct WaitingDamage {
@@ -269,6 +353,14 @@ private:
 public:
 	std::vector<int> targetUnitIDs; // GetEnemyUnits{NoLosTest}
 	std::vector<std::pair<float, CUnit*>> targetPairs; // GenerateWeaponTargets
+
+private:
+	std::vector<CWeapon*> autoTargetWeapons; // QueueWeaponAutoTarget
+	std::vector<std::vector<WeaponTargetCandidate>> autoTargetCandidates; // UpdateWeaponAutoTargets
+
+	std::vector<BatchedExplosion> batchedExplosions; // QueueExplosion
+	std::vector<BatchedExplosion> flushedExplosions; // FlushExplosionBatch
+	bool batchExplosions = false;
 };
 
 extern CGameHelper* helper;
\ No newline at end of file
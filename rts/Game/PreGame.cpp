@@ -44,6 +44,7 @@
 #include "System/FileSystem/VFSHandler.h"
 #include "System/LoadSave/DemoRecorder.h"
 #include "System/LoadSave/DemoReader.h"
+#include "System/LoadSave/CregLoadSaveHandler.h"
 #include "System/LoadSave/LoadSaveHandler.h"
 #include "System/Log/ILog.h"
 #include "System/Net/RawPacket.h"
@@ -557,6 +558,30 @@ void CPreGame::ReadDataFromDemo(const std::string& demoName)
 	}
 
 	assert(gameServer != nullptr);
+
+	if (clientSetup->demoStartFrame <= 0)
+		return;
+
+	// load the closest keyframe like a save-file, the server skips the stream ahead to match
+	const CDemoReader::KeyFrame* keyFrame = scanner.FindKeyFrame(clientSetup->demoStartFrame);
+
+	if (keyFrame == nullptr) {
+		LOG_L(L_WARNING, "[PreGame::%s] demo has no keyframe at or before frame %d", __func__, clientSetup->demoStartFrame);
+		return;
+	}
+
+	std::string state;
+	std::unique_ptr<CCregLoadSaveHandler> keyFrameHandler = std::make_unique<CCregLoadSaveHandler>();
+
+	if (!scanner.ReadKeyFrameState(*keyFrame, state) || !keyFrameHandler->LoadKeyFrameStartInfo(std::move(state))) {
+		LOG_L(L_WARNING, "[PreGame::%s] demo keyframe at frame %d is unusable", __func__, keyFrame->frameNum);
+		return;
+	}
+
+	LOG("[PreGame::%s] starting demo from keyframe at frame %d", __func__, keyFrame->frameNum);
+
+	saveFileHandler = keyFrameHandler.release();
+	gameServer->SetDemoResumeFrame(keyFrame->frameNum);
 }
 
 void CPreGame::GameDataReceived(std::shared_ptr<const netcode::RawPacket> packet)
@@ -0,0 +1,175 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "ReplayStatsWriter.h"
+
+#include "Sim/Misc/GlobalConstants.h"
+#include "Sim/Misc/Team.h"
+#include "Sim/Misc/TeamHandler.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/Log/ILog.h"
+#include "System/SpringFormat.h"
+
+#include <filesystem>
+#include <system_error>
+
+CONFIG(int, ReplayStatsTeamInterval)
+	.defaultValue(1)
+	.minimumValue(1)
+	.description("Number of sim-frames between team statistics records written by --replay-stats; sync checksums are always written for every frame.");
+
+
+static std::string EscapeJSON(const std::string& str)
+{
+	std::string ret;
+	ret.reserve(str.size());
+
+	for (const char c: str) {
+		switch (c) {
+			case '"' : { ret += "\\\""; } break;
+			case '\\': { ret += "\\\\"; } break;
+			case '\n': { ret += "\\n" ; } break;
+			case '\r': { ret += "\\r" ; } break;
+			case '\t': { ret += "\\t" ; } break;
+			default: {
+				if (static_cast<unsigned char>(c) < 0x20) {
+					ret += spring::format("\\u%04x", c);
+				} else {
+					ret += c;
+				}
+			} break;
+		}
+	}
+
+	return ret;
+}
+
+
+
+CReplayStatsWriter::CReplayStatsWriter(const std::string& fileName_)
+	: fileName(fileName_)
+	, tempFileName(fileName_ + ".tmp")
+	, teamStatsInterval(configHandler->GetInt("ReplayStatsTeamInterval"))
+{
+	if ((file = std::fopen(tempFileName.c_str(), "wb")) == nullptr) {
+		LOG_L(L_ERROR, "[ReplayStatsWriter] could not open \"%s\" for writing", tempFileName.c_str());
+		return;
+	}
+
+	// one replay produces a lot of small records, batch them up
+	std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+}
+
+CReplayStatsWriter::~CReplayStatsWriter()
+{
+	if (file == nullptr)
+		return;
+
+	// never finished (crashed or quit early), do not leave a partial
+	// file around that could be mistaken for a complete replay
+	std::fclose(file);
+	std::remove(tempFileName.c_str());
+}
+
+
+void CReplayStatsWriter::WriteHeader(const std::string& demoName, const std::string& mapName, const std::string& modName)
+{
+	if (file == nullptr)
+		return;
+
+	std::fprintf(file, "{\"type\":\"header\",\"demo\":\"%s\",\"map\":\"%s\",\"game\":\"%s\",\"gameSpeed\":%d}\n",
+		EscapeJSON(demoName).c_str(),
+		EscapeJSON(mapName).c_str(),
+		EscapeJSON(modName).c_str(),
+		GAME_SPEED
+	);
+}
+
+void CReplayStatsWriter::WriteFrame(int frameNum, unsigned int checksum)
+{
+	if (file == nullptr)
+		return;
+
+	std::fprintf(file, "{\"type\":\"frame\",\"frame\":%d,\"checksum\":%u", frameNum, checksum);
+
+	if ((frameNum % teamStatsInterval) == 0) {
+		std::fputs(",\"teams\":[", file);
+
+		for (int teamNum = 0, numTeams = teamHandler.ActiveTeams(); teamNum < numTeams; ++teamNum) {
+			const CTeam* team = teamHandler.Team(teamNum);
+			// counters for the current TeamStatistics::statsPeriod, reset once it is archived
+			const TeamStatistics& stats = team->GetCurrentStats();
+
+			std::fprintf(file,
+				"%s{\"team\":%d,\"dead\":%d,\"units\":%u,\"metal\":%g,\"energy\":%g,"
+				"\"metalUsed\":%g,\"energyUsed\":%g,\"metalProduced\":%g,\"energyProduced\":%g,"
+				"\"metalExcess\":%g,\"energyExcess\":%g,\"metalReceived\":%g,\"energyReceived\":%g,"
+				"\"metalSent\":%g,\"energySent\":%g,\"damageDealt\":%g,\"damageReceived\":%g,"
+				"\"unitsProduced\":%d,\"unitsDied\":%d,\"unitsReceived\":%d,\"unitsSent\":%d,"
+				"\"unitsCaptured\":%d,\"unitsOutCaptured\":%d,\"unitsKilled\":%d}",
+				(teamNum > 0)? ",": "",
+				teamNum, int(team->isDead), team->GetNumUnits(), team->res.metal, team->res.energy,
+				stats.metalUsed, stats.energyUsed, stats.metalProduced, stats.energyProduced,
+				stats.metalExcess, stats.energyExcess, stats.metalReceived, stats.energyReceived,
+				stats.metalSent, stats.energySent, stats.damageDealt, stats.damageReceived,
+				stats.unitsProduced, stats.unitsDied, stats.unitsReceived, stats.unitsSent,
+				stats.unitsCaptured, stats.unitsOutCaptured, stats.unitsKilled
+			);
+		}
+
+		std::fputc(']', file);
+	}
+
+	std::fputs("}\n", file);
+}
+
+void CReplayStatsWriter::WriteDesync(int frameNum, int playerNum, unsigned int demoChecksum, unsigned int localChecksum)
+{
+	if (file == nullptr)
+		return;
+
+	std::fprintf(file, "{\"type\":\"desync\",\"frame\":%d,\"player\":%d,\"demoChecksum\":%u,\"checksum\":%u}\n", frameNum, playerNum, demoChecksum, localChecksum);
+}
+
+void CReplayStatsWriter::WriteGameOver(int frameNum, const std::vector<unsigned char>& winningAllyTeams)
+{
+	if (file == nullptr)
+		return;
+
+	std::fprintf(file, "{\"type\":\"gameover\",\"frame\":%d,\"winningAllyTeams\":[", frameNum);
+
+	for (size_t i = 0; i < winningAllyTeams.size(); ++i) {
+		std::fprintf(file, "%s%d", (i > 0)? ",": "", int(winningAllyTeams[i]));
+	}
+
+	std::fputs("]}\n", file);
+}
+
+
+bool CReplayStatsWriter::Finish()
+{
+	if (file == nullptr)
+		return false;
+
+	const bool written = (std::fflush(file) == 0 && std::ferror(file) == 0);
+
+	std::fclose(file);
+	file = nullptr;
+
+	if (!written) {
+		LOG_L(L_ERROR, "[ReplayStatsWriter] failed writing \"%s\"", tempFileName.c_str());
+		std::remove(tempFileName.c_str());
+		return false;
+	}
+
+	std::error_code err;
+	std::filesystem::rename(tempFileName, fileName, err);
+
+	if (err) {
+		LOG_L(L_ERROR, "[ReplayStatsWriter] could not move \"%s\" to \"%s\": %s", tempFileName.c_str(), fileName.c_str(), err.message().c_str());
+		std::remove(tempFileName.c_str());
+		return false;
+	}
+
+	LOG("[ReplayStatsWriter] wrote replay statistics to \"%s\"", fileName.c_str());
+	return true;
+}
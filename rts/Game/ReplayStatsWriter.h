@@ -0,0 +1,46 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef REPLAY_STATS_WRITER_H
+#define REPLAY_STATS_WRITER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+/**
+ * Writes the per-frame state of a fast-forwarded demo replay (--replay-stats)
+ * as one JSON object per line. Output goes to a temporary file next to the
+ * target which is only renamed into place by Finish(), so a batch driver can
+ * treat any file that exists as complete, even with many replays running at
+ * the same time.
+ */
+class CReplayStatsWriter
+{
+public:
+	CReplayStatsWriter(const std::string& fileName);
+	~CReplayStatsWriter();
+
+	CReplayStatsWriter(const CReplayStatsWriter&) = delete;
+	CReplayStatsWriter& operator = (const CReplayStatsWriter&) = delete;
+
+	bool IsOpen() const { return (file != nullptr); }
+
+	void WriteHeader(const std::string& demoName, const std::string& mapName, const std::string& modName);
+	void WriteFrame(int frameNum, unsigned int checksum);
+	void WriteDesync(int frameNum, int playerNum, unsigned int demoChecksum, unsigned int localChecksum);
+	void WriteGameOver(int frameNum, const std::vector<unsigned char>& winningAllyTeams);
+
+	/// closes the output and moves it into place, returns false on failure
+	bool Finish();
+
+private:
+	std::string fileName;
+	std::string tempFileName;
+
+	std::FILE* file = nullptr;
+
+	int teamStatsInterval = 1;
+};
+
+#endif // REPLAY_STATS_WRITER_H
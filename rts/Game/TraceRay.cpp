@@ -20,6 +20,7 @@
 #include "Sim/Weapons/WeaponDef.h"
 #include "System/GlobalConfig.h"
 #include "System/SpringMath.h"
+#include "System/Threading/ThreadPool.h"
 
 #include <algorithm>
 #include <vector>
@@ -233,6 +234,7 @@ float TraceRay(
 		CollisionQuery cq;
 
 		QuadFieldQuery qfQuery;
+		qfQuery.threadOwner = ThreadPool::GetThreadNum();
 		quadField.GetQuadsOnRay(qfQuery, pos, dir, traceLength);
 
 		// locally point somewhere non-NULL; we cannot pass hitColQuery
@@ -340,6 +342,7 @@ void TraceRayShields(
 	CollisionQuery cq;
 
 	QuadFieldQuery qfQuery;
+	qfQuery.threadOwner = ThreadPool::GetThreadNum();
 	quadField.GetQuadsOnRay(qfQuery, start, dir, length);
 
 	for (const int quadIdx: *qfQuery.quads) {
@@ -535,6 +538,7 @@ bool TestCone(
 ) {
 	RECOIL_DETAILED_TRACY_ZONE;
 	QuadFieldQuery qfQuery;
+	qfQuery.threadOwner = ThreadPool::GetThreadNum();
 	quadField.GetQuadsOnRay(qfQuery, from, dir, length);
 
 	if (qfQuery.quads->empty())
@@ -602,6 +606,7 @@ bool TestTrajectoryCone(
 ) {
 	RECOIL_DETAILED_TRACY_ZONE;
 	QuadFieldQuery qfQuery;
+	qfQuery.threadOwner = ThreadPool::GetThreadNum();
 	quadField.GetQuadsOnRay(qfQuery, from, dir, length);
 
 	if (qfQuery.quads->empty())
@@ -484,6 +484,7 @@ static void DrawInfoText(TypedRenderBuffer<VA_TYPE_C   >& rb)
 	constexpr const char* spdFmtStr = "[4] {Current,Wanted}SimSpeedMul={%2.2f, %2.2f}x";
 	constexpr const char* sfxFmtStr = "[5] {Synced,Unsynced}Projectiles={%u,%u} Particles=%u Saturation=%.1f";
 	constexpr const char* pfsFmtStr = "[6] (%s)PFS-updates queued: {%i, %i}";
+	constexpr const char* qtpfsFmtStr = "[6] (%s)PFS-updates queued: {%i, %i} {Repaired,Replanned}Paths={%i, %i}";
 	constexpr const char* luaFmtStr = "[7] Lua-allocated memory: %.1fMB (%.1fK allocs : %.5u usecs : %.1u states)";
 	constexpr const char* gpuFmtStr = "[8] GPU-allocated memory: %.1fMB / %.1fMB";
 	constexpr const char* sopFmtStr = "[9] SOP-allocated memory: {U,F,P,W}={%.1f/%.1f, %.1f/%.1f, %.1f/%.1f, %.1f/%.1f}KB";
@@ -516,7 +517,8 @@ static void DrawInfoText(TypedRenderBuffer<VA_TYPE_C   >& rb)
 				font->glFormat(0.01f, 0.12f, 0.5f, DBG_FONT_FLAGS | FONT_BUFFERED, pfsFmtStr, "HA", pfsUpdates.x, pfsUpdates.y);
 			} break;
 			case QTPFS_TYPE: {
-				font->glFormat(0.01f, 0.12f, 0.5f, DBG_FONT_FLAGS | FONT_BUFFERED, pfsFmtStr, "QT", pfsUpdates.x, pfsUpdates.y);
+				const int2 pfsRepairs = pm->GetNumPathRepairs();
+				font->glFormat(0.01f, 0.12f, 0.5f, DBG_FONT_FLAGS | FONT_BUFFERED, qtpfsFmtStr, "QT", pfsUpdates.x, pfsUpdates.y, pfsRepairs.x, pfsRepairs.y);
 			} break;
 			default: {
 			} break;
@@ -65,6 +65,7 @@
 
 #include <algorithm>
 #include <string>
+#include <type_traits>
 
 
 CONFIG(float, LuaGarbageCollectionMemLoadMult).defaultValue(1.33f).minimumValue(1.0f).maximumValue(100.0f).description("How much the amount of Lua memory in use increases the rate of garbage collection.");
@@ -132,6 +133,46 @@ static void LUA_ERASE_CONTEXT(const luaContextData* D, const spring::unsynced_se
 	const_cast<  spring::unsynced_set<const luaContextData*>*  >(S)->erase(D);
 }
 
+// pushes one column of a batched call-in as a Lua array
+template<typename T>
+static void PushBatchColumn(lua_State* L, const std::vector<T>& column)
+{
+	lua_createtable(L, column.size(), 0);
+
+	for (size_t i = 0; i < column.size(); i++) {
+		if constexpr (std::is_same_v<T, bool>) {
+			lua_pushboolean(L, column[i]);
+		} else {
+			lua_pushnumber(L, column[i]);
+		}
+
+		lua_rawseti(L, -2, i + 1);
+	}
+}
+
+// watch filter shared by ProjectileCreated and its batched variant
+static bool IsWatchedProjectile(const std::vector<bool>& watchProjectileDefs, const CProjectile* p, const WeaponDef*& wd)
+{
+	// if empty, we are not a LuaHandleSynced
+	if (watchProjectileDefs.empty())
+		return false;
+
+	if (!p->weapon && !p->piece)
+		return false;
+
+	assert(p->synced);
+
+	wd = p->weapon? static_cast<const CWeaponProjectile*>(p)->GetWeaponDef(): nullptr;
+
+	// if this weapon-type is not being watched, bail
+	if (p->weapon && (wd == nullptr || !watchProjectileDefs[wd->id]))
+		return false;
+	if (p->piece && !watchProjectileDefs[watchProjectileDefs.size() - 1])
+		return false;
+
+	return true;
+}
+
 static int handlepanic(lua_State* L)
 {
 	throw content_error(luaL_optsstring(L, 1, "lua paniced"));
@@ -691,6 +732,12 @@ bool CLuaHandle::UpdateCallIn(lua_State* L, const string& name)
 		eventHandler.InsertEvent(this, name);
 	} else {
 		eventHandler.RemoveEvent(this, name);
+
+		// nothing would deliver (or ever empty) what was queued for it so far
+		if (name == "UnitDamagedBatch")
+			unitDamagedColumns.Clear();
+		if (name == "ProjectileCreatedBatch")
+			projectileCreatedColumns.Clear();
 	}
 	return true;
 }
@@ -1405,6 +1452,93 @@ void CLuaHandle::UnitDamaged(
 	RunCallInTraceback(L, cmdStr, argCount, 0, traceBack.GetErrFuncIdx(), false);
 }
 
+void CLuaHandle::QueueUnitDamaged(
+	const CUnit* unit,
+	const CUnit* attacker,
+	float damage,
+	int weaponDefID,
+	int projectileID,
+	bool paralyzer)
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	UnitDamagedColumns& c = unitDamagedColumns;
+
+	c.unitIDs.push_back(unit->id);
+	c.unitDefIDs.push_back(unit->unitDef->id);
+	c.unitTeams.push_back(unit->team);
+	c.damages.push_back(damage);
+	c.paralyzers.push_back(paralyzer);
+	c.weaponDefIDs.push_back(weaponDefID);
+	c.projectileIDs.push_back(projectileID);
+
+	// same rules as PushAttackerInfo, but resolved now since the
+	// attacker can be gone by the time the batch is delivered
+	const bool attackerVisible = (attacker != nullptr && LuaUtils::IsUnitVisible(L, attacker));
+	const bool attackerTyped = (attackerVisible && LuaUtils::IsUnitTyped(L, attacker));
+
+	c.attackerIDs.push_back(attackerVisible? attacker->id: -1);
+	c.attackerDefIDs.push_back(attackerTyped? LuaUtils::EffectiveUnitDef(L, attacker)->id: -1);
+	c.attackerTeams.push_back(attackerVisible? attacker->team: -1);
+}
+
+/*** Called once per frame, before GameFramePost, with every UnitDamaged event of that frame.
+ *
+ * Bulk alternative to UnitDamaged: events are collected during the frame
+ * and passed as parallel arrays, one entry per event in the order they
+ * happened. Attacker entries the handle may not see
+ * are -1 instead of nil. Damage dealt from within this callin is delivered
+ * with the next batch.
+ *
+ * @function Callins:UnitDamagedBatch
+ * @param count integer
+ * @param unitIDs integer[]
+ * @param unitDefIDs integer[]
+ * @param unitTeams integer[]
+ * @param damages number[]
+ * @param paralyzers boolean[]
+ * @param weaponDefIDs integer[]
+ * @param projectileIDs integer[]
+ * @param attackerIDs integer[]
+ * @param attackerDefIDs integer[]
+ * @param attackerTeams integer[]
+ */
+void CLuaHandle::UnitDamagedBatch()
+{
+	UnitDamagedColumns& c = unitDamagedColumns;
+
+	if (c.unitIDs.empty())
+		return;
+
+	LUA_CALL_IN_CHECK(L);
+	luaL_checkstack(L, 12, __func__);
+
+	static const LuaHashString cmdStr(__func__);
+	const LuaUtils::ScopedDebugTraceBack traceBack(L);
+
+	if (!cmdStr.GetGlobalFunc(L)) {
+		c.Clear();
+		return;
+	}
+
+	lua_pushnumber(L, c.unitIDs.size());
+	PushBatchColumn(L, c.unitIDs);
+	PushBatchColumn(L, c.unitDefIDs);
+	PushBatchColumn(L, c.unitTeams);
+	PushBatchColumn(L, c.damages);
+	PushBatchColumn(L, c.paralyzers);
+	PushBatchColumn(L, c.weaponDefIDs);
+	PushBatchColumn(L, c.projectileIDs);
+	PushBatchColumn(L, c.attackerIDs);
+	PushBatchColumn(L, c.attackerDefIDs);
+	PushBatchColumn(L, c.attackerTeams);
+
+	// emptied before the call, anything queued from within goes into the next batch
+	c.Clear();
+
+	// call the routine
+	RunCallInTraceback(L, cmdStr, 11, 0, traceBack.GetErrFuncIdx(), false);
+}
+
 /*** Called when a unit changes its stun status.
  *
  * @function Callins:UnitStunned
@@ -2130,24 +2264,12 @@ void CLuaHandle::FeatureDamaged(
 void CLuaHandle::ProjectileCreated(const CProjectile* p)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
-	// if empty, we are not a LuaHandleSynced
-	if (watchProjectileDefs.empty())
-		return;
+	const WeaponDef* wd = nullptr;
 
-	if (!p->weapon && !p->piece)
+	if (!IsWatchedProjectile(watchProjectileDefs, p, wd))
 		return;
 
-	assert(p->synced);
-
 	const CUnit* owner = p->owner();
-	const CWeaponProjectile* wp = p->weapon? static_cast<const CWeaponProjectile*>(p): nullptr;
-	const WeaponDef* wd = p->weapon? wp->GetWeaponDef(): nullptr;
-
-	// if this weapon-type is not being watched, bail
-	if (p->weapon && (wd == nullptr || !watchProjectileDefs[wd->id]))
-		return;
-	if (p->piece && !watchProjectileDefs[watchProjectileDefs.size() - 1])
-		return;
 
 	LUA_CALL_IN_CHECK(L);
 	luaL_checkstack(L, 5, __func__);
@@ -2166,6 +2288,64 @@ void CLuaHandle::ProjectileCreated(const CProjectile* p)
 }
 
 
+void CLuaHandle::QueueProjectileCreated(const CProjectile* p)
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	const WeaponDef* wd = nullptr;
+
+	if (!IsWatchedProjectile(watchProjectileDefs, p, wd))
+		return;
+
+	ProjectileCreatedColumns& c = projectileCreatedColumns;
+
+	c.proIDs.push_back(p->id);
+	c.proOwnerIDs.push_back(p->GetOwnerID());
+	c.weaponDefIDs.push_back((wd != nullptr)? wd->id: -1);
+}
+
+/*** Called once per frame, before GameFramePost, with every ProjectileCreated event of that frame.
+ *
+ * Bulk alternative to ProjectileCreated, subject to the same watch filters. Events are passed as parallel arrays in the order the
+ * projectiles were created.
+ *
+ * @function Callins:ProjectileCreatedBatch
+ * @param count integer
+ * @param proIDs integer[]
+ * @param proOwnerIDs integer[]
+ * @param weaponDefIDs integer[]
+ *
+ * @see Script.SetWatchProjectile
+ * @see Script.SetWatchWeapon
+ */
+void CLuaHandle::ProjectileCreatedBatch()
+{
+	ProjectileCreatedColumns& c = projectileCreatedColumns;
+
+	if (c.proIDs.empty())
+		return;
+
+	LUA_CALL_IN_CHECK(L);
+	luaL_checkstack(L, 6, __func__);
+
+	static const LuaHashString cmdStr(__func__);
+
+	if (!cmdStr.GetGlobalFunc(L)) {
+		c.Clear();
+		return;
+	}
+
+	lua_pushnumber(L, c.proIDs.size());
+	PushBatchColumn(L, c.proIDs);
+	PushBatchColumn(L, c.proOwnerIDs);
+	PushBatchColumn(L, c.weaponDefIDs);
+
+	c.Clear();
+
+	// call the routine
+	RunCallIn(L, cmdStr, 4, 0);
+}
+
+
 /*** Called when the projectile is destroyed.
  *
  * @function Callins:ProjectileDestroyed
@@ -147,6 +147,15 @@ class CLuaHandle : public CEventClient
 			int projectileID,
 			bool paralyzer
 		) override;
+		void QueueUnitDamaged(
+			const CUnit* unit,
+			const CUnit* attacker,
+			float damage,
+			int weaponDefID,
+			int projectileID,
+			bool paralyzer
+		) override;
+		void UnitDamagedBatch() override;
 		void UnitStunned(const CUnit* unit, bool stunned) override;
 		void UnitExperience(const CUnit* unit, float oldExperience) override;
 		void UnitHarvestStorageFull(const CUnit* unit) override;
@@ -190,6 +199,8 @@ class CLuaHandle : public CEventClient
 
 		void ProjectileCreated(const CProjectile* p) override;
 		void ProjectileDestroyed(const CProjectile* p) override;
+		void QueueProjectileCreated(const CProjectile* p) override;
+		void ProjectileCreatedBatch() override;
 
 		bool IsExplosionVisible(const WeaponDef* weaponDef, const CExplosionParams& params);
 		bool Explosion(int weaponID, const WeaponDef* weaponDef, const CExplosionParams& params) override;
@@ -370,6 +381,35 @@ class CLuaHandle : public CEventClient
 		std::vector<bool> watchExplosionDefs;   // callin masks for Explosion
 		std::vector<bool> watchAllowTargetDefs; // callin masks for AllowWeapon*Target*
 
+		// columns of the events queued for the batched call-ins, emptied by each delivery
+		struct UnitDamagedColumns {
+			void Clear() {
+				unitIDs.clear(); unitDefIDs.clear(); unitTeams.clear();
+				damages.clear(); paralyzers.clear();
+				weaponDefIDs.clear(); projectileIDs.clear();
+				attackerIDs.clear(); attackerDefIDs.clear(); attackerTeams.clear();
+			}
+
+			std::vector<int> unitIDs;
+			std::vector<int> unitDefIDs;
+			std::vector<int> unitTeams;
+			std::vector<float> damages;
+			std::vector<bool> paralyzers;
+			std::vector<int> weaponDefIDs;
+			std::vector<int> projectileIDs;
+			std::vector<int> attackerIDs;
+			std::vector<int> attackerDefIDs;
+			std::vector<int> attackerTeams;
+		} unitDamagedColumns;
+
+		struct ProjectileCreatedColumns {
+			void Clear() { proIDs.clear(); proOwnerIDs.clear(); weaponDefIDs.clear(); }
+
+			std::vector<int> proIDs;
+			std::vector<int> proOwnerIDs;
+			std::vector<int> weaponDefIDs;
+		} projectileCreatedColumns;
+
 	private: // call-outs
 		static int KillActiveHandle(lua_State* L);
 		static int CallOutGetName(lua_State* L);
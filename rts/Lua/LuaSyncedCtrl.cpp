@@ -2745,6 +2745,7 @@ int LuaSyncedCtrl::SetUnitLosMask(lua_State* L)
 	const unsigned char state = (newMask << LOS_MASK_SHIFT) | (losStatus & 0x0F);
 
 	unit->losStatus[allyTeam] = state;
+	unit->losStatusDirty = true;
 	unit->SetLosStatus(allyTeam, unit->CalcLosStatus(allyTeam));
 
 	return 0;
@@ -2790,6 +2791,7 @@ int LuaSyncedCtrl::SetUnitLosState(lua_State* L)
 	const unsigned char  oldState = losStatus & 0x0F;
 	const unsigned char  newState = ParseLosBits(L, 3, oldState);
 
+	unit->losStatusDirty = true;
 	unit->SetLosStatus(allyTeam, (losStatus & 0xF0) | newState);
 	return 0;
 }
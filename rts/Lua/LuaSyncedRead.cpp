@@ -77,6 +77,7 @@
 #include "System/FileSystem/FileSystem.h"
 #include "System/StringUtil.h"
 
+#include <array>
 #include <cctype>
 #include <type_traits>
 
@@ -187,6 +188,9 @@ bool LuaSyncedRead::PushEntries(lua_State* L)
 
 	REGISTER_LUA_CFUNC(GetUnitArrayCentroid);
 	REGISTER_LUA_CFUNC(GetUnitMapCentroid);
+	REGISTER_LUA_CFUNC(GetUnitArrayPositions);
+	REGISTER_LUA_CFUNC(GetUnitArrayVelocities);
+	REGISTER_LUA_CFUNC(GetUnitArrayHealths);
 
 	REGISTER_LUA_CFUNC(GetFeaturesInRectangle);
 	REGISTER_LUA_CFUNC(GetFeaturesInSphere);
@@ -3432,6 +3436,175 @@ int LuaSyncedRead::GetUnitMapCentroid(lua_State* L)
 }
 
 
+// shared by the GetUnitArray* getters: reads the unitIDs from the array at index 1 and
+// writes <stride> values per unit into the array at index 2 (created if not a table),
+// lined up with the input; units that are invalid or filtered out by <parseUnit> get nils
+template<size_t MaxStride, typename ParseFunc, typename FillFunc>
+static int FillUnitArrayTable(lua_State* L, const char* caller, int stride, ParseFunc parseUnit, FillFunc fillValues)
+{
+	luaL_checktype(L, 1, LUA_TTABLE);
+
+	const int numUnitIDs = lua_objlen(L, 1);
+
+	lua_settop(L, 2);
+
+	if (!lua_istable(L, 2)) {
+		lua_pop(L, 1);
+		lua_createtable(L, numUnitIDs * stride, 0);
+	}
+
+	std::array<float, MaxStride> values;
+	int numUnits = 0;
+
+	for (int i = 0; i < numUnitIDs; i++) {
+		lua_rawgeti(L, 1, i + 1);
+
+		if (!lua_isnumber(L, 3))
+			luaL_error(L, "[%s] unitIDs[%d] not a number\n", caller, i + 1);
+
+		const CUnit* unit = parseUnit(L, caller, 3);
+		lua_pop(L, 1);
+
+		// bit j set means field j is written as nil
+		uint32_t nilMask = ~0u;
+
+		if (unit != nullptr) {
+			nilMask = fillValues(unit, values);
+			numUnits += 1;
+		}
+
+		for (int j = 0; j < stride; j++) {
+			if ((nilMask & (1u << j)) != 0) {
+				lua_pushnil(L);
+			} else {
+				lua_pushnumber(L, values[j]);
+			}
+
+			lua_rawseti(L, 2, i * stride + j + 1);
+		}
+	}
+
+	lua_pushnumber(L, numUnits);
+	return 2;
+}
+
+static uint32_t GetUnitHealthValues(lua_State* L, const CUnit* unit, float* values)
+{
+	const UnitDef* ud = unit->unitDef;
+	const bool enemyUnit = LuaUtils::IsEnemyUnit(L, unit);
+
+	float scale = 1.0f;
+	uint32_t nilMask = 0;
+
+	if (ud->hideDamage && enemyUnit) {
+		nilMask = 1 | 2 | 4;
+	} else if (enemyUnit && (ud->decoyDef != nullptr)) {
+		scale = (ud->decoyDef->health / ud->health);
+	}
+
+	values[0] = scale * unit->health;
+	values[1] = scale * unit->maxHealth;
+	values[2] = scale * unit->paralyzeDamage;
+	values[3] = unit->captureProgress;
+	values[4] = unit->buildProgress;
+	return nilMask;
+}
+
+
+/*** Bulk version of `Spring.GetUnitPosition`
+ *
+ * Writes the positions of all units in `unitIDs` into `positions`, 3 numbers per unit
+ * (6 with `midPos` or `aimPos`, 9 with both) in the same order as `GetUnitPosition`
+ * returns them. Entries for units that do not exist or are not visible are set to nil,
+ * so the array lines up with `unitIDs` and can be reused across calls.
+ *
+ * @function Spring.GetUnitArrayPositions
+ * @param unitIDs integer[]
+ * @param positions number[]? table to fill, a new one is created if omitted
+ * @param midPos boolean? (Default: `false`) include midpoints
+ * @param aimPos boolean? (Default: `false`) include aimpoints
+ * @return number[] positions
+ * @return integer numUnits number of units that were written
+ */
+int LuaSyncedRead::GetUnitArrayPositions(lua_State* L)
+{
+	const bool returnMidPos = luaL_optboolean(L, 3, false);
+	const bool returnAimPos = luaL_optboolean(L, 4, false);
+
+	const int readAllyTeam = CLuaHandle::GetHandleReadAllyTeam(L);
+	const bool fullRead = CLuaHandle::GetHandleFullRead(L);
+
+	const auto FillPosition = [&](const CUnit* unit, std::array<float, 9>& values) {
+		float3 errorVec;
+
+		if (!LuaUtils::IsAllyUnit(L, unit))
+			errorVec = unit->GetLuaErrorVector(readAllyTeam, fullRead);
+
+		int n = 0;
+
+		const auto AddPos = [&](const float3& pos) {
+			values[n++] = pos.x + errorVec.x;
+			values[n++] = pos.y + errorVec.y;
+			values[n++] = pos.z + errorVec.z;
+		};
+
+		AddPos(unit->pos);
+
+		if (returnMidPos)
+			AddPos(unit->midPos);
+		if (returnAimPos)
+			AddPos(unit->aimPos);
+
+		return 0u;
+	};
+
+	return (FillUnitArrayTable<9>(L, __func__, 3 + (3 * returnMidPos) + (3 * returnAimPos), ParseUnit, FillPosition));
+}
+
+/*** Bulk version of `Spring.GetUnitVelocity`
+ *
+ * Writes 4 numbers (x, y, z, speed) per unit into `velocities`, lined up with `unitIDs`;
+ * entries for units that do not exist or are not in LOS are set to nil.
+ *
+ * @function Spring.GetUnitArrayVelocities
+ * @param unitIDs integer[]
+ * @param velocities number[]? table to fill, a new one is created if omitted
+ * @return number[] velocities
+ * @return integer numUnits number of units that were written
+ */
+int LuaSyncedRead::GetUnitArrayVelocities(lua_State* L)
+{
+	const auto FillVelocity = [](const CUnit* unit, std::array<float, 4>& values) {
+		values = {unit->speed.x, unit->speed.y, unit->speed.z, unit->speed.w};
+		return 0u;
+	};
+
+	return (FillUnitArrayTable<4>(L, __func__, 4, ParseInLosUnit, FillVelocity));
+}
+
+/*** Bulk version of `Spring.GetUnitHealth`
+ *
+ * Writes 5 numbers (health, maxHealth, paralyzeDamage, captureProgress, buildProgress)
+ * per unit into `healths`, lined up with `unitIDs`. Entries for units that do not exist
+ * or are not in LOS are set to nil, as are the hidden fields of enemy units that have
+ * `hideDamage` set.
+ *
+ * @function Spring.GetUnitArrayHealths
+ * @param unitIDs integer[]
+ * @param healths number[]? table to fill, a new one is created if omitted
+ * @return number[] healths
+ * @return integer numUnits number of units that were written
+ */
+int LuaSyncedRead::GetUnitArrayHealths(lua_State* L)
+{
+	const auto FillHealth = [&](const CUnit* unit, std::array<float, 5>& values) {
+		return (GetUnitHealthValues(L, unit, values.data()));
+	};
+
+	return (FillUnitArrayTable<5>(L, __func__, 5, ParseInLosUnit, FillHealth));
+}
+
+
 /***
  *
  * @function Spring.GetUnitNearestAlly
@@ -4174,25 +4347,17 @@ int LuaSyncedRead::GetUnitHealth(lua_State* L)
 	if (unit == nullptr)
 		return 0;
 
-	const UnitDef* ud = unit->unitDef;
-	const bool enemyUnit = LuaUtils::IsEnemyUnit(L, unit);
+	float values[5];
+	const uint32_t nilMask = GetUnitHealthValues(L, unit, values);
 
-	if (ud->hideDamage && enemyUnit) {
-		lua_pushnil(L);
-		lua_pushnil(L);
-		lua_pushnil(L);
-	} else if (!enemyUnit || (ud->decoyDef == nullptr)) {
-		lua_pushnumber(L, unit->health);
-		lua_pushnumber(L, unit->maxHealth);
-		lua_pushnumber(L, unit->paralyzeDamage);
-	} else {
-		const float scale = (ud->decoyDef->health / ud->health);
-		lua_pushnumber(L, scale * unit->health);
-		lua_pushnumber(L, scale * unit->maxHealth);
-		lua_pushnumber(L, scale * unit->paralyzeDamage);
+	for (int i = 0; i < 5; i++) {
+		if ((nilMask & (1u << i)) != 0) {
+			lua_pushnil(L);
+		} else {
+			lua_pushnumber(L, values[i]);
+		}
 	}
-	lua_pushnumber(L, unit->captureProgress);
-	lua_pushnumber(L, unit->buildProgress);
+
 	return 5;
 }
 
@@ -91,6 +91,9 @@ class LuaSyncedRead {
 
 		static int GetUnitArrayCentroid(lua_State* L);
 		static int GetUnitMapCentroid(lua_State* L);
+		static int GetUnitArrayPositions(lua_State* L);
+		static int GetUnitArrayVelocities(lua_State* L);
+		static int GetUnitArrayHealths(lua_State* L);
 
 		static int GetUnitNearestAlly(lua_State* L);
 		static int GetUnitNearestEnemy(lua_State* L);
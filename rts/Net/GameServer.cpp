@@ -4,6 +4,7 @@
 #include "System/Net/UDPConnection.h"
 
 #include <functional>
+#include <limits>
 
 #if defined DEDICATED || defined DEBUG
 	#include <iostream>
@@ -57,6 +58,10 @@
 #include "System/Platform/Threading.h"
 #include "System/Threading/SpringThreading.h"
 
+#ifdef SYNCCHECK
+#include "System/Sync/SyncChecker.h"
+#endif
+
 #ifndef DEDICATED
 #include "lib/luasocket/src/restrictions.h"
 #endif
@@ -110,6 +115,25 @@ static constexpr unsigned gameProgressFrameInterval = GAME_SPEED * 5;
 
 static constexpr unsigned syncResponseEchoInterval = GAME_SPEED * 2;
 
+/// demo packets that still have to reach a client resuming from a keyframe
+/// past them; they change player state, which keyframes do not contain
+static bool IsDemoParticipantPacket(const RawPacket* pkt)
+{
+	switch (pkt->data[0]) {
+		case NETMSG_PLAYERNAME:
+		case NETMSG_PLAYERLEFT:
+		case NETMSG_PLAYERSTAT:
+		case NETMSG_CHAT:
+			return true;
+		case NETMSG_TEAM:
+			return (pkt->length > 2 && pkt->data[2] == TEAMMSG_RESIGN);
+		default:
+			break;
+	}
+
+	return false;
+}
+
 
 //FIXME remodularize server commands, so they get registered in word completion etc.
 decltype(CGameServer::commandBlacklist) CGameServer::commandBlacklist{
@@ -283,6 +307,12 @@ void CGameServer::Initialize()
 void CGameServer::PostLoad(int newServerFrameNum)
 {
 	std::lock_guard<spring::recursive_mutex> scoped_lock(gameServerMutex);
+
+	// a demo keyframe was loaded; frames are counted from the stream, which
+	// may already have been read past it while the client was loading
+	if (demoReader != nullptr)
+		return;
+
 	serverFrameNum = newServerFrameNum;
 
 	gameHasStarted = !PreSimFrame();
@@ -294,6 +324,14 @@ void CGameServer::PostLoad(int newServerFrameNum)
 }
 
 
+void CGameServer::SetDemoResumeFrame(int frameNum)
+{
+	std::lock_guard<spring::recursive_mutex> scoped_lock(gameServerMutex);
+	assert(demoReader != nullptr && PreSimFrame());
+	demoResumeFrame = frameNum;
+}
+
+
 void CGameServer::Reload(const std::shared_ptr<const CGameSetup> newGameSetup)
 {
 	const std::shared_ptr<const ClientSetup> clientSetup = gameServer->GetClientSetup();
@@ -457,8 +495,9 @@ bool CGameServer::SendDemoData(int targetFrameNum)
 	if (demoReader == nullptr)
 		return ret;
 
-	// get all packets from the stream up to <modGameTime>
-	while ((buf = demoReader->GetData(modGameTime))) {
+	// get all packets from the stream up to <modGameTime>, or everything up
+	// to the resume frame once the first frame is read and a keyframe is used
+	while ((buf = demoReader->GetData((demoResumeFrame > serverFrameNum && serverFrameNum >= 0)? std::numeric_limits<float>::max(): modGameTime))) {
 		std::shared_ptr<const RawPacket> rpkt(buf);
 
 		if (buf->length <= 0) {
@@ -467,6 +506,41 @@ bool CGameServer::SendDemoData(int targetFrameNum)
 		}
 
 		const unsigned msgCode = buf->data[0];
+		// packets before the first frame are sent as usual
+		const bool isFrame = (msgCode == NETMSG_NEWFRAME || msgCode == NETMSG_KEYFRAME);
+		const bool catchingUp = (demoResumeFrame > serverFrameNum && (serverFrameNum >= 0 || isFrame));
+
+		if (catchingUp) {
+			// the local client starts out from a keyframe which already holds the
+			// simulation up to it, so only what happened outside the simulation is
+			// sent; the server's own player bookkeeping below still runs
+			switch (msgCode) {
+				case NETMSG_NEWFRAME:
+				case NETMSG_KEYFRAME: {
+					if ((++serverFrameNum) < demoResumeFrame)
+						continue;
+
+					demoResumeFrame = -1;
+					demoReader->ResetReadTime(modGameTime);
+
+					// same as PostLoad, the local client is not behind
+					for (GameParticipant& p: players) {
+						p.lastFrameResponse = serverFrameNum;
+					}
+					continue;
+				}
+				case NETMSG_CREATE_NEWPLAYER:
+				case NETMSG_CCOMMAND: {
+					break;
+				}
+				default: {
+					if (IsDemoParticipantPacket(buf))
+						Broadcast(rpkt);
+
+					continue;
+				}
+			}
+		}
 
 		switch (msgCode) {
 			case NETMSG_NEWFRAME:
@@ -523,7 +597,9 @@ bool CGameServer::SendDemoData(int targetFrameNum)
 					Message(spring::format("Warning: Discarding invalid command message packet in demo: %s", ex.what()));
 					continue;
 				}
-				Broadcast(rpkt);
+				// the keyframe already has the effects of earlier commands
+				if (!catchingUp)
+					Broadcast(rpkt);
 				break;
 			}
 			default: {
@@ -547,6 +623,28 @@ bool CGameServer::SendDemoData(int targetFrameNum)
 	return ret;
 }
 
+void CGameServer::SendFastReplayData()
+{
+	// instead of advancing <modGameTime> by wall-clock time (see Update)
+	// keep moving it just past the next chunk, with the local client at
+	// most <GAME_SPEED> frames behind so the packets do not all pile up
+	// in its queue at once
+	while (demoReader != nullptr && HasLocalClient()) {
+		if ((serverFrameNum - players[localClientNumber].lastFrameResponse) >= GAME_SPEED)
+			return;
+
+		modGameTime = demoReader->GetNextDemoReadTime() + 0.001f;
+
+		SendDemoData(-1);
+
+		gameTime = GetDemoTime();
+	}
+
+	// nothing left to replay, the quit message tells the client to finish up
+	if (demoReader == nullptr)
+		quitServer = true;
+}
+
 void CGameServer::Broadcast(std::shared_ptr<const netcode::RawPacket> packet)
 {
 	for (GameParticipant& p: players) {
@@ -731,6 +829,14 @@ void CGameServer::CheckSync()
 				Broadcast(CBaseNetProtocol::Get().SendSdCheckrequest(serverFrameNum));
 			#endif
 
+				// ask everyone for their per-subsystem checksums of this frame,
+				// which is enough to tell where it diverged without a dump
+				syncTreeFrame = outstandingSyncFrame;
+				syncTreeChecksum = correctChecksum;
+				syncTreeReference.clear();
+				syncTreesPending.clear();
+				Broadcast(CBaseNetProtocol::Get().SendSyncTreeRequest(syncTreeFrame));
+
 				if (!desyncHasOccurred) {
 					if (globalConfig.dumpGameStateOnDesync) {
 						LOG("Desync detected. Requesting all clients to collect game state information.");
@@ -786,6 +892,36 @@ void CGameServer::CheckSync()
 #endif
 }
 
+void CGameServer::ReportSyncTree(int playerNum, const std::vector<uint32_t>& tree)
+{
+#ifdef SYNCCHECK
+	std::string subsystems;
+	std::string firstSubsystem;
+
+	// subsystems are numbered in the order SimFrame runs them
+	for (size_t i = 1; i < tree.size(); ++i) {
+		if (tree[i] == syncTreeReference[i])
+			continue;
+
+		const char* name = GetSyncSubsystemName(i - 1);
+
+		if (firstSubsystem.empty())
+			firstSubsystem = name;
+		else
+			subsystems += ", ";
+
+		subsystems += name;
+	}
+
+	if (firstSubsystem.empty()) {
+		Message(spring::format(SyncTreeUnscoped, players[playerNum].name.c_str(), syncTreeFrame));
+		return;
+	}
+
+	Message(spring::format(SyncTreeError, players[playerNum].name.c_str(), syncTreeFrame, firstSubsystem.c_str(), subsystems.c_str()));
+#endif
+}
+
 
 float CGameServer::GetDemoTime() const {
 	if (!gameHasStarted) return gameTime;
@@ -1844,6 +1980,51 @@ void CGameServer::ProcessPacket(const unsigned playerNum, std::shared_ptr<const
 			Broadcast(packet);
 			break;
 #endif
+		case NETMSG_SYNCTREE: {
+#ifdef SYNCCHECK
+			try {
+				netcode::UnpackPacket pckt(packet, 3);
+
+				uint8_t playerNum; pckt >> playerNum;
+				int32_t  frameNum; pckt >> frameNum;
+
+				if (playerNum != a) {
+					Message(spring::format(WrongPlayer, msgCode, a, (unsigned)playerNum));
+					break;
+				}
+
+				std::vector<uint32_t> tree(SyncChecksumTree().size());
+				pckt >> tree;
+
+				// late answer to an earlier request
+				if (frameNum != syncTreeFrame)
+					break;
+
+				if (tree[0] != syncTreeChecksum) {
+					if (syncTreeReference.empty()) {
+						syncTreesPending[a] = std::move(tree);
+					} else {
+						ReportSyncTree(a, tree);
+					}
+					break;
+				}
+
+				if (!syncTreeReference.empty())
+					break;
+
+				syncTreeReference = std::move(tree);
+
+				for (const auto& p: syncTreesPending) {
+					ReportSyncTree(p.first, p.second);
+				}
+
+				syncTreesPending.clear();
+			} catch (const netcode::UnpackPacketException& ex) {
+				Message(spring::format("Player %s sent invalid SyncTree: %s", players[a].name.c_str(), ex.what()));
+			}
+#endif
+		} break;
+
 		case NETMSG_GAMESTATE_DUMP:
 			LOG("Server broadcast game state collection request.");
 			Broadcast(packet);
@@ -2575,11 +2756,21 @@ bool CGameServer::HasFinished() const
 	return quitServer;
 }
 
+bool CGameServer::IsFastReplay() const
+{
+	return (myGameSetup->hostDemo && !myClientSetup->replayStatsFile.empty());
+}
+
 void CGameServer::CreateNewFrame(bool fromServerThread, bool fixedFrameTime)
 {
 	if (demoReader != nullptr) {
 		CheckSync();
-		SendDemoData(-1);
+
+		if (IsFastReplay()) {
+			SendFastReplayData();
+		} else {
+			SendDemoData(-1);
+		}
 		return;
 	}
 
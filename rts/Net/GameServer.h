@@ -86,6 +86,11 @@ public:
 	 * WARNING! No checks are done, so be careful
 	 */
 	void PostLoad(int serverFrameNum);
+	/**
+	 * @brief Continue demo playback behind a keyframe the local client loaded
+	 * Takes effect when the stream reaches its first frame.
+	 */
+	void SetDemoResumeFrame(int frameNum);
 
 	void CreateNewFrame(bool fromServerThread, bool fixedFrameTime);
 
@@ -96,6 +101,8 @@ public:
 	bool HasStarted() const { return gameHasStarted; }
 	bool HasGameID() const { return generatedGameID; }
 	bool HasLocalClient() const { return (localClientNumber != -1u); }
+	/// Are we replaying a demo as fast as the local client can simulate it?
+	bool IsFastReplay() const;
 	/// Is the server still running?
 	bool HasFinished() const;
 
@@ -161,6 +168,7 @@ private:
 	void Update();
 	void ProcessPacket(const unsigned playerNum, std::shared_ptr<const netcode::RawPacket> packet);
 	void CheckSync();
+	void ReportSyncTree(int playerNum, const std::vector<uint32_t>& tree);
 	void HandleConnectionAttempts();
 	void ServerReadNet();
 
@@ -172,6 +180,8 @@ private:
 	void WriteDemoData();
 	/// read data from demo and send it to clients
 	bool SendDemoData(int targetFrameNum);
+	/// read data from demo for as long as the local client keeps up with it
+	void SendFastReplayData();
 
 	void Broadcast(std::shared_ptr<const netcode::RawPacket> packet);
 
@@ -226,6 +236,16 @@ private:
 	/////////////////// sync stuff ///////////////////
 #ifdef SYNCCHECK
 	std::set<int> outstandingSyncFrames;
+
+	/// desync frame whose per-subsystem checksums are being collected, -1 if none
+	int syncTreeFrame = -1;
+	/// root checksum that was considered correct for syncTreeFrame
+	unsigned syncTreeChecksum = 0;
+
+	/// tree of a client that had the correct checksum
+	std::vector<uint32_t> syncTreeReference;
+	/// trees of desynced clients that arrived before any reference tree
+	std::map<int, std::vector<uint32_t>> syncTreesPending;
 #endif
 
 	/////////////////// game status variables ///////////////////
@@ -252,6 +272,7 @@ private:
 
 
 	int serverFrameNum = -1;
+	int demoResumeFrame = -1;
 
 	int syncErrorFrame = 0;
 	int syncWarningFrame = 0;
@@ -8,6 +8,7 @@
 #include "ExternalAI/EngineOutHandler.h"
 #include "ExternalAI/SkirmishAIHandler.h"
 #include "Game/ClientData.h"
+#include "Game/ReplayStatsWriter.h"
 #include "Game/CommandMessage.h"
 #include "Game/GameSetup.h"
 #include "Game/GlobalUnsynced.h"
@@ -31,6 +32,7 @@
 #include "System/EventHandler.h"
 #include "System/GlobalConfig.h"
 #include "System/Log/ILog.h"
+#include "System/SpringExitCode.h"
 #include "System/SpringMath.h"
 #include "System/TimeProfiler.h"
 #include "System/LoadSave/DemoRecorder.h"
@@ -235,6 +237,9 @@ void CGame::UpdateNetMessageProcessingTimeLeft()
 		}
 
 		lastReadNetTime = currentReadNetTime;
+	} else if (replayStats != nullptr) {
+		// nothing to draw, eat through whatever the server has queued up
+		msgProcTimeLeft = GAME_SPEED * 1000.0f;
 	} else {
 		// ensure ClientReadNet returns at least every 15 simframes
 		// so CGame can process keyboard input, and render etc.
@@ -325,7 +330,17 @@ void CGame::ClientReadNet()
 
 					LOG("%s", message.c_str());
 
+					// writes the gameover record of replays that did not end with one
 					GameEnd({});
+
+					if (replayStats != nullptr) {
+						// the server quits as soon as a fast replay reaches the end of the demo
+						if (!replayStats->Finish())
+							spring::exitCode = spring::EXIT_CODE_FAILURE;
+
+						gu->globalQuit = true;
+					}
+
 					AddTraffic(-1, packetCode, dataLength);
 					clientNet->Close(true);
 				} catch (const netcode::UnpackPacketException& ex) {
@@ -617,20 +632,33 @@ void CGame::ClientReadNet()
 
 				SimFrame();
 
+				// nothing may run between SimFrame and taking the checksum (tree),
+				// anything that is not part of the simulation goes further below
 #ifdef SYNCCHECK
 				// both NETMSG_SYNCRESPONSE and NETMSG_NEWFRAME are used for ping calculation by server
 				ASSERT_SYNCED(gs->frameNum);
 				ASSERT_SYNCED(CSyncChecker::GetChecksum());
 				clientNet->Send(CBaseNetProtocol::Get().SendSyncResponse(gu->myPlayerNum, gs->frameNum, CSyncChecker::GetChecksum()));
+				// kept around in case the server asks for it to narrow down a desync
+				CSyncChecker::SaveChecksumTree(gs->frameNum);
 
 				// buffer all checksums, so we can check sync later between demo & local
 				if (haveServerDemo)
 					localSyncChecksums[gs->frameNum] = CSyncChecker::GetChecksum();
 
+				if (replayStats != nullptr)
+					replayStats->WriteFrame(gs->frameNum, CSyncChecker::GetChecksum());
+
 				// reset checksum every 4096 frames =~ 2.5 minutes
 				if ((gs->frameNum & 4095) == 0)
 					CSyncChecker::NewFrame();
+#else
+				if (replayStats != nullptr)
+					replayStats->WriteFrame(gs->frameNum, 0);
 #endif
+
+				SaveDemoKeyFrame();
+
 				AddTraffic(-1, packetCode, dataLength);
 			} break;
 
@@ -665,6 +693,9 @@ void CGame::ClientReadNet()
 					const char* fmtStr = "[DESYNC WARNING] checksum %x from demo %s %d (%s) does not match our checksum %x for frame-number %d";
 
 					LOG_L(L_ERROR, fmtStr, checkSum, pType, playerNum, pName, ourCheckSum, frameNum);
+
+					if (replayStats != nullptr)
+						replayStats->WriteDesync(frameNum, playerNum, checkSum, ourCheckSum);
 				}
 #endif
 			} break;
@@ -1573,6 +1604,22 @@ void CGame::ClientReadNet()
 			case NETMSG_GAME_FRAME_PROGRESS: {
 			} break;
 
+			case NETMSG_SYNCTREE_REQUEST: {
+				ZoneScopedN("Net::SyncTreeRequest");
+#ifdef SYNCCHECK
+				const int32_t frameNum = *reinterpret_cast<const int32_t*>(inbuf + 1);
+
+				SyncChecksumTree tree;
+
+				if (CSyncChecker::GetChecksumTree(frameNum, tree)) {
+					clientNet->Send(CBaseNetProtocol::Get().SendSyncTree(gu->myPlayerNum, frameNum, {tree.begin(), tree.end()}));
+				} else {
+					LOG_L(L_WARNING, "[Game::%s] no sync checksum tree for frame %d (current frame %d)", __func__, frameNum, gs->frameNum);
+				}
+#endif
+				AddTraffic(-1, packetCode, dataLength);
+			} break;
+
 			case NETMSG_GAMESTATE_DUMP: {
 				ZoneScopedN("Net::GamestateDump");
 				LOG("Collecting current game state information.");
@@ -612,6 +612,24 @@ PacketType CBaseNetProtocol::SendGameStateDump(uint32_t frameNum)
 	return PacketType(packet);
 }
 
+PacketType CBaseNetProtocol::SendSyncTreeRequest(int32_t frameNum)
+{
+	PackPacket* packet = new PackPacket(sizeof(uint8_t) + sizeof(frameNum), NETMSG_SYNCTREE_REQUEST);
+	*packet << frameNum;
+	return PacketType(packet);
+}
+
+PacketType CBaseNetProtocol::SendSyncTree(uint8_t playerNum, int32_t frameNum, const std::vector<uint32_t>& checksums)
+{
+	const uint32_t payloadSize = sizeof(playerNum) + sizeof(frameNum) + (checksums.size() * sizeof(uint32_t));
+	const uint32_t headerSize = sizeof(uint8_t) + sizeof(uint16_t);
+	const uint32_t packetSize = headerSize + payloadSize;
+
+	PackPacket* packet = new PackPacket(packetSize, NETMSG_SYNCTREE);
+	*packet << static_cast<uint16_t>(packetSize) << playerNum << frameNum << checksums;
+	return PacketType(packet);
+}
+
 CBaseNetProtocol::CBaseNetProtocol()
 {
 	netcode::ProtocolDef* proto = netcode::ProtocolDef::GetInstance();
@@ -682,5 +700,7 @@ CBaseNetProtocol::CBaseNetProtocol()
 #endif // SYNCDEBUG
 
 	proto->AddType(NETMSG_GAMESTATE_DUMP, 1 + sizeof(uint32_t));
+	proto->AddType(NETMSG_SYNCTREE_REQUEST, 1 + sizeof(int32_t));
+	proto->AddType(NETMSG_SYNCTREE, -2);
 }
 
@@ -119,6 +119,8 @@ public:
 #endif
 
 	PacketType SendGameStateDump(uint32_t frameNum);
+	PacketType SendSyncTreeRequest(int32_t frameNum);
+	PacketType SendSyncTree(uint8_t playerNum, int32_t frameNum, const std::vector<uint32_t>& checksums);
 
 private:
 	CBaseNetProtocol();
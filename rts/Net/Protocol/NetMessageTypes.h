@@ -68,6 +68,8 @@ enum NETMSG {
 #endif // SYNCDEBUG
 
 	NETMSG_GAMESTATE_DUMP	= 46, // no arguments
+	NETMSG_SYNCTREE_REQUEST = 47, // int32_t frameNum
+	NETMSG_SYNCTREE         = 48, // uint16_t messageSize, uint8_t playerNum, int32_t frameNum, std::vector<uint32_t> checksums (root, then per subsystem)
 
 	NETMSG_LOGMSG           = 49, // uint8_t playerNum, uint8_t logMsgLvl, std::string strData
 	NETMSG_LUAMSG           = 50, // /* uint16_t messageSize */, uint8_t playerNum, uint16_t script, uint8_t mode, std::vector<uint8_t> rawData
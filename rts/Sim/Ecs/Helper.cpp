@@ -14,6 +14,6 @@ void Sim::LoadComponents(std::stringstream &iss) {
     saveLoadUtils.LoadComponents(iss);
 }
 
-void Sim::SaveComponents(std::stringstream &oss) {
+void Sim::SaveComponents(std::ostream &oss) {
     saveLoadUtils.SaveComponents(oss);
 }
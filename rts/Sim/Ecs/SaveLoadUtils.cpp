@@ -72,7 +72,7 @@ void SaveLoadUtils::LoadComponents(std::stringstream &iss) {
     systemUtils.NotifyPostLoad();
 }
 
-void SaveLoadUtils::SaveComponents(std::stringstream &oss) {
+void SaveLoadUtils::SaveComponents(std::ostream &oss) {
     auto archive = cereal::BinaryOutputArchive{oss};
     LOG_L(L_DEBUG, "%s: Entities before save is %d (%d)", __func__, (int)registry.alive(), (int)oss.tellp());
     {ProcessComponents<entt::snapshot>(archive, entt::snapshot{registry});}
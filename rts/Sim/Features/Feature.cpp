@@ -608,6 +608,8 @@ bool CFeature::UpdatePosition()
 		// clamp final position
 		if (!pos.IsInBounds()) {
 			Move(pos.cClampInBounds(), false);
+			// quads are unaffected (GetQuads clamps as well), the cached footprint is not
+			quadField.MovedFeature(this);
 
 			// ensure that no more horizontal movement is done
 			CWorldObject::SetVelocity((speed * UpVector) * moveCtrl.velocityMask);
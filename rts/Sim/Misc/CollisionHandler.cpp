@@ -12,14 +12,14 @@
 
 #include "System/Misc/TracyDefs.h"
 
-unsigned int CCollisionHandler::numDiscTests = 0;
-unsigned int CCollisionHandler::numContTests = 0;
+std::atomic<unsigned int> CCollisionHandler::numDiscTests = {0};
+std::atomic<unsigned int> CCollisionHandler::numContTests = {0};
 
 
 
 void CCollisionHandler::PrintStats()
 {
-	LOG("[CCollisionHandler] dis-/continuous tests: %i/%i", numDiscTests, numContTests);
+	LOG("[CCollisionHandler] dis-/continuous tests: %u/%u", numDiscTests.load(), numContTests.load());
 }
 
 
@@ -143,7 +143,7 @@ bool CCollisionHandler::CollisionFootPrint(const CSolidObject* o, const float3&
 bool CCollisionHandler::Collision(const CollisionVolume* v, const CMatrix44f& m, const float3& p)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
-	numDiscTests += 1;
+	numDiscTests.fetch_add(1, std::memory_order_relaxed);
 
 	// get the inverse volume transformation matrix and
 	// apply it to the projectile's position, then test
@@ -357,7 +357,7 @@ inline bool CCollisionHandler::Intersect(
 bool CCollisionHandler::Intersect(const CollisionVolume* v, const CMatrix44f& m, const float3& p0, const float3& p1, CollisionQuery* q)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
-	numContTests += 1;
+	numContTests.fetch_add(1, std::memory_order_relaxed);
 
 	const CMatrix44f mInv = m.InvertAffine();
 	const float3 pi0 = mInv.Mul(p0);
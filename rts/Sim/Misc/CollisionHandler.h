@@ -8,6 +8,7 @@
 #include "System/Matrix44f.h"
 
 #include <algorithm>
+#include <atomic>
 
 class CSolidObject;
 struct LocalModelPiece;
@@ -168,8 +169,9 @@ class CCollisionHandler {
 		static bool IntersectBox(const CollisionVolume* v, const float3& pi0, const float3& pi1, CollisionQuery* cq);
 
 	private:
-		static unsigned int numDiscTests; // number of discrete hit-tests executed
-		static unsigned int numContTests; // number of continuous hit-tests executed (inc. unsynced)
+		// atomic since projectile collision candidates are searched in parallel
+		static std::atomic<unsigned int> numDiscTests; // number of discrete hit-tests executed
+		static std::atomic<unsigned int> numContTests; // number of continuous hit-tests executed (inc. unsynced)
 };
 
 #endif // COLLISION_HANDLER_H
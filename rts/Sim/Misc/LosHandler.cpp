@@ -33,6 +33,8 @@ CR_REG_METADATA(CLosHandler,(
 	CR_IGNORED(synced_),
 
 	CR_MEMBER(globalLOS),
+	CR_IGNORED(globalLOSEpochs),
+	CR_IGNORED(anyGlobalLOSEpoch),
 	CR_IGNORED(los),
 	CR_IGNORED(airLos),
 	CR_IGNORED(radar),
@@ -75,6 +77,8 @@ size_t ILosType::cacheFails = 1;
 size_t ILosType::cacheHits  = 1;
 size_t ILosType::cacheRefs  = 1;
 
+int ILosType::changeEpoch = 1;
+
 constexpr float CLosHandler::defBaseRadarErrorSize;
 constexpr float CLosHandler::defBaseRadarErrorMult;
 constexpr SLosInstance::RLE SLosInstance::EMPTY_RLE;
@@ -100,6 +104,14 @@ void ILosType::Init(const int mipLevel_, LosType type_)
 	for (CLosMap& losMap: losMaps) {
 		losMap.Init(size, int2(mapDims.mapx, mapDims.mapy), ctrHeightMap, mipHeightMap, type == LOS_TYPE_LOS);
 	}
+
+	numChangeBlocks.x = ((size.x - 1) >> CHANGE_BLOCK_SHIFT) + 1;
+	numChangeBlocks.y = ((size.y - 1) >> CHANGE_BLOCK_SHIFT) + 1;
+
+	anyBlockEpochs.clear();
+	anyBlockEpochs.resize(numChangeBlocks.x * numChangeBlocks.y, 0);
+	allyBlockEpochs.clear();
+	allyBlockEpochs.resize(numChangeBlocks.x * numChangeBlocks.y * losMaps.size(), 0);
 }
 
 void ILosType::Kill()
@@ -127,6 +139,15 @@ void ILosType::Kill()
 	losDeleted.clear();
 	losRecalc.clear();
 
+	allyLosChanges.clear();
+	bandEnteredSquares.clear();
+
+	anyBlockEpochs.clear();
+	allyBlockEpochs.clear();
+
+	numAppliedInstances = 0;
+	applyTimeMs = 0.0f;
+
 	// mark as invalid
 	size = {0, 0};
 }
@@ -304,6 +325,95 @@ inline void ILosType::LosRemove(SLosInstance* li)
 }
 
 
+void ILosType::ApplyLosChanges(const std::vector<SLosInstance*>& changes, int amount)
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	const spring_time t0 = spring_gettime();
+	const int numBands = ThreadPool::GetNumThreads();
+
+	numAppliedInstances += changes.size();
+
+	for (const SLosInstance* li: changes) {
+		MarkChangedBlocks(li);
+	}
+
+	if (changes.size() < MT_APPLY_MIN_INSTANCES || numBands <= 1) {
+		for (SLosInstance* li: changes) {
+			assert(amount < 0 || li->refCount > 0);
+			(amount > 0)? LosAdd(li): LosRemove(li);
+		}
+
+		applyTimeMs += (spring_gettime() - t0).toMilliSecsf();
+		return;
+	}
+
+	// every map square is written by exactly one task (one allyteam map,
+	// one band of rows) in the original per-map instance order, so counts
+	// and LOS-enter events come out the same as when applied serially
+	allyLosChanges.resize(losMaps.size());
+	bandEnteredSquares.resize(losMaps.size() * numBands);
+
+	for (auto& v: allyLosChanges) {
+		v.clear();
+	}
+	for (SLosInstance* li: changes) {
+		assert(teamHandler.IsValidAllyTeam(li->allyteam));
+		allyLosChanges[li->allyteam].push_back(li);
+	}
+
+	const int bandRows = (size.y + numBands - 1) / numBands;
+
+	for_mt(0, losMaps.size() * numBands, [&](const int taskIdx) {
+		const int allyTeam = taskIdx / numBands;
+		const int y0 = std::min(size.y, (taskIdx % numBands) * bandRows);
+		const int y1 = std::min(size.y, y0 + bandRows);
+
+		CLosMap& losMap = losMaps[allyTeam];
+		std::vector<int>& enteredSquares = bandEnteredSquares[taskIdx];
+
+		enteredSquares.clear();
+
+		for (const SLosInstance* li: allyLosChanges[allyTeam]) {
+			if (algoType == LOS_ALGO_RAYCAST) {
+				losMap.AddRaycast(li, amount, y0, y1, &enteredSquares);
+			} else {
+				losMap.AddCircle(li, amount, y0, y1);
+			}
+		}
+	});
+
+	// ReadMap is not thread-safe, inform it from here
+	for (size_t taskIdx = 0; taskIdx < bandEnteredSquares.size(); ++taskIdx) {
+		for (const int idx: bandEnteredSquares[taskIdx]) {
+			losMaps[taskIdx / numBands].SquareEnteredLos(idx);
+		}
+
+		bandEnteredSquares[taskIdx].clear();
+	}
+
+	applyTimeMs += (spring_gettime() - t0).toMilliSecsf();
+}
+
+
+void ILosType::MarkChangedBlocks(const SLosInstance* li)
+{
+	// both raycast and circle instances stay within basePos +- radius
+	const int bx0 = std::clamp(li->basePos.x - li->radius, 0, size.x - 1) >> CHANGE_BLOCK_SHIFT;
+	const int bx1 = std::clamp(li->basePos.x + li->radius, 0, size.x - 1) >> CHANGE_BLOCK_SHIFT;
+	const int by0 = std::clamp(li->basePos.y - li->radius, 0, size.y - 1) >> CHANGE_BLOCK_SHIFT;
+	const int by1 = std::clamp(li->basePos.y + li->radius, 0, size.y - 1) >> CHANGE_BLOCK_SHIFT;
+
+	int* allyEpochs = &allyBlockEpochs[li->allyteam * numChangeBlocks.x * numChangeBlocks.y];
+
+	for (int by = by0; by <= by1; ++by) {
+		for (int bx = bx0; bx <= bx1; ++bx) {
+			anyBlockEpochs[by * numChangeBlocks.x + bx] = changeEpoch;
+			allyEpochs[by * numChangeBlocks.x + bx] = changeEpoch;
+		}
+	}
+}
+
+
 inline void ILosType::RefInstance(SLosInstance* li)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
@@ -569,10 +679,7 @@ void ILosType::Update()
 	}
 
 	// remove sight
-	//FIXME multithread?
-	for (SLosInstance* li: losRemove) {
-		LosRemove(li);
-	}
+	ApplyLosChanges(losRemove, -1);
 
 	// raycast terrain
 	if (algoType == LOS_ALGO_RAYCAST)  {
@@ -585,10 +692,7 @@ void ILosType::Update()
 	}
 
 	// add sight
-	for (SLosInstance* li: losAdd) {
-		assert(li->refCount > 0);
-		LosAdd(li);
-	}
+	ApplyLosChanges(losAdd, 1);
 
 	// delete / move to cache unused instances
 	if (algoType == LOS_ALGO_RAYCAST) {
@@ -686,6 +790,8 @@ void CLosHandler::InitStatic()
 	ILosType::cacheHits  = 1;
 	ILosType::cacheRefs  = 1;
 
+	ILosType::changeEpoch = 1;
+
 	if (losHandler == nullptr)
 		losHandler = new (losHandlerMem) CLosHandler();
 
@@ -709,6 +815,8 @@ void CLosHandler::Init()
 {
 	RECOIL_DETAILED_TRACY_ZONE;
 	globalLOS.fill(false);
+	globalLOSEpochs.fill(0);
+	anyGlobalLOSEpoch = 0;
 
 	baseRadarErrorSize = defBaseRadarErrorSize;
 	baseRadarErrorMult = defBaseRadarErrorMult;
@@ -738,6 +846,16 @@ void CLosHandler::Init()
 void CLosHandler::Kill()
 {
 	RECOIL_DETAILED_TRACY_ZONE;
+	for (const ILosType* lt: losTypes) {
+		if (lt == nullptr || lt->numAppliedInstances == 0)
+			continue;
+
+		LOG("[LosHandler::%s] type=%d applied-instances=%u (%.3fms, %.1f/ms)",
+			__func__, int(lt->type), unsigned(lt->numAppliedInstances), lt->applyTimeMs,
+			lt->numAppliedInstances / std::max(lt->applyTimeMs, 0.001f)
+		);
+	}
+
 	los.Kill();
 	airLos.Kill();
 	radar.Kill();
@@ -773,6 +891,8 @@ void CLosHandler::SetGlobalLOS(const int allyTeamId, const bool newState)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
 	globalLOS[allyTeamId] = newState;
+	globalLOSEpochs[allyTeamId] = ILosType::changeEpoch;
+	anyGlobalLOSEpoch = ILosType::changeEpoch;
 
 	if (globalLOS[allyTeamId])
 		readMap->BecomeSpectator(); //update unsynced heightmap
@@ -971,6 +1091,51 @@ bool CLosHandler::InRadar(const CUnit* unit, int allyTeam) const
 }
 
 
+void CLosHandler::GetLosStatusInputs(const CUnit* unit, LosStatusInputs& inputs) const
+{
+	inputs[0]  = (unit->alwaysVisible   << 0);
+	inputs[0] |= (unit->isCloaked       << 1);
+	inputs[0] |= (unit->useAirLos       << 2);
+	inputs[0] |= (unit->IsInWater()     << 3);
+	inputs[0] |= (unit->IsUnderWater()  << 4);
+	inputs[0] |= (unit->stealth         << 5);
+	inputs[0] |= (unit->sonarStealth    << 6);
+	inputs[0] |= (unit->beingBuilt      << 7);
+	inputs[1]  = unit->allyteam;
+
+	inputs[2] = los.PosToSquareKey(unit->pos);
+	inputs[3] = los.PosToSquareKey(unit->pos + unit->speed);
+	inputs[4] = airLos.PosToSquareKey(unit->pos);
+	inputs[5] = airLos.PosToSquareKey(unit->pos + unit->speed);
+	inputs[6] = radar.PosToSquareKey(unit->pos);
+	inputs[7] = sonar.PosToSquareKey(unit->pos);
+	inputs[8] = jammer.PosToSquareKey(unit->pos);
+	inputs[9] = sonarJammer.PosToSquareKey(unit->pos);
+}
+
+
+bool CLosHandler::LosStatusChangedSince(const CUnit* unit, int allyTeam, int epoch) const
+{
+	const LosStatusInputs& inputs = unit->losStatusInputs;
+
+	// jammers are looked up for the unit's own allyteam (or the shared map)
+	const int jammerAlly = (allyTeam < 0)? -1: (modInfo.separateJammers? unit->allyteam: 0);
+
+	if (((allyTeam < 0)? anyGlobalLOSEpoch: globalLOSEpochs[allyTeam]) >= epoch)
+		return true;
+
+	return
+		los.SquareChangedSince(inputs[2], allyTeam, epoch) ||
+		los.SquareChangedSince(inputs[3], allyTeam, epoch) ||
+		airLos.SquareChangedSince(inputs[4], allyTeam, epoch) ||
+		airLos.SquareChangedSince(inputs[5], allyTeam, epoch) ||
+		radar.SquareChangedSince(inputs[6], allyTeam, epoch) ||
+		sonar.SquareChangedSince(inputs[7], allyTeam, epoch) ||
+		jammer.SquareChangedSince(inputs[8], jammerAlly, epoch) ||
+		sonarJammer.SquareChangedSince(inputs[9], jammerAlly, epoch);
+}
+
+
 bool CLosHandler::InJammer(const float3 pos, int allyTeam) const
 {
 	RECOIL_DETAILED_TRACY_ZONE;
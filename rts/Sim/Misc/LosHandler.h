@@ -111,6 +111,28 @@ public:
 		return (losMaps[allyTeam].At(PosToSquare(pos)) != 0);
 	}
 
+	/// the (clamped) square InSight would look at for pos, packed as (y << 16) | x
+	int PosToSquareKey(const float3 pos) const {
+		const int2 p = PosToSquare(pos);
+		return (std::clamp(p.y, 0, size.y - 1) << 16) | std::clamp(p.x, 0, size.x - 1);
+	}
+
+	/**
+	 * @brief whether the counts around a square might have changed since epoch
+	 * @param squareKey as returned by PosToSquareKey
+	 * @param allyTeam map to check, or -1 for any allyteam
+	 */
+	bool SquareChangedSince(int squareKey, int allyTeam, int epoch) const {
+		const int bx = (squareKey & 0xFFFF) >> CHANGE_BLOCK_SHIFT;
+		const int by = (squareKey >>    16) >> CHANGE_BLOCK_SHIFT;
+		const int bi = by * numChangeBlocks.x + bx;
+
+		if (allyTeam < 0)
+			return (anyBlockEpochs[bi] >= epoch);
+
+		return (allyBlockEpochs[allyTeam * numChangeBlocks.x * numChangeBlocks.y + bi] >= epoch);
+	}
+
 public:
 	enum LosAlgoType { LOS_ALGO_RAYCAST, LOS_ALGO_CIRCLE };
 	enum LosType {
@@ -138,6 +160,8 @@ private:
 
 	void LosAdd(SLosInstance* instance);
 	void LosRemove(SLosInstance* instance);
+	void ApplyLosChanges(const std::vector<SLosInstance*>& changes, int amount);
+	void MarkChangedBlocks(const SLosInstance* instance);
 
 	void RefInstance(SLosInstance* instance);
 	void UnrefInstance(SLosInstance* instance);
@@ -170,6 +194,13 @@ public:
 	static size_t cacheHits;
 	static size_t cacheRefs;
 
+	// advanced by every CLosHandler::NextLosStatusEpoch, stamps map changes
+	static int changeEpoch;
+
+	// instances added to or removed from the maps, and the time it took
+	size_t numAppliedInstances = 0;
+	float applyTimeMs = 0.0f;
+
 	spring::unordered_map<int, std::vector<SLosInstance*> > instanceHashes;
 
 	std::vector<CLosMap> losMaps;
@@ -192,7 +223,21 @@ private:
 	std::vector<SLosInstance*> losDeleted;
 	std::vector<SLosInstance*> losRecalc;
 
+	// scratch for ApplyLosChanges: changes split up per allyteam map,
+	// squares entering LOS per (map, row-band) task
+	std::vector< std::vector<SLosInstance*> > allyLosChanges;
+	std::vector< std::vector<int> > bandEnteredSquares;
+
+	// changeEpoch of the last instance add or remove touching a block
+	// of squares, for any allyteam and per allyteam map respectively
+	std::vector<int> anyBlockEpochs;
+	std::vector<int> allyBlockEpochs;
+	int2 numChangeBlocks;
+
+	static constexpr int CHANGE_BLOCK_SHIFT = 3;
 	static constexpr int CACHE_SIZE = 4096;
+	// below this many instance changes per frame the maps are updated serially
+	static constexpr int MT_APPLY_MIN_INSTANCES = 64;
 };
 
 
@@ -263,6 +308,23 @@ public:
 		return seismic.InSight(unit->pos, allyTeam);
 	}
 
+public:
+	// everything CalcLosStatus depends on besides the map counts and globalLOS
+	static constexpr int NUM_LOS_STATUS_INPUTS = 10;
+	using LosStatusInputs = std::array<int, NUM_LOS_STATUS_INPUTS>;
+
+	void GetLosStatusInputs(const CUnit* unit, LosStatusInputs& inputs) const;
+
+	/**
+	 * @brief whether InLos or InRadar might give a different answer for
+	 *   unit than at the start of epoch, assuming unchanged inputs
+	 * @param allyTeam the observing allyteam, or -1 for any allyteam
+	 */
+	bool LosStatusChangedSince(const CUnit* unit, int allyTeam, int epoch) const;
+
+	/// begins a new epoch, returns the one in which changes were last recorded
+	int NextLosStatusEpoch() { return (ILosType::changeEpoch++); }
+
 public:
 	// default operations for targeting-facilities
 	void IncreaseAllyTeamRadarErrorSize(int allyTeam) { radarErrorSizes[allyTeam] *= baseRadarErrorMult; }
@@ -315,6 +377,9 @@ private:
 	*/
 
 	std::array<bool, MAX_TEAMS> globalLOS;
+	// changeEpoch of the last globalLOS change per allyteam, and of any
+	std::array<int, MAX_TEAMS> globalLOSEpochs;
+	int anyGlobalLOSEpoch = 0;
 private:
 	static constexpr float defBaseRadarErrorSize = 96.0f;
 	static constexpr float defBaseRadarErrorMult =  2.0f;
@@ -409,25 +409,27 @@ void CLosTableHelper::Debug(const LosTable& losRays, const std::vector<int2>& po
 //////////////////////////////////////////////////////////////////////
 /// CLosMap implementation
 
-void CLosMap::AddCircle(SLosInstance* instance, int amount)
+void CLosMap::AddCircle(const SLosInstance* instance, int amount, int y0, int y1)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
 	MidpointCircleAlgoPerLine(instance->radius, [&](int width, int y) {
-		const unsigned y_ = instance->basePos.y + y;
+		const int y_ = instance->basePos.y + y;
 
-		if (y_ < size.y) {
+		if (y_ >= y0 && y_ < y1) {
 			const unsigned sx = std::clamp(instance->basePos.x - width,     0, size.x);
 			const unsigned ex = std::clamp(instance->basePos.x + width + 1, 0, size.x);
 
+			unsigned short* row = &losmap[y_ * size.x];
+
 			for (unsigned x_ = sx; x_ < ex; ++x_) {
-				losmap[(y_ * size.x) + x_] += amount;
+				row[x_] += amount;
 			}
 		}
 	});
 }
 
 
-void CLosMap::AddRaycast(SLosInstance* instance, int amount)
+void CLosMap::AddRaycast(const SLosInstance* instance, int amount, int y0, int y1, std::vector<int>* enteredSquares)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
 	const auto& losSquares = instance->squares;
@@ -435,39 +437,61 @@ void CLosMap::AddRaycast(SLosInstance* instance, int amount)
 	if (losSquares.empty() || losSquares[0].length == SLosInstance::EMPTY_RLE.length)
 		return;
 
+	// RLE's are sorted by start index and never span multiple rows
+	const int idx0 = y0 * size.x;
+	const int idx1 = y1 * size.x;
+
+	const auto pred = [](const SLosInstance::RLE& rle, int idx) { return (rle.start < idx); };
+	const auto rleBeg = (y0 == 0)? losSquares.begin(): std::lower_bound(losSquares.begin(), losSquares.end(), idx0, pred);
+	const auto rleEnd = (y1 == size.y)? losSquares.end(): std::lower_bound(rleBeg, losSquares.end(), idx1, pred);
+
 	// inform ReadMap when squares enter LoS
 	const bool visibleInstanceSquares = (instance->allyteam >= 0 && (instance->allyteam == gu->myAllyTeam || gu->spectatingFullView));
 	const bool updateUnsyncedHeightMap = sendReadmapEvents && visibleInstanceSquares;
 
 	if ((amount > 0) && updateUnsyncedHeightMap) {
-		for (const SLosInstance::RLE rle: losSquares) {
-			for (int idx = rle.start, len = rle.length; len > 0; --len, ++idx) {
+		for (auto it = rleBeg; it != rleEnd; ++it) {
+			for (int idx = it->start, len = it->length; len > 0; --len, ++idx) {
 				losmap[idx] += amount;
 
 				// skip if this los-square did not *enter* LOS
 				if (losmap[idx] != amount)
 					continue;
 
-				const int2 lm = IdxToCoord(idx, size.x);
-				const int2 p1 = (lm             ) * LOS2HEIGHT;
-				const int2 p2 = (lm + int2(1, 1)) * LOS2HEIGHT;
-				const int2 p3 = {std::min(p2.x, mapDims.mapxm1), std::min(p2.y, mapDims.mapym1)};
-
-				readMap->UpdateLOS(SRectangle(p1.x, p1.y,  p3.x, p3.y));
+				if (enteredSquares != nullptr) {
+					enteredSquares->push_back(idx);
+				} else {
+					SquareEnteredLos(idx);
+				}
 			}
 		}
 
 		return;
 	}
 
-	for (const SLosInstance::RLE rle: losSquares) {
-		for (int idx = rle.start, len = rle.length; len > 0; --len, ++idx) {
-			losmap[idx] += amount;
+	// plain span adds, trivially vectorized
+	for (auto it = rleBeg; it != rleEnd; ++it) {
+		unsigned short* span = &losmap[it->start];
+
+		for (unsigned i = 0; i < it->length; ++i) {
+			span[i] += amount;
 		}
 	}
 }
 
 
+void CLosMap::SquareEnteredLos(int idx) const
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	const int2 lm = IdxToCoord(idx, size.x);
+	const int2 p1 = (lm             ) * LOS2HEIGHT;
+	const int2 p2 = (lm + int2(1, 1)) * LOS2HEIGHT;
+	const int2 p3 = {std::min(p2.x, mapDims.mapxm1), std::min(p2.y, mapDims.mapym1)};
+
+	readMap->UpdateLOS(SRectangle(p1.x, p1.y,  p3.x, p3.y));
+}
+
+
 void CLosMap::PrepareRaycast(SLosInstance* instance) const
 {
 	RECOIL_DETAILED_TRACY_ZONE;
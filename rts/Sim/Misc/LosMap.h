@@ -35,10 +35,22 @@ public:
 
 public:
 	/// circular area, for airLosMap, circular radar maps, jammer maps, ...
-	void AddCircle(SLosInstance* instance, int amount);
+	void AddCircle(const SLosInstance* instance, int amount) { AddCircle(instance, amount, 0, size.y); }
 
 	/// arbitrary area, for losMap, non-circular radar maps, ...
-	void AddRaycast(SLosInstance* instance, int amount);
+	void AddRaycast(const SLosInstance* instance, int amount) { AddRaycast(instance, amount, 0, size.y, nullptr); }
+
+	/**
+	 * Variants restricted to the rows [y0, y1) of the map, so disjoint row
+	 * bands can be written by different threads. Squares entering LOS are
+	 * appended to enteredSquares if given and should be passed on to
+	 * SquareEnteredLos by the caller, otherwise they are reported directly.
+	 */
+	void AddCircle(const SLosInstance* instance, int amount, int y0, int y1);
+	void AddRaycast(const SLosInstance* instance, int amount, int y0, int y1, std::vector<int>* enteredSquares);
+
+	/// informs ReadMap that a square was not in LOS before
+	void SquareEnteredLos(int idx) const;
 
 	/// arbitrary area, for losMap, non-circular radar maps, ...
 	void PrepareRaycast(SLosInstance* instance) const;
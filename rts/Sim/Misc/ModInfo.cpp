@@ -14,6 +14,7 @@
 
 #include "lib/fmt/format.h"
 
+#include <algorithm>
 #include <bit>
 
 CModInfo modInfo;
@@ -117,12 +118,22 @@ void CModInfo::ResetState()
 		pfRawMoveSpeedThreshold = 0.f;
 		qtMaxNodesSearched = 8192;
 		qtRefreshPathMinDist = 512.f;
+		qtAbstractSearchMinDist = 0.f;
+		qtFlowFieldMinRequests = 0;
 		qtMaxNodesSearchedRelativeToMapOpenNodes = 0.25;
 
 		enableSmoothMesh = true;
 		smoothMeshResDivider = 2;
 		smoothMeshSmoothRadius = 40;
 		quadFieldQuadSizeInElmos = 128;
+		unitUpdateMT = false;
+		weaponAutoTargetMT = false;
+		projectileCollisionMT = false;
+		explosionDamageMT = false;
+		weaponLineOfFireMT = false;
+		slowUpdateCostBalanced = false;
+		slowUpdateClassWeights = {{2, 3, 3, 8, 6}};
+		slowUpdateWeaponWeight = 1;
 
 		SLuaAllocLimit::MAX_ALLOC_BYTES = SLuaAllocLimit::MAX_ALLOC_BYTES_DEFAULT;
 
@@ -175,6 +186,8 @@ void CModInfo::Init(const std::string& modFileName)
 		pfRawMoveSpeedThreshold = system.GetFloat("pfRawMoveSpeedThreshold", pfRawMoveSpeedThreshold);
 		qtMaxNodesSearched = system.GetInt("qtMaxNodesSearched", qtMaxNodesSearched);
 		qtRefreshPathMinDist = system.GetFloat("qtRefreshPathMinDist", qtRefreshPathMinDist);
+		qtAbstractSearchMinDist = system.GetFloat("qtAbstractSearchMinDist", qtAbstractSearchMinDist);
+		qtFlowFieldMinRequests = system.GetInt("qtFlowFieldMinRequests", qtFlowFieldMinRequests);
 		qtMaxNodesSearchedRelativeToMapOpenNodes = system.GetFloat("qtMaxNodesSearchedRelativeToMapOpenNodes", qtMaxNodesSearchedRelativeToMapOpenNodes);
 
 		enableSmoothMesh = system.GetBool("enableSmoothMesh", enableSmoothMesh);
@@ -182,6 +195,23 @@ void CModInfo::Init(const std::string& modFileName)
 		smoothMeshSmoothRadius = system.GetInt("smoothMeshSmoothRadius", smoothMeshSmoothRadius);
 
 		quadFieldQuadSizeInElmos = system.GetInt("quadFieldQuadSizeInElmos", quadFieldQuadSizeInElmos);
+		unitUpdateMT = system.GetBool("unitUpdateMT", unitUpdateMT);
+		weaponAutoTargetMT = system.GetBool("weaponAutoTargetMT", weaponAutoTargetMT);
+		projectileCollisionMT = system.GetBool("projectileCollisionMT", projectileCollisionMT);
+		explosionDamageMT = system.GetBool("explosionDamageMT", explosionDamageMT);
+		weaponLineOfFireMT = system.GetBool("weaponLineOfFireMT", weaponLineOfFireMT);
+
+		slowUpdateCostBalanced = system.GetBool("slowUpdateCostBalanced", slowUpdateCostBalanced);
+		{
+			const LuaTable& weights = system.SubTable("slowUpdateCostWeights");
+
+			slowUpdateClassWeights[0] = std::max(1, weights.GetInt("command", slowUpdateClassWeights[0]));
+			slowUpdateClassWeights[1] = std::max(1, weights.GetInt("mobile" , slowUpdateClassWeights[1]));
+			slowUpdateClassWeights[2] = std::max(1, weights.GetInt("air"    , slowUpdateClassWeights[2]));
+			slowUpdateClassWeights[3] = std::max(1, weights.GetInt("builder", slowUpdateClassWeights[3]));
+			slowUpdateClassWeights[4] = std::max(1, weights.GetInt("factory", slowUpdateClassWeights[4]));
+			slowUpdateWeaponWeight    = std::max(0, weights.GetInt("weapon" , slowUpdateWeaponWeight   ));
+		}
 
 		// Specify in megabytes: 1 << 20 = (1024 * 1024)
 		SLuaAllocLimit::MAX_ALLOC_BYTES = static_cast<decltype(SLuaAllocLimit::MAX_ALLOC_BYTES)>(system.GetInt("LuaAllocLimit", SLuaAllocLimit::MAX_ALLOC_BYTES >> 20u)) << 20u;
@@ -360,6 +390,8 @@ void CModInfo::Init(const std::string& modFileName)
 	qtMaxNodesSearched                       = std::max  (qtMaxNodesSearched                      , 1024          );
 	qtMaxNodesSearchedRelativeToMapOpenNodes = std::max  (qtMaxNodesSearchedRelativeToMapOpenNodes,    0.0f       );
 	qtRefreshPathMinDist                     = std::max  (qtRefreshPathMinDist                    ,    0.0f       );
+	qtAbstractSearchMinDist                  = std::max  (qtAbstractSearchMinDist                 ,    0.0f       );
+	qtFlowFieldMinRequests                   = std::max  (qtFlowFieldMinRequests                  ,    0          );
 	quadFieldQuadSizeInElmos                 = std::clamp(quadFieldQuadSizeInElmos                ,    8    , 1024);
 	smoothMeshResDivider                     = std::max  (smoothMeshResDivider                    ,    1          );
 	smoothMeshSmoothRadius                   = std::max  (smoothMeshSmoothRadius                  ,    1          );
@@ -3,6 +3,7 @@
 #ifndef MOD_INFO_H
 #define MOD_INFO_H
 
+#include <array>
 #include <string>
 #include "Sim/Path/PFSTypes.h"
 
@@ -214,6 +215,18 @@ public:
 	/// would bring the unit nearer to the goal.
 	float qtRefreshPathMinDist;
 
+	/// Minimum straight-line distance, in elmos, between start and goal for a QTPFS search
+	/// to first plan over the layer's cluster graph and then only search the nodes in the
+	/// resulting corridor. Searches that cannot complete inside the corridor are repeated
+	/// without it. 0 disables the cluster graph entirely.
+	float qtAbstractSearchMinDist;
+
+	/// Minimum number of synced QTPFS searches queued in the same frame towards the same goal
+	/// node, for the same MoveDef path-type, before a flow-field is integrated from that goal.
+	/// Those and all later searches to the goal, until the field expires or the terrain
+	/// changes, follow the field instead of searching. 0 disables flow-fields.
+	int qtFlowFieldMinRequests;
+
 	float pfRawDistMult;
 	float pfUpdateRateScale;
 
@@ -230,6 +243,52 @@ public:
 
 	int quadFieldQuadSizeInElmos;
 
+	/// Run the unit-local bookkeeping of CUnit::Update in parallel: physical state
+	/// bits, position error, recentDamage decay, flanking, reload stalls, restTime
+	/// and the quad lookup of the collision-map update. Physical state events and
+	/// the collision-map writes are still done serially in activeUnits order, as
+	/// is everything else (builder/factory logic, move types, scripts). Lua
+	/// callins fired while committing one unit can then no longer change the
+	/// bookkeeping of another unit in the same frame, it is already done.
+	bool unitUpdateMT;
+
+	/// Generate auto-target candidates for all weapons retargeting in a SlowUpdate
+	/// slice in parallel, then assign targets serially in unit order. Weapons of
+	/// units later in the slice then pick targets after (instead of before) the
+	/// SlowUpdate of units earlier in the slice. The TargetWeight script and
+	/// AllowWeaponTarget Lua callins of a weapon also run only once all of its
+	/// candidates are gathered, rather than interleaved with gathering.
+	bool weaponAutoTargetMT;
+
+	/// Search the hit candidates of all synced projectiles in parallel before the
+	/// (serial, container-ordered) collision pass. Deterministic, but the hit
+	/// tests then see object positions from before, instead of after, collisions
+	/// applied earlier in the same pass. Unsynced projectiles always do this.
+	bool projectileCollisionMT;
+
+	/// Defer explosions of projectiles colliding in the same frame until the end
+	/// of the collision pass, collect the objects each one damages in parallel,
+	/// then apply them serially in collision order. Deterministic, but explosions
+	/// then see object positions from before the pass, and miss objects created
+	/// by earlier explosions of the same pass.
+	bool explosionDamageMT;
+
+	/// Run the line-of-fire tests (ray and trajectory traces) of all weapons about
+	/// to fire in parallel before the serial weapon update, which then reuses them
+	/// if its target and positions still match. Deterministic, but the traces then
+	/// see the world from before, instead of after, the damage dealt by (hitscan)
+	/// weapons updated earlier in the same frame.
+	bool weaponLineOfFireMT;
+
+	/// Fill the per-frame unit SlowUpdate buckets by estimated unit cost instead
+	/// of giving each frame the same number of units. The estimate of a unit is
+	/// the weight of its CommandAI type (command, mobile, air, builder, factory)
+	/// plus one weapon weight per weapon. Changes the frame in which each unit's
+	/// SlowUpdate runs.
+	bool slowUpdateCostBalanced;
+	std::array<int, 5> slowUpdateClassWeights;
+	int slowUpdateWeaponWeight;
+
 	bool allowTake;
 	bool allowEnginePlayerlist;
 
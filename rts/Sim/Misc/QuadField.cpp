@@ -16,6 +16,8 @@
 	#include "Sim/Projectiles/Projectile.h"
 	#include "Sim/Units/Unit.h"
 	#include "Sim/Weapons/PlasmaRepulser.h"
+#elif defined(QUADFIELD_TEST_OBJECTS)
+	#include "QuadFieldTestObjects.h" // stand-in objects provided by the test
 #endif
 
 #include "System/Misc/TracyDefs.h"
@@ -32,6 +34,7 @@ CR_REG_METADATA(CQuadField, (
 	CR_IGNORED(tempUnits),
 	CR_IGNORED(tempFeatures),
 	CR_IGNORED(tempProjectiles),
+	CR_IGNORED(tempRepulsers),
 	CR_IGNORED(tempSolids),
 	CR_IGNORED(tempQuads)
 ))
@@ -41,6 +44,7 @@ CR_REG_METADATA_SUB(CQuadField, Quad, (
 	CR_MEMBER(units),
 	CR_IGNORED(teamUnits),
 	CR_MEMBER(features),
+	CR_IGNORED(featuresSoA),
 	CR_MEMBER(projectiles),
 	CR_MEMBER(repulsers),
 
@@ -60,6 +64,12 @@ void CQuadField::Quad::PostLoad()
 	for (CUnit* unit: units) {
 		spring::VectorInsertUnique(teamUnits[unit->allyteam], unit, false);
 	}
+
+	featuresSoA.clear();
+
+	for (const CFeature* feature: features) {
+		featuresSoA.push_back(feature->pos.x, feature->pos.z, feature->radius);
+	}
 #endif
 }
 
@@ -84,7 +94,6 @@ void CQuadField::Init(int2 mapDims, int quadSize)
 
 	for (size_t i = 0; i < threadCount; ++i) {
 		tempQuads[i].ReserveAll(numQuadsX * numQuadsZ);
-		tempQuads[i].ReleaseAll();
 	}
 
 
@@ -104,18 +113,22 @@ void CQuadField::Kill()
 		quad.Clear();
 	}
 
-	for (auto cache : tempUnits)
+	for (auto& cache : tempUnits)
 		cache.ReleaseAll();
 
-	for (auto cache : tempFeatures)
+	for (auto& cache : tempFeatures)
 		cache.ReleaseAll();
 
-	tempProjectiles.ReleaseAll();
+	for (auto& cache : tempProjectiles)
+		cache.ReleaseAll();
+
+	for (auto& cache : tempRepulsers)
+		cache.ReleaseAll();
 
-	for (auto cache : tempSolids)
+	for (auto& cache : tempSolids)
 		cache.ReleaseAll();
 
-	for (auto cache : tempQuads)
+	for (auto& cache : tempQuads)
 		cache.ReleaseAll();
 }
 
@@ -136,7 +149,7 @@ int CQuadField::WorldPosToQuadFieldIdx(const float3 p) const
 }
 
 
-#ifndef UNIT_TEST // ClampInBounds() is not linked
+#if !defined(UNIT_TEST) || defined(QUADFIELD_TEST_OBJECTS) // ClampInBounds() is only linked by the object tests
 void CQuadField::GetQuads(QuadFieldQuery& qfq, float3 pos, float radius)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
@@ -191,7 +204,7 @@ void CQuadField::GetQuadsRectangle(QuadFieldQuery& qfq, const float3& mins, cons
 
 	return;
 }
-#endif // UNIT_TEST
+#endif
 
 
 /// note: this function got an UnitTest, check the tests/ folder!
@@ -247,7 +260,7 @@ void CQuadField::GetQuadsOnRay(QuadFieldQuery& qfq, const float3& start, const f
 	const int startZ = std::clamp <int> (startZuc, 0, numQuadsZ - 1);
 	const int finalZ = std::clamp <int> (finalZuc, 0, numQuadsZ - 1);
 
-	assert(finalZ < quadSizeZ);
+	assert(finalZ < numQuadsZ);
 
 	const float invDirZ = 1.0f / dir.z;
 
@@ -337,7 +350,7 @@ void CQuadField::GetQuadsOnWideRay(QuadFieldQuery& qfq, const float3& start, con
 	const int startZ = std::clamp <int> (startZuc, 0, numQuadsZ - 1);
 	const int finalZ = std::clamp <int> (finalZuc, 0, numQuadsZ - 1);
 
-	assert(finalZ < quadSizeZ);
+	assert(finalZ < numQuadsZ);
 
 	const float invDirZ = 1.0f / dir.z;
 
@@ -436,10 +449,15 @@ void CQuadField::MovedUnit(CUnit* unit)
 	RECOIL_DETAILED_TRACY_ZONE;
 	QuadFieldQuery qfQuery;
 	GetQuads(qfQuery, unit->pos, unit->radius);
+	MovedUnit(unit, *qfQuery.quads);
+}
 
+void CQuadField::MovedUnit(CUnit* unit, std::vector<int>& newQuads)
+{
+	RECOIL_DETAILED_TRACY_ZONE;
 	// compare if the quads have changed, if not stop here
-	if (qfQuery.quads->size() == unit->quads.size()) {
-		if (std::equal(qfQuery.quads->begin(), qfQuery.quads->end(), unit->quads.begin()))
+	if (newQuads.size() == unit->quads.size()) {
+		if (std::equal(newQuads.begin(), newQuads.end(), unit->quads.begin()))
 			return;
 	}
 
@@ -448,12 +466,12 @@ void CQuadField::MovedUnit(CUnit* unit)
 		spring::VectorErase(baseQuads[qi].teamUnits[unit->allyteam], unit);
 	}
 
-	for (const int qi: *qfQuery.quads) {
+	for (const int qi: newQuads) {
 		spring::VectorInsertUnique(baseQuads[qi].units, unit, false);
 		spring::VectorInsertUnique(baseQuads[qi].teamUnits[unit->allyteam], unit, false);
 	}
 
-	unit->quads = std::move(*qfQuery.quads);
+	unit->quads = std::move(newQuads);
 }
 
 void CQuadField::RemoveUnit(CUnit* unit)
@@ -529,7 +547,10 @@ void CQuadField::AddFeature(CFeature* feature)
 	GetQuads(qfQuery, feature->pos, feature->radius);
 
 	for (const int qi: *qfQuery.quads) {
-		spring::VectorInsertUnique(baseQuads[qi].features, feature, false);
+		Quad& quad = baseQuads[qi];
+
+		spring::VectorInsertUnique(quad.features, feature, false);
+		quad.featuresSoA.push_back(feature->pos.x, feature->pos.z, feature->radius);
 	}
 }
 
@@ -540,7 +561,16 @@ void CQuadField::RemoveFeature(CFeature* feature)
 	GetQuads(qfQuery, feature->pos, feature->radius);
 
 	for (const int qi: *qfQuery.quads) {
-		spring::VectorErase(baseQuads[qi].features, feature);
+		Quad& quad = baseQuads[qi];
+
+		const auto iter = std::find(quad.features.begin(), quad.features.end(), feature);
+
+		if (iter == quad.features.end())
+			continue;
+
+		// keep the SoA mirror in the same order as VectorErase leaves <features>
+		quad.featuresSoA.erase(iter - quad.features.begin());
+		spring::VectorErase(quad.features, feature);
 	}
 
 	#ifdef DEBUG_QUADFIELD
@@ -548,10 +578,30 @@ void CQuadField::RemoveFeature(CFeature* feature)
 		for (CFeature* f: q.features) {
 			assert(f != feature);
 		}
+
+		assert(q.features.size() == q.featuresSoA.size());
 	}
 	#endif
 }
 
+void CQuadField::MovedFeature(CFeature* feature)
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	QuadFieldQuery qfQuery;
+	GetQuads(qfQuery, feature->pos, feature->radius);
+
+	for (const int qi: *qfQuery.quads) {
+		Quad& quad = baseQuads[qi];
+
+		const auto iter = std::find(quad.features.begin(), quad.features.end(), feature);
+
+		if (iter == quad.features.end())
+			continue;
+
+		quad.featuresSoA.set(iter - quad.features.begin(), feature->pos.x, feature->pos.z, feature->radius);
+	}
+}
+
 
 
 void CQuadField::MovedProjectile(CProjectile* p)
@@ -603,11 +653,11 @@ void CQuadField::RemoveProjectile(CProjectile* p)
 
 	p->quads.clear();
 }
+#endif // UNIT_TEST
 
 
 
-
-
+#if !defined(UNIT_TEST) || defined(QUADFIELD_TEST_OBJECTS)
 void CQuadField::GetUnits(QuadFieldQuery& qfq, const float3& pos, float radius)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
@@ -707,9 +757,14 @@ void CQuadField::GetFeaturesExact(QuadFieldQuery& qfq, const float3& pos, float
 	qfq.features = tempFeatures[curThread].ReserveVector();
 
 	for (const int qi: *qfQuery.quads) {
-		for (CFeature* f: baseQuads[qi].features) {
+		const Quad& quad = baseQuads[qi];
+
+		// only candidates passing the 2D footprint test are dereferenced
+		quad.featuresSoA.ForEachInCircle(pos.x, pos.z, radius, [&](size_t i) {
+			CFeature* f = quad.features[i];
+
 			if (f->mtTempNum[curThread] == tempNum)
-				continue;
+				return;
 
 			f->mtTempNum[curThread] = tempNum;
 
@@ -720,10 +775,10 @@ void CQuadField::GetFeaturesExact(QuadFieldQuery& qfq, const float3& pos, float
 				pos.SqDistance2D(f->pos);
 
 			if (posDstSq >= totRadSq)
-				continue;
+				return;
 
 			qfq.features->push_back(f);
-		}
+		});
 	}
 
 	return;
@@ -740,20 +795,27 @@ void CQuadField::GetFeaturesExact(QuadFieldQuery& qfq, const float3& mins, const
 	qfq.features = tempFeatures[curThread].ReserveVector();
 
 	for (const int qi: *qfQuery.quads) {
-		for (CFeature* feature: baseQuads[qi].features) {
+		const Quad& quad = baseQuads[qi];
+
+		// only candidates passing the 2D footprint test are dereferenced
+		quad.featuresSoA.ForEachInRect(mins.x, mins.z, maxs.x, maxs.z, [&](size_t i) {
+			CFeature* feature = quad.features[i];
+
 			if (feature->mtTempNum[curThread] == tempNum)
-				continue;
+				return;
 
 			feature->mtTempNum[curThread] = tempNum;
 
+			// the SoA copy can lag behind a feature moved without being
+			// re-added to the quadfield (e.g. Lua's Move + ForcedMove)
 			const float3& pos = feature->pos;
 			if (pos.x < mins.x || pos.x > maxs.x)
-				continue;
+				return;
 			if (pos.z < mins.z || pos.z > maxs.z)
-				continue;
+				return;
 
 			qfq.features->push_back(feature);
-		}
+		});
 	}
 
 	return;
@@ -764,17 +826,19 @@ void CQuadField::GetFeaturesExact(QuadFieldQuery& qfq, const float3& mins, const
 void CQuadField::GetProjectilesExact(QuadFieldQuery& qfq, const float3& pos, float radius)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
+	auto curThread = qfq.threadOwner;
 	QuadFieldQuery qfQuery;
+	qfQuery.threadOwner = curThread;
 	GetQuads(qfQuery, pos, radius);
-	const int tempNum = gs->GetTempNum();
-	qfq.projectiles = tempProjectiles.ReserveVector();
+	const int tempNum = gs->GetMtTempNum(curThread);
+	qfq.projectiles = tempProjectiles[curThread].ReserveVector();
 
 	for (const int qi: *qfQuery.quads) {
 		for (CProjectile* p: baseQuads[qi].projectiles) {
-			if (p->tempNum == tempNum)
+			if (p->mtTempNum[curThread] == tempNum)
 				continue;
 
-			p->tempNum = tempNum;
+			p->mtTempNum[curThread] = tempNum;
 
 			if (pos.SqDistance(p->pos) >= Square(radius + p->radius))
 				continue;
@@ -789,17 +853,19 @@ void CQuadField::GetProjectilesExact(QuadFieldQuery& qfq, const float3& pos, flo
 void CQuadField::GetProjectilesExact(QuadFieldQuery& qfq, const float3& mins, const float3& maxs)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
+	auto curThread = qfq.threadOwner;
 	QuadFieldQuery qfQuery;
+	qfQuery.threadOwner = curThread;
 	GetQuadsRectangle(qfQuery, mins, maxs);
-	const int tempNum = gs->GetTempNum();
-	qfq.projectiles = tempProjectiles.ReserveVector();
+	const int tempNum = gs->GetMtTempNum(curThread);
+	qfq.projectiles = tempProjectiles[curThread].ReserveVector();
 
 	for (const int qi: *qfQuery.quads) {
 		for (CProjectile* p: baseQuads[qi].projectiles) {
-			if (p->tempNum == tempNum)
+			if (p->mtTempNum[curThread] == tempNum)
 				continue;
 
-			p->tempNum = tempNum;
+			p->mtTempNum[curThread] = tempNum;
 
 			const float3& pos = p->pos;
 			if (pos.x < mins.x || pos.x > maxs.x)
@@ -917,8 +983,10 @@ bool CQuadField::NoSolidsExact(
 
 	return true;
 }
+#endif
 
 
+#ifndef UNIT_TEST
 // optimization specifically for projectile collisions
 void CQuadField::GetUnitsAndFeaturesColVol(
 	const float3& pos,
@@ -928,21 +996,42 @@ void CQuadField::GetUnitsAndFeaturesColVol(
 	std::vector<CPlasmaRepulser*>* repulsers
 ) {
 	RECOIL_DETAILED_TRACY_ZONE;
-	const int tempNum = gs->GetTempNum();
+	QuadFieldQuery qfq;
+	GetUnitsAndFeaturesColVol(qfq, pos, radius, repulsers != nullptr);
+
+	units.insert(units.end(), qfq.units->begin(), qfq.units->end());
+	features.insert(features.end(), qfq.features->begin(), qfq.features->end());
+
+	if (repulsers == nullptr)
+		return;
+
+	repulsers->insert(repulsers->end(), qfq.repulsers->begin(), qfq.repulsers->end());
+}
 
+void CQuadField::GetUnitsAndFeaturesColVol(QuadFieldQuery& qfq, const float3& pos, const float radius, bool withRepulsers)
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	auto curThread = qfq.threadOwner;
 	QuadFieldQuery qfQuery;
+	qfQuery.threadOwner = curThread;
 	GetQuads(qfQuery, pos, radius);
-	// start counting from the previous object-cache sizes
+	const int tempNum = gs->GetMtTempNum(curThread);
+
+	qfq.units = tempUnits[curThread].ReserveVector();
+	qfq.features = tempFeatures[curThread].ReserveVector();
+
+	if (withRepulsers)
+		qfq.repulsers = tempRepulsers[curThread].ReserveVector();
 
 	for (const int qi: *qfQuery.quads) {
 		const Quad& quad = baseQuads[qi];
 
 		for (CUnit* u: quad.units) {
 			// prevent double adding
-			if (u->tempNum == tempNum)
+			if (u->mtTempNum[curThread] == tempNum)
 				continue;
 
-			u->tempNum = tempNum;
+			u->mtTempNum[curThread] = tempNum;
 
 			const auto* colvol = &u->collisionVolume;
 			const float totRad = radius + colvol->GetBoundingRadius();
@@ -950,15 +1039,15 @@ void CQuadField::GetUnitsAndFeaturesColVol(
 			if (pos.SqDistance(colvol->GetWorldSpacePos(u)) >= (totRad * totRad))
 				continue;
 
-			units.push_back(u);
+			qfq.units->push_back(u);
 		}
 
 		for (CFeature* f: quad.features) {
 			// prevent double adding
-			if (f->tempNum == tempNum)
+			if (f->mtTempNum[curThread] == tempNum)
 				continue;
 
-			f->tempNum = tempNum;
+			f->mtTempNum[curThread] = tempNum;
 
 			const auto* colvol = &f->collisionVolume;
 			const float totRad = radius + colvol->GetBoundingRadius();
@@ -966,15 +1055,15 @@ void CQuadField::GetUnitsAndFeaturesColVol(
 			if (pos.SqDistance(colvol->GetWorldSpacePos(f)) >= (totRad * totRad))
 				continue;
 
-			features.push_back(f);
+			qfq.features->push_back(f);
 		}
-		if (repulsers != nullptr) {
+		if (withRepulsers) {
 			for (CPlasmaRepulser* r: quad.repulsers) {
 				// prevent double adding
-				if (r->tempNum == tempNum)
+				if (r->mtTempNum[curThread] == tempNum)
 					continue;
 
-				r->tempNum = tempNum;
+				r->mtTempNum[curThread] = tempNum;
 
 				const auto* colvol = &r->collisionVolume;
 				const float totRad = radius + colvol->GetBoundingRadius();
@@ -982,7 +1071,7 @@ void CQuadField::GetUnitsAndFeaturesColVol(
 				if (pos.SqDistance(r->weaponMuzzlePos) >= (totRad * totRad))
 					continue;
 
-				repulsers->push_back(r);
+				qfq.repulsers->push_back(r);
 			}
 		}
 	}
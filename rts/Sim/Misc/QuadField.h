@@ -5,8 +5,10 @@
 
 #include <algorithm>
 #include <array>
+#include <deque>
 #include <vector>
 
+#include "Sim/Misc/QuadFieldSoA.h"
 #include "System/Misc/NonCopyable.h"
 #include "System/Threading/ThreadPool.h"
 #include "System/creg/creg_cond.h"
@@ -20,29 +22,35 @@ class CSolidObject;
 class CPlasmaRepulser;
 struct QuadFieldQuery;
 
+/**
+ * Per-thread arena of query result vectors. Vectors (and their capacity)
+ * are recycled through a free-list, so reserving and releasing are O(1)
+ * and any number of queries may be nested. Each instance must only ever
+ * be touched by the thread owning it, hence there is one per pool thread.
+ */
 template<typename T>
 class QueryVectorCache {
 public:
-	typedef std::pair<bool, std::vector<T>> PairType;
+	// the common case is a query plus its internal quad lookup
+	QueryVectorCache() { Grow(3); }
+	QueryVectorCache(const QueryVectorCache&) = delete;
+	QueryVectorCache& operator = (const QueryVectorCache&) = delete;
 
-	std::vector<T>* ReserveVector(size_t base = 0, size_t capa = 1024) {
-		const auto pred = [](const PairType& p) { return (!p.first); };
-		const auto iter = std::find_if(vectors.begin() + base, vectors.end(), pred);
+	std::vector<T>* ReserveVector(size_t capa = 1024) {
+		if (freeVectors.empty())
+			Grow(1);
 
-		if (iter != vectors.end()) {
-			iter->first = true;
-			iter->second.clear();
-			iter->second.reserve(capa);
-			return &iter->second;
-		}
+		std::vector<T>* vec = freeVectors.back();
+		freeVectors.pop_back();
 
-		assert(false);
-		return nullptr;
+		vec->clear();
+		vec->reserve(capa);
+		return vec;
 	}
 
 	void ReserveAll(size_t capa) {
-		for (size_t i = 0; i < vectors.size(); ++i) {
-			ReserveVector(i, capa);
+		for (auto& vec: vectors) {
+			vec.reserve(capa);
 		}
 	}
 
@@ -50,26 +58,31 @@ public:
 		if (released == nullptr)
 			return;
 
-		const auto pred = [&](const PairType& p) { return (&p.second == released); };
-		const auto iter = std::find_if(vectors.begin(), vectors.end(), pred);
+		// releasing twice would hand the same vector to two queries
+		assert(std::find(freeVectors.begin(), freeVectors.end(), released) == freeVectors.end());
+		freeVectors.push_back(const_cast<std::vector<T>*>(released));
+	}
+	void ReleaseAll() {
+		freeVectors.clear();
 
-		if (iter == vectors.end()) {
-			assert(false);
-			return;
+		for (auto& vec: vectors) {
+			freeVectors.push_back(&vec);
 		}
-
-		iter->first = false;
 	}
-	void ReleaseAll() {
-		for (auto& pair: vectors) {
-			ReleaseVector(&pair.second);
+
+	size_t GetNumVectors() const { return vectors.size(); }
+	size_t GetNumFreeVectors() const { return freeVectors.size(); }
+private:
+	void Grow(size_t n) {
+		for (size_t i = 0; i < n; ++i) {
+			// deque never relocates its elements, handed out pointers stay valid
+			vectors.emplace_back();
+			freeVectors.push_back(&vectors.back());
 		}
 	}
 private:
-	// There should at most be 2 concurrent users of each vector type
-	// using 3 to be safe, increase this number if the assertions below
-	// fail
-	std::array<PairType, 3> vectors = {{{false, {}}, {false, {}}, {false, {}}}};
+	std::deque< std::vector<T> > vectors;
+	std::vector< std::vector<T>* > freeVectors;
 };
 
 
@@ -97,6 +110,12 @@ public:
 		std::vector<CFeature*>& features,
 		std::vector<CPlasmaRepulser*>* repulsers = nullptr
 	);
+	/**
+	 * Same as above, but results are handed out in <qfq> from the arena of
+	 * qfq.threadOwner (repulsers only if @c withRepulsers is set) so it can
+	 * be called from any pool thread
+	 */
+	void GetUnitsAndFeaturesColVol(QuadFieldQuery& qfq, const float3& pos, const float radius, bool withRepulsers);
 
 	/**
 	 * Returns all units within @c radius of @c pos,
@@ -149,10 +168,14 @@ public:
 	bool RemoveUnitIf(CUnit* unit, const float3& wpos);
 
 	void MovedUnit(CUnit* unit);
+	// as above, with the quads for the unit's position already looked up
+	void MovedUnit(CUnit* unit, std::vector<int>& newQuads);
 	void RemoveUnit(CUnit* unit);
 
 	void AddFeature(CFeature* feature);
 	void RemoveFeature(CFeature* feature);
+	/// refreshes the SoA footprint of a feature whose quads did not change
+	void MovedFeature(CFeature* feature);
 
 	void MovedProjectile(CProjectile* projectile);
 	void AddProjectile(CProjectile* projectile);
@@ -165,7 +188,8 @@ public:
 
 	void ReleaseVector(std::vector<CUnit*>* v       , int onThread = 0) { tempUnits[onThread].ReleaseVector(v); }
 	void ReleaseVector(std::vector<CFeature*>* v    , int onThread = 0) { tempFeatures[onThread].ReleaseVector(v); }
-	void ReleaseVector(std::vector<CProjectile*>* v ) { tempProjectiles.ReleaseVector(v); }
+	void ReleaseVector(std::vector<CProjectile*>* v , int onThread = 0) { tempProjectiles[onThread].ReleaseVector(v); }
+	void ReleaseVector(std::vector<CPlasmaRepulser*>* v, int onThread = 0) { tempRepulsers[onThread].ReleaseVector(v); }
 	void ReleaseVector(std::vector<CSolidObject*>* v, int onThread = 0) { tempSolids[onThread].ReleaseVector(v); }
 	void ReleaseVector(std::vector<int>* v          , int onThread = 0) { tempQuads[onThread].ReleaseVector(v); }
 
@@ -182,6 +206,7 @@ public:
 			units = std::move(q.units);
 			teamUnits = std::move(q.teamUnits);
 			features = std::move(q.features);
+			featuresSoA = std::move(q.featuresSoA);
 			projectiles = std::move(q.projectiles);
 			repulsers = std::move(q.repulsers);
 			return *this;
@@ -197,6 +222,7 @@ public:
 				v.clear();
 			}
 			features.clear();
+			featuresSoA.clear();
 			projectiles.clear();
 			repulsers.clear();
 		}
@@ -205,6 +231,7 @@ public:
 		std::vector<CUnit*> units;
 		std::vector< std::vector<CUnit*> > teamUnits;
 		std::vector<CFeature*> features;
+		QuadFieldSoA featuresSoA;
 		std::vector<CProjectile*> projectiles;
 		std::vector<CPlasmaRepulser*> repulsers;
 	};
@@ -237,7 +264,8 @@ private:
 	// preallocated vectors for Get*Exact functions
 	std::array< QueryVectorCache<CUnit*>, ThreadPool::MAX_THREADS >  tempUnits;
 	std::array< QueryVectorCache<CFeature*>, ThreadPool::MAX_THREADS >  tempFeatures;
-	QueryVectorCache<CProjectile*> tempProjectiles;
+	std::array< QueryVectorCache<CProjectile*>, ThreadPool::MAX_THREADS > tempProjectiles;
+	std::array< QueryVectorCache<CPlasmaRepulser*>, ThreadPool::MAX_THREADS > tempRepulsers;
 	std::array< QueryVectorCache<CSolidObject*>, ThreadPool::MAX_THREADS > tempSolids;
 	std::array< QueryVectorCache<int>, ThreadPool::MAX_THREADS > tempQuads;
 
@@ -257,7 +285,8 @@ struct QuadFieldQuery {
 	~QuadFieldQuery() {
 		quadField.ReleaseVector(units, threadOwner);
 		quadField.ReleaseVector(features, threadOwner);
-		quadField.ReleaseVector(projectiles);
+		quadField.ReleaseVector(projectiles, threadOwner);
+		quadField.ReleaseVector(repulsers, threadOwner);
 		quadField.ReleaseVector(solids, threadOwner);
 		quadField.ReleaseVector(quads, threadOwner);
 	}
@@ -265,6 +294,7 @@ struct QuadFieldQuery {
 	std::vector<CUnit*>* units = nullptr;
 	std::vector<CFeature*>* features = nullptr;
 	std::vector<CProjectile*>* projectiles = nullptr;
+	std::vector<CPlasmaRepulser*>* repulsers = nullptr;
 	std::vector<CSolidObject*>* solids = nullptr;
 	std::vector<int>* quads = nullptr;
 	int threadOwner = 0;
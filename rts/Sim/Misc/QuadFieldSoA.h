@@ -0,0 +1,145 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef QUAD_FIELD_SOA_H
+#define QUAD_FIELD_SOA_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "xsimd/xsimd.hpp"
+
+/**
+ * Structure-of-arrays mirror of the 2D footprint (x, z, radius) of the
+ * objects stored in a quad, kept in the same order as the quad's object
+ * vector. The Get*Exact queries run these batch filters first and only
+ * touch the (cold) object of a surviving index.
+ *
+ * Both filters are conservative w.r.t. the exact per-object tests: the
+ * circle filter drops an entry only if its 2D distance is already out of
+ * range (which rules out the 3D test as well), the rectangle filter uses
+ * the exact same comparisons (negated, so NaNs are never dropped).
+ */
+class QuadFieldSoA {
+public:
+	size_t size() const { return xs.size(); }
+	bool empty() const { return xs.empty(); }
+
+	void clear() {
+		xs.clear();
+		zs.clear();
+		rs.clear();
+	}
+
+	void push_back(float x, float z, float r) {
+		xs.push_back(x);
+		zs.push_back(z);
+		rs.push_back(r);
+	}
+
+	void set(size_t i, float x, float z, float r) {
+		assert(i < size());
+		xs[i] = x;
+		zs[i] = z;
+		rs[i] = r;
+	}
+
+	// mirrors spring::VectorErase (swap with back, then pop)
+	void erase(size_t i) {
+		assert(i < size());
+		xs[i] = xs.back(); xs.pop_back();
+		zs[i] = zs.back(); zs.pop_back();
+		rs[i] = rs.back(); rs.pop_back();
+	}
+
+	/// calls f(i) for each entry whose footprint may overlap the circle at (px, pz)
+	template<typename F> void ForEachInCircle(float px, float pz, float radius, F&& f) const {
+		const size_t n = size();
+		size_t i = 0;
+
+	#ifdef XSIMD_BATCH_FLOAT_SIZE
+		using batch_type = xsimd::simd_type<float>;
+		constexpr size_t N = xsimd::simd_traits<float>::size;
+
+		const batch_type bpx(px);
+		const batch_type bpz(pz);
+		const batch_type brad(radius);
+
+		for (bool lanes[N]; (i + N) <= n; i += N) {
+			const batch_type dx = bpx - xsimd::load_unaligned(&xs[i]);
+			const batch_type dz = bpz - xsimd::load_unaligned(&zs[i]);
+			const batch_type tr = brad + xsimd::load_unaligned(&rs[i]);
+			const auto hits = !((dx * dx + dz * dz) >= (tr * tr));
+
+			if (!xsimd::any(hits))
+				continue;
+
+			hits.store_unaligned(lanes);
+
+			for (size_t j = 0; j < N; ++j) {
+				if (lanes[j])
+					f(i + j);
+			}
+		}
+	#endif
+
+		for (; i < n; ++i) {
+			const float dx = px - xs[i];
+			const float dz = pz - zs[i];
+			const float tr = radius + rs[i];
+
+			if ((dx * dx + dz * dz) >= (tr * tr))
+				continue;
+
+			f(i);
+		}
+	}
+
+	/// calls f(i) for each entry whose center lies inside [mins, maxs] (xz-plane)
+	template<typename F> void ForEachInRect(float minx, float minz, float maxx, float maxz, F&& f) const {
+		const size_t n = size();
+		size_t i = 0;
+
+	#ifdef XSIMD_BATCH_FLOAT_SIZE
+		using batch_type = xsimd::simd_type<float>;
+		constexpr size_t N = xsimd::simd_traits<float>::size;
+
+		const batch_type bminx(minx);
+		const batch_type bminz(minz);
+		const batch_type bmaxx(maxx);
+		const batch_type bmaxz(maxz);
+
+		for (bool lanes[N]; (i + N) <= n; i += N) {
+			const batch_type bx = xsimd::load_unaligned(&xs[i]);
+			const batch_type bz = xsimd::load_unaligned(&zs[i]);
+			const auto hits = !((bx < bminx) || (bx > bmaxx) || (bz < bminz) || (bz > bmaxz));
+
+			if (!xsimd::any(hits))
+				continue;
+
+			hits.store_unaligned(lanes);
+
+			for (size_t j = 0; j < N; ++j) {
+				if (lanes[j])
+					f(i + j);
+			}
+		}
+	#endif
+
+		for (; i < n; ++i) {
+			if (xs[i] < minx || xs[i] > maxx)
+				continue;
+			if (zs[i] < minz || zs[i] > maxz)
+				continue;
+
+			f(i);
+		}
+	}
+
+private:
+	std::vector<float> xs;
+	std::vector<float> zs;
+	std::vector<float> rs;
+};
+
+#endif /* QUAD_FIELD_SOA_H */
@@ -1,6 +1,7 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include <cassert>
+#include <utility>
 
 
 #include "MoveType.h"
@@ -14,6 +15,7 @@
 #include "Sim/Units/UnitDef.h"
 #include "System/SpringMath.h"
 #include "System/SpringHash.h"
+#include "System/Threading/ThreadPool.h"
 
 #include "System/TimeProfiler.h"
 
@@ -38,7 +40,12 @@ CR_REG_METADATA(AMoveType, (
 	CR_MEMBER(waterline),
 
 	CR_MEMBER(useHeading),
-	CR_MEMBER(useWantedSpeed)
+	CR_MEMBER(useWantedSpeed),
+
+	CR_IGNORED(preparedQuads),
+	CR_IGNORED(preparedQuadsPos),
+	CR_IGNORED(preparedQuadsRadius),
+	CR_IGNORED(haveQuadsPrepared)
 ))
 
 
@@ -87,15 +94,44 @@ void AMoveType::SlowUpdate()
 void AMoveType::UpdateCollisionMap(bool force)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
+	// a prepared lookup is only good for the update directly following it
+	const bool usePrepared = std::exchange(haveQuadsPrepared, false);
+
 	if (!force && ((gs->frameNum + owner->id) % modInfo.unitQuadPositionUpdateRate))
 		return;
 
 	if (owner->pos != oldCollisionUpdatePos){
 		oldCollisionUpdatePos = owner->pos;
-		quadField.MovedUnit(owner);
+
+		// stale if a call-in moved or resized the owner since it was made
+		if (usePrepared && preparedQuadsPos.same(owner->pos) && preparedQuadsRadius == owner->radius) {
+			quadField.MovedUnit(owner, preparedQuads);
+		} else {
+			quadField.MovedUnit(owner);
+		}
 	}
 }
 
+void AMoveType::PrepareCollisionMapUpdate()
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	haveQuadsPrepared = false;
+
+	if ((gs->frameNum + owner->id) % modInfo.unitQuadPositionUpdateRate)
+		return;
+	if (owner->pos == oldCollisionUpdatePos)
+		return;
+
+	QuadFieldQuery qfQuery;
+	qfQuery.threadOwner = ThreadPool::GetThreadNum();
+	quadField.GetQuads(qfQuery, owner->pos, owner->radius);
+
+	preparedQuads.assign(qfQuery.quads->begin(), qfQuery.quads->end());
+	preparedQuadsPos = owner->pos;
+	preparedQuadsRadius = owner->radius;
+	haveQuadsPrepared = true;
+}
+
 void AMoveType::UpdateGroundBlockMap() {
 	RECOIL_DETAILED_TRACY_ZONE;
 	if (owner->pos != oldSlowUpdatePos) {
@@ -10,6 +10,7 @@
 #include "Sim/Misc/GlobalConstants.h"
 
 #include <algorithm>
+#include <vector>
 
 class CUnit;
 
@@ -54,6 +55,8 @@ public:
 	virtual bool Update() = 0;
 	virtual void SlowUpdate();
 	void UpdateCollisionMap(bool force = false);
+	// looks up the quads for UpdateCollisionMap ahead of time, thread-safe
+	void PrepareCollisionMapUpdate();
 	void UpdateGroundBlockMap();
 
 	virtual bool IsSkidding() const { return false; }
@@ -115,6 +118,13 @@ protected:
 
 	bool useHeading = true;
 	bool useWantedSpeed[2] = {true, true};  // if false, SelUnitsAI will not (re)set wanted-speed for {[0] := individual, [1] := formation} orders
+
+private:
+	// result of PrepareCollisionMapUpdate, consumed by the next UpdateCollisionMap
+	std::vector<int> preparedQuads;
+	float3 preparedQuadsPos;
+	float preparedQuadsRadius = 0.0f;
+	bool haveQuadsPrepared = false;
 };
 
 #endif // MOVETYPE_H
@@ -2,8 +2,9 @@
 
 #include "PathingState.h"
 
-#include "zlib.h"
-#include "minizip/zip.h"
+#include <filesystem>
+#include <fstream>
+#include <random>
 
 #include "Game/GlobalUnsynced.h"
 #include "Game/LoadScreen.h"
@@ -21,13 +22,13 @@
 #include "PathMemPool.h"
 
 #include "System/Config/ConfigHandler.h"
-#include "System/FileSystem/Archives/IArchive.h"
-#include "System/FileSystem/ArchiveLoader.h"
 #include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/FileQueryFlags.h"
+#include "System/FileSystem/MemoryMappedFile.h"
 #include "System/Platform/Threading.h"
 #include "System/StringUtil.h"
+#include "System/Sync/SHA512.hpp"
 #include "System/Threading/ThreadPool.h" // for_mt
 
 #include "System/Misc/TracyDefs.h"
@@ -36,6 +37,28 @@
 
 static constexpr int BLOCK_UPDATE_DELAY_FRAMES = GAME_SPEED / 2;
 
+// "PECF"
+static constexpr std::uint32_t CACHE_FILE_MAGIC = 0x46434550;
+static constexpr std::uint32_t CACHE_FILE_VERSION = 1;
+// vertex-costs start on a page boundary so they can be used straight from the mapping
+static constexpr std::uint64_t CACHE_FILE_ALIGNMENT = 4096;
+
+namespace {
+	struct CacheFileHeader {
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t hash;
+		std::uint32_t numPathTypes;
+		std::uint32_t numBlocks;
+		std::uint32_t numVertexCosts;
+		std::uint64_t nodeOffsetsPos;
+		std::uint64_t vertexCostsPos;
+	};
+
+	static_assert(sizeof(CacheFileHeader) == 40);
+	static_assert(std::is_trivially_copyable_v<short2>);
+}
+
 namespace HAPFS {
 
 bool TEST_ACTIVE = false;
@@ -53,7 +76,7 @@ static const std::string GetPathCacheDir() {
 
 static const std::string GetCacheFileName(const std::string& fileHashCode, const std::string& peFileName, const std::string& mapFileName) {
 	RECOIL_DETAILED_TRACY_ZONE;
-	return (GetPathCacheDir() + mapFileName + "." + peFileName + "-" + fileHashCode + ".zip");
+	return (GetPathCacheDir() + mapFileName + "." + peFileName + "-" + fileHashCode + ".pecache");
 }
 
 void PathingState::KillStatic() { pathingStates = 0; }
@@ -65,6 +88,8 @@ PathingState::PathingState()
 	pathCache[1] = nullptr;
 }
 
+PathingState::~PathingState() = default;
+
 void PathingState::Init(std::vector<IPathFinder*> pathFinderlist, PathingState* parentState, unsigned int _BLOCK_SIZE, const std::string& peFileName, const std::string& mapFileName)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
@@ -109,8 +134,10 @@ void PathingState::Init(std::vector<IPathFinder*> pathFinderlist, PathingState*
 		offsetBlockNum = {mapDimensionsInBlocks.x * mapDimensionsInBlocks.y};
 		costBlockNum = {mapDimensionsInBlocks.x * mapDimensionsInBlocks.y};
 
-		vertexCosts.clear();
-		vertexCosts.resize(moveDefHandler.GetNumMoveDefs() * blockStates.GetSize() * PATH_DIRECTION_VERTICES, PATHCOST_INFINITY);
+		// backed by either the cache-file or a local buffer, see InitEstimator
+		vertexCosts = {};
+		vertexCostsBuffer.clear();
+		cacheFile.reset();
 		maxSpeedMods.clear();
 		maxSpeedMods.resize(moveDefHandler.GetNumMoveDefs(), 0.001f);
 
@@ -190,6 +217,10 @@ void PathingState::Terminate()
 	// allow our PNSB to be reused across reloads
 	if (instanceIndex < nodeStateBuffers.size())
 		nodeStateBuffers[instanceIndex] = std::move(blockStates);
+
+	vertexCosts = {};
+	vertexCostsBuffer = {};
+	cacheFile.reset();
 }
 
 void PathingState::AllocStateBuffer()
@@ -235,6 +266,10 @@ void PathingState::InitEstimator(const std::string& peFileName, const std::strin
 			loadscreen->SetLoadMessage(calcMsg);
 		}
 
+		vertexCostsBuffer.clear();
+		vertexCostsBuffer.resize(moveDefHandler.GetNumMoveDefs() * blockStates.GetSize() * PATH_DIRECTION_VERTICES, PATHCOST_INFINITY);
+		vertexCosts = vertexCostsBuffer;
+
 		// Mark block directions as dirty to ensure they get updated.
 		auto& nodeFlags = blockStates.nodeLinksObsoleteFlags;
 		std::for_each(nodeFlags.begin(), nodeFlags.end(), [](std::uint8_t& f){ f = PATH_DIRECTIONS_HALF_MASK; });
@@ -491,6 +526,11 @@ void PathingState::CalcVertexPathCost(
 
 /**
  * Try to read offset and vertices data from file, return false on failure
+ *
+ * The block-offsets are small and get copied out, the vertex-costs are used
+ * in-place from a copy-on-write mapping of the file: pages are only faulted
+ * in once a search touches them and stay shared with other processes until
+ * a terrain change overwrites some of their costs.
  */
 bool PathingState::ReadFile(const std::string& peFileName, const std::string& mapFileName)
 {
@@ -503,63 +543,71 @@ bool PathingState::ReadFile(const std::string& peFileName, const std::string& ma
 	if (!FileSystem::FileExists(cacheFileName))
 		return false;
 
-	std::unique_ptr<IArchive> upfile(archiveLoader.OpenArchive(dataDirsAccess.LocateFile(cacheFileName), "sdz"));
+	auto file = std::make_unique<CMemoryMappedFile>(dataDirsAccess.LocateFile(cacheFileName), true);
 
-	if (upfile == nullptr || !upfile->IsOpen()) {
+	const auto RejectFile = [&](const char* reason) {
+		LOG_L(L_WARNING, "[PathEstimator::ReadFile] discarding \"%s\" (%s)", cacheFileName.c_str(), reason);
+		// mapped files can not be removed on all platforms
+		file.reset();
 		FileSystem::Remove(cacheFileName);
 		return false;
-	}
+	};
+
+	if (!file->IsOpen())
+		return RejectFile("unreadable");
 
 	char calcMsg[512];
 	sprintf(calcMsg, "Reading Estimate PathCosts [%d]", BLOCK_SIZE);
 	loadscreen->SetLoadMessage(calcMsg);
 
-	const unsigned fid = upfile->FindFile("pathinfo");
-	if (fid >= upfile->NumFiles()) {
-		FileSystem::Remove(cacheFileName);
-		return false;
-	}
+	CacheFileHeader header;
 
-	std::vector<std::uint8_t> buffer;
+	if (file->GetSize() < sizeof(header))
+		return RejectFile("truncated header");
 
-	if (!upfile->GetFile(fid, buffer) || buffer.size() < 4) {
-		FileSystem::Remove(cacheFileName);
-		return false;
-	}
+	std::memcpy(&header, file->GetData(), sizeof(header));
 
-	const unsigned int filehash = *(reinterpret_cast<unsigned int*>(&buffer[0]));
-	const unsigned int blockSize = blockStates.GetSize() * sizeof(short2);
-	unsigned int pos = sizeof(unsigned);
+	const std::uint64_t numPathTypes = moveDefHandler.GetNumMoveDefs();
+	const std::uint64_t numVertexCosts = numPathTypes * blockStates.GetSize() * PATH_DIRECTION_VERTICES;
 
-	if (filehash != fileHashCode) {
-		FileSystem::Remove(cacheFileName);
-		return false;
-	}
+	const std::uint64_t nodeOffsetsSize = numPathTypes * blockStates.GetSize() * sizeof(short2);
+	const std::uint64_t vertexCostsSize = numVertexCosts * sizeof(float);
 
-	if (buffer.size() < (pos + blockSize * moveDefHandler.GetNumMoveDefs())) {
-		FileSystem::Remove(cacheFileName);
-		return false;
-	}
+	if (header.magic != CACHE_FILE_MAGIC || header.version != CACHE_FILE_VERSION)
+		return RejectFile("version mismatch");
+	if (header.hash != fileHashCode || header.numPathTypes != numPathTypes || header.numBlocks != blockStates.GetSize() || header.numVertexCosts != numVertexCosts)
+		return RejectFile("key mismatch");
+	if ((header.vertexCostsPos % CACHE_FILE_ALIGNMENT) != 0)
+		return RejectFile("misaligned vertex-costs");
+	if (header.nodeOffsetsPos > file->GetSize() || nodeOffsetsSize > (file->GetSize() - header.nodeOffsetsPos))
+		return RejectFile("truncated block-offsets");
+	if (header.vertexCostsPos > file->GetSize() || vertexCostsSize > (file->GetSize() - header.vertexCostsPos))
+		return RejectFile("truncated vertex-costs");
 
 	// read center-offset data
-	for (int pathType = 0; pathType < moveDefHandler.GetNumMoveDefs(); ++pathType) {
-		std::memcpy(&blockStates.peNodeOffsets[pathType][0], &buffer[pos], blockSize);
-		pos += blockSize;
-	}
+	for (size_t pathType = 0, pos = header.nodeOffsetsPos; pathType < numPathTypes; ++pathType) {
+		auto& nodeOffsets = blockStates.peNodeOffsets[pathType];
 
-	// read vertex-cost data
-	if (buffer.size() < (pos + vertexCosts.size() * sizeof(float))) {
-		FileSystem::Remove(cacheFileName);
-		return false;
+		std::memcpy(nodeOffsets.data(), file->GetData() + pos, nodeOffsets.size() * sizeof(short2));
+		pos += (nodeOffsets.size() * sizeof(short2));
 	}
 
-	std::memcpy(&vertexCosts[0], &buffer[pos], vertexCosts.size() * sizeof(float));
+	// map vertex-cost data
+	vertexCosts = {reinterpret_cast<float*>(file->GetWritableData() + header.vertexCostsPos), numVertexCosts};
+	vertexCostsBuffer = {};
+	cacheFile = std::move(file);
+
+	LOG("[PathEstimator::%s] using %" PRIu64 "KB of vertex-costs (mapped=%d)", __func__, vertexCostsSize / 1024, cacheFile->IsMapped());
 	return true;
 }
 
 
 /**
  * Try to write offset and vertex data to file.
+ *
+ * Several engine instances may be writing the same cache concurrently, so
+ * the data goes to a private temporary file which then replaces the final
+ * one in a single step; readers either see a complete file or none.
  */
 bool PathingState::WriteFile(const std::string& peFileName, const std::string& mapFileName)
 {
@@ -570,41 +618,56 @@ bool PathingState::WriteFile(const std::string& peFileName, const std::string& m
 
 	const std::string hashHexString = IntToString(fileHashCode, "%x");
 	const std::string cacheFileName = GetCacheFileName(hashHexString, peFileName, mapFileName);
+	const std::string tempFileName = cacheFileName + "." + IntToString(std::random_device()(), "%x") + ".tmp";
 
 	LOG("[PathEstimator::%s] hash=%s file=\"%s\" (exists=%d)", __func__, hashHexString.c_str(), cacheFileName.c_str(), FileSystem::FileExists(cacheFileName));
 
-	// open file for writing in a suitable location
-	zipFile file = zipOpen(dataDirsAccess.LocateFile(cacheFileName, FileQueryFlags::WRITE).c_str(), APPEND_STATUS_CREATE);
+	const std::uint64_t numPathTypes = moveDefHandler.GetNumMoveDefs();
+	const std::uint64_t nodeOffsetsSize = numPathTypes * blockStates.GetSize() * sizeof(short2);
 
-	if (file == nullptr)
-		return false;
+	CacheFileHeader header;
+	header.magic = CACHE_FILE_MAGIC;
+	header.version = CACHE_FILE_VERSION;
+	header.hash = fileHashCode;
+	header.numPathTypes = numPathTypes;
+	header.numBlocks = blockStates.GetSize();
+	header.numVertexCosts = vertexCosts.size();
+	header.nodeOffsetsPos = sizeof(header);
+	header.vertexCostsPos = ((header.nodeOffsetsPos + nodeOffsetsSize + CACHE_FILE_ALIGNMENT - 1) / CACHE_FILE_ALIGNMENT) * CACHE_FILE_ALIGNMENT;
+
+	const std::string tempFilePath = dataDirsAccess.LocateFile(tempFileName, FileQueryFlags::WRITE);
+	const std::vector<char> padding(header.vertexCostsPos - (header.nodeOffsetsPos + nodeOffsetsSize), 0);
 
-	zipOpenNewFileInZip(file, "pathinfo", nullptr, nullptr, 0, nullptr, 0, nullptr, Z_DEFLATED, Z_BEST_COMPRESSION);
+	std::ofstream ofs(tempFilePath, std::ios::out | std::ios::binary | std::ios::trunc);
 
-	// write hash-code (NOTE: this also affects the CRC!)
-	zipWriteInFileInZip(file, (const void*) &fileHashCode, 4);
+	ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
 
 	// write center-offsets
-	for (int pathType = 0; pathType < moveDefHandler.GetNumMoveDefs(); ++pathType) {
-		zipWriteInFileInZip(file, (const void*) &blockStates.peNodeOffsets[pathType][0], blockStates.peNodeOffsets[pathType].size() * sizeof(short2));
+	for (size_t pathType = 0; pathType < numPathTypes; ++pathType) {
+		ofs.write(reinterpret_cast<const char*>(blockStates.peNodeOffsets[pathType].data()), blockStates.peNodeOffsets[pathType].size() * sizeof(short2));
 	}
 
 	// write vertex-costs
-	zipWriteInFileInZip(file, vertexCosts.data(), vertexCosts.size() * sizeof(float));
-
-	zipCloseFileInZip(file);
-	zipClose(file, nullptr);
+	ofs.write(padding.data(), padding.size());
+	ofs.write(reinterpret_cast<const char*>(vertexCosts.data()), vertexCosts.size() * sizeof(float));
+	ofs.close();
 
+	if (!ofs.good()) {
+		FileSystem::Remove(tempFileName);
+		return false;
+	}
 
-	// get the CRC over the written path data
-	std::unique_ptr<IArchive> upfile(archiveLoader.OpenArchive(dataDirsAccess.LocateFile(cacheFileName), "sdz"));
+	std::error_code ec;
+	std::filesystem::rename(tempFilePath, dataDirsAccess.LocateFile(cacheFileName, FileQueryFlags::WRITE), ec);
 
-	if (upfile == nullptr || !upfile->IsOpen()) {
-		FileSystem::Remove(cacheFileName);
+	if (ec) {
+		// most likely another instance already put an identical file in place
+		// which is mapped and can not be replaced on every platform right now
+		LOG_L(L_WARNING, "[PathEstimator::%s] could not move \"%s\" into place (%s)", __func__, tempFileName.c_str(), ec.message().c_str());
+		FileSystem::Remove(tempFileName);
 		return false;
 	}
 
-	assert(upfile->FindFile("pathinfo") < upfile->NumFiles());
 	return true;
 }
 
@@ -4,6 +4,8 @@
 #define HAPFS_PATHINGSTATESYSTEM_H
 
 #include <atomic>
+#include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -15,6 +17,7 @@
 #include "Sim/Path/HAPFS/PathManager.h"
 
 struct HAPFSPathDrawer;
+class CMemoryMappedFile;
 
 namespace HAPFS {
 
@@ -25,6 +28,7 @@ class PathingState {
 public:
 
 	PathingState();
+	~PathingState();
 
     void Init(std::vector<IPathFinder*> pathFinderlist, PathingState* parentState, unsigned int BLOCK_SIZE, const std::string& peFileName, const std::string& mapFileName);
 
@@ -40,7 +44,7 @@ public:
 
     float GetVertexCost(size_t index) const { return vertexCosts[index]; };
 
-	const std::vector<float>& GetVertexCosts() const { return vertexCosts; }
+	std::span<const float> GetVertexCosts() const { return vertexCosts; }
 	const std::deque<int2>& GetUpdatedBlocks() const { return updatedBlocks; }
 
 	struct SOffsetBlock {
@@ -176,7 +180,15 @@ private:
     std::vector<IPathFinder*> pathFinders; // InitEstimator helpers
 
     std::vector<float> maxSpeedMods;
-    std::vector<float> vertexCosts;
+
+    // points either into vertexCostsBuffer (when the costs were calculated)
+    // or into the copy-on-write mapping of the cache-file (when they were
+    // read); unmodified pages of the latter are shared by every process
+    // running on the same map
+    std::span<float> vertexCosts;
+    std::vector<float> vertexCostsBuffer;
+    std::unique_ptr<CMemoryMappedFile> cacheFile;
+
     std::deque<int2> updatedBlocks;
 
     PathNodeStateBuffer blockStates;
@@ -179,6 +179,8 @@ public:
 	virtual const float* GetNodeExtraCosts(bool synced) const { return nullptr; }
 
 	virtual int2 GetNumQueuedUpdates() const { return (int2(0, 0)); }
+	/// number of invalidated paths that were {repaired, fully searched again} since load
+	virtual int2 GetNumPathRepairs() const { return (int2(0, 0)); }
 
 	virtual void SavePathCacheForPathId(int pathIdToSave) {};
 };
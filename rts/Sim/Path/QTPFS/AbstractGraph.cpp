@@ -0,0 +1,412 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <algorithm>
+#include <cassert>
+
+#include "AbstractGraph.h"
+#include "NodeLayer.h"
+#include "Node.h"
+
+#include "Sim/Misc/GlobalConstants.h"
+
+#include "System/Misc/TracyDefs.h"
+
+namespace {
+	// marks a leaf that is open but has not been assigned a region yet
+	constexpr int REGION_UNASSIGNED = -2;
+	constexpr int REGION_CLOSED = -1;
+}
+
+
+std::size_t QTPFS::AbstractSearchData::GetMemFootPrint() const {
+	std::size_t memFootPrint = 0;
+
+	memFootPrint += openRegions.capacity() * sizeof(decltype(openRegions)::value_type);
+	memFootPrint += pathCosts.size() * sizeof(decltype(pathCosts)::value_type);
+	memFootPrint += prevRegions.size() * sizeof(decltype(prevRegions)::value_type);
+	memFootPrint += regionStamps.size() * sizeof(decltype(regionStamps)::value_type);
+	memFootPrint += clusterStamps.size() * sizeof(decltype(clusterStamps)::value_type);
+
+	return memFootPrint;
+}
+
+
+void QTPFS::AbstractGraph::Init(const NodeLayer& nl) {
+	ZoneScoped;
+
+	clusterSize = nl.GetRootNodeSize() * CLUSTER_ROOT_NODES;
+	xClusters = (nl.GetXRootNodes() + CLUSTER_ROOT_NODES - 1) / CLUSTER_ROOT_NODES;
+	zClusters = (nl.GetZRootNodes() + CLUSTER_ROOT_NODES - 1) / CLUSTER_ROOT_NODES;
+
+	clusters.clear();
+	clusters.resize(xClusters * zClusters);
+	dirtyClusters.clear();
+	dirtyClusters.reserve(clusters.size());
+	nodeRegions.clear();
+
+	for (int i = 0; i < int(clusters.size()); ++i) {
+		clusters[i].dirty = true;
+		dirtyClusters.push_back(i);
+	}
+
+	Update(nl);
+}
+
+void QTPFS::AbstractGraph::Clear() {
+	clusters.clear();
+	dirtyClusters.clear();
+	nodeRegions.clear();
+	regionClusters.clear();
+	tmpNodeQueue.clear();
+	tmpEdgeClusters.clear();
+
+	numRegions = 0;
+}
+
+
+void QTPFS::AbstractGraph::MarkDirty(const SRectangle& r) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	if (!IsBuilt())
+		return;
+
+	// grow by a square so that clusters whose leaves only border the
+	// re-tesselated area (and thus had their neighbour links changed)
+	// are picked up as well
+	const int cxmin = std::max(r.x1 - 1, 0) / clusterSize;
+	const int czmin = std::max(r.z1 - 1, 0) / clusterSize;
+	const int cxmax = std::min((r.x2 + 1) / clusterSize, xClusters - 1);
+	const int czmax = std::min((r.z2 + 1) / clusterSize, zClusters - 1);
+
+	for (int cz = czmin; cz <= czmax; ++cz) {
+		for (int cx = cxmin; cx <= cxmax; ++cx) {
+			Cluster& cluster = clusters[cz * xClusters + cx];
+
+			if (cluster.dirty)
+				continue;
+
+			cluster.dirty = true;
+			dirtyClusters.push_back(cz * xClusters + cx);
+		}
+	}
+}
+
+void QTPFS::AbstractGraph::Update(const NodeLayer& nl) {
+	if (dirtyClusters.empty())
+		return;
+
+	ZoneScoped;
+
+	if (int(nodeRegions.size()) < nl.GetMaxNodesAlloced())
+		nodeRegions.resize(nl.GetMaxNodesAlloced(), REGION_CLOSED);
+
+	// keep the rebuild order independent of the order areas were damaged in
+	std::sort(dirtyClusters.begin(), dirtyClusters.end());
+
+	for (const int clusterIdx: dirtyClusters) {
+		CollectLeafNodes(nl, clusterIdx);
+		RebuildRegions(nl, clusterIdx);
+	}
+
+	// region indices of the dirty clusters have changed, so the edges of
+	// their neighbours pointing into them have to be redone too
+	tmpEdgeClusters.clear();
+	tmpEdgeClusters.resize(clusters.size(), false);
+
+	for (const int clusterIdx: dirtyClusters) {
+		const int cx = clusterIdx % xClusters;
+		const int cz = clusterIdx / xClusters;
+
+		for (int z = std::max(cz - 1, 0); z <= std::min(cz + 1, zClusters - 1); ++z) {
+			for (int x = std::max(cx - 1, 0); x <= std::min(cx + 1, xClusters - 1); ++x) {
+				tmpEdgeClusters[z * xClusters + x] = true;
+			}
+		}
+
+		clusters[clusterIdx].dirty = false;
+	}
+
+	for (int i = 0; i < int(clusters.size()); ++i) {
+		if (tmpEdgeClusters[i])
+			RebuildEdges(nl, i);
+	}
+
+	dirtyClusters.clear();
+
+	RebuildRegionIndex();
+}
+
+
+void QTPFS::AbstractGraph::CollectLeafNodes(const NodeLayer& nl, int clusterIdx) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	Cluster& cluster = clusters[clusterIdx];
+
+	const int rxmin = (clusterIdx % xClusters) * CLUSTER_ROOT_NODES;
+	const int rzmin = (clusterIdx / xClusters) * CLUSTER_ROOT_NODES;
+	const int rxmax = std::min(rxmin + CLUSTER_ROOT_NODES, nl.GetXRootNodes());
+	const int rzmax = std::min(rzmin + CLUSTER_ROOT_NODES, nl.GetZRootNodes());
+
+	cluster.leafNodes.clear();
+	tmpNodeQueue.clear();
+
+	for (int rz = rzmin; rz < rzmax; ++rz) {
+		for (int rx = rxmin; rx < rxmax; ++rx) {
+			tmpNodeQueue.push_back(rz * nl.GetXRootNodes() + rx);
+		}
+	}
+
+	while (!tmpNodeQueue.empty()) {
+		const int nodeIdx = tmpNodeQueue.back();
+		const INode* curNode = nl.GetPoolNode(nodeIdx);
+
+		tmpNodeQueue.pop_back();
+
+		if (curNode->IsLeaf()) {
+			cluster.leafNodes.push_back(nodeIdx);
+			continue;
+		}
+
+		for (int i = 0; i < QTNODE_CHILD_COUNT; ++i) {
+			tmpNodeQueue.push_back(curNode->GetChildBaseIndex() + i);
+		}
+	}
+}
+
+void QTPFS::AbstractGraph::RebuildRegions(const NodeLayer& nl, int clusterIdx) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	Cluster& cluster = clusters[clusterIdx];
+
+	cluster.regions.clear();
+
+	for (const int nodeIdx: cluster.leafNodes) {
+		nodeRegions[nodeIdx] = (nl.GetPoolNode(nodeIdx)->AllSquaresImpassable())? REGION_CLOSED: REGION_UNASSIGNED;
+	}
+
+	// flood-fill the open leaves; only leaves of this cluster can still be
+	// unassigned, so no explicit cluster check is needed on neighbours
+	for (const int seedIdx: cluster.leafNodes) {
+		if (nodeRegions[seedIdx] != REGION_UNASSIGNED)
+			continue;
+
+		const int regionIdx = cluster.regions.size();
+
+		float2 centreSum;
+		float costSum = 0.0f;
+		float areaSum = 0.0f;
+
+		tmpNodeQueue.clear();
+		tmpNodeQueue.push_back(seedIdx);
+		nodeRegions[seedIdx] = regionIdx;
+
+		while (!tmpNodeQueue.empty()) {
+			const INode* curNode = nl.GetPoolNode(tmpNodeQueue.back());
+			const float area = curNode->area();
+
+			tmpNodeQueue.pop_back();
+
+			centreSum.x += curNode->xmid() * area;
+			centreSum.y += curNode->zmid() * area;
+			costSum += curNode->GetMoveCost() * area;
+			areaSum += area;
+
+			for (const auto& ngb: curNode->GetNeighbours()) {
+				if (nodeRegions[ngb.nodeId] != REGION_UNASSIGNED)
+					continue;
+
+				nodeRegions[ngb.nodeId] = regionIdx;
+				tmpNodeQueue.push_back(ngb.nodeId);
+			}
+		}
+
+		Region& region = cluster.regions.emplace_back();
+
+		region.centre = float2(centreSum.x / areaSum, centreSum.y / areaSum) * SQUARE_SIZE;
+		region.moveCost = costSum / areaSum;
+		region.area = areaSum;
+	}
+}
+
+void QTPFS::AbstractGraph::RebuildEdges(const NodeLayer& nl, int clusterIdx) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	Cluster& cluster = clusters[clusterIdx];
+
+	for (Region& region: cluster.regions) {
+		region.edges.clear();
+	}
+
+	for (const int nodeIdx: cluster.leafNodes) {
+		const int regionIdx = nodeRegions[nodeIdx];
+
+		if (regionIdx < 0)
+			continue;
+
+		Region& region = cluster.regions[regionIdx];
+
+		for (const auto& ngb: nl.GetPoolNode(nodeIdx)->GetNeighbours()) {
+			const INode* ngbNode = nl.GetPoolNode(ngb.nodeId);
+			const int ngbClusterIdx = GetClusterIndex(ngbNode->xmin(), ngbNode->zmin());
+			const int ngbRegionIdx = nodeRegions[ngb.nodeId];
+
+			if (ngbClusterIdx == clusterIdx || ngbRegionIdx < 0)
+				continue;
+
+			assert(ngbRegionIdx < int(clusters[ngbClusterIdx].regions.size()));
+
+			const auto edgeMatch = [&](const Edge& e) { return (e.cluster == ngbClusterIdx && e.region == ngbRegionIdx); };
+
+			if (std::find_if(region.edges.begin(), region.edges.end(), edgeMatch) != region.edges.end())
+				continue;
+
+			const Region& ngbRegion = clusters[ngbClusterIdx].regions[ngbRegionIdx];
+			const float cost = region.centre.Distance(ngbRegion.centre) * (region.moveCost + ngbRegion.moveCost) * 0.5f;
+
+			region.edges.push_back({ngbClusterIdx, ngbRegionIdx, cost});
+		}
+	}
+}
+
+void QTPFS::AbstractGraph::RebuildRegionIndex() {
+	RECOIL_DETAILED_TRACY_ZONE;
+	numRegions = 0;
+
+	for (Cluster& cluster: clusters) {
+		cluster.regionBase = numRegions;
+		numRegions += cluster.regions.size();
+	}
+
+	regionClusters.resize(numRegions);
+
+	for (int i = 0; i < int(clusters.size()); ++i) {
+		std::fill_n(regionClusters.begin() + clusters[i].regionBase, clusters[i].regions.size(), i);
+	}
+}
+
+
+bool QTPFS::AbstractGraph::FindCorridor(const INode* srcNode, const INode* tgtNode, float hCostMult, AbstractSearchData& searchData) const {
+	ZoneScoped;
+
+	searchData.numRegionsSearched = 0;
+
+	if (!IsBuilt())
+		return false;
+	if (srcNode->GetIndex() >= nodeRegions.size() || tgtNode->GetIndex() >= nodeRegions.size())
+		return false;
+
+	const int srcLocalIdx = nodeRegions[srcNode->GetIndex()];
+	const int tgtLocalIdx = nodeRegions[tgtNode->GetIndex()];
+
+	if (srcLocalIdx < 0 || tgtLocalIdx < 0)
+		return false;
+
+	const int srcRegionIdx = clusters[GetClusterIndex(srcNode->xmin(), srcNode->zmin())].regionBase + srcLocalIdx;
+	const int tgtRegionIdx = clusters[GetClusterIndex(tgtNode->xmin(), tgtNode->zmin())].regionBase + tgtLocalIdx;
+
+	const auto getRegion = [this](int regionIdx) -> const Region& {
+		const Cluster& cluster = clusters[regionClusters[regionIdx]];
+		return cluster.regions[regionIdx - cluster.regionBase];
+	};
+
+	if (int(searchData.pathCosts.size()) < numRegions) {
+		searchData.pathCosts.resize(numRegions);
+		searchData.prevRegions.resize(numRegions);
+		searchData.regionStamps.resize(numRegions, 0);
+	}
+	if (searchData.clusterStamps.size() != clusters.size()) {
+		searchData.clusterStamps.clear();
+		searchData.clusterStamps.resize(clusters.size(), 0);
+		searchData.corridorStamp = 0;
+	}
+	if ((++searchData.regionStamp) == 0) {
+		std::fill(searchData.regionStamps.begin(), searchData.regionStamps.end(), 0);
+		searchData.regionStamp = 1;
+	}
+
+	const float2 tgtCentre = getRegion(tgtRegionIdx).centre;
+	auto& openRegions = searchData.openRegions;
+
+	openRegions.clear();
+	openRegions.push_back({getRegion(srcRegionIdx).centre.Distance(tgtCentre) * hCostMult, 0.0f, srcRegionIdx});
+
+	searchData.pathCosts[srcRegionIdx] = 0.0f;
+	searchData.prevRegions[srcRegionIdx] = -1;
+	searchData.regionStamps[srcRegionIdx] = searchData.regionStamp;
+
+	bool foundPath = false;
+
+	while (!openRegions.empty()) {
+		std::pop_heap(openRegions.begin(), openRegions.end());
+		const AbstractSearchData::OpenRegion curRegion = openRegions.back();
+		openRegions.pop_back();
+
+		// superseded by a cheaper entry pushed later
+		if (curRegion.gCost > searchData.pathCosts[curRegion.region])
+			continue;
+
+		searchData.numRegionsSearched++;
+
+		if ((foundPath = (curRegion.region == tgtRegionIdx)))
+			break;
+
+		for (const Edge& edge: getRegion(curRegion.region).edges) {
+			const int nxtRegionIdx = clusters[edge.cluster].regionBase + edge.region;
+			const float gCost = curRegion.gCost + edge.cost;
+
+			if (searchData.regionStamps[nxtRegionIdx] == searchData.regionStamp && gCost >= searchData.pathCosts[nxtRegionIdx])
+				continue;
+
+			searchData.pathCosts[nxtRegionIdx] = gCost;
+			searchData.prevRegions[nxtRegionIdx] = curRegion.region;
+			searchData.regionStamps[nxtRegionIdx] = searchData.regionStamp;
+
+			const float hCost = getRegion(nxtRegionIdx).centre.Distance(tgtCentre) * hCostMult;
+
+			openRegions.push_back({gCost + hCost, gCost, nxtRegionIdx});
+			std::push_heap(openRegions.begin(), openRegions.end());
+		}
+	}
+
+	if (!foundPath)
+		return false;
+
+	if ((++searchData.corridorStamp) == 0) {
+		std::fill(searchData.clusterStamps.begin(), searchData.clusterStamps.end(), 0);
+		searchData.corridorStamp = 1;
+	}
+
+	for (int regionIdx = tgtRegionIdx; regionIdx != -1; regionIdx = searchData.prevRegions[regionIdx]) {
+		MarkCorridor(regionClusters[regionIdx], searchData);
+	}
+
+	return true;
+}
+
+void QTPFS::AbstractGraph::MarkCorridor(int clusterIdx, AbstractSearchData& searchData) const {
+	const int cx = clusterIdx % xClusters;
+	const int cz = clusterIdx / xClusters;
+
+	for (int z = std::max(cz - CORRIDOR_MARGIN, 0); z <= std::min(cz + CORRIDOR_MARGIN, zClusters - 1); ++z) {
+		for (int x = std::max(cx - CORRIDOR_MARGIN, 0); x <= std::min(cx + CORRIDOR_MARGIN, xClusters - 1); ++x) {
+			searchData.clusterStamps[z * xClusters + x] = searchData.corridorStamp;
+		}
+	}
+}
+
+
+std::uint64_t QTPFS::AbstractGraph::GetMemFootPrint() const {
+	std::uint64_t memFootPrint = sizeof(AbstractGraph);
+
+	for (const Cluster& cluster: clusters) {
+		memFootPrint += sizeof(Cluster);
+		memFootPrint += cluster.leafNodes.size() * sizeof(decltype(cluster.leafNodes)::value_type);
+
+		for (const Region& region: cluster.regions) {
+			memFootPrint += sizeof(Region);
+			memFootPrint += region.edges.size() * sizeof(Edge);
+		}
+	}
+
+	memFootPrint += dirtyClusters.size() * sizeof(decltype(dirtyClusters)::value_type);
+	memFootPrint += nodeRegions.size() * sizeof(decltype(nodeRegions)::value_type);
+	memFootPrint += regionClusters.size() * sizeof(decltype(regionClusters)::value_type);
+
+	return memFootPrint;
+}
@@ -0,0 +1,136 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef QTPFS_ABSTRACTGRAPH_H_
+#define QTPFS_ABSTRACTGRAPH_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+#include "System/Rectangle.h"
+#include "System/type2.h"
+
+namespace QTPFS {
+	struct INode;
+	struct NodeLayer;
+
+	// Per-thread scratch space for AbstractGraph::FindCorridor. Kept alive
+	// between searches so nothing has to be allocated once it has grown.
+	struct AbstractSearchData {
+		struct OpenRegion {
+			float fCost;
+			float gCost;
+			int region;
+
+			// min-heap on f-cost; ties are broken on region index so that
+			// the result never depends on heap implementation details
+			bool operator < (const OpenRegion& o) const {
+				return (fCost != o.fCost) ? (fCost > o.fCost) : (region > o.region);
+			}
+		};
+
+		std::vector<OpenRegion> openRegions;
+		std::vector<float> pathCosts;
+		std::vector<int> prevRegions;
+		std::vector<std::uint32_t> regionStamps;
+		std::vector<std::uint32_t> clusterStamps;
+
+		std::uint32_t regionStamp = 0;
+		std::uint32_t corridorStamp = 0;
+
+		int numRegionsSearched = 0;
+
+		bool InCorridor(int clusterIdx) const { return (clusterStamps[clusterIdx] == corridorStamp); }
+
+		std::size_t GetMemFootPrint() const;
+	};
+
+	// Coarse view of a NodeLayer that is used to steer long-distance searches,
+	// in the style of HPA*. The layer is cut into square clusters that are
+	// CLUSTER_ROOT_NODES root-nodes wide; since leaf nodes never cross root
+	// node boundaries every leaf belongs to exactly one cluster. The passable
+	// leaves of a cluster that reach each other without leaving it form a
+	// region, and regions of neighbouring clusters are linked wherever a leaf
+	// of one is a neighbour of a leaf of the other.
+	//
+	// Clusters touched by a re-tesselation are only marked in MarkDirty and
+	// rebuilt in Update, which the PathManager runs after each layer's batch
+	// of map-damage updates.
+	struct AbstractGraph {
+	public:
+		static constexpr int CLUSTER_ROOT_NODES = 2;
+
+		// ring of clusters added around the abstract path when marking the
+		// corridor, so the refined path has room to cut corners
+		static constexpr int CORRIDOR_MARGIN = 1;
+
+		void Init(const NodeLayer& nl);
+		void Clear();
+
+		// r is in heightmap squares
+		void MarkDirty(const SRectangle& r);
+		void Update(const NodeLayer& nl);
+
+		// Searches the region graph from the region of srcNode to that of
+		// tgtNode and on success stamps the clusters along the result (and
+		// CORRIDOR_MARGIN around them) into searchData.
+		bool FindCorridor(const INode* srcNode, const INode* tgtNode, float hCostMult, AbstractSearchData& searchData) const;
+
+		bool IsBuilt() const { return (!clusters.empty()); }
+
+		int GetClusterIndex(int x, int z) const { return ((z / clusterSize) * xClusters + (x / clusterSize)); }
+		int GetNumClusters() const { return clusters.size(); }
+		int GetNumRegions() const { return numRegions; }
+
+		std::uint64_t GetMemFootPrint() const;
+
+	private:
+		struct Edge {
+			int cluster;
+			int region;
+			float cost;
+		};
+
+		struct Region {
+			float2 centre; // area-weighted, in elmos
+			float moveCost; // area-weighted average of the leaves
+			float area;
+
+			std::vector<Edge> edges;
+		};
+
+		struct Cluster {
+			std::vector<Region> regions;
+			std::vector<int> leafNodes;
+
+			int regionBase = 0; // index of regions[0] in the flattened region list
+			bool dirty = false;
+		};
+
+		void CollectLeafNodes(const NodeLayer& nl, int clusterIdx);
+		void RebuildRegions(const NodeLayer& nl, int clusterIdx);
+		void RebuildEdges(const NodeLayer& nl, int clusterIdx);
+		void RebuildRegionIndex();
+
+		void MarkCorridor(int clusterIdx, AbstractSearchData& searchData) const;
+
+	private:
+		std::vector<Cluster> clusters;
+		std::vector<int> dirtyClusters;
+
+		// local region of every leaf node, indexed by pool index; -1 if closed
+		std::vector<int> nodeRegions;
+		// owning cluster of every region in the flattened region list
+		std::vector<int> regionClusters;
+
+		std::vector<int> tmpNodeQueue;
+		std::vector<bool> tmpEdgeClusters;
+
+		int clusterSize = 0;
+		int xClusters = 0;
+		int zClusters = 0;
+		int numRegions = 0;
+	};
+}
+
+#endif
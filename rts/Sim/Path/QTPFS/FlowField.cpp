@@ -0,0 +1,125 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "FlowField.h"
+#include "Node.h"
+#include "NodeLayer.h"
+#include "PathDefines.h"
+
+#include "Sim/Misc/GlobalConstants.h"
+#include "System/Misc/TracyDefs.h"
+
+
+void QTPFS::FlowField::Generate(const NodeLayer& nl, SearchPriorityQueue& openNodes) {
+	ZoneScoped;
+
+	const INode* goalNode = nl.GetPoolNode(goalNodeIndex);
+	const size_t numNodes = nl.GetMaxNodesAlloced();
+
+	nextNodes.assign(numNodes, -1);
+	exitPoints.assign(numNodes, {0.0f, 0.0f});
+	costs.assign(numNodes, std::numeric_limits<float>::infinity());
+
+	costs[goalNodeIndex] = 0.0f;
+	exitPoints[goalNodeIndex] = {float(goalNode->xmid() * SQUARE_SIZE), float(goalNode->zmid() * SQUARE_SIZE)};
+
+	openNodes.clear();
+	openNodes.emplace(goalNodeIndex, 0.0f);
+
+	while (!openNodes.empty()) {
+		const SearchQueueNode curOpenNode = openNodes.top();
+		const int curIndex = curOpenNode.nodeIndex;
+
+		openNodes.pop();
+
+		// stale entry, the node has been reached more cheaply since
+		if (curOpenNode.heapPriority > costs[curIndex])
+			continue;
+
+		const INode* curNode = nl.GetPoolNode(curIndex);
+		const float2& curPoint = exitPoints[curIndex];
+		const float curMoveCost = curNode->AllSquaresImpassable() ? QTPFS_CLOSED_NODE_COST : curNode->GetMoveCost();
+
+		for (const INode::NeighbourPoints& ngbPoints: curNode->GetNeighbours()) {
+			const int ngbIndex = ngbPoints.nodeId;
+			const INode* ngbNode = nl.GetPoolNode(ngbIndex);
+
+			// the field is walked towards the goal, so the link has to exist in the
+			// neighbour's direction; nothing may enter an exit-only node from outside
+			if (curNode->IsExitOnly() && !ngbNode->IsExitOnly())
+				continue;
+
+			// same segment cost as PathSearch::IterateNodeNeighbors, from the edge
+			// point into curNode up to where the route leaves it again
+			const float2& ngbPoint = ngbPoints.netpoints[0];
+			const float ngbCost = costs[curIndex] + curMoveCost * curPoint.Distance(ngbPoint);
+
+			if (ngbCost >= costs[ngbIndex])
+				continue;
+
+			costs[ngbIndex] = ngbCost;
+			nextNodes[ngbIndex] = curIndex;
+			exitPoints[ngbIndex] = ngbPoint;
+
+			openNodes.emplace(ngbIndex, ngbCost);
+		}
+	}
+}
+
+std::size_t QTPFS::FlowField::GetMemFootPrint() const {
+	std::size_t memFootPrint = sizeof(FlowField);
+
+	memFootPrint += nextNodes.size() * sizeof(decltype(nextNodes)::value_type);
+	memFootPrint += exitPoints.size() * sizeof(decltype(exitPoints)::value_type);
+	memFootPrint += costs.size() * sizeof(decltype(costs)::value_type);
+
+	return memFootPrint;
+}
+
+
+const QTPFS::FlowField* QTPFS::FlowFieldCache::Find(int goalNodeIndex) const {
+	const auto iter = std::find_if(fields.begin(), fields.end(), [goalNodeIndex](const FlowField& f) { return (f.GetGoalNodeIndex() == goalNodeIndex); });
+	return ((iter != fields.end())? &(*iter): nullptr);
+}
+
+QTPFS::FlowField* QTPFS::FlowFieldCache::Find(int goalNodeIndex) {
+	return const_cast<FlowField*>(static_cast<const FlowFieldCache*>(this)->Find(goalNodeIndex));
+}
+
+QTPFS::FlowField* QTPFS::FlowFieldCache::Insert(int goalNodeIndex, int frame) {
+	assert(Find(goalNodeIndex) == nullptr);
+
+	// callers may hold on to fields inserted earlier in the same frame
+	fields.reserve(MAX_FIELDS);
+
+	if (fields.size() < MAX_FIELDS)
+		return &fields.emplace_back(goalNodeIndex, frame);
+
+	const auto lruIter = std::min_element(fields.begin(), fields.end(), [](const FlowField& a, const FlowField& b) {
+		return (a.GetLastUsedFrame() < b.GetLastUsedFrame());
+	});
+
+	if (lruIter->GetLastUsedFrame() >= frame)
+		return nullptr;
+
+	*lruIter = FlowField(goalNodeIndex, frame);
+	return &(*lruIter);
+}
+
+void QTPFS::FlowFieldCache::RemoveIdle(int frame) {
+	const auto isIdle = [frame](const FlowField& f) { return ((frame - f.GetLastUsedFrame()) > MAX_IDLE_FRAMES); };
+	fields.erase(std::remove_if(fields.begin(), fields.end(), isIdle), fields.end());
+}
+
+std::size_t QTPFS::FlowFieldCache::GetMemFootPrint() const {
+	std::size_t memFootPrint = 0;
+
+	for (const FlowField& f: fields) {
+		memFootPrint += f.GetMemFootPrint();
+	}
+
+	return memFootPrint;
+}
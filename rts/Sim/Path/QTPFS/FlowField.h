@@ -0,0 +1,85 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef QTPFS_FLOWFIELD_H_
+#define QTPFS_FLOWFIELD_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+#include "SearchQueue.h"
+#include "Sim/Misc/GlobalConstants.h"
+#include "System/type2.h"
+
+namespace QTPFS {
+	struct INode;
+	struct NodeLayer;
+
+	// Integration field towards a single goal node. For every leaf node that
+	// can reach the goal it holds the neighbour to move into next, the point on
+	// the edge shared with that neighbour and the cost of the remaining route.
+	// It is the backward half of a PathSearch run to exhaustion, with the same
+	// edge costs, so any search towards the goal node can be answered by just
+	// following it from the source node.
+	struct FlowField {
+	public:
+		FlowField(int goalNode, int frame)
+			: goalNodeIndex(goalNode)
+			, lastUsedFrame(frame)
+			{}
+
+		void Generate(const NodeLayer& nl, SearchPriorityQueue& openNodes);
+
+		bool CanReachGoal(int nodeIndex) const {
+			return (nodeIndex == goalNodeIndex) || (size_t(nodeIndex) < nextNodes.size() && nextNodes[nodeIndex] != -1);
+		}
+
+		int GetGoalNodeIndex() const { return goalNodeIndex; }
+		int GetNextNode(int nodeIndex) const { return nextNodes[nodeIndex]; }
+
+		// point on the edge between a node and GetNextNode, centre for the goal node
+		const float2& GetExitPoint(int nodeIndex) const { return exitPoints[nodeIndex]; }
+
+		int GetLastUsedFrame() const { return lastUsedFrame; }
+		void SetLastUsedFrame(int frame) { lastUsedFrame = frame; }
+
+		std::size_t GetMemFootPrint() const;
+
+	private:
+		std::vector<int> nextNodes;
+		std::vector<float2> exitPoints;
+		std::vector<float> costs;
+
+		int goalNodeIndex;
+		int lastUsedFrame;
+	};
+
+	// The flow-fields of one NodeLayer, keyed by goal node. Fields are created
+	// by the PathManager for goals that enough searches are queued towards in
+	// the same frame, and are dropped when the layer is re-tesselated since
+	// node indices are not stable across that.
+	struct FlowFieldCache {
+	public:
+		static constexpr int MAX_FIELDS = 8;
+		static constexpr int MAX_IDLE_FRAMES = GAME_SPEED * 30;
+
+		const FlowField* Find(int goalNodeIndex) const;
+		      FlowField* Find(int goalNodeIndex);
+
+		// Replaces the least recently used field once MAX_FIELDS are in use,
+		// but never one that was used in this frame; returns nullptr then.
+		FlowField* Insert(int goalNodeIndex, int frame);
+
+		void RemoveIdle(int frame);
+		void Clear() { fields.clear(); }
+
+		bool Empty() const { return fields.empty(); }
+
+		std::size_t GetMemFootPrint() const;
+
+	private:
+		std::vector<FlowField> fields;
+	};
+}
+
+#endif
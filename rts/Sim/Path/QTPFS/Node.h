@@ -25,11 +25,13 @@
 
 namespace QTPFS {
 	struct NodeLayer;
+	struct NodeLayerCache;
 	struct SearchNode;
 	struct UpdateThreadData;
 
 	struct INode {
 			friend SearchNode;
+			friend struct NodeLayerCache;
 	public:
 		struct NeighbourPoints {
 			int nodeId;
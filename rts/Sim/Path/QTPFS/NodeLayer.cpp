@@ -83,6 +83,9 @@ void QTPFS::NodeLayer::Clear() {
 	RECOIL_DETAILED_TRACY_ZONE;
 	curSpeedMods.clear();
 	curSpeedBins.clear();
+
+	abstractGraph.Clear();
+	flowFieldCache.Clear();
 }
 
 
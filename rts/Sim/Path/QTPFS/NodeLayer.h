@@ -11,6 +11,8 @@
 #include <cinttypes>
 
 #include "System/Rectangle.h"
+#include "AbstractGraph.h"
+#include "FlowField.h"
 #include "Node.h"
 #include "PathDefines.h"
 #include "PathThreads.h"
@@ -26,6 +28,7 @@ namespace QTPFS {
 	struct INode;
 
 	struct NodeLayer {
+		friend struct NodeLayerCache;
 	public:
 		static void InitStatic();
 		static size_t MaxSpeedModTypeValue() { return (std::numeric_limits<SpeedModType>::max()); }
@@ -141,6 +144,8 @@ namespace QTPFS {
 			}
 
 			memFootPrint += (nodeIndcs.size() * sizeof(decltype(nodeIndcs)::value_type));
+			memFootPrint += abstractGraph.GetMemFootPrint();
+			memFootPrint += flowFieldCache.GetMemFootPrint();
 			return memFootPrint;
 		}
 
@@ -155,6 +160,16 @@ namespace QTPFS {
 			return numRootNodes;
 		}
 
+		int GetXRootNodes() const { return xRootNodes; }
+		int GetZRootNodes() const { return zRootNodes; }
+		int GetRootNodeSize() const { return rootNodeSize; }
+
+		      AbstractGraph& GetAbstractGraph()       { return abstractGraph; }
+		const AbstractGraph& GetAbstractGraph() const { return abstractGraph; }
+
+		      FlowFieldCache& GetFlowFieldCache()       { return flowFieldCache; }
+		const FlowFieldCache& GetFlowFieldCache() const { return flowFieldCache; }
+
 		int GetNodelayer() const {
 			return layerNumber;
 		}
@@ -175,6 +190,9 @@ namespace QTPFS {
 		std::vector<SpeedModType> curSpeedMods;
 		std::vector<SpeedBinType> curSpeedBins;
 
+		AbstractGraph abstractGraph;
+		FlowFieldCache flowFieldCache;
+
 public:
 		static constexpr unsigned int NUM_POOL_CHUNKS = sizeof(poolNodes) / sizeof(poolNodes[0]);
 		static constexpr unsigned int POOL_TOTAL_SIZE = (1024 * 1024) / 2;
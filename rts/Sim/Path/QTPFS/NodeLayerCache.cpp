@@ -0,0 +1,421 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <type_traits>
+
+#include "NodeLayerCache.h"
+#include "NodeLayer.h"
+#include "Node.h"
+
+#include "Game/GameSetup.h"
+#include "Map/MapInfo.h"
+#include "Map/ReadMap.h"
+#include "Sim/MoveTypes/MoveDefHandler.h"
+#include "System/FileSystem/ArchiveScanner.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/FileSystem/FileSystem.h"
+#include "System/FileSystem/FileSystemAbstraction.h"
+#include "System/FileSystem/MemoryMappedFile.h"
+#include "System/Log/ILog.h"
+#include "System/SpringHash.h"
+#include "System/StringUtil.h"
+#include "System/Threading/ThreadPool.h"
+
+#include "System/Misc/TracyDefs.h"
+
+namespace {
+	struct FileHeader {
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t hash;
+		std::uint32_t pfsCheckSum;
+		std::uint32_t numLayers;
+		std::uint32_t maxDepth;
+		std::uint64_t tableHash;
+	};
+
+	struct LayerEntry {
+		std::uint64_t offset;
+		std::uint64_t size;
+		std::uint64_t hash;
+	};
+
+	struct LayerHeader {
+		std::uint32_t layerNumber;
+		std::uint32_t numLeafNodes;
+		std::uint32_t numOpenNodes;
+		std::uint32_t numClosedNodes;
+		std::int32_t maxNodesAlloced;
+		std::int32_t numRootNodes;
+		std::int32_t xRootNodes;
+		std::int32_t zRootNodes;
+		std::int32_t rootNodeSize;
+		std::uint32_t rootMask;
+		std::uint32_t numFreeNodes;
+	};
+
+	struct NodeRecord {
+		std::uint32_t nodeNumber;
+		std::uint32_t index;
+		std::uint16_t points[4];
+		float moveCostAvg;
+		std::uint32_t childBaseIndex;
+		std::uint32_t numNeighbours;
+	};
+
+	using NeighbourPoints = QTPFS::INode::NeighbourPoints;
+
+	static_assert(std::is_trivially_copyable_v<NeighbourPoints>, "NeighbourPoints are stored as raw bytes");
+	static_assert(sizeof(NodeRecord) == 28, "NodeRecord must not contain padding");
+
+
+	template<typename T> void Append(std::vector<std::uint8_t>& buffer, const T* items, size_t count) {
+		const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(items);
+		buffer.insert(buffer.end(), bytes, bytes + count * sizeof(T));
+	}
+	template<typename T> void Append(std::vector<std::uint8_t>& buffer, const T& item) {
+		Append(buffer, &item, 1);
+	}
+
+	// mapped data carries no alignment guarantees, hence the memcpy's
+	struct Reader {
+		template<typename T> bool Get(T* items, size_t count) {
+			if (count > size_t(end - pos) / sizeof(T))
+				return false;
+
+			std::memcpy(static_cast<void*>(items), pos, count * sizeof(T));
+			pos += (count * sizeof(T));
+			return true;
+		}
+		template<typename T> bool Get(T& item) { return Get(&item, 1); }
+
+		bool Skip(size_t bytes) {
+			if (bytes > size_t(end - pos))
+				return false;
+
+			pos += bytes;
+			return true;
+		}
+
+		bool AtEnd() const { return (pos == end); }
+
+		const std::uint8_t* pos;
+		const std::uint8_t* end;
+	};
+
+
+	std::string GetCacheDir() {
+		return (FileSystem::GetCacheDir() + FileSystemAbstraction::GetNativePathSeparator() + "paths" + FileSystemAbstraction::GetNativePathSeparator());
+	}
+
+	std::string GetCacheFileName(std::uint32_t hash) {
+		return (GetCacheDir() + mapInfo->map.name + ".qtpfs-" + IntToString(hash, "%x") + ".dat");
+	}
+}
+
+
+std::uint32_t QTPFS::NodeLayerCache::CalcHash(int rootSize) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	const auto& qtpfsConsts = mapInfo->pfs.qtpfs_constants;
+
+	const std::uint32_t mapChecksum = archiveScanner->GetArchiveCompleteChecksum(gameSetup->mapName);
+	const std::uint32_t hmChecksum = readMap->CalcHeightmapChecksum();
+	const std::uint32_t tmChecksum = readMap->CalcTypemapChecksum();
+	const std::uint32_t mdChecksum = moveDefHandler.GetCheckSum();
+
+	std::uint32_t hash = CACHE_VERSION;
+
+	hash = spring::LiteHash(mapChecksum, hash);
+	hash = spring::LiteHash(hmChecksum, hash);
+	hash = spring::LiteHash(tmChecksum, hash);
+	hash = spring::LiteHash(mdChecksum, hash);
+	hash = spring::LiteHash(qtpfsConsts.minNodeSizeX, hash);
+	hash = spring::LiteHash(qtpfsConsts.minNodeSizeZ, hash);
+	hash = spring::LiteHash(qtpfsConsts.maxNodeDepth, hash);
+	hash = spring::LiteHash(NodeLayer::NUM_SPEEDMOD_BINS, hash);
+	hash = spring::LiteHash(NodeLayer::MIN_SPEEDMOD_VALUE, hash);
+	hash = spring::LiteHash(NodeLayer::MAX_SPEEDMOD_VALUE, hash);
+	hash = spring::LiteHash(rootSize, hash);
+
+	LOG_L(L_DEBUG, "[NodeLayerCache::%s] CACHE_VERSION=%u", __func__, CACHE_VERSION);
+	LOG_L(L_DEBUG, "[NodeLayerCache::%s] mapChecksum=%x", __func__, mapChecksum);
+	LOG_L(L_DEBUG, "[NodeLayerCache::%s] heightMapChecksum=%x", __func__, hmChecksum);
+	LOG_L(L_DEBUG, "[NodeLayerCache::%s] typeMapChecksum=%x", __func__, tmChecksum);
+	LOG_L(L_DEBUG, "[NodeLayerCache::%s] moveDefChecksum=%x", __func__, mdChecksum);
+	LOG_L(L_DEBUG, "[NodeLayerCache::%s] cacheHashCode=%x", __func__, hash);
+
+	return hash;
+}
+
+
+bool QTPFS::NodeLayerCache::Exists(std::uint32_t hash) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	return (FileSystem::FileExists(GetCacheFileName(hash)));
+}
+
+bool QTPFS::NodeLayerCache::Read(std::vector<NodeLayer>& nodeLayers, std::uint32_t hash, std::uint32_t& pfsCheckSum) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	const std::string cacheFileName = GetCacheFileName(hash);
+
+	LOG("[NodeLayerCache::%s] file=\"%s\" (exists=%d)", __func__, cacheFileName.c_str(), FileSystem::FileExists(cacheFileName));
+
+	if (!FileSystem::FileExists(cacheFileName))
+		return false;
+
+	CMemoryMappedFile file(cacheFileName);
+
+	const auto RejectFile = [&](const char* reason) {
+		LOG_L(L_WARNING, "[NodeLayerCache::Read] discarding \"%s\" (%s)", cacheFileName.c_str(), reason);
+		// mapped files can not be removed on all platforms
+		file.Close();
+		FileSystem::Remove(cacheFileName);
+		return false;
+	};
+
+	if (!file.IsOpen())
+		return RejectFile("unreadable");
+
+	FileHeader header;
+	Reader reader = {file.GetData(), file.GetData() + file.GetSize()};
+
+	if (!reader.Get(header))
+		return RejectFile("truncated header");
+	if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION)
+		return RejectFile("version mismatch");
+	if (header.hash != hash || header.numLayers != nodeLayers.size() || header.maxDepth != QTNode::MAX_DEPTH)
+		return RejectFile("key mismatch");
+
+	std::vector<LayerEntry> layerTable(header.numLayers);
+
+	if (!reader.Get(layerTable.data(), layerTable.size()))
+		return RejectFile("truncated layer table");
+	if (XXH3_64bits(layerTable.data(), layerTable.size() * sizeof(LayerEntry)) != header.tableHash)
+		return RejectFile("corrupt layer table");
+
+	for (const LayerEntry& entry: layerTable) {
+		if (entry.offset > file.GetSize() || entry.size > (file.GetSize() - entry.offset))
+			return RejectFile("layer out of bounds");
+	}
+
+	// validate everything before any layer is touched, partially read
+	// layers would otherwise have to be torn down again by the caller
+	std::vector<std::uint8_t> layerValid(nodeLayers.size(), 0);
+
+	for_mt(0, nodeLayers.size(), [&](const int layerNum) {
+		const LayerEntry& entry = layerTable[layerNum];
+		const std::uint8_t* data = file.GetData() + entry.offset;
+
+		if (XXH3_64bits(data, entry.size) != entry.hash)
+			return;
+
+		layerValid[layerNum] = CheckLayer(nodeLayers[layerNum], data, entry.size);
+	});
+
+	if (std::find(layerValid.begin(), layerValid.end(), 0) != layerValid.end())
+		return RejectFile("corrupt node-layer");
+
+	for_mt(0, nodeLayers.size(), [&](const int layerNum) {
+		const LayerEntry& entry = layerTable[layerNum];
+		ReadLayer(nodeLayers[layerNum], file.GetData() + entry.offset, entry.size);
+	});
+
+	LOG("[NodeLayerCache::%s] read %u node-layers (%zuKB, mapped=%d)", __func__, header.numLayers, file.GetSize() / 1024, file.IsMapped());
+
+	pfsCheckSum = header.pfsCheckSum;
+	return true;
+}
+
+bool QTPFS::NodeLayerCache::Write(const std::vector<NodeLayer>& nodeLayers, std::uint32_t hash, std::uint32_t pfsCheckSum) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	const std::string cacheFileName = GetCacheFileName(hash);
+
+	if (!FileSystem::CreateDirectory(GetCacheDir()))
+		return false;
+
+	std::vector< std::vector<std::uint8_t> > layerData(nodeLayers.size());
+	std::vector<LayerEntry> layerTable(nodeLayers.size());
+
+	for_mt(0, nodeLayers.size(), [&](const int layerNum) {
+		WriteLayer(nodeLayers[layerNum], layerData[layerNum]);
+		layerTable[layerNum].size = layerData[layerNum].size();
+		layerTable[layerNum].hash = XXH3_64bits(layerData[layerNum].data(), layerData[layerNum].size());
+	});
+
+	std::uint64_t offset = sizeof(FileHeader) + layerTable.size() * sizeof(LayerEntry);
+
+	for (LayerEntry& entry: layerTable) {
+		entry.offset = offset;
+		offset += entry.size;
+	}
+
+	FileHeader header;
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.hash = hash;
+	header.pfsCheckSum = pfsCheckSum;
+	header.numLayers = nodeLayers.size();
+	header.maxDepth = QTNode::MAX_DEPTH;
+	header.tableHash = XXH3_64bits(layerTable.data(), layerTable.size() * sizeof(LayerEntry));
+
+	// several engine instances may share this cache, write into a private
+	// file first so that readers which have the final one mapped never see
+	// it truncated or half-written
+	const std::string tempFileName = cacheFileName + "." + IntToString(std::random_device()(), "%x") + ".tmp";
+	const std::string tempFilePath = dataDirsAccess.LocateFile(tempFileName, FileQueryFlags::WRITE);
+
+	std::ofstream ofs(tempFilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+
+	ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	ofs.write(reinterpret_cast<const char*>(layerTable.data()), layerTable.size() * sizeof(LayerEntry));
+
+	for (const auto& data: layerData) {
+		ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+	}
+
+	ofs.close();
+
+	if (!ofs.good()) {
+		FileSystem::Remove(tempFileName);
+		return false;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempFilePath, dataDirsAccess.LocateFile(cacheFileName, FileQueryFlags::WRITE), ec);
+
+	if (ec) {
+		// most likely another instance already put an identical file in place
+		LOG_L(L_WARNING, "[NodeLayerCache::%s] could not move \"%s\" into place (%s)", __func__, tempFileName.c_str(), ec.message().c_str());
+		FileSystem::Remove(tempFileName);
+		return false;
+	}
+
+	LOG("[NodeLayerCache::%s] wrote %u node-layers to \"%s\" (%" PRIu64 "KB)", __func__, header.numLayers, cacheFileName.c_str(), offset / 1024);
+	return true;
+}
+
+bool QTPFS::NodeLayerCache::Remove(std::uint32_t hash) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	return (FileSystem::Remove(GetCacheFileName(hash)));
+}
+
+
+void QTPFS::NodeLayerCache::WriteLayer(const NodeLayer& nl, std::vector<std::uint8_t>& buffer) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	LayerHeader header;
+	header.layerNumber = nl.layerNumber;
+	header.numLeafNodes = nl.numLeafNodes;
+	header.numOpenNodes = nl.numOpenNodes;
+	header.numClosedNodes = nl.numClosedNodes;
+	header.maxNodesAlloced = nl.maxNodesAlloced;
+	header.numRootNodes = nl.numRootNodes;
+	header.xRootNodes = nl.xRootNodes;
+	header.zRootNodes = nl.zRootNodes;
+	header.rootNodeSize = nl.rootNodeSize;
+	header.rootMask = nl.rootMask;
+	header.numFreeNodes = nl.nodeIndcs.size();
+
+	// nodes are stored in pool order, including free'd ones, so that all
+	// child and neighbour indices remain valid without any remapping
+	buffer.reserve(sizeof(LayerHeader) + nl.maxNodesAlloced * (sizeof(NodeRecord) + 4 * sizeof(NeighbourPoints)) + nl.nodeIndcs.size() * sizeof(unsigned int));
+
+	Append(buffer, header);
+
+	for (int32_t i = 0; i < nl.maxNodesAlloced; ++i) {
+		const INode* node = nl.GetPoolNode(i);
+
+		NodeRecord record;
+		record.nodeNumber = node->nodeNumber;
+		record.index = node->index;
+		std::copy(node->points.begin(), node->points.end(), std::begin(record.points));
+		record.moveCostAvg = node->moveCostAvg;
+		record.childBaseIndex = node->childBaseIndex;
+		record.numNeighbours = node->neighbours.size();
+
+		Append(buffer, record);
+		Append(buffer, node->neighbours.data(), node->neighbours.size());
+	}
+
+	Append(buffer, nl.nodeIndcs.data(), nl.nodeIndcs.size());
+}
+
+bool QTPFS::NodeLayerCache::CheckLayer(const NodeLayer& nl, const std::uint8_t* data, size_t size) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	LayerHeader header;
+	Reader reader = {data, data + size};
+
+	if (!reader.Get(header))
+		return false;
+
+	// root nodes are (re)created by InitNodeLayer, they have to agree
+	if (header.layerNumber != nl.layerNumber || header.numRootNodes != nl.numRootNodes || header.rootMask != nl.rootMask)
+		return false;
+	if (header.xRootNodes != nl.xRootNodes || header.zRootNodes != nl.zRootNodes || header.rootNodeSize != nl.rootNodeSize)
+		return false;
+	if (header.maxNodesAlloced < header.numRootNodes || header.maxNodesAlloced > int32_t(NodeLayer::POOL_TOTAL_SIZE))
+		return false;
+	if (header.numFreeNodes > NodeLayer::POOL_TOTAL_SIZE)
+		return false;
+
+	const std::uint32_t maxNodes = header.maxNodesAlloced;
+
+	for (std::uint32_t i = 0; i < maxNodes; ++i) {
+		NodeRecord record;
+
+		if (!reader.Get(record))
+			return false;
+		if (record.childBaseIndex != -1u && (std::uint64_t(record.childBaseIndex) + QTNODE_CHILD_COUNT) > maxNodes)
+			return false;
+
+		for (std::uint32_t n = 0; n < record.numNeighbours; ++n) {
+			NeighbourPoints ngb;
+
+			if (!reader.Get(ngb))
+				return false;
+			if (std::uint32_t(ngb.nodeId) >= maxNodes)
+				return false;
+		}
+	}
+
+	return (reader.Skip(header.numFreeNodes * sizeof(unsigned int)) && reader.AtEnd());
+}
+
+void QTPFS::NodeLayerCache::ReadLayer(NodeLayer& nl, const std::uint8_t* data, size_t size) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	LayerHeader header;
+	Reader reader = {data, data + size};
+
+	reader.Get(header);
+
+	nl.numLeafNodes = header.numLeafNodes;
+	nl.numOpenNodes = header.numOpenNodes;
+	nl.numClosedNodes = header.numClosedNodes;
+	nl.maxNodesAlloced = header.maxNodesAlloced;
+
+	for (size_t i = 0, n = (header.maxNodesAlloced + NodeLayer::POOL_CHUNK_SIZE - 1) / NodeLayer::POOL_CHUNK_SIZE; i < n; ++i) {
+		nl.poolNodes[i].resize(NodeLayer::POOL_CHUNK_SIZE);
+	}
+
+	for (int32_t i = 0; i < header.maxNodesAlloced; ++i) {
+		INode* node = nl.GetPoolNode(i);
+		NodeRecord record;
+
+		reader.Get(record);
+
+		node->nodeNumber = record.nodeNumber;
+		node->index = record.index;
+		std::copy(std::begin(record.points), std::end(record.points), node->points.begin());
+		node->moveCostAvg = record.moveCostAvg;
+		node->childBaseIndex = record.childBaseIndex;
+
+		node->neighbours.resize(record.numNeighbours);
+		reader.Get(node->neighbours.data(), record.numNeighbours);
+	}
+
+	nl.nodeIndcs.resize(header.numFreeNodes);
+	reader.Get(nl.nodeIndcs.data(), nl.nodeIndcs.size());
+}
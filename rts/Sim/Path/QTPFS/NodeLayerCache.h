@@ -0,0 +1,42 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef QTPFS_NODELAYERCACHE_H_
+#define QTPFS_NODELAYERCACHE_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+namespace QTPFS {
+	struct NodeLayer;
+
+	// On-disk copy of the fully tesselated node-layers, written after the
+	// first load of a map and memory-mapped on subsequent ones so that
+	// PathManager::Load can skip InitNodeLayersThreaded entirely.
+	//
+	// The file is keyed by everything the initial tesselation depends on
+	// (map archive, height- and typemap, MoveDefs, QTPFS map-constants and
+	// root-node size) and additionally carries the pfs-checksum of the
+	// layers it was written from, which the caller verifies after reading.
+	struct NodeLayerCache {
+	public:
+		static constexpr std::uint32_t CACHE_MAGIC = 0x53465451; // "QTFS"
+		static constexpr std::uint32_t CACHE_VERSION = 1;
+
+		static std::uint32_t CalcHash(int rootSize);
+
+		static bool Exists(std::uint32_t hash);
+
+		// layers must have been through PathManager::InitNodeLayer already
+		static bool Read(std::vector<NodeLayer>& nodeLayers, std::uint32_t hash, std::uint32_t& pfsCheckSum);
+		static bool Write(const std::vector<NodeLayer>& nodeLayers, std::uint32_t hash, std::uint32_t pfsCheckSum);
+		static bool Remove(std::uint32_t hash);
+
+	private:
+		static void WriteLayer(const NodeLayer& nl, std::vector<std::uint8_t>& buffer);
+		static bool CheckLayer(const NodeLayer& nl, const std::uint8_t* data, size_t size);
+		static void ReadLayer(NodeLayer& nl, const std::uint8_t* data, size_t size);
+	};
+}
+
+#endif
@@ -37,6 +37,10 @@ static constexpr uint32_t QTPFS_PARTIAL_SHARE_PATH_MAX_SIZE = 32;
 
 static constexpr uint32_t QTPFS_MAP_DAMAGE_SIZE = 16;
 
+// Number of times a path repair is tried before falling back to a full search. Each retry happens when the previous
+// attempt could not be completed inside its search area, and grows that area by its original size.
+static constexpr uint32_t QTPFS_MAX_PATH_REPAIR_ATTEMPTS = 2;
+
 // Though there are four quads per level, having nothing is like a 5th state. So 3 bits, not 2, is needed per level.
 static constexpr uint32_t QTPFS_NODE_NUMBER_SHIFT_STEP = 3;
 
@@ -13,6 +13,7 @@
 #include "System/Threading/ThreadPool.h"
 #include "System/Threading/SpringThreading.h"
 
+#include "NodeLayerCache.h"
 #include "PathDefines.h"
 #include "PathManager.h"
 
@@ -57,6 +58,7 @@
 #define MAP_RECTANGLE SRectangle(0, 0,  mapDims.mapx, mapDims.mapy)
 
 CONFIG(int, PathingThreadCount).defaultValue(0).safemodeValue(1).minimumValue(0);
+CONFIG(bool, PathingNodeLayerCache).defaultValue(true).safemodeValue(false).description("Store tesselated QTPFS node-layers in the cache directory and reuse them on the next load of the same map.");
 
 namespace QTPFS {
 	struct PMLoadScreen {
@@ -253,6 +255,7 @@ std::int64_t QTPFS::PathManager::PostFinalizeRefresh() {
 			int layerNum = nodeLayerUpdatePriorityOrder[index];
 			int blocksToUpdate = nodeLayersMapDamageTrack.mapChangeTrackers[layerNum].damageQueue.size();
 			for (int i = 0; i < blocksToUpdate; ++i) { UpdateNodeLayer(layerNum, rect, curThread); }
+			nodeLayers[layerNum].GetAbstractGraph().Update(nodeLayers[layerNum]);
 		});
 
 		PathSpeedModInfoSystem::Init();
@@ -304,6 +307,8 @@ void QTPFS::PathManager::Load() {
 	// NOTE: offset *must* start at a non-zero value
 	searchStateOffset = NODE_STATE_OFFSET;
 	numPathRequests   = 0;
+	numPathsRepaired  = 0;
+	numPathsReplanned = 0;
 	int maxAllocedNodes   = 0;
 
 	deadPathsToUpdatePerFrame = 1;
@@ -365,7 +370,21 @@ void QTPFS::PathManager::Load() {
 		sha512::dump_digest(mapCheckSum, mapCheckSumHex);
 		sha512::dump_digest(modCheckSum, modCheckSumHex);
 
-		InitNodeLayersThreaded(MAP_RECTANGLE);
+		useNodeLayerCache = configHandler->GetBool("PathingNodeLayerCache");
+		nodeLayerCacheHash = NodeLayerCache::CalcHash(rootSize);
+
+		if (!ReadNodeLayerCache(MAP_RECTANGLE)) {
+			InitNodeLayersThreaded(MAP_RECTANGLE);
+			WriteNodeLayerCache();
+		}
+
+		// cluster graphs are only maintained when the game asks for them
+		if (modInfo.qtAbstractSearchMinDist > 0.0f) {
+			for_mt(0, nodeLayers.size(), [this](const int layerNum) {
+				nodeLayers[layerNum].GetAbstractGraph().Init(nodeLayers[layerNum]);
+			});
+		}
+
 		PathSpeedModInfoSystem::Init();
 		RemoveDeadPathsSystem::Init();
 		RequeuePathsSystem::Init();
@@ -510,6 +529,65 @@ void QTPFS::PathManager::InitNodeLayersThreaded(const SRectangle& rect) {
 	streflop::streflop_init<streflop::Simple>();
 }
 
+bool QTPFS::PathManager::ReadNodeLayerCache(const SRectangle& rect) {
+	RECOIL_DETAILED_TRACY_ZONE;
+	if (!useNodeLayerCache || !NodeLayerCache::Exists(nodeLayerCacheHash))
+		return false;
+
+	// root nodes, masks and MAX_DEPTH are derived as usual, the cache
+	// only supplies the result of tesselating them
+	for (unsigned int layerNum = 0; layerNum < nodeLayers.size(); layerNum++) {
+		InitNodeLayer(layerNum, rect);
+	}
+
+	std::uint32_t cacheCheckSum = 0;
+	const bool haveCache = NodeLayerCache::Read(nodeLayers, nodeLayerCacheHash, cacheCheckSum);
+
+	if (haveCache && cacheCheckSum == CalcNodeLayersCheckSum()) {
+		pmLoadScreen.AddMessage("[PathManager::" + std::string(__func__) + "] read node-layers from cache");
+		return true;
+	}
+
+	if (haveCache) {
+		LOG_L(L_WARNING, "[QTPFS::%s] cached node-layers do not match their checksum %08x, rebuilding", __func__, cacheCheckSum);
+		NodeLayerCache::Remove(nodeLayerCacheHash);
+	}
+
+	// start over from pristine layers, InitNodeLayer is not idempotent
+	const size_t numLayers = nodeLayers.size();
+
+	nodeLayers.clear();
+	nodeLayers.resize(numLayers);
+	return false;
+}
+
+void QTPFS::PathManager::WriteNodeLayerCache() {
+	RECOIL_DETAILED_TRACY_ZONE;
+	if (!useNodeLayerCache)
+		return;
+
+	if (!NodeLayerCache::Write(nodeLayers, nodeLayerCacheHash, CalcNodeLayersCheckSum()))
+		LOG_L(L_WARNING, "[QTPFS::%s] failed to write node-layer cache", __func__);
+}
+
+std::uint32_t QTPFS::PathManager::CalcNodeLayersCheckSum() const {
+	RECOIL_DETAILED_TRACY_ZONE;
+	std::uint32_t checkSum = 0;
+
+	for (const NodeLayer& nodeLayer: nodeLayers) {
+		for (int i = 0; i < nodeLayer.GetRootNodeCount(); ++i) {
+			checkSum ^= nodeLayer.GetPoolNode(i)->GetCheckSum(nodeLayer);
+		}
+	}
+
+	return checkSum;
+}
+
+void QTPFS::PathManager::RemoveCacheFiles() {
+	RECOIL_DETAILED_TRACY_ZONE;
+	NodeLayerCache::Remove(nodeLayerCacheHash);
+}
+
 void QTPFS::PathManager::InitRootSize(const SRectangle& r) {
 	RECOIL_DETAILED_TRACY_ZONE;
 	// setup the root node system
@@ -681,6 +759,9 @@ void QTPFS::PathManager::UpdateNodeLayer(unsigned int layerNum, const SRectangle
 		#ifndef QTPFS_CONSERVATIVE_NEIGHBOR_CACHE_UPDATES
 		nodeLayers[layerNum].ExecNodeNeighborCacheUpdates(ur, updateThreadData[currentThread]);
 		#endif
+
+		nodeLayer.GetAbstractGraph().MarkDirty(ur);
+		nodeLayer.GetFlowFieldCache().Clear();
 	}
 }
 
@@ -761,6 +842,7 @@ void QTPFS::PathManager::Update() {
 			int layerNum = nodeLayerUpdatePriorityOrder[index];
 			int blocksToUpdate = numBlocksToUpdate(layerNum);
 			for (int i = 0; i < blocksToUpdate; ++i) { UpdateNodeLayer(layerNum, rect, curThread); }
+			nodeLayers[layerNum].GetAbstractGraph().Update(nodeLayers[layerNum]);
 		});
 
 		// Mark all dirty paths so that they can be recalculated
@@ -920,10 +1002,84 @@ void QTPFS::PathManager::ReadyQueuedSearches() {
 	}
 }
 
+void QTPFS::PathManager::GenerateFlowFields() {
+	ZoneScoped;
+
+	if (modInfo.qtFlowFieldMinRequests <= 0)
+		return;
+
+	for (auto& nodeLayer: nodeLayers) {
+		nodeLayer.GetFlowFieldCache().RemoveIdle(gs->frameNum);
+	}
+
+	auto pathView = registry.group<PathSearch, ProcessPath>();
+
+	flowFieldGoals.clear();
+	flowFieldGoalIndices.clear();
+	flowFieldsToGenerate.clear();
+
+	// Count the searches per goal node in the order they were queued. Only synced searches
+	// count; they decide which fields exist, and so which paths all clients get.
+	for (auto pathSearchEntity: pathView) {
+		const PathSearch& search = pathView.get<PathSearch>(pathSearchEntity);
+
+		if (!search.synced || search.rawPathCheck)
+			continue;
+
+		const int pathType = search.GetPathType();
+		const float3& goalPos = search.GetGoalPos();
+		const int goalNodeIndex = nodeLayers[pathType].GetNode(goalPos.x / SQUARE_SIZE, goalPos.z / SQUARE_SIZE)->GetIndex();
+		const std::uint64_t goalKey = (std::uint64_t(pathType) << 32) | std::uint32_t(goalNodeIndex);
+
+		const auto iter = flowFieldGoalIndices.find(goalKey);
+
+		if (iter == flowFieldGoalIndices.end()) {
+			flowFieldGoalIndices.emplace(goalKey, flowFieldGoals.size());
+			flowFieldGoals.push_back({pathType, goalNodeIndex, 1});
+		} else {
+			flowFieldGoals[iter->second].numSearches += 1;
+		}
+	}
+
+	for (const FlowFieldGoal& goal: flowFieldGoals) {
+		NodeLayer& nodeLayer = nodeLayers[goal.pathType];
+		FlowFieldCache& flowFieldCache = nodeLayer.GetFlowFieldCache();
+		FlowField* flowField = flowFieldCache.Find(goal.goalNodeIndex);
+
+		if (flowField != nullptr) {
+			flowField->SetLastUsedFrame(gs->frameNum);
+			continue;
+		}
+
+		if (goal.numSearches < modInfo.qtFlowFieldMinRequests)
+			continue;
+
+		// searches to these get their goal moved, see PathSearch::InitializeThread
+		const INode* goalNode = nodeLayer.GetPoolNode(goal.goalNodeIndex);
+		if (goalNode->AllSquaresImpassable() || goalNode->IsExitOnly())
+			continue;
+
+		if ((flowField = flowFieldCache.Insert(goal.goalNodeIndex, gs->frameNum)) == nullptr)
+			continue;
+
+		flowFieldsToGenerate.emplace_back(goal.pathType, flowField);
+	}
+
+	for_mt(0, flowFieldsToGenerate.size(), [this](int i) {
+		auto& [pathType, flowField] = flowFieldsToGenerate[i];
+		auto& threadData = searchThreadData[ThreadPool::GetThreadNum()];
+
+		flowField->Generate(nodeLayers[pathType], threadData.openNodes[SearchThreadData::SEARCH_FORWARD]);
+	});
+
+	TracyPlot("QTPFS::FlowFieldsGenerated", int64_t(flowFieldsToGenerate.size()));
+}
+
 void QTPFS::PathManager::ExecuteQueuedSearches() {
 	ZoneScoped;
 
 	ReadyQueuedSearches();
+	GenerateFlowFields();
 
 	auto pathView = registry.group<PathSearch, ProcessPath>();
 
@@ -971,6 +1127,18 @@ void QTPFS::PathManager::ExecuteQueuedSearches() {
 			// Only owned paths should be actioned in this function.
 			IPath* path = registry.try_get<IPath>(pathEntity);
 			if (path != nullptr) {
+				if (search->isRequeued) {
+					// only count the final outcome, not the attempts that queue another search
+					const bool searchRequeued = search->pathRequestWaiting
+							|| search->rejectPartialSearch
+							|| (search->rawPathCheck && !search->PathWasFound());
+
+					if (!searchRequeued) {
+						numPathsRepaired += search->doPathRepair;
+						numPathsReplanned += !search->doPathRepair;
+					}
+				}
+
 				if (search->PathWasFound()) {
 					completePath(pathEntity, path);
 					// LOG("%s: %x - path found", __func__, entt::to_integral(pathEntity));
@@ -988,7 +1156,13 @@ void QTPFS::PathManager::ExecuteQueuedSearches() {
 						// LOG("%s: %x - waiting for partial root path", __func__, entt::to_integral(pathEntity));
 						// continue;
 						registry.remove<PathSearchRef>(pathEntity);
-						RequeueSearch(path, false, search->allowPartialSearch, false);
+
+						// A repair that could not be linked up inside its search area gets another go with a larger
+						// area before the whole path is searched again.
+						const unsigned int repairAttempt = search->repairAttempt + search->doPathRepair;
+						const bool retryRepair = search->doPathRepair && (repairAttempt < QTPFS_MAX_PATH_REPAIR_ATTEMPTS);
+
+						RequeueSearch(path, false, search->allowPartialSearch, retryRepair, repairAttempt);
 					} else if (search->rejectPartialSearch) {
 						registry.remove<PathSearchRef>(pathEntity);
 						RequeueSearch(path, false, false, false);
@@ -1052,6 +1226,13 @@ bool QTPFS::PathManager::ExecuteSearch(
 	QTPFS::entity chainHeadEntity = entt::null;
 	QTPFS::entity partialChainHeadEntity = entt::null;
 
+	const FlowField* flowField = nullptr;
+
+	if (modInfo.qtFlowFieldMinRequests > 0 && !search->rawPathCheck) {
+		const float3& goalPos = search->GetGoalPos();
+		flowField = nodeLayer.GetFlowFieldCache().Find(nodeLayer.GetNode(goalPos.x / SQUARE_SIZE, goalPos.z / SQUARE_SIZE)->GetIndex());
+	}
+
 	// TODO: make a function?
 	if (path->GetOwner() != nullptr)
 	{
@@ -1060,7 +1241,8 @@ bool QTPFS::PathManager::ExecuteSearch(
 		if (search->doPartialSearch)
 			search->doPartialSearch = false;
 
-		if (search->allowPartialSearch)
+		// No point waiting to share part of another path if the field can answer the search.
+		if (search->allowPartialSearch && flowField == nullptr)
 		{
 			PartialSharedPathMap::const_iterator partialSharedPathsIt = partialSharedPaths.find(path->GetVirtualHash());
 			if (partialSharedPathsIt != partialSharedPaths.end()) {
@@ -1148,6 +1330,7 @@ bool QTPFS::PathManager::ExecuteSearch(
 	search->tryPathRepair &= isHeadOfPathSharing;
 
 	search->InitializeThread(&searchThreadData[currentThread]);
+	search->SetFlowField(flowField);
 
 	if (search->doPartialSearch) {
 		auto* path = &registry.get<IPath>(partialChainHeadEntity);
@@ -1314,7 +1497,7 @@ unsigned int QTPFS::PathManager::QueueSearch(
 // #pragma GCC pop_options
 
 unsigned int QTPFS::PathManager::RequeueSearch(
-	IPath* oldPath, const bool allowRawSearch, const bool allowPartialSearch, const bool allowRepair
+	IPath* oldPath, const bool allowRawSearch, const bool allowPartialSearch, const bool allowRepair, const unsigned int repairAttempt
 ) {
 	RECOIL_DETAILED_TRACY_ZONE;
 	assert(!ThreadPool::inMultiThreadedSection);
@@ -1366,6 +1549,8 @@ unsigned int QTPFS::PathManager::RequeueSearch(
 	newSearch->synced = oldPath->IsSynced();
 
 	newSearch->tryPathRepair = allowRepair;
+	newSearch->isRequeued = true;
+	newSearch->repairAttempt = repairAttempt;
 
 	registry.emplace_or_replace<PathSearchRef>(pathEntity, searchEntity);
 
@@ -1724,6 +1909,10 @@ void QTPFS::PathManager::GetPathWayPoints(
 	}
 }
 
+int2 QTPFS::PathManager::GetNumPathRepairs() const {
+	return {numPathsRepaired, numPathsReplanned};
+}
+
 int2 QTPFS::PathManager::GetNumQueuedUpdates() const {
 	RECOIL_DETAILED_TRACY_ZONE;
 	int2 data;
@@ -86,6 +86,9 @@ namespace QTPFS {
 		) const override;
 
 		int2 GetNumQueuedUpdates() const override;
+		int2 GetNumPathRepairs() const override;
+
+		void RemoveCacheFiles() override;
 
 
 		const NodeLayer& GetNodeLayer(unsigned int pathType) const { return nodeLayers[pathType]; }
@@ -123,12 +126,17 @@ namespace QTPFS {
 		void InitRootSize(const SRectangle& r);
 		void UpdateNodeLayer(unsigned int layerNum, const SRectangle& r, int currentThread);
 
+		bool ReadNodeLayerCache(const SRectangle& rect);
+		void WriteNodeLayerCache();
+		std::uint32_t CalcNodeLayersCheckSum() const;
+
 		bool InitializeSearch(QTPFS::entity searchEntity);
 		void RemovePathFromShared(QTPFS::entity entity);
 		void RemovePathFromPartialShared(QTPFS::entity entity);
 		void RemovePathSearch(QTPFS::entity pathEntity);
 
 		void ReadyQueuedSearches();
+		void GenerateFlowFields();
 		void ExecuteQueuedSearches();
 		void QueueDeadPathSearches();
 
@@ -147,7 +155,8 @@ namespace QTPFS {
 			IPath* oldPath,
 			const bool allowRawSearch,
 			const bool allowPartialSearch,
-			const bool allowRepair
+			const bool allowRepair,
+			const unsigned int repairAttempt = 0
 		);
 
 	private:
@@ -172,6 +181,17 @@ namespace QTPFS {
 		std::vector<UpdateThreadData> updateThreadData;
 		std::vector<unsigned char> nodeLayerUpdatePriorityOrder;
 
+		struct FlowFieldGoal {
+			int pathType;
+			int goalNodeIndex;
+			int numSearches;
+		};
+
+		// scratch space for GenerateFlowFields
+		std::vector<FlowFieldGoal> flowFieldGoals;
+		spring::unordered_map<std::uint64_t, size_t> flowFieldGoalIndices;
+		std::vector<std::pair<int, FlowField*>> flowFieldsToGenerate;
+
 		PathTraceMap pathTraces;
 		SharedPathMap sharedPaths;
 		PartialSharedPathMap partialSharedPaths;
@@ -195,11 +215,17 @@ namespace QTPFS {
 		std::int32_t updateDirtyPathRate = 0;
 		std::int32_t updateDirtyPathRemainder = 0;
 
+		// invalidated paths that were repaired in place vs. searched again from scratch
+		std::int32_t numPathsRepaired = 0;
+		std::int32_t numPathsReplanned = 0;
+
 		std::uint32_t pfsCheckSum;
+		std::uint32_t nodeLayerCacheHash = 0;
 
 		QTPFS::entity systemEntity = entt::null;
 
 		bool isFinalized = false;
+		bool useNodeLayerCache = false;
 
 		static constexpr size_t INITIAL_PATH_RESERVE = 256;
 	};
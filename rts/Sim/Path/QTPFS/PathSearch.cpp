@@ -268,9 +268,7 @@ void QTPFS::PathSearch::InitializeThread(SearchThreadData* threadData) {
 		auto& data = directionalSearchData[i];
 		data.openNodes = &searchThreadData->openNodes[i];
 		data.minSearchNode = data.srcSearchNode;
-
-		while (!data.openNodes->empty())
-			data.openNodes->pop();
+		data.openNodes->clear();
 	}
 
 	// Set search boundaries for path repairs. If a repair cannot be made within the boundaries then the path is better
@@ -281,7 +279,7 @@ void QTPFS::PathSearch::InitializeThread(SearchThreadData* threadData) {
 
 		const float3 diff = (fwd.tgtPoint  - fwd.srcPoint) / 2.f;
 		const float3 midPoint = fwd.srcPoint + diff;
-		const float searchHalfWidth = std::max(abs(diff.x), abs(diff.z));
+		const float searchHalfWidth = std::max(abs(diff.x), abs(diff.z)) * (repairAttempt + 1);
 
 		searchLimitMins = midPoint - searchHalfWidth;
 		searchLimitMaxs = midPoint + searchHalfWidth;
@@ -546,9 +544,136 @@ bool QTPFS::PathSearch::Execute(unsigned int searchStateOffset) {
 	if (rawPathCheck)
 		return ExecuteRawSearch();
 
+	// Repairs and partial searches link up with existing paths, which the field knows nothing about.
+	if (flowField != nullptr && !doPathRepair && !doPartialSearch && ExecuteFlowFieldSearch())
+		return true;
+
+	// Long searches are first planned over the layer's cluster graph. Repairs and partial
+	// searches are already bounded by the path they are linking up with.
+	const bool tryCorridorSearch = (modInfo.qtAbstractSearchMinDist > 0.f)
+			&& !doPathRepair
+			&& !doPartialSearch
+			&& (fwd.srcPoint.SqDistance2D(fwd.tgtPoint) >= Square(modInfo.qtAbstractSearchMinDist));
+
+	if (tryCorridorSearch && ExecuteCorridorSearch())
+		return true;
+
 	return ExecutePathSearch();
 }
 
+bool QTPFS::PathSearch::ExecuteCorridorSearch() {
+	ZoneScoped;
+	auto& fwd = directionalSearchData[SearchThreadData::SEARCH_FORWARD];
+	auto& bwd = directionalSearchData[SearchThreadData::SEARCH_BACKWARD];
+	auto& abstractSearchData = searchThreadData->abstractSearchData;
+
+	UpdateHcostMult();
+
+	const INode* srcNode = nodeLayer->GetPoolNode(fwd.srcSearchNode->GetIndex());
+	const INode* tgtNode = nodeLayer->GetPoolNode(fwd.tgtSearchNode->GetIndex());
+
+	useCorridor = nodeLayer->GetAbstractGraph().FindCorridor(srcNode, tgtNode, hCostMult, abstractSearchData);
+
+	TracyPlot("QTPFS::AbstractRegionsSearched", int64_t(abstractSearchData.numRegionsSearched));
+
+	if (!useCorridor)
+		return false;
+
+	// ExecutePathSearch can move the end points, keep them for the fall-back
+	const float3 srcPoints[] = {fwd.srcPoint, bwd.srcPoint};
+	const float3 tgtPoints[] = {fwd.tgtPoint, bwd.tgtPoint};
+
+	ExecutePathSearch();
+	useCorridor = false;
+
+	TracyPlot("QTPFS::CorridorNodesSearched", int64_t(fwdNodesSearched + bwdNodesSearched));
+
+	if (haveFullPath)
+		return true;
+
+	// The region graph treats partially blocked and exit-only nodes as open, so the corridor
+	// can occasionally be a dead end. Start over without it; the result must be the same as
+	// if no corridor had been tried.
+	fwd.srcPoint = srcPoints[SearchThreadData::SEARCH_FORWARD];
+	bwd.srcPoint = srcPoints[SearchThreadData::SEARCH_BACKWARD];
+	fwd.tgtPoint = tgtPoints[SearchThreadData::SEARCH_FORWARD];
+	bwd.tgtPoint = tgtPoints[SearchThreadData::SEARCH_BACKWARD];
+
+	#ifdef QTPFS_TRACE_PATH_SEARCHES
+	delete searchExec;
+	searchExec = nullptr;
+	#endif
+
+	havePartPath = false;
+	useFwdPathOnly = false;
+	searchEarlyDrop = false;
+	fwdNodesSearched = 0;
+	bwdNodesSearched = 0;
+
+	InitializeThread(searchThreadData);
+	return false;
+}
+
+bool QTPFS::PathSearch::ExecuteFlowFieldSearch() {
+	ZoneScoped;
+	auto& fwd = directionalSearchData[SearchThreadData::SEARCH_FORWARD];
+	auto& bwd = directionalSearchData[SearchThreadData::SEARCH_BACKWARD];
+	auto& fwdSearchNodes = searchThreadData->allSearchedNodes[SearchThreadData::SEARCH_FORWARD];
+
+	const int tgtNodeIndex = fwd.tgtSearchNode->GetIndex();
+
+	// The target may have been moved off a closed or exit-only node, in which case the
+	// search has to find out how close it can get.
+	if (badGoal || flowField->GetGoalNodeIndex() != tgtNodeIndex)
+		return false;
+	if (!flowField->CanReachGoal(fwd.srcSearchNode->GetIndex()))
+		return false;
+
+	UpdateHcostMult();
+	InitStartingSearchNodes();
+
+	// Lay out the nodes the field leads through as if the forward search had expanded just
+	// those, and link up with the backward search at its starting (i.e. the goal) node, the
+	// same way ExecutePathSearch does when the two searches meet there.
+	SearchNode* prvSearchNode = fwd.srcSearchNode;
+	int curNodeIndex = fwd.srcSearchNode->GetIndex();
+
+	InitSearchNodeData(prvSearchNode, nodeLayer->GetPoolNode(curNodeIndex));
+
+	for (int nxtNodeIndex = flowField->GetNextNode(curNodeIndex); nxtNodeIndex != tgtNodeIndex; nxtNodeIndex = flowField->GetNextNode(curNodeIndex)) {
+		const INode* curNode = nodeLayer->GetPoolNode(curNodeIndex);
+		const float2& prvPoint = prvSearchNode->GetNeighborEdgeTransitionPoint();
+		const float2& nxtPoint = flowField->GetExitPoint(curNodeIndex);
+		const float curMoveCost = curNode->AllSquaresImpassable() ? QTPFS_CLOSED_NODE_COST : curNode->GetMoveCost();
+		const float gCost = prvSearchNode->GetPathCost(NODE_PATH_COST_G) + curMoveCost * prvPoint.Distance(nxtPoint);
+
+		SearchNode* nxtSearchNode = &fwdSearchNodes.InsertINodeIfNotPresent(nxtNodeIndex);
+
+		InitSearchNodeData(nxtSearchNode, nodeLayer->GetPoolNode(nxtNodeIndex));
+		LocalUpdateNode(nxtSearchNode, prvSearchNode, gCost, 0.0f, nxtPoint);
+
+		prvSearchNode = nxtSearchNode;
+		curNodeIndex = nxtNodeIndex;
+		fwdNodesSearched++;
+	}
+
+	const float2& lastPoint = flowField->GetExitPoint(curNodeIndex);
+
+	fwd.tgtSearchNode = prvSearchNode;
+	fwd.minSearchNode = prvSearchNode;
+	bwd.tgtSearchNode = bwd.srcSearchNode;
+	bwd.tgtPoint = float3(lastPoint.x, 0.0f, lastPoint.y);
+
+	AssertPointIsOnNodeEdge(bwd.tgtPoint, fwd.tgtSearchNode);
+
+	searchThreadData->ResetQueue();
+
+	TracyPlot("QTPFS::FlowFieldNodesFollowed", int64_t(fwdNodesSearched));
+
+	haveFullPath = true;
+	return true;
+}
+
 void QTPFS::PathSearch::InitStartingSearchNodes() {
 	RECOIL_DETAILED_TRACY_ZONE;
 	fwdPathConnected = false;
@@ -1354,6 +1479,14 @@ void QTPFS::PathSearch::IterateNodes(unsigned int searchDir) {
 		if (curSearchNode->zmax*SQUARE_SIZE < searchLimitMins.z) { return; }
 	}
 
+	// Long searches are restricted to the corridor found over the cluster graph.
+	if (useCorridor) {
+		const AbstractGraph& abstractGraph = nodeLayer->GetAbstractGraph();
+
+		if (!searchThreadData->abstractSearchData.InCorridor(abstractGraph.GetClusterIndex(curSearchNode->xmin, curSearchNode->zmin)))
+			return;
+	}
+
 	// Check if we've linked up with the other search
 	auto& otherNodes = searchThreadData->allSearchedNodes[1 - searchDir];
 	if (otherNodes.isSet(curSearchNode->GetIndex())){
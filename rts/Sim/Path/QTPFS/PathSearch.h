@@ -14,6 +14,7 @@
 struct CollisionVolume;
 
 namespace QTPFS {
+	struct FlowField;
 	struct IPath;
 	struct NodeLayer;
 	struct PathCache;
@@ -129,6 +130,9 @@ namespace QTPFS {
 		int GetPathType() const { return pathType; }
 
 		void SetGoalDistance(float dist) { goalDistance = dist; }
+		const float3& GetGoalPos() const { return goalPos; }
+
+		void SetFlowField(const FlowField* field) { flowField = field; }
 
 		const CSolidObject* Getowner() const { return pathOwner; }
 
@@ -182,6 +186,8 @@ namespace QTPFS {
 
 		bool ExecutePathSearch();
 		bool ExecuteRawSearch();
+		bool ExecuteCorridorSearch();
+		bool ExecuteFlowFieldSearch();
 
 		void SetForwardSearchLimit();
 
@@ -211,6 +217,9 @@ namespace QTPFS {
 
 		const CSolidObject* pathOwner;
 		NodeLayer* nodeLayer;
+
+		// set by the PathManager if there is a field towards our goal node
+		const FlowField* flowField = nullptr;
 		int pathType;
 
 		// not used unless QTPFS_TRACE_PATH_SEARCHES is defined
@@ -260,6 +269,11 @@ public:
 		bool initialized = false;
 		bool partialReverseTrace = false;
 		bool doPathRepair = false;
+		bool useCorridor = false;
+		bool isRequeued = false;
+
+		// number of earlier repair attempts for this path that could not be completed
+		unsigned int repairAttempt = 0;
 
 		bool fwdPathConnected = false;
 		bool bwdPathConnected = false;
@@ -0,0 +1,42 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef QTPFS_SEARCH_QUEUE_H_
+#define QTPFS_SEARCH_QUEUE_H_
+
+#include <queue>
+#include <tuple>
+#include <vector>
+
+namespace QTPFS {
+	struct SearchQueueNode {
+		SearchQueueNode(int index, float newPriorty)
+			: heapPriority(newPriorty)
+			, nodeIndex(index)
+			{}
+
+		float heapPriority;
+		int nodeIndex;
+	};
+
+	/// Functor to define node priority.
+	/// Needs to guarantee stable ordering, even if the sorting algorithm itself is not stable.
+	struct ShouldMoveTowardsBottomOfPriorityQueue {
+		inline bool operator() (const SearchQueueNode& lhs, const SearchQueueNode& rhs) const {
+			return std::tie(lhs.heapPriority, lhs.nodeIndex) > std::tie(rhs.heapPriority, rhs.nodeIndex);
+		}
+	};
+
+	/// std::priority_queue plus a clear() that drops its elements in one go,
+	/// rather than popping (and re-heapifying) them one by one.
+	template<typename T, typename Compare> class std_priority_queue: public std::priority_queue<T, std::vector<T>, Compare> {
+	public:
+		void clear() { this->c.clear(); }
+	};
+
+
+	// Reminder that std::priority does comparisons to push element back to the bottom. So using
+	// ShouldMoveTowardsBottomOfPriorityQueue here means the smallest value will be top()
+	typedef std_priority_queue<SearchQueueNode, ShouldMoveTowardsBottomOfPriorityQueue> SearchPriorityQueue;
+}
+
+#endif
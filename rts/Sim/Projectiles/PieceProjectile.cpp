@@ -171,7 +171,7 @@ void CPieceProjectile::Collision(CUnit* unit, CFeature* feature)
 			.projectileID         = static_cast<uint32_t>(id)
 		};
 
-		helper->Explosion(params);
+		helper->QueueExplosion(params);
 	}
 
 	if (explFlags & PF_Smoke) {
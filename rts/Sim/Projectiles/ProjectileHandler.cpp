@@ -5,6 +5,7 @@
 #include "Projectile.h"
 #include "ProjectileHandler.h"
 #include "ProjectileMemPool.h"
+#include "Game/GameHelper.h"
 #include "Game/GlobalUnsynced.h"
 #include "Game/TraceRay.h"
 #include "Map/Ground.h"
@@ -15,6 +16,7 @@
 #include "Sim/Misc/CollisionHandler.h"
 #include "Sim/Misc/CollisionVolume.h"
 #include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/ModInfo.h"
 #include "Sim/Misc/QuadField.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Rendering/Env/Particles/Classes/NanoProjectile.h"
@@ -66,6 +68,37 @@ ProjMemPool projMemPool;
 CProjectileHandler projectileHandler;
 
 
+// below this many projectiles the candidate search is not worth a for_mt
+static constexpr size_t MT_COLLISION_MIN_PROJECTILES = 64;
+
+template<typename T> struct CollisionCandidate {
+	T* object;
+	CollisionQuery cq;
+	// piece-tree volumes lazily update their matrices, which is not
+	// thread-safe, so these are only hit-tested during resolution
+	bool deferred;
+};
+
+struct ProjectileCollisionCandidates {
+	std::vector< CollisionCandidate<CPlasmaRepulser> > shields;
+	std::vector< CollisionCandidate<CUnit> > units;
+	std::vector< CollisionCandidate<CFeature> > features;
+
+	// the ray all candidates were tested against
+	float3 ppos0;
+	float3 ppos1;
+
+	// the projectile they were gathered for, container
+	// slots can be reused by the time they are resolved
+	int projectileID = -1;
+
+	bool prepared = false;
+};
+
+// one entry per projectile container index, reused across frames
+static std::vector<ProjectileCollisionCandidates> collisionCandidates;
+
+
 
 void CProjectileHandler::Init()
 {
@@ -117,6 +150,8 @@ void CProjectileHandler::Kill()
 		projectiles[false].clear();
 	}
 
+	collisionCandidates.clear();
+
 	{
 		for (CGroundFlash* gf: groundFlashes)
 			projMemPool.free(gf);
@@ -425,6 +460,22 @@ static bool CheckProjectileCollisionFlags(const CProjectile* p, const CUnit* u)
 }
 
 
+template<typename T>
+static void ApplyObjectCollision(CProjectile* p, T* object, const CollisionQuery& cq, const float3 ppos0)
+{
+	if (cq.GetHitPiece() != nullptr)
+		object->SetLastHitPiece(cq.GetHitPiece(), gs->frameNum, p->synced);
+
+	if (!cq.InsideHit()) {
+		p->SetPosition(cq.GetHitPos());
+		p->Collision(object);
+		p->SetPosition(ppos0);
+	} else {
+		p->Collision(object);
+	}
+}
+
+
 void CProjectileHandler::CheckUnitCollisions(
 	CProjectile* p,
 	std::vector<CUnit*>& tempUnits,
@@ -450,17 +501,7 @@ void CProjectileHandler::CheckUnitCollisions(
 			continue;
 
 		if (CCollisionHandler::DetectHit(unit, unit->GetTransformMatrix(true), ppos0, ppos1, &cq)) {
-			if (cq.GetHitPiece() != nullptr)
-				unit->SetLastHitPiece(cq.GetHitPiece(), gs->frameNum, p->synced);
-
-			if (!cq.InsideHit()) {
-				p->SetPosition(cq.GetHitPos());
-				p->Collision(unit);
-				p->SetPosition(ppos0);
-			} else {
-				p->Collision(unit);
-			}
-
+			ApplyObjectCollision(p, unit, cq, ppos0);
 			break;
 		}
 	}
@@ -489,17 +530,7 @@ void CProjectileHandler::CheckFeatureCollisions(
 			continue;
 
 		if (CCollisionHandler::DetectHit(feature, feature->GetTransformMatrix(true), ppos0, ppos1, &cq)) {
-			if (cq.GetHitPiece() != nullptr)
-				feature->SetLastHitPiece(cq.GetHitPiece(), gs->frameNum, p->synced);
-
-			if (!cq.InsideHit()) {
-				p->SetPosition(cq.GetHitPos());
-				p->Collision(feature);
-				p->SetPosition(ppos0);
-			} else {
-				p->Collision(feature);
-			}
-
+			ApplyObjectCollision(p, feature, cq, ppos0);
 			break;
 		}
 	}
@@ -560,12 +591,177 @@ void CProjectileHandler::CheckShieldCollisions(
 	}
 }
 
+void CProjectileHandler::FindCollisionCandidates(bool synced)
+{
+	SCOPED_TIMER("Sim::Projectiles::FindCollisionCandidatesMT");
+	const auto& pc = projectiles[synced];
+
+	if (collisionCandidates.size() < pc.size())
+		collisionCandidates.resize(pc.size());
+
+	// read-only w.r.t. simulation state; everything that depends on state
+	// which earlier collisions in the same pass can change (shield power,
+	// collidable bits, cloak, ...) is left for ResolveCollisionCandidates
+	for_mt_chunk(0, pc.size(), [&pc](int i) {
+		const CProjectile* p = pc[i];
+		ProjectileCollisionCandidates& pcc = collisionCandidates[i];
+
+		pcc.shields.clear();
+		pcc.units.clear();
+		pcc.features.clear();
+		pcc.projectileID = p->id;
+		pcc.prepared = (p->checkCol && !p->deleteMe);
+
+		if (!pcc.prepared)
+			return;
+
+		const float3 ppos0 = pcc.ppos0 = p->pos;
+		const float3 ppos1 = pcc.ppos1 = p->pos + p->speed;
+
+		QuadFieldQuery qfQuery;
+		qfQuery.threadOwner = ThreadPool::GetThreadNum();
+		quadField.GetUnitsAndFeaturesColVol(qfQuery, p->pos, p->speed.w + p->radius, true);
+
+		CollisionQuery cq;
+
+		// see CheckShieldCollisions
+		if (p->weapon && static_cast<const CWeaponProjectile*>(p)->GetWeaponDef()->interceptedByShieldType != 0) {
+			const float3 rpvec = ppos0 - ppos1;
+
+			for (CPlasmaRepulser* repulser: *qfQuery.repulsers) {
+				const float3 rppos0 = ppos0 + rpvec * repulser->GetDeltaDist();
+				const float3 cvpos  = repulser->weaponMuzzlePos - repulser->owner->relMidPos;
+
+				if (!CCollisionHandler::DetectHit(repulser->owner, &repulser->collisionVolume, CMatrix44f{cvpos}, rppos0, ppos1, &cq))
+					continue;
+
+				pcc.shields.push_back({repulser, cq, false});
+			}
+		}
+
+		// see CheckUnitCollisions
+		for (CUnit* unit: *qfQuery.units) {
+			if (unit == p->owner())
+				continue;
+
+			if (unit->collisionVolume.DefaultToPieceTree()) {
+				pcc.units.push_back({unit, {}, true});
+				continue;
+			}
+
+			if (!CCollisionHandler::DetectHit(unit, unit->GetTransformMatrix(true), ppos0, ppos1, &cq))
+				continue;
+
+			pcc.units.push_back({unit, cq, false});
+		}
+
+		// see CheckFeatureCollisions
+		if ((p->GetCollisionFlags() & Collision::NOFEATURES) != 0)
+			return;
+
+		for (CFeature* feature: *qfQuery.features) {
+			if (feature->collisionVolume.DefaultToPieceTree()) {
+				pcc.features.push_back({feature, {}, true});
+				continue;
+			}
+
+			if (!CCollisionHandler::DetectHit(feature, feature->GetTransformMatrix(true), ppos0, ppos1, &cq))
+				continue;
+
+			pcc.features.push_back({feature, cq, false});
+		}
+	});
+}
+
+bool CProjectileHandler::ResolveCollisionCandidates(CProjectile* p, size_t idx)
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	ProjectileCollisionCandidates& pcc = collisionCandidates[idx];
+
+	if (!pcc.prepared)
+		return false;
+	if (pcc.projectileID != p->id)
+		return false;
+
+	// moved (e.g. by a callin) since the candidates were gathered
+	if (!pcc.ppos0.equals(p->pos, ZeroVector) || !pcc.ppos1.equals(p->pos + p->speed, ZeroVector))
+		return false;
+
+	const float3 ppos0 = pcc.ppos0;
+	const float3 ppos1 = pcc.ppos1;
+
+	CollisionQuery cq;
+
+	if (!pcc.shields.empty()) {
+		CWeaponProjectile* wpro = static_cast<CWeaponProjectile*>(p);
+
+		const unsigned int interceptType = wpro->GetWeaponDef()->interceptedByShieldType;
+		const unsigned int projAllyTeam = p->GetAllyteamID();
+
+		for (const auto& c: pcc.shields) {
+			if (!p->checkCol)
+				break;
+
+			if (!c.object->CanIntercept(interceptType, projAllyTeam))
+				continue;
+			if (c.cq.InsideHit() && c.object->IgnoreInteriorHit(wpro))
+				continue;
+
+			if (c.object->IncomingProjectile(wpro, c.cq.GetHitPos()))
+				break;
+		}
+	}
+
+	if (!p->checkCol)
+		return true;
+
+	for (auto& c: pcc.units) {
+		CUnit* unit = c.object;
+
+		if (unit == p->owner())
+			continue;
+		if (!unit->HasCollidableStateBit(CSolidObject::CSTATE_BIT_PROJECTILES))
+			continue;
+
+		if (!CheckProjectileCollisionFlags(p, unit))
+			continue;
+
+		if (c.deferred && !CCollisionHandler::DetectHit(unit, unit->GetTransformMatrix(true), ppos0, ppos1, &c.cq))
+			continue;
+
+		ApplyObjectCollision(p, unit, c.cq, ppos0);
+		break;
+	}
+
+	if (!p->checkCol)
+		return true;
+
+	for (auto& c: pcc.features) {
+		CFeature* feature = c.object;
+
+		if (!feature->HasCollidableStateBit(CSolidObject::CSTATE_BIT_PROJECTILES))
+			continue;
+
+		if (c.deferred && !CCollisionHandler::DetectHit(feature, feature->GetTransformMatrix(true), ppos0, ppos1, &c.cq))
+			continue;
+
+		ApplyObjectCollision(p, feature, c.cq, ppos0);
+		break;
+	}
+
+	return true;
+}
+
 void CProjectileHandler::CheckUnitFeatureCollisions(bool synced)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
-	static std::vector<CUnit*> tempUnits;
-	static std::vector<CFeature*> tempFeatures;
-	static std::vector<CPlasmaRepulser*> tempRepulsers;
+	// unsynced projectiles can always be hit-tested up front; synced ones
+	// only if the game opted in, since this changes what the tests observe
+	const bool findCandidates = (!synced || modInfo.projectileCollisionMT) && (projectiles[synced].size() >= MT_COLLISION_MIN_PROJECTILES);
+	const size_t numCandidates = findCandidates? projectiles[synced].size(): 0;
+
+	if (findCandidates)
+		FindCollisionCandidates(synced);
 
 	//can't use iterators here, because instructions inside the loop modify projectiles[synced]
 	for (size_t i = 0; i < projectiles[synced].size(); ++i) {
@@ -574,15 +770,20 @@ void CProjectileHandler::CheckUnitFeatureCollisions(bool synced)
 		if (!p->checkCol) continue;
 		if ( p->deleteMe) continue;
 
+		// projectiles added during this pass have no candidates yet
+		if (i < numCandidates && ResolveCollisionCandidates(p, i))
+			continue;
+
 		const float3 ppos0 = p->pos;
 		const float3 ppos1 = p->pos + p->speed;
 		// const float3 ppos1 = p->pos + p->dir * (p->speed.w + p->radius);
 
-		quadField.GetUnitsAndFeaturesColVol(p->pos, p->speed.w + p->radius, tempUnits, tempFeatures, &tempRepulsers);
+		QuadFieldQuery qfQuery;
+		quadField.GetUnitsAndFeaturesColVol(qfQuery, p->pos, p->speed.w + p->radius, true);
 
-		CheckShieldCollisions (p, tempRepulsers, ppos0, ppos1); tempRepulsers.clear();
-		CheckUnitCollisions   (p, tempUnits    , ppos0, ppos1); tempUnits.clear();
-		CheckFeatureCollisions(p, tempFeatures , ppos0, ppos1); tempFeatures.clear();
+		CheckShieldCollisions (p, *qfQuery.repulsers, ppos0, ppos1);
+		CheckUnitCollisions   (p, *qfQuery.units    , ppos0, ppos1);
+		CheckFeatureCollisions(p, *qfQuery.features , ppos0, ppos1);
 	}
 }
 
@@ -635,10 +836,16 @@ void CProjectileHandler::CheckCollisions()
 {
 	SCOPED_TIMER("Sim::Projectiles::Collisions");
 
+	// explosions of synced projectiles are applied after both passes
+	helper->BeginExplosionBatch();
+
 	CheckUnitFeatureCollisions(true ); // changes simulation state
 	CheckUnitFeatureCollisions(false); // does not change simulation state
 
 	CheckGroundCollisions(true ); // changes simulation state
+
+	helper->FlushExplosionBatch();
+
 	CheckGroundCollisions(false); // does not change simulation state
 }
 
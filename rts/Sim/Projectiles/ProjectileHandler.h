@@ -103,6 +103,9 @@ private:
 	template<bool synced>
 	CProjectile* GetProjectileByID(int id);
 
+	void FindCollisionCandidates(bool synced);
+	bool ResolveCollisionCandidates(CProjectile* p, size_t idx);
+
 	template<bool synced>
 	void UpdateProjectilesImpl();
 	void UpdateProjectiles() {
@@ -214,7 +214,7 @@ void CWeaponProjectile::Explode(
 		.projectileID         = static_cast<uint32_t>(id)
 	};
 
-	helper->Explosion(params);
+	helper->QueueExplosion(params);
 
 	if (weaponDef->noExplode && !TraveledRange())
 		return;
@@ -29,12 +29,6 @@ CR_REG_METADATA(CCobEngine, (
 	CR_MEMBER(threadCounter)
 ))
 
-CR_BIND(CCobEngine::SleepingThread, )
-CR_REG_METADATA(CCobEngine::SleepingThread, (
-	CR_MEMBER(id),
-	CR_MEMBER(wt)
-))
-
 static const char* const numCobThreadsPlot = "CobThreads";
 
 int CCobEngine::AddThread(CCobThread&& thread)
@@ -61,6 +55,7 @@ bool CCobEngine::RemoveThread(int threadID) {
 
 	if (it != threadInstances.end()) {
 		threadInstances.erase(it);
+		sleepingThreadIDs.Remove(threadID);
 		TracyPlot(numCobThreadsPlot, static_cast<int64_t>(threadInstances.size()));
 		return true;
 	}
@@ -97,7 +92,7 @@ void CCobEngine::ScheduleThread(const CCobThread* thread)
 			waitingThreadIDs.push_back(thread->GetID());
 		} break;
 		case CCobThread::Sleep: {
-			sleepingThreadIDs.push(SleepingThread{thread->GetID(), thread->GetWakeTime()});
+			sleepingThreadIDs.Push(thread->GetID(), thread->GetWakeTime());
 		} break;
 		default: {
 			LOG_L(L_ERROR, "[COBEngine::%s] unknown state %d for thread %d", __func__, thread->GetState(), thread->GetID());
@@ -136,21 +131,14 @@ void CCobEngine::TickThread(CCobThread* thread)
 void CCobEngine::WakeSleepingThreads()
 {
 	ZoneScoped;
-	// check on the sleeping threads, remove any whose owner died
-	while (!sleepingThreadIDs.empty()) {
-		CCobThread* zzzThread = GetThread((sleepingThreadIDs.top()).id);
-
-		if (zzzThread == nullptr) {
-			sleepingThreadIDs.pop();
-			continue;
-		}
+	CCobTimerWheel::SleepingThread zzz;
 
-		// not yet time to execute this thread or any subsequent sleepers
-		if (zzzThread->GetWakeTime() >= currentTime)
-			break;
+	// check on the sleeping threads whose wake-time has passed, in order
+	while (sleepingThreadIDs.PopDue(currentTime, zzz)) {
+		CCobThread* zzzThread = GetThread(zzz.id);
 
-		// remove executing thread from the queue
-		sleepingThreadIDs.pop();
+		if (zzzThread == nullptr)
+			continue;
 
 		// wake up the thread and tick it (if not dead)
 		// this can quite possibly re-add the thread to <sleepingThreadIDs>
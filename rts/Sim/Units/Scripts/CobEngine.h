@@ -12,8 +12,8 @@
 
 #include "CobThread.h"
 #include "CobDeferredCallin.h"
+#include "CobTimerWheel.h"
 #include "System/creg/creg_cond.h"
-#include "System/creg/STL_Queue.h"
 #include "System/creg/STL_Map.h"
 #include "System/Cpp11Compat.hpp"
 
@@ -26,21 +26,6 @@ class CCobEngine
 {
 	CR_DECLARE_STRUCT(CCobEngine)
 
-public:
-	struct SleepingThread {
-		CR_DECLARE_STRUCT(SleepingThread)
-
-		int id;
-		int wt;
-	};
-
-	struct CCobThreadComp {
-	public:
-		bool operator() (const SleepingThread& a, const SleepingThread& b) const {
-			return a.wt > b.wt || (a.wt == b.wt && a.id > b.id);
-		}
-	};
-
 public:
 	void Init() {
 		threadInstances.reserve(2048);
@@ -49,7 +34,7 @@ public:
 		runningThreadIDs.reserve(512);
 		waitingThreadIDs.reserve(512);
 
-		sleepingThreadIDs = {};
+		sleepingThreadIDs.Clear();
 
 		curThread = nullptr;
 
@@ -66,9 +51,7 @@ public:
 		runningThreadIDs.clear();
 		waitingThreadIDs.clear();
 
-		while (!sleepingThreadIDs.empty()) {
-			sleepingThreadIDs.pop();
-		}
+		sleepingThreadIDs.Clear();
 	}
 
 	void Tick(int deltaTime);
@@ -127,8 +110,8 @@ private:
 	spring::unordered_map<int, std::vector<CCobDeferredCallin> > deferredCallins;
 
 	// stores <id, waketime> pairs s.t. after waking up the ID can be checked
-	// for validity; thread owner might get removed while a thread is sleeping
-	std::priority_queue<SleepingThread, std::vector<SleepingThread>, CCobThreadComp> sleepingThreadIDs;
+	// for validity; removed threads are also dropped from it right away
+	CCobTimerWheel sleepingThreadIDs;
 
 	CCobThread* curThread = nullptr;
 
@@ -169,6 +169,9 @@ CCobFile::CCobFile(CFileHandler& in, const std::string& scriptName)
 		swabDWordInPlace(code[i]);
 	}
 
+	// CALL needs the script names to be resolved
+	program = CobProgram::Decode(code, scriptNames);
+
 	numStaticVars = ch.NumberOfStaticVars;
 
 	// if this is a TA:K script, read the sound names
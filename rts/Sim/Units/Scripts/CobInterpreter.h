@@ -0,0 +1,525 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef COB_INTERPRETER_H
+#define COB_INTERPRETER_H
+
+#include <type_traits>
+
+#include "CobOpCodes.h"
+#include "CobProgram.h"
+#include "CobScriptNames.h"
+#include "Sim/Misc/GlobalConstants.h"
+#include "System/Log/ILog.h"
+
+// GCC and Clang support taking label addresses, which lets every handler
+// jump straight to the next one instead of going through a shared switch
+#if defined(__GNUC__)
+	#define COB_COMPUTED_GOTO 1
+#else
+	#define COB_COMPUTED_GOTO 0
+#endif
+
+/**
+ * The COB interpreter loop. It is written against the interface of
+ * CCobThread (state, stacks, unit and engine call-outs via <cobInst> and a
+ * few helpers) rather than the class itself, so that tests can run it on a
+ * mock unit without an engine.
+ *
+ * Runs a thread until it sleeps, waits, dies or gets killed, and returns
+ * false if the thread is dead.
+ */
+namespace CobInterpreter {
+	/// executes the pre-decoded CCobFile::program
+	template<typename Thread> bool Run(Thread& t);
+}
+
+
+
+template<typename Thread>
+bool CobInterpreter::Run(Thread& t)
+{
+	using namespace CobProgram;
+	using Inst = std::remove_pointer_t<decltype(t.cobInst)>;
+
+	const Instr* instr = nullptr;
+
+	int r1, r2, r3, r4, r5, r6;
+
+	#if (COB_COMPUTED_GOTO == 1)
+	static const void* const DISPATCH_TABLE[] = {
+		&&L_OP_MOVE, &&L_OP_TURN, &&L_OP_SPIN, &&L_OP_STOP_SPIN, &&L_OP_SHOW, &&L_OP_HIDE, &&L_OP_MOVE_NOW, &&L_OP_TURN_NOW, &&L_OP_EMIT_SFX, &&L_OP_NOP,
+		&&L_OP_WAIT_TURN, &&L_OP_WAIT_MOVE, &&L_OP_SLEEP,
+		&&L_OP_PUSH_CONSTANT, &&L_OP_PUSH_LOCAL_VAR, &&L_OP_PUSH_STATIC, &&L_OP_CREATE_LOCAL_VAR, &&L_OP_POP_LOCAL_VAR, &&L_OP_POP_STATIC, &&L_OP_POP_STACK,
+		&&L_OP_ADD, &&L_OP_SUB, &&L_OP_MUL, &&L_OP_DIV, &&L_OP_MOD, &&L_OP_BITWISE_AND, &&L_OP_BITWISE_OR, &&L_OP_BITWISE_XOR, &&L_OP_BITWISE_NOT,
+		&&L_OP_RAND, &&L_OP_GET_UNIT_VALUE, &&L_OP_GET,
+		&&L_OP_SET_LESS, &&L_OP_SET_LESS_OR_EQUAL, &&L_OP_SET_GREATER, &&L_OP_SET_GREATER_OR_EQUAL, &&L_OP_SET_EQUAL, &&L_OP_SET_NOT_EQUAL,
+		&&L_OP_LOGICAL_AND, &&L_OP_LOGICAL_OR, &&L_OP_LOGICAL_XOR, &&L_OP_LOGICAL_NOT,
+		&&L_OP_START, &&L_OP_REAL_CALL, &&L_OP_LUA_CALL, &&L_OP_BATCH_LUA, &&L_OP_JUMP, &&L_OP_RETURN, &&L_OP_JUMP_NOT_EQUAL, &&L_OP_SIGNAL, &&L_OP_SET_SIGNAL_MASK,
+		&&L_OP_EXPLODE, &&L_OP_PLAY_SOUND,
+		&&L_OP_SET, &&L_OP_ATTACH, &&L_OP_DROP,
+		&&L_OP_SIGNATURE_LUA,
+		&&L_OP_MOVE_CONST, &&L_OP_TURN_CONST, &&L_OP_SPIN_CONST, &&L_OP_MOVE_NOW_CONST, &&L_OP_TURN_NOW_CONST, &&L_OP_SLEEP_CONST, &&L_OP_SET_CONST,
+		&&L_OP_UNKNOWN, &&L_OP_TRUNCATED, &&L_OP_END,
+	};
+
+	static_assert((sizeof(DISPATCH_TABLE) / sizeof(DISPATCH_TABLE[0])) == OP_COUNT);
+
+	// a callout may have put the thread to sleep or killed it (e.g. through Signal)
+	#define COB_DISPATCH()                               \
+		do {                                             \
+			if (t.state != Thread::Run)                  \
+				goto L_DONE;                             \
+			instr = &t.cobFile->program[t.pc];           \
+			t.pc = instr->next;                          \
+			goto *DISPATCH_TABLE[instr->op];             \
+		} while (false)
+	#define COB_OP(op) L_##op:
+
+	COB_DISPATCH();
+	#else
+	#define COB_DISPATCH() continue
+	#define COB_OP(op) case op:
+
+	while (t.state == Thread::Run) {
+		instr = &t.cobFile->program[t.pc];
+		t.pc = instr->next;
+
+		switch (instr->op) {
+	#endif
+
+	COB_OP(OP_PUSH_CONSTANT) {
+		t.PushDataStack(instr->args[0]);
+	} COB_DISPATCH();
+	COB_OP(OP_SLEEP) {
+		t.SleepFor(t.PopDataStack());
+		return true;
+	}
+	COB_OP(OP_SPIN) {
+		r3 = t.PopDataStack();         // speed
+		r4 = t.PopDataStack();         // accel
+		t.cobInst->Spin(instr->args[0], instr->args[1], r3, r4);
+	} COB_DISPATCH();
+	COB_OP(OP_STOP_SPIN) {
+		r3 = t.PopDataStack();         // decel
+		t.cobInst->StopSpin(instr->args[0], instr->args[1], r3);
+	} COB_DISPATCH();
+	COB_OP(OP_RETURN) {
+		t.retCode = t.PopDataStack();
+
+		if (t.LocalReturnAddr() == -1) {
+			t.state = Thread::Dead;
+			return false;
+		}
+
+		// return to caller
+		t.pc = t.LocalReturnAddr();
+		if (t.dataStack.size() > t.LocalStackFrame())
+			t.dataStack.resize(t.LocalStackFrame());
+
+		t.callStack.pop_back();
+	} COB_DISPATCH();
+
+	COB_OP(OP_NOP) {
+	} COB_DISPATCH();
+
+	COB_OP(OP_SIGNATURE_LUA) {
+		LOG_L(L_ERROR, "BAD ACCESS: Entered a lua method reference.");
+		t.state = Thread::Dead;
+		return false;
+	}
+	COB_OP(OP_BATCH_LUA) {
+		t.DeferredCall(instr->args[0], instr->args[1]);
+	} COB_DISPATCH();
+
+	COB_OP(OP_REAL_CALL) {
+		r1 = instr->args[0];
+		r2 = instr->args[1];
+
+		// do not call zero-length functions
+		if (t.cobFile->scriptLengths[r1] == 0)
+			COB_DISPATCH();
+
+		auto& ci = t.PushCallStackRef();
+		ci.functionId = r1;
+		ci.returnAddr = t.pc;
+		ci.stackTop = t.dataStack.size() - r2;
+
+		t.paramCount = r2;
+		t.pc = t.cobFile->scriptOffsets[r1];
+	} COB_DISPATCH();
+	COB_OP(OP_LUA_CALL) {
+		t.LuaCall(instr->args[0], instr->args[1]);
+	} COB_DISPATCH();
+
+	COB_OP(OP_POP_STATIC) {
+		r1 = instr->args[0];
+		r2 = t.PopDataStack();
+
+		if (static_cast<size_t>(r1) < t.cobInst->staticVars.size())
+			t.cobInst->staticVars[r1] = r2;
+	} COB_DISPATCH();
+	COB_OP(OP_POP_STACK) {
+		t.PopDataStack();
+	} COB_DISPATCH();
+
+	COB_OP(OP_START) {
+		if (t.cobFile->scriptLengths[instr->args[0]] == 0)
+			COB_DISPATCH();
+
+		t.StartThread(instr->args[0], instr->args[1]);
+	} COB_DISPATCH();
+
+	COB_OP(OP_CREATE_LOCAL_VAR) {
+		if (t.paramCount == 0) {
+			t.PushDataStack(0);
+		} else {
+			t.paramCount--;
+		}
+	} COB_DISPATCH();
+	COB_OP(OP_GET_UNIT_VALUE) {
+		r1 = t.PopDataStack();
+		if ((r1 >= LUA0) && (r1 <= LUA9)) {
+			t.PushDataStack(t.luaArgs[r1 - LUA0]);
+			COB_DISPATCH();
+		}
+		t.PushDataStack(t.cobInst->GetUnitVal(r1, 0, 0, 0, 0));
+	} COB_DISPATCH();
+
+	COB_OP(OP_JUMP_NOT_EQUAL) {
+		if (t.PopDataStack() == 0)
+			t.pc = instr->args[0];
+	} COB_DISPATCH();
+	COB_OP(OP_JUMP) {
+		t.pc = instr->args[0];
+	} COB_DISPATCH();
+
+	COB_OP(OP_POP_LOCAL_VAR) {
+		r2 = t.PopDataStack();
+		t.dataStack[t.LocalStackFrame() + instr->args[0]] = r2;
+	} COB_DISPATCH();
+	COB_OP(OP_PUSH_LOCAL_VAR) {
+		r2 = t.dataStack[t.LocalStackFrame() + instr->args[0]];
+		t.PushDataStack(r2);
+	} COB_DISPATCH();
+
+	COB_OP(OP_BITWISE_AND) {
+		r1 = t.PopDataStack();
+		r2 = t.PopDataStack();
+		t.PushDataStack(r1 & r2);
+	} COB_DISPATCH();
+	COB_OP(OP_BITWISE_OR) {
+		r1 = t.PopDataStack();
+		r2 = t.PopDataStack();
+		t.PushDataStack(r1 | r2);
+	} COB_DISPATCH();
+	COB_OP(OP_BITWISE_XOR) {
+		r1 = t.PopDataStack();
+		r2 = t.PopDataStack();
+		t.PushDataStack(r1 ^ r2);
+	} COB_DISPATCH();
+	COB_OP(OP_BITWISE_NOT) {
+		r1 = t.PopDataStack();
+		t.PushDataStack(~r1);
+	} COB_DISPATCH();
+
+	COB_OP(OP_EXPLODE) {
+		r2 = t.PopDataStack();
+		t.cobInst->Explode(instr->args[0], r2);
+	} COB_DISPATCH();
+
+	COB_OP(OP_PLAY_SOUND) {
+		r2 = t.PopDataStack();
+		t.cobInst->PlayUnitSound(instr->args[0], r2);
+	} COB_DISPATCH();
+
+	COB_OP(OP_PUSH_STATIC) {
+		r1 = instr->args[0];
+
+		if (static_cast<size_t>(r1) < t.cobInst->staticVars.size())
+			t.PushDataStack(t.cobInst->staticVars[r1]);
+	} COB_DISPATCH();
+
+	COB_OP(OP_SET_NOT_EQUAL) {
+		r1 = t.PopDataStack();
+		r2 = t.PopDataStack();
+		t.PushDataStack(int(r1 != r2));
+	} COB_DISPATCH();
+	COB_OP(OP_SET_EQUAL) {
+		r1 = t.PopDataStack();
+		r2 = t.PopDataStack();
+		t.PushDataStack(int(r1 == r2));
+	} COB_DISPATCH();
+
+	COB_OP(OP_SET_LESS) {
+		r2 = t.PopDataStack();
+		r1 = t.PopDataStack();
+		t.PushDataStack(int(r1 < r2));
+	} COB_DISPATCH();
+	COB_OP(OP_SET_LESS_OR_EQUAL) {
+		r2 = t.PopDataStack();
+		r1 = t.PopDataStack();
+		t.PushDataStack(int(r1 <= r2));
+	} COB_DISPATCH();
+
+	COB_OP(OP_SET_GREATER) {
+		r2 = t.PopDataStack();
+		r1 = t.PopDataStack();
+		t.PushDataStack(int(r1 > r2));
+	} COB_DISPATCH();
+	COB_OP(OP_SET_GREATER_OR_EQUAL) {
+		r2 = t.PopDataStack();
+		r1 = t.PopDataStack();
+		t.PushDataStack(int(r1 >= r2));
+	} COB_DISPATCH();
+
+	COB_OP(OP_RAND) {
+		r2 = t.PopDataStack();
+		r1 = t.PopDataStack();
+		t.PushDataStack(t.RandInt(r1, r2));
+	} COB_DISPATCH();
+	COB_OP(OP_EMIT_SFX) {
+		r1 = t.PopDataStack();
+		t.cobInst->EmitSfx(r1, instr->args[0]);
+	} COB_DISPATCH();
+	COB_OP(OP_MUL) {
+		r1 = t.PopDataStack();
+		r2 = t.PopDataStack();
+		t.PushDataStack(r1 * r2);
+	} COB_DISPATCH();
+
+	COB_OP(OP_SIGNAL) {
+		r1 = t.PopDataStack();
+		t.cobInst->Signal(r1);
+	} COB_DISPATCH();
+	COB_OP(OP_SET_SIGNAL_MASK) {
+		t.signalMask = t.PopDataStack();
+	} COB_DISPATCH();
+
+	COB_OP(OP_TURN) {
+		r2 = t.PopDataStack();
+		r1 = t.PopDataStack();
+		t.cobInst->Turn(instr->args[0], instr->args[1], r1, r2);
+	} COB_DISPATCH();
+	COB_OP(OP_GET) {
+		r5 = t.PopDataStack();
+		r4 = t.PopDataStack();
+		r3 = t.PopDataStack();
+		r2 = t.PopDataStack();
+		r1 = t.PopDataStack();
+		if ((r1 >= LUA0) && (r1 <= LUA9)) {
+			t.PushDataStack(t.luaArgs[r1 - LUA0]);
+			COB_DISPATCH();
+		}
+		r6 = t.cobInst->GetUnitVal(r1, r2, r3, r4, r5);
+		t.PushDataStack(r6);
+	} COB_DISPATCH();
+	COB_OP(OP_ADD) {
+		r2 = t.PopDataStack();
+		r1 = t.PopDataStack();
+		t.PushDataStack(r1 + r2);
+	} COB_DISPATCH();
+	COB_OP(OP_SUB) {
+		r2 = t.PopDataStack();
+		r1 = t.PopDataStack();
+		t.PushDataStack(r1 - r2);
+	} COB_DISPATCH();
+
+	COB_OP(OP_DIV) {
+		r2 = t.PopDataStack();
+		r1 = t.PopDataStack();
+
+		if (r2 != 0) {
+			r3 = r1 / r2;
+		} else {
+			r3 = 1000; // infinity!
+			t.ShowError("division by zero");
+		}
+		t.PushDataStack(r3);
+	} COB_DISPATCH();
+	COB_OP(OP_MOD) {
+		r2 = t.PopDataStack();
+		r1 = t.PopDataStack();
+
+		if (r2 != 0) {
+			t.PushDataStack(r1 % r2);
+		} else {
+			t.PushDataStack(0);
+			t.ShowError("modulo division by zero");
+		}
+	} COB_DISPATCH();
+
+	COB_OP(OP_MOVE) {
+		r4 = t.PopDataStack();
+		r3 = t.PopDataStack();
+		t.cobInst->Move(instr->args[0], instr->args[1], r3, r4);
+	} COB_DISPATCH();
+	COB_OP(OP_MOVE_NOW) {
+		r3 = t.PopDataStack();
+		t.cobInst->MoveNow(instr->args[0], instr->args[1], r3);
+	} COB_DISPATCH();
+	COB_OP(OP_TURN_NOW) {
+		r3 = t.PopDataStack();
+		t.cobInst->TurnNow(instr->args[0], instr->args[1], r3);
+	} COB_DISPATCH();
+
+	COB_OP(OP_WAIT_TURN) {
+		r1 = instr->args[0];
+		r2 = instr->args[1];
+
+		if (t.cobInst->NeedsWait(Inst::ATurn, r1, r2)) {
+			t.state = Thread::WaitTurn;
+			t.waitPiece = r1;
+			t.waitAxis = r2;
+			return true;
+		}
+	} COB_DISPATCH();
+	COB_OP(OP_WAIT_MOVE) {
+		r1 = instr->args[0];
+		r2 = instr->args[1];
+
+		if (t.cobInst->NeedsWait(Inst::AMove, r1, r2)) {
+			t.state = Thread::WaitMove;
+			t.waitPiece = r1;
+			t.waitAxis = r2;
+			return true;
+		}
+	} COB_DISPATCH();
+
+	COB_OP(OP_SET) {
+		r2 = t.PopDataStack();
+		r1 = t.PopDataStack();
+
+		if ((r1 >= LUA0) && (r1 <= LUA9)) {
+			t.luaArgs[r1 - LUA0] = r2;
+			COB_DISPATCH();
+		}
+
+		t.cobInst->SetUnitVal(r1, r2);
+	} COB_DISPATCH();
+
+	COB_OP(OP_ATTACH) {
+		r3 = t.PopDataStack();
+		r2 = t.PopDataStack();
+		r1 = t.PopDataStack();
+		t.cobInst->AttachUnit(r2, r1);
+	} COB_DISPATCH();
+	COB_OP(OP_DROP) {
+		r1 = t.PopDataStack();
+		t.cobInst->DropUnit(r1);
+	} COB_DISPATCH();
+
+	// like bitwise ops, but only on values 1 and 0
+	COB_OP(OP_LOGICAL_NOT) {
+		r1 = t.PopDataStack();
+		t.PushDataStack(int(r1 == 0));
+	} COB_DISPATCH();
+	COB_OP(OP_LOGICAL_AND) {
+		r1 = t.PopDataStack();
+		r2 = t.PopDataStack();
+		t.PushDataStack(int(r1 && r2));
+	} COB_DISPATCH();
+	COB_OP(OP_LOGICAL_OR) {
+		r1 = t.PopDataStack();
+		r2 = t.PopDataStack();
+		t.PushDataStack(int(r1 || r2));
+	} COB_DISPATCH();
+	COB_OP(OP_LOGICAL_XOR) {
+		r1 = t.PopDataStack();
+		r2 = t.PopDataStack();
+		t.PushDataStack(int((!!r1) ^ (!!r2)));
+	} COB_DISPATCH();
+
+	COB_OP(OP_HIDE) {
+		t.cobInst->SetVisibility(instr->args[0], false);
+	} COB_DISPATCH();
+	COB_OP(OP_SHOW) {
+		int i;
+		for (i = 0; i < MAX_WEAPONS_PER_UNIT; ++i)
+			if (t.LocalFunctionID() == t.cobFile->scriptIndex[COBFN_FirePrimary + COBFN_Weapon_Funcs * i])
+				break;
+
+		// if true, we are in a Fire-script and should show a special flare effect
+		if (i < MAX_WEAPONS_PER_UNIT) {
+			t.cobInst->ShowFlare(instr->args[0]);
+		} else {
+			t.cobInst->SetVisibility(instr->args[0], true);
+		}
+	} COB_DISPATCH();
+
+
+	// the stack traffic of the fused PUSH_CONSTANT's cancels out
+	COB_OP(OP_MOVE_CONST) {
+		t.cobInst->Move(instr->args[2], instr->args[3], instr->args[0], instr->args[1]);
+	} COB_DISPATCH();
+	COB_OP(OP_TURN_CONST) {
+		t.cobInst->Turn(instr->args[2], instr->args[3], instr->args[0], instr->args[1]);
+	} COB_DISPATCH();
+	COB_OP(OP_SPIN_CONST) {
+		t.cobInst->Spin(instr->args[2], instr->args[3], instr->args[1], instr->args[0]);
+	} COB_DISPATCH();
+	COB_OP(OP_MOVE_NOW_CONST) {
+		t.cobInst->MoveNow(instr->args[1], instr->args[2], instr->args[0]);
+	} COB_DISPATCH();
+	COB_OP(OP_TURN_NOW_CONST) {
+		t.cobInst->TurnNow(instr->args[1], instr->args[2], instr->args[0]);
+	} COB_DISPATCH();
+	COB_OP(OP_SLEEP_CONST) {
+		t.SleepFor(instr->args[0]);
+		return true;
+	}
+	COB_OP(OP_SET_CONST) {
+		r1 = instr->args[0];
+		r2 = instr->args[1];
+
+		if ((r1 >= LUA0) && (r1 <= LUA9)) {
+			t.luaArgs[r1 - LUA0] = r2;
+			COB_DISPATCH();
+		}
+
+		t.cobInst->SetUnitVal(r1, r2);
+	} COB_DISPATCH();
+
+
+	COB_OP(OP_UNKNOWN) {
+		const char* name = t.cobFile->name.c_str();
+		const char* func = t.cobFile->scriptNames[t.LocalFunctionID()].c_str();
+
+		LOG_L(L_ERROR, "[COBThread::Tick] unknown opcode %x (in %s:%s at %x)", instr->args[0], name, func, t.pc - 1);
+
+		t.state = Thread::Dead;
+		return false;
+	}
+	COB_OP(OP_TRUNCATED) {
+		const char* name = t.cobFile->name.c_str();
+		const char* func = t.cobFile->scriptNames[t.LocalFunctionID()].c_str();
+
+		LOG_L(L_ERROR, "[COBThread::Tick] truncated opcode %x (in %s:%s at %x)", instr->args[0], name, func, t.pc - 1);
+
+		t.state = Thread::Dead;
+		return false;
+	}
+	COB_OP(OP_END) {
+		const char* name = t.cobFile->name.c_str();
+		const char* func = t.cobFile->scriptNames[t.LocalFunctionID()].c_str();
+
+		LOG_L(L_ERROR, "[COBThread::Tick] jumped or ran past the end of the code (in %s:%s)", name, func);
+
+		t.state = Thread::Dead;
+		return false;
+	}
+
+	#if (COB_COMPUTED_GOTO == 1)
+	L_DONE:
+	#else
+		}
+	}
+	#endif
+
+	#undef COB_OP
+	#undef COB_DISPATCH
+
+	// can arrive here as dead, through CCobInstance::Signal()
+	return (t.state != Thread::Dead);
+}
+
+#endif // COB_INTERPRETER_H
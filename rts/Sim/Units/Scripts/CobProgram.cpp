@@ -0,0 +1,207 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "CobProgram.h"
+#include "CobOpCodes.h"
+
+#include "System/Misc/TracyDefs.h"
+
+using namespace CobProgram;
+
+
+struct OpInfo {
+	int op;
+	int numOperands;
+};
+
+static OpInfo GetOpInfo(int opcode)
+{
+	switch (opcode) {
+		case MOVE                : return {OP_MOVE                , 2};
+		case TURN                : return {OP_TURN                , 2};
+		case SPIN                : return {OP_SPIN                , 2};
+		case STOP_SPIN           : return {OP_STOP_SPIN           , 2};
+		case SHOW                : return {OP_SHOW                , 1};
+		case HIDE                : return {OP_HIDE                , 1};
+		case CACHE               : return {OP_NOP                 , 1};
+		case DONT_CACHE          : return {OP_NOP                 , 1};
+		case MOVE_NOW            : return {OP_MOVE_NOW            , 2};
+		case TURN_NOW            : return {OP_TURN_NOW            , 2};
+		case SHADE               : return {OP_NOP                 , 1};
+		case DONT_SHADE          : return {OP_NOP                 , 1};
+		case EMIT_SFX            : return {OP_EMIT_SFX            , 1};
+
+		case WAIT_TURN           : return {OP_WAIT_TURN           , 2};
+		case WAIT_MOVE           : return {OP_WAIT_MOVE           , 2};
+		case SLEEP               : return {OP_SLEEP               , 0};
+
+		case PUSH_CONSTANT       : return {OP_PUSH_CONSTANT       , 1};
+		case PUSH_LOCAL_VAR      : return {OP_PUSH_LOCAL_VAR      , 1};
+		case PUSH_STATIC         : return {OP_PUSH_STATIC         , 1};
+		case CREATE_LOCAL_VAR    : return {OP_CREATE_LOCAL_VAR    , 0};
+		case POP_LOCAL_VAR       : return {OP_POP_LOCAL_VAR       , 1};
+		case POP_STATIC          : return {OP_POP_STATIC          , 1};
+		case POP_STACK           : return {OP_POP_STACK           , 0};
+
+		case ADD                 : return {OP_ADD                 , 0};
+		case SUB                 : return {OP_SUB                 , 0};
+		case MUL                 : return {OP_MUL                 , 0};
+		case DIV                 : return {OP_DIV                 , 0};
+		case MOD                 : return {OP_MOD                 , 0};
+		case BITWISE_AND         : return {OP_BITWISE_AND         , 0};
+		case BITWISE_OR          : return {OP_BITWISE_OR          , 0};
+		case BITWISE_XOR         : return {OP_BITWISE_XOR         , 0};
+		case BITWISE_NOT         : return {OP_BITWISE_NOT         , 0};
+
+		case RAND                : return {OP_RAND                , 0};
+		case GET_UNIT_VALUE      : return {OP_GET_UNIT_VALUE      , 0};
+		case GET                 : return {OP_GET                 , 0};
+
+		case SET_LESS            : return {OP_SET_LESS            , 0};
+		case SET_LESS_OR_EQUAL   : return {OP_SET_LESS_OR_EQUAL   , 0};
+		case SET_GREATER         : return {OP_SET_GREATER         , 0};
+		case SET_GREATER_OR_EQUAL: return {OP_SET_GREATER_OR_EQUAL, 0};
+		case SET_EQUAL           : return {OP_SET_EQUAL           , 0};
+		case SET_NOT_EQUAL       : return {OP_SET_NOT_EQUAL       , 0};
+		case LOGICAL_AND         : return {OP_LOGICAL_AND         , 0};
+		case LOGICAL_OR          : return {OP_LOGICAL_OR          , 0};
+		case LOGICAL_XOR         : return {OP_LOGICAL_XOR         , 0};
+		case LOGICAL_NOT         : return {OP_LOGICAL_NOT         , 0};
+
+		case START               : return {OP_START               , 2};
+		case CALL                : return {OP_REAL_CALL           , 2}; // bound by Decode
+		case REAL_CALL           : return {OP_REAL_CALL           , 2};
+		case LUA_CALL            : return {OP_LUA_CALL            , 2};
+		case BATCH_LUA           : return {OP_BATCH_LUA           , 2};
+		case JUMP                : return {OP_JUMP                , 1};
+		case RETURN              : return {OP_RETURN              , 0};
+		case JUMP_NOT_EQUAL      : return {OP_JUMP_NOT_EQUAL      , 1};
+		case SIGNAL              : return {OP_SIGNAL              , 0};
+		case SET_SIGNAL_MASK     : return {OP_SET_SIGNAL_MASK     , 0};
+
+		case EXPLODE             : return {OP_EXPLODE             , 1};
+		case PLAY_SOUND          : return {OP_PLAY_SOUND          , 1};
+
+		case SET                 : return {OP_SET                 , 0};
+		case ATTACH              : return {OP_ATTACH              , 0};
+		case DROP                : return {OP_DROP                , 0};
+
+		case SIGNATURE_LUA       : return {OP_SIGNATURE_LUA       , 0};
+		default: break;
+	}
+
+	return {OP_UNKNOWN, 0};
+}
+
+
+static bool DecodeFused(const std::vector<int>& code, int pc, Instr& instr)
+{
+	const int size = code.size();
+	const auto HasWords = [&](int n) { return (pc + n <= size); };
+
+	if (code[pc] != PUSH_CONSTANT || !HasWords(3))
+		return false;
+
+	const int a = code[pc + 1];
+
+	switch (code[pc + 2]) {
+		case SLEEP: {
+			instr = {OP_SLEEP_CONST, pc + 3, {a, 0, 0, 0}};
+			return true;
+		} break;
+		case MOVE_NOW:
+		case TURN_NOW: {
+			if (!HasWords(5))
+				return false;
+
+			instr = {(code[pc + 2] == MOVE_NOW)? OP_MOVE_NOW_CONST: OP_TURN_NOW_CONST, pc + 5, {a, code[pc + 3], code[pc + 4], 0}};
+			return true;
+		} break;
+		case PUSH_CONSTANT: {
+		} break;
+		default: {
+			return false;
+		} break;
+	}
+
+	if (!HasWords(5))
+		return false;
+
+	const int b = code[pc + 3];
+
+	switch (code[pc + 4]) {
+		case SET: {
+			instr = {OP_SET_CONST, pc + 5, {a, b, 0, 0}};
+			return true;
+		} break;
+		case MOVE:
+		case TURN:
+		case SPIN: {
+			if (!HasWords(7))
+				return false;
+
+			constexpr int ops[] = {OP_MOVE_CONST, OP_TURN_CONST, OP_SPIN_CONST};
+			const int op = ops[(code[pc + 4] == TURN) + (code[pc + 4] == SPIN) * 2];
+
+			instr = {op, pc + 7, {a, b, code[pc + 5], code[pc + 6]}};
+			return true;
+		} break;
+		default: {
+		} break;
+	}
+
+	return false;
+}
+
+
+std::vector<Instr> CobProgram::Decode(const std::vector<int>& code, const std::vector<std::string>& scriptNames)
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+
+	const int size = code.size();
+
+	std::vector<Instr> instrs(size + 1);
+
+	for (int pc = 0; pc < size; pc++) {
+		Instr& instr = instrs[pc];
+
+		if (DecodeFused(code, pc, instr))
+			continue;
+
+		const OpInfo info = GetOpInfo(code[pc]);
+
+		instr = {info.op, pc + 1 + info.numOperands, {0, 0, 0, 0}};
+
+		if (info.op == OP_UNKNOWN) {
+			instr.args[0] = code[pc];
+			continue;
+		}
+		if (instr.next > size) {
+			instr = {OP_TRUNCATED, pc + 1, {code[pc], 0, 0, 0}};
+			continue;
+		}
+
+		for (int i = 0; i < info.numOperands; i++) {
+			instr.args[i] = code[pc + 1 + i];
+		}
+
+		switch (code[pc]) {
+			case CALL: {
+				const int fn = instr.args[0];
+
+				// what CCobThread used to patch into the code the first time the call was made
+				if (fn >= 0 && fn < int(scriptNames.size()) && scriptNames[fn].find("lua_") == 0)
+					instr.op = OP_LUA_CALL;
+			} break;
+			case JUMP:
+			case JUMP_NOT_EQUAL: {
+				if (instr.args[0] < 0 || instr.args[0] >= size)
+					instr.args[0] = size;
+			} break;
+			default: {
+			} break;
+		}
+	}
+
+	instrs[size] = {OP_END, size, {0, 0, 0, 0}};
+	return instrs;
+}
@@ -0,0 +1,120 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef COB_PROGRAM_H
+#define COB_PROGRAM_H
+
+#include <string>
+#include <vector>
+
+/**
+ * Pre-decoded form of a COB file's code, built once when the file is loaded.
+ *
+ * There is one instruction per code word, so a program-counter means the
+ * same thing in both representations (callstacks and savegames keep using
+ * code offsets) and any jump target, however odd, decodes exactly like the
+ * raw word stream would. Operands are resolved up-front, CALL is bound to
+ * REAL_CALL or LUA_CALL, and short runs of PUSH_CONSTANT followed by the
+ * instruction consuming those constants are fused into one.
+ */
+namespace CobProgram {
+	enum Op {
+		OP_MOVE,
+		OP_TURN,
+		OP_SPIN,
+		OP_STOP_SPIN,
+		OP_SHOW,
+		OP_HIDE,
+		OP_MOVE_NOW,
+		OP_TURN_NOW,
+		OP_EMIT_SFX,
+		OP_NOP, // CACHE, DONT_CACHE, SHADE, DONT_SHADE
+
+		OP_WAIT_TURN,
+		OP_WAIT_MOVE,
+		OP_SLEEP,
+
+		OP_PUSH_CONSTANT,
+		OP_PUSH_LOCAL_VAR,
+		OP_PUSH_STATIC,
+		OP_CREATE_LOCAL_VAR,
+		OP_POP_LOCAL_VAR,
+		OP_POP_STATIC,
+		OP_POP_STACK,
+
+		OP_ADD,
+		OP_SUB,
+		OP_MUL,
+		OP_DIV,
+		OP_MOD,
+		OP_BITWISE_AND,
+		OP_BITWISE_OR,
+		OP_BITWISE_XOR,
+		OP_BITWISE_NOT,
+
+		OP_RAND,
+		OP_GET_UNIT_VALUE,
+		OP_GET,
+
+		OP_SET_LESS,
+		OP_SET_LESS_OR_EQUAL,
+		OP_SET_GREATER,
+		OP_SET_GREATER_OR_EQUAL,
+		OP_SET_EQUAL,
+		OP_SET_NOT_EQUAL,
+		OP_LOGICAL_AND,
+		OP_LOGICAL_OR,
+		OP_LOGICAL_XOR,
+		OP_LOGICAL_NOT,
+
+		OP_START,
+		OP_REAL_CALL,
+		OP_LUA_CALL,
+		OP_BATCH_LUA,
+		OP_JUMP,
+		OP_RETURN,
+		OP_JUMP_NOT_EQUAL,
+		OP_SIGNAL,
+		OP_SET_SIGNAL_MASK,
+
+		OP_EXPLODE,
+		OP_PLAY_SOUND,
+
+		OP_SET,
+		OP_ATTACH,
+		OP_DROP,
+
+		OP_SIGNATURE_LUA,
+
+		// superinstructions; the constants are in the order they were pushed
+		OP_MOVE_CONST,     // PUSH_CONSTANT a, PUSH_CONSTANT b, MOVE piece axis
+		OP_TURN_CONST,     // PUSH_CONSTANT a, PUSH_CONSTANT b, TURN piece axis
+		OP_SPIN_CONST,     // PUSH_CONSTANT a, PUSH_CONSTANT b, SPIN piece axis
+		OP_MOVE_NOW_CONST, // PUSH_CONSTANT a, MOVE_NOW piece axis
+		OP_TURN_NOW_CONST, // PUSH_CONSTANT a, TURN_NOW piece axis
+		OP_SLEEP_CONST,    // PUSH_CONSTANT a, SLEEP
+		OP_SET_CONST,      // PUSH_CONSTANT a, PUSH_CONSTANT b, SET
+
+		OP_UNKNOWN,   // args[0] is the offending word
+		OP_TRUNCATED, // operands would extend past the end of the code
+		OP_END,       // sentinel after the last code word, also the target of out-of-range jumps
+
+		OP_COUNT
+	};
+
+	struct Instr {
+		int op;
+		/// code offset of the following instruction
+		int next;
+		/// operands in code order, for superinstructions the constants come first
+		int args[4];
+	};
+
+	/**
+	 * Decodes every offset of <code>; the result has one extra entry (OP_END)
+	 * so that falling off the end or jumping out of range is caught without
+	 * bounds-checking each fetch.
+	 */
+	std::vector<Instr> Decode(const std::vector<int>& code, const std::vector<std::string>& scriptNames);
+}
+
+#endif // COB_PROGRAM_H
@@ -7,6 +7,7 @@
 #include <array>
 
 #include "CobInstance.h"
+#include "CobInterpreter.h"
 #include "Lua/LuaRules.h"
 
 class CCobFile;
@@ -40,6 +41,8 @@ class CCobThread
 	CR_DECLARE_STRUCT(CCobThread)
 	CR_DECLARE_SUB(CallInfo)
 
+	template<typename Thread> friend bool CobInterpreter::Run(Thread& t);
+
 public:
 	// default and copy-ctor are creg only
 	CCobThread() {}
@@ -127,8 +130,12 @@ protected:
 		int stackTop = -1;
 	};
 
-	void LuaCall();
-	void DeferredCall(bool synced);
+	void LuaCall(int scriptId, int argCount);
+	void DeferredCall(int scriptId, int argCount);
+
+	void SleepFor(int time);
+	void StartThread(int functionId, int argCount);
+	int RandInt(int min, int max) const;
 
 	void PushCallStack(CallInfo v) { callStack.push_back(v); }
 	void PushDataStack(int v) { dataStack.push_back(v); }
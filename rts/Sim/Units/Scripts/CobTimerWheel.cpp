@@ -0,0 +1,337 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "CobTimerWheel.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+#include "System/Misc/TracyDefs.h"
+
+CR_BIND(CCobTimerWheel, )
+CR_REG_METADATA(CCobTimerWheel, (
+	CR_IGNORED(nodes),
+	CR_IGNORED(freeNodes),
+	CR_IGNORED(slots),
+	CR_IGNORED(slotMasks),
+	CR_IGNORED(batch),
+	CR_IGNORED(overdue),
+	CR_IGNORED(cascade),
+	CR_IGNORED(nodeIndices),
+	CR_IGNORED(cursor),
+	CR_IGNORED(numEntries),
+	CR_SERIALIZER(Serialize)
+))
+
+
+void CCobTimerWheel::Clear()
+{
+	nodes.clear();
+	freeNodes.clear();
+	batch.clear();
+	overdue.clear();
+	spring::clear_unordered_map(nodeIndices);
+
+	for (auto& slot: slots) {
+		slot.clear();
+	}
+
+	slotMasks.fill(0);
+
+	cursor = 0;
+	numEntries = 0;
+}
+
+
+int CCobTimerWheel::AllocNode()
+{
+	if (freeNodes.empty()) {
+		nodes.push_back({SLOT_FREE, 0});
+		return (nodes.size() - 1);
+	}
+
+	const int idx = freeNodes.back();
+
+	freeNodes.pop_back();
+	return idx;
+}
+
+void CCobTimerWheel::FreeNode(int idx)
+{
+	nodes[idx].slot = SLOT_FREE;
+	freeNodes.push_back(idx);
+}
+
+
+void CCobTimerWheel::Link(const Entry& e)
+{
+	const uint64_t key = Key(e.wt);
+	const uint64_t diff = key ^ cursor;
+
+	// the highest 64-slot group in which key and cursor differ decides the level
+	const int level = (diff == 0)? 0: ((63 - std::countl_zero(diff)) / SLOT_BITS);
+	const int index = (key >> (level * SLOT_BITS)) & (NUM_SLOTS - 1);
+	const int slot = level * NUM_SLOTS + index;
+
+	nodes[e.node] = {slot, static_cast<int>(slots[slot].size())};
+
+	slots[slot].push_back(e);
+	slotMasks[level] |= (uint64_t(1) << index);
+}
+
+void CCobTimerWheel::Unlink(int idx)
+{
+	const Node& node = nodes[idx];
+	std::vector<Entry>& slot = slots[node.slot];
+
+	// swap-remove; the entry taking its place needs its position updated
+	slot[node.pos] = slot.back();
+	nodes[slot[node.pos].node].pos = node.pos;
+	slot.pop_back();
+
+	if (slot.empty())
+		slotMasks[node.slot / NUM_SLOTS] &= ~(uint64_t(1) << (node.slot % NUM_SLOTS));
+}
+
+
+void CCobTimerWheel::Advance(uint64_t newCursor)
+{
+	const uint64_t oldCursor = cursor;
+
+	cursor = newCursor;
+
+	// re-distribute the slots the cursor moved into, highest level first;
+	// all lower-level slots are necessarily empty when a boundary is crossed
+	for (int level = NUM_LEVELS - 1; level > 0; level--) {
+		if ((oldCursor >> (level * SLOT_BITS)) == (newCursor >> (level * SLOT_BITS)))
+			continue;
+
+		const int index = (newCursor >> (level * SLOT_BITS)) & (NUM_SLOTS - 1);
+		const int slot = level * NUM_SLOTS + index;
+
+		if (slots[slot].empty())
+			continue;
+
+		std::swap(cascade, slots[slot]);
+		slotMasks[level] &= ~(uint64_t(1) << index);
+
+		for (const Entry& e: cascade) {
+			Link(e);
+		}
+
+		cascade.clear();
+	}
+}
+
+bool CCobTimerWheel::FillBatch(uint64_t limit)
+{
+	assert(batch.empty());
+
+	for (int level = 0; level < NUM_LEVELS; ) {
+		const int shift = level * SLOT_BITS;
+		const int index = (cursor >> shift) & (NUM_SLOTS - 1);
+
+		// level 0 includes the cursor's own slot; above that it is always empty
+		const uint64_t mask = (level == 0)?
+			(slotMasks[level] & (~uint64_t(0) << index)):
+			(slotMasks[level] & ((~uint64_t(0) << index) << 1));
+
+		if (mask == 0) {
+			level++;
+			continue;
+		}
+
+		const int slotIndex = std::countr_zero(mask);
+		const uint64_t slotKey = ((cursor >> (shift + SLOT_BITS)) << (shift + SLOT_BITS)) | (uint64_t(slotIndex) << shift);
+
+		if (slotKey >= limit)
+			return false;
+
+		if (level > 0) {
+			// move the cursor to the start of the slot and cascade it down
+			Advance(slotKey);
+			level = 0;
+			continue;
+		}
+
+		std::swap(batch, slots[slotIndex]);
+		slotMasks[0] &= ~(uint64_t(1) << slotIndex);
+
+		for (const Entry& e: batch) {
+			nodes[e.node].slot = SLOT_BATCH;
+		}
+
+		// all entries share the same wake-time
+		std::sort(batch.begin(), batch.end(), [](const Entry& a, const Entry& b) { return (a.id > b.id); });
+
+		// anything pushed for this wake-time from now on goes to the overdue heap
+		Advance(slotKey + 1);
+		return true;
+	}
+
+	return false;
+}
+
+
+void CCobTimerWheel::PushOverdue(const Entry& e)
+{
+	nodes[e.node].slot = SLOT_OVERDUE;
+	overdue.push_back(e);
+	std::push_heap(overdue.begin(), overdue.end(), [](const Entry& a, const Entry& b) { return Before(b, a); });
+}
+
+void CCobTimerWheel::PopOverdue()
+{
+	std::pop_heap(overdue.begin(), overdue.end(), [](const Entry& a, const Entry& b) { return Before(b, a); });
+	overdue.pop_back();
+}
+
+void CCobTimerWheel::SkipRemoved()
+{
+	while (!batch.empty() && nodes[batch.back().node].slot == SLOT_REMOVED) {
+		FreeNode(batch.back().node);
+		batch.pop_back();
+	}
+	while (!overdue.empty() && nodes[overdue.front().node].slot == SLOT_REMOVED) {
+		FreeNode(overdue.front().node);
+		PopOverdue();
+	}
+}
+
+
+void CCobTimerWheel::Push(int id, int wt)
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	const Entry e = {id, wt, AllocNode()};
+
+	// a thread can only be asleep once; should it somehow be pushed twice,
+	// the older entry stays put and also wakes (and ticks) the thread when
+	// due, just like a duplicate in the former priority queue did
+	nodeIndices[id] = e.node;
+	numEntries++;
+
+	if (Key(wt) < cursor) {
+		PushOverdue(e);
+		return;
+	}
+
+	Link(e);
+}
+
+bool CCobTimerWheel::Remove(int id)
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	const auto it = nodeIndices.find(id);
+
+	if (it == nodeIndices.end())
+		return false;
+
+	const int idx = it->second;
+
+	nodeIndices.erase(it);
+	numEntries--;
+
+	if (nodes[idx].slot >= 0) {
+		Unlink(idx);
+		FreeNode(idx);
+	} else {
+		// still referenced by the batch or the overdue heap, freed when it surfaces
+		nodes[idx].slot = SLOT_REMOVED;
+	}
+
+	return true;
+}
+
+bool CCobTimerWheel::PopDue(int time, SleepingThread& st)
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	SkipRemoved();
+
+	if (batch.empty() && FillBatch(Key(time)))
+		SkipRemoved();
+
+	const bool haveBatch = !batch.empty();
+	const bool haveOverdue = !overdue.empty();
+
+	if (!haveBatch && !haveOverdue)
+		return false;
+
+	// the overdue heap only ever holds entries behind the cursor, but
+	// these can still precede (or tie with) the slot being drained
+	const bool fromBatch = haveBatch && (!haveOverdue || Before(batch.back(), overdue.front()));
+	const Entry e = fromBatch? batch.back(): overdue.front();
+
+	if (e.wt >= time)
+		return false;
+
+	st = {e.id, e.wt};
+
+	if (fromBatch)
+		batch.pop_back();
+	else
+		PopOverdue();
+
+	if (const auto it = nodeIndices.find(e.id); it != nodeIndices.end() && it->second == e.node)
+		nodeIndices.erase(it);
+
+	numEntries--;
+	FreeNode(e.node);
+	return true;
+}
+
+
+std::vector<CCobTimerWheel::SleepingThread> CCobTimerWheel::GetSorted() const
+{
+	std::vector<SleepingThread> entries;
+	entries.reserve(numEntries);
+
+	const auto AddLive = [&](const std::vector<Entry>& v) {
+		for (const Entry& e: v) {
+			if (nodes[e.node].slot != SLOT_REMOVED)
+				entries.push_back({e.id, e.wt});
+		}
+	};
+
+	for (const auto& slot: slots) {
+		AddLive(slot);
+	}
+
+	AddLive(batch);
+	AddLive(overdue);
+
+	std::sort(entries.begin(), entries.end(), [](const SleepingThread& a, const SleepingThread& b) {
+		return (a.wt < b.wt || (a.wt == b.wt && a.id < b.id));
+	});
+
+	return entries;
+}
+
+
+void CCobTimerWheel::Serialize(creg::ISerializer* s)
+{
+	// stored as a flat list in wake order, the wheel is rebuilt on load
+	if (s->IsWriting()) {
+		std::vector<SleepingThread> entries = GetSorted();
+		int numSaved = entries.size();
+
+		s->SerializeInt(&numSaved, sizeof(numSaved));
+
+		for (SleepingThread& st: entries) {
+			s->SerializeInt(&st.id, sizeof(st.id));
+			s->SerializeInt(&st.wt, sizeof(st.wt));
+		}
+	} else {
+		int numSaved = 0;
+
+		s->SerializeInt(&numSaved, sizeof(numSaved));
+		Clear();
+
+		for (int i = 0; i < numSaved; i++) {
+			SleepingThread st;
+
+			s->SerializeInt(&st.id, sizeof(st.id));
+			s->SerializeInt(&st.wt, sizeof(st.wt));
+			Push(st.id, st.wt);
+		}
+	}
+}
@@ -0,0 +1,117 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef COB_TIMER_WHEEL_H
+#define COB_TIMER_WHEEL_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "System/creg/creg_cond.h"
+#include "System/UnorderedMap.hpp"
+
+/**
+ * Hierarchical timing wheel holding the sleeping COB threads, keyed on
+ * wake-time. Threads come out in exactly the order the former priority
+ * queue produced (ascending wake-time, ties broken by ascending ID), so
+ * the switch is invisible to sync.
+ *
+ * Level 0 has one slot per millisecond; every higher level covers 64 slots
+ * of the level below and is cascaded down as the cursor reaches it, which
+ * makes Push and Remove O(1). Pushes that land before the cursor (sleeping
+ * for a negative time, or re-sleeping while the current slot is drained)
+ * go to a small overflow heap that is merged on the way out.
+ */
+class CCobTimerWheel
+{
+	CR_DECLARE_STRUCT(CCobTimerWheel)
+
+public:
+	struct SleepingThread {
+		int id;
+		int wt;
+	};
+
+public:
+	CCobTimerWheel() { Clear(); }
+
+	void Clear();
+	void Push(int id, int wt);
+	/// drops the entry for <id> if there is one, returns whether it was found
+	bool Remove(int id);
+	/// pops the next entry in wake order if its wake-time is before <time>
+	bool PopDue(int time, SleepingThread& st);
+
+	/// all entries in wake order, for sync dumps
+	std::vector<SleepingThread> GetSorted() const;
+
+	size_t size() const { return numEntries; }
+	bool empty() const { return (numEntries == 0); }
+
+	void Serialize(creg::ISerializer* s);
+
+private:
+	static constexpr int SLOT_BITS = 6;
+	static constexpr int NUM_SLOTS = 1 << SLOT_BITS;
+	// 6 levels span 36 bits, enough for any int wake-time
+	static constexpr int NUM_LEVELS = 6;
+
+	// Node::slot values for entries that are not in a wheel slot
+	static constexpr int SLOT_BATCH   = -1;
+	static constexpr int SLOT_OVERDUE = -2;
+	static constexpr int SLOT_REMOVED = -3;
+	static constexpr int SLOT_FREE    = -4;
+
+	struct Entry {
+		int id;
+		int wt;
+		int node;
+	};
+
+	// tracks where an entry currently lives so it can be removed in O(1)
+	struct Node {
+		int slot;
+		int pos;
+	};
+
+	static uint64_t Key(int wt) { return (static_cast<uint64_t>(static_cast<int64_t>(wt) - INT32_MIN)); }
+	static bool Before(const Entry& a, const Entry& b) { return (a.wt < b.wt || (a.wt == b.wt && a.id < b.id)); }
+
+	int AllocNode();
+	void FreeNode(int idx);
+
+	void Link(const Entry& e);
+	void Unlink(int idx);
+
+	void Advance(uint64_t newCursor);
+	bool FillBatch(uint64_t limit);
+
+	void PushOverdue(const Entry& e);
+	void PopOverdue();
+
+	// drops removed entries off the front of the batch and the overdue heap
+	void SkipRemoved();
+
+private:
+	std::vector<Node> nodes;
+	std::vector<int> freeNodes;
+
+	std::array<std::vector<Entry>, NUM_LEVELS * NUM_SLOTS> slots;
+	std::array<uint64_t, NUM_LEVELS> slotMasks;
+
+	// entries of the level-0 slot currently being drained, sorted by descending ID
+	std::vector<Entry> batch;
+	// min-heap (by wake order) of entries pushed behind the cursor
+	std::vector<Entry> overdue;
+	// scratch space for cascading
+	std::vector<Entry> cascade;
+
+	// thread ID -> node
+	spring::unordered_map<int, int> nodeIndices;
+
+	// every entry linked into the wheel has a key >= cursor
+	uint64_t cursor = 0;
+	size_t numEntries = 0;
+};
+
+#endif // COB_TIMER_WHEEL_H
@@ -134,9 +134,10 @@ void CUnitScriptEngine::Tick(int deltaTime)
 		ZoneScopedN("CUnitScriptEngine::Tick(MT)");
 
 		// setting currentScript = animating[i]; is not required here, only in ST section below
-		for_mt(0, animating.size(), [&](const int i) {
+		// scripts only touch their own unit's pieces, so contiguous chunks can run independently
+		for_mt_chunk(0, animating.size(), [&](const int i) {
 			animating[i]->TickAllAnims(deltaTime);
-		});
+		}, 16);
 	}
 	{
 		ZoneScopedN("CUnitScriptEngine::Tick(ST)");
@@ -86,6 +86,7 @@ CUnit::CUnit(): CSolidObject()
 	static_assert((sizeof(los) / sizeof(los[0])) == ILosType::LOS_TYPE_COUNT, "");
 	static_assert((sizeof(losStatus) / sizeof(losStatus[0])) == MAX_TEAMS, "");
 	static_assert((sizeof(posErrorMask) == 32), "");
+	static_assert((sizeof(losStatusInputs) / sizeof(losStatusInputs[0])) == CLosHandler::NUM_LOS_STATUS_INPUTS, "");
 
 	losStatus.fill(0);
 	posErrorMask.fill(0xFFFFFFFF);
@@ -676,12 +677,40 @@ void CUnit::DisableScriptMoveType()
 }
 
 
+void CUnit::UpdateCompute()
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	// NOTE:
+	//   only used with modInfo.unitUpdateMT, runs concurrently for all units
+	//   before any of their Update calls; this must only touch our own state
+	//   and read from shared state that is immutable during the unit update,
+	//   anything with side-effects (events, callins) belongs in Update
+	prevPhysicalState = physicalState;
+
+	CSolidObject::UpdatePhysicalState(0.1f);
+	UpdateOwnState();
+
+	moveType->PrepareCollisionMapUpdate();
+}
+
 void CUnit::Update()
 {
 	RECOIL_DETAILED_TRACY_ZONE;
 	ASSERT_SYNCED(pos);
 
+	if (modInfo.unitUpdateMT) {
+		// commit the state-changes buffered by UpdateCompute
+		IssuePhysicalStateEvents(prevPhysicalState);
+		return;
+	}
+
 	UpdatePhysicalState(0.1f);
+	UpdateOwnState();
+}
+
+void CUnit::UpdateOwnState()
+{
+	RECOIL_DETAILED_TRACY_ZONE;
 	UpdatePosErrorParams(true, false);
 
 	if (beingBuilt)
@@ -1566,6 +1595,8 @@ bool CUnit::ChangeTeam(int newteam, ChangeType type)
 
 	unitHandler.ChangeUnitTeam(this, oldteam, newteam);
 
+	losStatusDirty = true;
+
 	for (int at = 0; at < teamHandler.ActiveAllyTeams(); ++at) {
 		if (teamHandler.Ally(at, allyteam)) {
 			SetLosStatus(at, LOS_ALL_MASK_BITS | LOS_INLOS | LOS_INRADAR | LOS_PREVLOS | LOS_CONTRADAR);
@@ -1837,11 +1868,18 @@ void CUnit::DependentDied(CObject* o)
 void CUnit::UpdatePhysicalState(float eps)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
-	const bool inAir      = IsInAir();
-	const bool inWater    = IsInWater();
-	const bool underWater = IsUnderWater();
+	const unsigned int prevState = physicalState;
 
 	CSolidObject::UpdatePhysicalState(eps);
+	IssuePhysicalStateEvents(prevState);
+}
+
+void CUnit::IssuePhysicalStateEvents(unsigned int prevState)
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	const bool inAir      = ((prevState & PSTATE_BIT_INAIR     ) != 0);
+	const bool inWater    = ((prevState & PSTATE_BIT_INWATER   ) != 0);
+	const bool underWater = ((prevState & PSTATE_BIT_UNDERWATER) != 0);
 
 	if (IsInAir() != inAir) {
 		if (IsInAir()) {
@@ -2932,6 +2970,8 @@ CR_REG_METADATA(CUnit, (
 	CR_IGNORED(los),
 	CR_MEMBER(losStatus),
 	CR_MEMBER(posErrorMask),
+	CR_IGNORED(losStatusInputs),
+	CR_IGNORED(losStatusDirty),
 	CR_MEMBER(quads),
 
 
@@ -2960,6 +3000,7 @@ CR_REG_METADATA(CUnit, (
 	CR_MEMBER(delayedWreckLevel),
 
 	CR_MEMBER(restTime),
+	CR_IGNORED(prevPhysicalState),
 
 	CR_MEMBER(reloadSpeed),
 	CR_MEMBER(maxRange),
@@ -81,6 +81,10 @@ public:
 	virtual void PreInit(const UnitLoadParams& params);
 	virtual void PostInit(const CUnit* builder);
 
+	// with modInfo.unitUpdateMT the per-frame update is split into a part
+	// run in parallel for all units (UpdateCompute) and one that commits its
+	// side-effects (Update); otherwise Update does everything by itself
+	void UpdateCompute();
 	virtual void Update();
 	virtual void SlowUpdate();
 
@@ -149,6 +153,9 @@ public:
 	void CalculateTerrainType();
 	void UpdateTerrainType();
 	void UpdatePhysicalState(float eps);
+	void IssuePhysicalStateEvents(unsigned int prevState);
+	// per-frame bookkeeping that only touches this unit
+	void UpdateOwnState();
 
 	float3 GetErrorVector(int allyteam) const;
 	float3 GetErrorPos(int allyteam, bool aiming = false) const { return (aiming? aimPos: midPos) + GetErrorVector(allyteam); }
@@ -323,6 +330,10 @@ public:
 	// indicates the los/radar status each allyteam has on this unit
 	// should technically be MAX_ALLYTEAMS, but #allyteams <= #teams
 	std::array<uint8_t, /*MAX_TEAMS*/ 255> losStatus{{0}};
+	// CLosHandler::GetLosStatusInputs as of the last UpdateUnitLosStates evaluation;
+	// set losStatusDirty when losStatus is modified outside of that evaluation
+	std::array<int, /*CLosHandler::NUM_LOS_STATUS_INPUTS*/ 10> losStatusInputs{{0}};
+	bool losStatusDirty = true;
 	// bit-mask indicating which allyteams see this unit with positional error
 	std::array<uint32_t, /*MAX_TEAMS/32*/ 8> posErrorMask{{1}};
 
@@ -386,6 +397,8 @@ public:
 
 	// how long the unit has been inactive
 	unsigned int restTime = 0;
+	// physical state before the last UpdateCompute, events are issued from it in Update (MT only)
+	unsigned int prevPhysicalState = 0;
 
 	float reloadSpeed = 1.0f;
 	float maxRange = 0.0f;
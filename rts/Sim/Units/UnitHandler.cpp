@@ -1,6 +1,9 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <algorithm>
 #include <cassert>
+#include <limits>
+#include <optional>
 
 #include "UnitHandler.h"
 #include "Unit.h"
@@ -10,8 +13,10 @@
 #include "UnitTypes/Factory.h"
 
 #include "CommandAI/BuilderCAI.h"
+#include "Game/GameHelper.h"
 #include "Sim/Ecs/Registry.h"
 #include "Sim/Misc/GlobalSynced.h"
+#include "Sim/Misc/LosHandler.h"
 #include "Sim/Misc/ModInfo.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/MoveTypes/MoveType.h"
@@ -51,6 +56,9 @@ CR_REG_METADATA(CUnitHandler, (
 	CR_MEMBER(activeSlowUpdateUnit),
 	CR_MEMBER(activeUpdateUnit),
 
+	CR_MEMBER(slowUpdateTotalCost),
+	CR_MEMBER(slowUpdateDoneCost),
+
 	CR_MEMBER(maxUnits),
 	CR_MEMBER(maxUnitRadius),
 
@@ -64,6 +72,17 @@ UnitMemPool unitMemPool;
 CUnitHandler unitHandler;
 
 
+// one timer per SlowUpdate bucket with modInfo.slowUpdateCostBalanced, so
+// the most expensive one stands out
+static constexpr std::array<const char*, UNIT_SLOWUPDATE_RATE> SLOWUPDATE_BUCKET_TIMERS = {{
+	"Sim::Unit::SlowUpdate::Bucket00", "Sim::Unit::SlowUpdate::Bucket01", "Sim::Unit::SlowUpdate::Bucket02",
+	"Sim::Unit::SlowUpdate::Bucket03", "Sim::Unit::SlowUpdate::Bucket04", "Sim::Unit::SlowUpdate::Bucket05",
+	"Sim::Unit::SlowUpdate::Bucket06", "Sim::Unit::SlowUpdate::Bucket07", "Sim::Unit::SlowUpdate::Bucket08",
+	"Sim::Unit::SlowUpdate::Bucket09", "Sim::Unit::SlowUpdate::Bucket10", "Sim::Unit::SlowUpdate::Bucket11",
+	"Sim::Unit::SlowUpdate::Bucket12", "Sim::Unit::SlowUpdate::Bucket13", "Sim::Unit::SlowUpdate::Bucket14",
+}};
+
+
 CUnit* CUnitHandler::NewUnit(const UnitDef* ud)
 {
 	RECOIL_DETAILED_TRACY_ZONE;
@@ -109,6 +128,14 @@ void CUnitHandler::Init() {
 	{
 		activeSlowUpdateUnit = 0;
 		activeUpdateUnit = 0;
+
+		slowUpdateTotalCost = 0;
+		slowUpdateDoneCost = 0;
+
+		for (const char* timerName: SLOWUPDATE_BUCKET_TIMERS) {
+			if (modInfo.slowUpdateCostBalanced)
+				CTimeProfiler::RegisterTimer(timerName);
+		}
 	}
 	{
 		units.resize(maxUnits, nullptr);
@@ -160,6 +187,9 @@ void CUnitHandler::Kill()
 	{
 		maxUnits = 0;
 		maxUnitRadius = 0.0f;
+
+		slowUpdateTotalCost = 0;
+		slowUpdateDoneCost = 0;
 	}
 }
 
@@ -207,6 +237,9 @@ void CUnitHandler::InsertActiveUnit(CUnit* unit)
 	#endif
 
 	units[unit->id] = unit;
+
+	// appended behind the SlowUpdate iterator, so this cycle still covers it
+	slowUpdateTotalCost += GetSlowUpdateCost(unit);
 }
 
 
@@ -303,9 +336,17 @@ void CUnitHandler::DeleteUnit(CUnit* delUnit)
 
 	teamHandler.Team(delUnitTeam)->RemoveUnit(delUnit, CTeam::RemoveDied);
 
-	if (activeSlowUpdateUnit > std::distance(activeUnits.begin(), it))
+	const uint32_t delUnitCost = GetSlowUpdateCost(delUnit);
+
+	slowUpdateTotalCost -= delUnitCost;
+
+	if (activeSlowUpdateUnit > std::distance(activeUnits.begin(), it)) {
 		--activeSlowUpdateUnit;
 
+		if (modInfo.slowUpdateCostBalanced)
+			slowUpdateDoneCost -= delUnitCost;
+	}
+
 	activeUnits.erase(it);
 
 	spring::VectorErase(GetUnitsByTeamAndDef(delUnitTeam,           0), delUnit);
@@ -337,32 +378,111 @@ void CUnitHandler::UpdateUnitMoveTypes()
 void CUnitHandler::UpdateUnitLosStates()
 {
 	ZoneScopedC(tracy::Color::Goldenrod);
+	// anything changing from here on, including from within the call-ins
+	// triggered below, is only picked up by the next sweep (as before)
+	const int epoch = losHandler->NextLosStatusEpoch();
+	const int numAllyTeams = teamHandler.ActiveAllyTeams();
+
+	CLosHandler::LosStatusInputs inputs;
+
 	for (CUnit* unit: activeUnits) {
-		for (int at = 0; at < teamHandler.ActiveAllyTeams(); ++at) {
+		losHandler->GetLosStatusInputs(unit, inputs);
+
+		// unit moved to another square, changed state or had its losStatus
+		// modified externally; all allyteams have to be re-evaluated
+		if (unit->losStatusDirty || inputs != unit->losStatusInputs) {
+			unit->losStatusInputs = inputs;
+			unit->losStatusDirty = false;
+
+			for (int at = 0; at < numAllyTeams; ++at) {
+				unit->UpdateLosStatus(at);
+			}
+
+			continue;
+		}
+
+		// otherwise only those whose maps changed near the unit; for all
+		// others the last evaluation is still a fixed point of CalcLosStatus
+		if (!losHandler->LosStatusChangedSince(unit, -1, epoch))
+			continue;
+
+		for (int at = 0; at < numAllyTeams; ++at) {
+			if (!losHandler->LosStatusChangedSince(unit, at, epoch))
+				continue;
+
 			unit->UpdateLosStatus(at);
 		}
 	}
 }
 
 
+CUnitHandler::SlowUpdateCostClass CUnitHandler::GetSlowUpdateCostClass(const UnitDef* ud)
+{
+	// same order of tests as CUnitLoader::NewCommandAI
+	if (ud->IsFactoryUnit())
+		return SLOWUPDATE_COST_FACTORY;
+	if (ud->IsMobileBuilderUnit() || ud->IsStaticBuilderUnit())
+		return SLOWUPDATE_COST_BUILDER;
+	if (ud->IsStrafingAirUnit())
+		return SLOWUPDATE_COST_AIR;
+	if (ud->IsAirUnit() || ud->IsGroundUnit() || ud->IsTransportUnit())
+		return SLOWUPDATE_COST_MOBILE;
+
+	return SLOWUPDATE_COST_COMMAND;
+}
+
+uint32_t CUnitHandler::GetSlowUpdateCost(const CUnit* unit)
+{
+	// must only depend on the (constant) UnitDef and modrules, this is
+	// summed on insertion and subtracted again on deletion of <unit>
+	const UnitDef* ud = unit->unitDef;
+	return (modInfo.slowUpdateClassWeights[GetSlowUpdateCostClass(ud)] + ud->NumWeapons() * modInfo.slowUpdateWeaponWeight);
+}
+
 void CUnitHandler::SlowUpdateUnits()
 {
 	SCOPED_TIMER("Sim::Unit::SlowUpdate");
 
 	assert(activeSlowUpdateUnit >= 0);
 
+	const int bucket = gs->frameNum % UNIT_SLOWUPDATE_RATE;
+
 	// reset the iterator every <UNIT_SLOWUPDATE_RATE> frames
-	if ((gs->frameNum % UNIT_SLOWUPDATE_RATE) == 0)
+	if (bucket == 0) {
 		activeSlowUpdateUnit = 0;
+		slowUpdateDoneCost = 0;
+	}
+
+	std::optional<ScopedTimer> bucketTimer;
+
+	if (modInfo.slowUpdateCostBalanced)
+		bucketTimer.emplace(hashString(SLOWUPDATE_BUCKET_TIMERS[bucket]));
 
 	const size_t idxBeg = activeSlowUpdateUnit;
-	const size_t maximumCnt = activeUnits.size() - idxBeg;
-	const size_t logicalCnt = (activeUnits.size() / UNIT_SLOWUPDATE_RATE) + 1;
-	const size_t indCnt = logicalCnt > maximumCnt ? maximumCnt : logicalCnt;
-	const size_t idxEnd = idxBeg + indCnt;
+	      size_t idxEnd = idxBeg;
+
+	if (modInfo.slowUpdateCostBalanced) {
+		// stagger the SlowUpdate's; each frame takes units until the cost it has
+		// covered so far reaches its share of the total, rather than a fixed count
+		// such that frames landing on many builders or factories do not spike
+		// (the last frame of a cycle takes whatever is left)
+		const uint64_t targetCost = (bucket == (UNIT_SLOWUPDATE_RATE - 1))?
+			std::numeric_limits<uint64_t>::max():
+			(slowUpdateTotalCost * (bucket + 1)) / UNIT_SLOWUPDATE_RATE;
+
+		for (; idxEnd < activeUnits.size() && slowUpdateDoneCost < targetCost; ++idxEnd) {
+			slowUpdateDoneCost += GetSlowUpdateCost(activeUnits[idxEnd]);
+		}
+	} else {
+		// stagger the SlowUpdate's
+		const size_t maximumCnt = activeUnits.size() - idxBeg;
+		const size_t logicalCnt = (activeUnits.size() / UNIT_SLOWUPDATE_RATE) + 1;
+		const size_t indCnt = logicalCnt > maximumCnt ? maximumCnt : logicalCnt;
+
+		idxEnd = idxBeg + indCnt;
+	}
 
 	activeSlowUpdateUnit = idxEnd;
-	// stagger the SlowUpdate's
 
 	static std::vector<CUnit*> updateBoundingVolumeList;
 	updateBoundingVolumeList.clear();
@@ -380,6 +500,11 @@ void CUnitHandler::SlowUpdateUnits()
 				updateBoundingVolumeList.emplace_back(unit);
 		}
 	}
+	{
+		ZoneScopedN("Sim::Unit::SlowUpdateAutoTarget");
+		// weapons queued by SlowUpdateWeapons if modInfo.weaponAutoTargetMT
+		helper->UpdateWeaponAutoTargets();
+	}
 	// Since the bounding volumes are calculated from the maximum piecematrix-offset piece vertices
 	// They dont have much of an effect if updated late-ish.
 	{
@@ -394,18 +519,48 @@ void CUnitHandler::UpdateUnits()
 {
 	SCOPED_TIMER("Sim::Unit::Update");
 
-	size_t activeUnitCount = activeUnits.size();
-	for (size_t i = 0; i < activeUnitCount; ++i) {
-		CUnit* unit = activeUnits[i];
+	if (!modInfo.unitUpdateMT) {
+		size_t activeUnitCount = activeUnits.size();
+		for (size_t i = 0; i < activeUnitCount; ++i) {
+			CUnit* unit = activeUnits[i];
+
+			unit->SanityCheck();
+			unit->Update();
+			unit->moveType->UpdateCollisionMap();
+			// unsynced; done on-demand when drawing unit
+			// unit->UpdateLocalModel();
+			unit->SanityCheck();
+
+			assert(activeUnits[i] == unit);
+		}
+
+		return;
+	}
+
+	{
+		SCOPED_TIMER("Sim::Unit::Update::Compute");
+
+		// only touches per-unit state, see CUnit::UpdateCompute;
+		// this includes the quad lookups for UpdateCollisionMap below
+		for_mt_chunk(0, activeUnits.size(), [this](const int idx) {
+			activeUnits[idx]->UpdateCompute();
+		});
+	}
+	{
+		SCOPED_TIMER("Sim::Unit::Update::Apply");
+
+		// commit in activeUnits order, identical on all clients
+		size_t activeUnitCount = activeUnits.size();
+		for (size_t i = 0; i < activeUnitCount; ++i) {
+			CUnit* unit = activeUnits[i];
 
-		unit->SanityCheck();
-		unit->Update();
-		unit->moveType->UpdateCollisionMap();
-		// unsynced; done on-demand when drawing unit
-		// unit->UpdateLocalModel();
-		unit->SanityCheck();
+			unit->SanityCheck();
+			unit->Update();
+			unit->moveType->UpdateCollisionMap();
+			unit->SanityCheck();
 
-		assert(activeUnits[i] == unit);
+			assert(activeUnits[i] == unit);
+		}
 	}
 }
 
@@ -419,6 +574,35 @@ void CUnitHandler::UpdateUnitWeapons()
 			unit->UpdateWeaponVectors();
 		});
 	}
+	if (modInfo.weaponLineOfFireMT) {
+		SCOPED_TIMER("Sim::Unit::WeaponLineOfFire");
+
+		// traces against piece-tree volumes read the piece matrices, which
+		// are updated lazily; bring them up to date while that is per-unit
+		for_mt(0, activeUnits.size(), [&](const int idx) {
+			const CUnit* unit = activeUnits[idx];
+
+			if (!unit->collisionVolume.DefaultToPieceTree())
+				return;
+
+			for (unsigned int i = 0; unit->localModel.HasPiece(i); i++) {
+				unit->localModel.GetPiece(i)->GetModelSpaceMatrix();
+			}
+		});
+
+		// Fire, salvo and stockpile changes and all script callins
+		// stay in the serial loop below, which consumes these tests
+		for_mt_chunk(0, activeUnits.size(), [&](const int idx) {
+			CUnit* unit = activeUnits[idx];
+
+			if (!unit->CanUpdateWeapons())
+				return;
+
+			for (CWeapon* w: unit->weapons) {
+				w->PrepareFireTest();
+			}
+		});
+	}
 	{
 		SCOPED_TIMER("Sim::Unit::Weapon");
 		for (activeUpdateUnit = 0; activeUpdateUnit < activeUnits.size(); ++activeUpdateUnit) {
@@ -4,6 +4,7 @@
 #define UNITHANDLER_H
 
 #include <array>
+#include <cstdint>
 #include <vector>
 
 #include "Sim/Misc/GlobalConstants.h"
@@ -94,6 +95,22 @@ private:
 	void MultiThreadPathRequests(std::vector<CUnit*>& unitsToMove);
 	void SingleThreadPathRequests(std::vector<CUnit*>& unitsToMove);
 
+public:
+	// SlowUpdate cost classes, mirrors the CommandAI types handed out by CUnitLoader
+	// (and the order of modInfo.slowUpdateClassWeights)
+	enum SlowUpdateCostClass {
+		SLOWUPDATE_COST_COMMAND = 0, // CCommandAI (non-builder structures)
+		SLOWUPDATE_COST_MOBILE  = 1, // CMobileCAI
+		SLOWUPDATE_COST_AIR     = 2, // CAirCAI
+		SLOWUPDATE_COST_BUILDER = 3, // CBuilderCAI
+		SLOWUPDATE_COST_FACTORY = 4, // CFactoryCAI
+		SLOWUPDATE_COST_COUNT   = 5,
+	};
+
+	static SlowUpdateCostClass GetSlowUpdateCostClass(const UnitDef* ud);
+	/// synced (estimated) cost of one SlowUpdate + SlowUpdateWeapons call, see modInfo.slowUpdateCostBalanced
+	static uint32_t GetSlowUpdateCost(const CUnit* unit);
+
 private:
 	SimObjectIDPool idPool;
 
@@ -110,6 +127,9 @@ private:
 	size_t activeSlowUpdateUnit = 0;  ///< first unit of batch that will be SlowUpdate'd this frame
 	size_t activeUpdateUnit = 0;      ///< first unit of batch that will be SlowUpdate'd this frame
 
+	uint64_t slowUpdateTotalCost = 0; ///< summed SlowUpdate cost of all active units
+	uint64_t slowUpdateDoneCost = 0;  ///< summed SlowUpdate cost of the active units already SlowUpdate'd this cycle
+
 
 	///< global unit-limit (derived from the per-team limit)
 	///< units.size() is equal to this and constant at runtime
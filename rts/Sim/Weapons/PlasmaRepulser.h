@@ -5,7 +5,9 @@
 
 #include "Weapon.h"
 #include "Sim/Misc/CollisionVolume.h"
+#include "System/Threading/ThreadPool.h"
 
+#include <array>
 #include <vector>
 
 class CPlasmaRepulser: public CWeapon
@@ -64,7 +66,7 @@ private:
 public:
 	CollisionVolume collisionVolume;
 
-	int tempNum = 0;
+	std::array<int, ThreadPool::MAX_THREADS> mtTempNum = {};
 	int scIndex = 0;
 
 private:
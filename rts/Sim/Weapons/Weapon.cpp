@@ -111,7 +111,9 @@ CR_REG_METADATA(CWeapon, (
 	CR_MEMBER(weaponAimAdjustPriority),
 	CR_MEMBER(fastAutoRetargeting),
 	CR_MEMBER(fastQueryPointUpdate),
-	CR_MEMBER(burstControlWhenOutOfArc)
+	CR_MEMBER(burstControlWhenOutOfArc),
+
+	CR_IGNORED(preparedFireTest)
 ))
 
 
@@ -705,6 +707,11 @@ bool CWeapon::AllowWeaponAutoTarget() const
 	return (gs->frameNum > (lastTargetRetry + 65));
 }
 
+const CUnit* CWeapon::GetAutoTargetAvoidUnit() const
+{
+	return ((avoidTarget && HaveUnitTarget()) ? currentTarget.unit : nullptr);
+}
+
 bool CWeapon::AutoTarget()
 {
 	RECOIL_DETAILED_TRACY_ZONE;
@@ -714,18 +721,35 @@ bool CWeapon::AutoTarget()
 	// search for other in-range targets
 	lastTargetRetry = gs->frameNum;
 
-	const CUnit* avoidUnit = (avoidTarget && HaveUnitTarget()) ? currentTarget.unit : nullptr;
+	auto& targetPairs = helper->targetPairs;
+
+	CGameHelper::GenerateWeaponTargets(this, GetAutoTargetAvoidUnit(), targetPairs);
+	return (PickAutoTarget(targetPairs));
+}
+
+bool CWeapon::QueueAutoTarget()
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	if (!AllowWeaponAutoTarget())
+		return false;
 
+	lastTargetRetry = gs->frameNum;
+
+	helper->QueueWeaponAutoTarget(this);
+	return true;
+}
+
+bool CWeapon::PickAutoTarget(const std::vector<std::pair<float, CUnit*>>& targetPairs)
+{
+	RECOIL_DETAILED_TRACY_ZONE;
 	CUnit* goodTargetUnit = nullptr;
 	CUnit*  badTargetUnit = nullptr;
 
-	auto& targetPairs = helper->targetPairs;
-
 	// NOTE:
 	//   GenerateWeaponTargets sorts by INCREASING order of priority, so lower equals better
 	//   <targetPairs> is normally sorted such that all bad TargetCategory units live at the
 	//   end, but Lua can mess with the ordering arbitrarily
-	for (size_t i = 0, n = CGameHelper::GenerateWeaponTargets(this, avoidUnit, targetPairs); i < n; i++, assert(n == targetPairs.size())) {
+	for (size_t i = 0, n = targetPairs.size(); i < n; i++, assert(n == targetPairs.size())) {
 		CUnit* unit = targetPairs[i].second;
 
 		// save the "best" bad target in case we have no other
@@ -796,7 +820,12 @@ void CWeapon::SlowUpdate()
 		Attack(owner->lastAttacker);
 	}
 	// AutoTarget: Find new/better Target
-	AutoTarget();
+	// (batched for all weapons in this SlowUpdate slice if enabled)
+	if (modInfo.weaponAutoTargetMT) {
+		QueueAutoTarget();
+	} else {
+		AutoTarget();
+	}
 }
 
 
@@ -953,9 +982,56 @@ bool CWeapon::TryTarget(const float3 tgtPos, const SWeaponTarget& trg, bool preF
 		return false;
 
 	// TODO: add a forcedUserTarget (forced-fire mode enabled with CTRL e.g.) and skip the tests below
+	if (preFire && HavePreparedFireTest(GetAimFromPos(preFire), tgtPos, trg))
+		return preparedFireTest.freeLineOfFire;
+
 	return (HaveFreeLineOfFire(GetAimFromPos(preFire), tgtPos, trg));
 }
 
+bool CWeapon::HavePreparedFireTest(const float3 srcPos, const float3 tgtPos, const SWeaponTarget& trg) const
+{
+	if (preparedFireTest.frame != gs->frameNum)
+		return false;
+
+	// anything the serial Update changed since invalidates the result
+	return (preparedFireTest.srcPos.same(srcPos) && preparedFireTest.tgtPos.same(tgtPos) && preparedFireTest.target == trg);
+}
+
+void CWeapon::PrepareFireTest()
+{
+	RECOIL_DETAILED_TRACY_ZONE;
+	preparedFireTest.frame = -1;
+
+	if (!HaveTarget())
+		return;
+
+	// UpdateFire would first move the weapon pieces, which needs the script
+	if (fastQueryPointUpdate)
+		return;
+
+	// skip weapons that will not get as far as TryTarget anyway; angleGood
+	// is ignored since UpdateAim (running the aim script) may still set it
+	if (!CanFire(true, false, false))
+		return;
+
+	const float3 tgtPos = GetLeadTargetPos(currentTarget);
+	const float3 srcPos = GetAimFromPos(true);
+
+	// same (cheap) tests TryTarget does before the line-of-fire one
+	if (!TestTarget(tgtPos, currentTarget))
+		return;
+	if (!currentTarget.isAutoTarget && !TestRange(tgtPos, currentTarget))
+		return;
+	if (srcPos.y < CGround::GetHeightReal(srcPos.x, srcPos.z))
+		return;
+
+	preparedFireTest.target = currentTarget;
+	preparedFireTest.srcPos = srcPos;
+	preparedFireTest.tgtPos = tgtPos;
+	preparedFireTest.freeLineOfFire = HaveFreeLineOfFire(srcPos, tgtPos, currentTarget);
+	preparedFireTest.frame = gs->frameNum;
+}
+
 
 bool CWeapon::TestTarget(const float3 tgtPos, const SWeaponTarget& trg) const
 {
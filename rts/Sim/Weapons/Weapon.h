@@ -83,6 +83,9 @@ public:
 	virtual void UpdateRange(const float val) { range = val; }
 
 	bool AutoTarget();
+	bool QueueAutoTarget();
+	bool PickAutoTarget(const std::vector<std::pair<float, CUnit*>>& targetPairs);
+	const CUnit* GetAutoTargetAvoidUnit() const;
 	void AimReady(const int value);
 	void Fire(const bool scriptCall);
 
@@ -99,6 +102,11 @@ public:
 	void UpdateWeaponErrorVector();
 	void UpdateWeaponVectors();
 
+	/// runs the line-of-fire test UpdateFire is expected to need this frame
+	/// ahead of time; does not modify simulation state, so weapons can be
+	/// prepared in parallel
+	void PrepareFireTest();
+
 protected:
 	virtual void FireImpl(const bool scriptCall) {}
 	virtual void UpdateWantedDir();
@@ -126,6 +134,7 @@ private:
 	void HoldIfTargetInvalid();
 
 	bool TryTarget(const float3 tgtPos, const SWeaponTarget& trg, bool preFire = false) const;
+	bool HavePreparedFireTest(const float3 srcPos, const float3 tgtPos, const SWeaponTarget& trg) const;
 
 public:
 	CUnit* owner;
@@ -214,6 +223,20 @@ protected:
 	// projectiles that are on the way to our interception zone
 	// (eg. nuke toward a repulsor, or missile toward a shield)
 	std::vector<int> incomingProjectileIDs;
+
+private:
+	struct PreparedFireTest {
+		SWeaponTarget target;
+
+		float3 srcPos;
+		float3 tgtPos;
+
+		int frame = -1;
+		bool freeLineOfFire = false;
+	};
+
+	// set by PrepareFireTest, valid only for the frame (and inputs) it was made in
+	PreparedFireTest preparedFireTest;
 };
 
 #endif /* WEAPON_H */
@@ -145,6 +145,16 @@ class CEventClient
 			int weaponDefID,
 			int projectileID,
 			bool paralyzer) {}
+		// UnitDamaged events are queued during the frame and delivered in one
+		// UnitDamagedBatch call-in at GameFramePost to clients that want it
+		virtual void QueueUnitDamaged(
+			const CUnit* unit,
+			const CUnit* attacker,
+			float damage,
+			int weaponDefID,
+			int projectileID,
+			bool paralyzer) {}
+		virtual void UnitDamagedBatch() {}
 		virtual void UnitStunned(const CUnit* unit, bool stunned) {}
 		virtual void UnitExperience(const CUnit* unit, float oldExperience) {}
 		virtual void UnitHarvestStorageFull(const CUnit* unit) {}
@@ -195,6 +205,9 @@ class CEventClient
 
 		virtual void ProjectileCreated(const CProjectile* proj) {}
 		virtual void ProjectileDestroyed(const CProjectile* proj) {}
+		// same scheme as QueueUnitDamaged
+		virtual void QueueProjectileCreated(const CProjectile* proj) {}
+		virtual void ProjectileCreatedBatch() {}
 
 		virtual void RenderProjectileCreated(const CProjectile* proj) {}
 		virtual void RenderProjectileDestroyed(const CProjectile* proj) {}
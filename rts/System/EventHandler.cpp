@@ -558,6 +558,11 @@ void CEventHandler::GameFrame(int gameFrame)
 void CEventHandler::GameFramePost(int gameFrame)
 {
 	ZoneScoped;
+	// hand out everything queued for the batched call-ins this frame first;
+	// events raised from here on go into the next frame's batches
+	ITERATE_EVENTCLIENTLIST_NA(UnitDamagedBatch);
+	ITERATE_EVENTCLIENTLIST_NA(ProjectileCreatedBatch);
+
 	ITERATE_EVENTCLIENTLIST(GameFramePost, gameFrame);
 }
 
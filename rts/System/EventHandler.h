@@ -553,6 +553,12 @@ inline void CEventHandler::UnitDamaged(
 	bool paralyzer)
 {
 	ITERATE_UNIT_ALLYTEAM_EVENTCLIENTLIST(UnitDamaged, unit, attacker, damage, weaponDefID, projectileID, paralyzer)
+
+	// queueing can not add or remove clients
+	for (CEventClient* ec: listUnitDamagedBatch) {
+		if (ec->CanReadAllyTeam(unitAllyTeam))
+			ec->QueueUnitDamaged(unit, attacker, damage, weaponDefID, projectileID, paralyzer);
+	}
 }
 
 inline void CEventHandler::UnitStunned(
@@ -679,6 +685,11 @@ inline void CEventHandler::ProjectileCreated(const CProjectile* proj, int allyTe
 			ec->ProjectileCreated(proj);
 		}
 	}
+
+	for (CEventClient* ec: listProjectileCreatedBatch) {
+		if ((allyTeam < 0) || ec->CanReadAllyTeam(allyTeam))
+			ec->QueueProjectileCreated(proj);
+	}
 }
 
 
@@ -0,0 +1,437 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "BlockGZ.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <zlib.h>
+
+#include "System/Threading/ThreadPool.h"
+
+
+static constexpr std::uint8_t GZ_FLAG_EXTRA = 4;
+static constexpr std::uint8_t GZ_OS_UNKNOWN = 255;
+
+// gzip extra-field subfield identifying a block, followed by the member and raw sizes
+static constexpr std::uint8_t BLOCK_SUBFIELD_ID[2] = {'R', 'B'};
+static constexpr std::uint16_t BLOCK_SUBFIELD_LEN = 8;
+
+// no block is ever this large, anything claiming otherwise is garbage
+static constexpr std::uint32_t MAX_BLOCK_RAW_SIZE = 1u << 30;
+
+
+static void WriteLE16(std::uint8_t* p, std::uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+static void WriteLE32(std::uint8_t* p, std::uint32_t v) { WriteLE16(p, v & 0xFFFF); WriteLE16(p + 2, v >> 16); }
+
+static std::uint16_t ReadLE16(const std::uint8_t* p) { return (p[0] | (p[1] << 8)); }
+static std::uint32_t ReadLE32(const std::uint8_t* p) { return (ReadLE16(p) | (std::uint32_t(ReadLE16(p + 2)) << 16)); }
+
+
+std::vector<std::uint8_t> BlockGZ::CompressBlock(const std::uint8_t* data, size_t size, int level)
+{
+	z_stream zstream;
+	std::memset(&zstream, 0, sizeof(zstream));
+
+	// raw deflate, the gzip framing is written by hand to include the block sizes
+	deflateInit2(&zstream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+	const size_t maxDeflatedSize = deflateBound(&zstream, size);
+
+	std::vector<std::uint8_t> member(MEMBER_HEADER_SIZE + maxDeflatedSize + MEMBER_TRAILER_SIZE);
+
+	zstream.next_in   = const_cast<Bytef*>(data);
+	zstream.avail_in  = size;
+	zstream.next_out  = member.data() + MEMBER_HEADER_SIZE;
+	zstream.avail_out = maxDeflatedSize;
+
+	const int ret = deflate(&zstream, Z_FINISH);
+	const size_t deflatedSize = zstream.total_out;
+
+	deflateEnd(&zstream);
+	assert(ret == Z_STREAM_END);
+
+	member.resize(MEMBER_HEADER_SIZE + deflatedSize + MEMBER_TRAILER_SIZE);
+
+	std::uint8_t* header = member.data();
+	std::uint8_t* trailer = member.data() + MEMBER_HEADER_SIZE + deflatedSize;
+
+	header[0] = 0x1F;
+	header[1] = 0x8B;
+	header[2] = Z_DEFLATED;
+	header[3] = GZ_FLAG_EXTRA;
+	WriteLE32(header + 4, 0); // mtime
+	header[8] = 0;
+	header[9] = GZ_OS_UNKNOWN;
+	WriteLE16(header + 10, 4 + BLOCK_SUBFIELD_LEN);
+	header[12] = BLOCK_SUBFIELD_ID[0];
+	header[13] = BLOCK_SUBFIELD_ID[1];
+	WriteLE16(header + 14, BLOCK_SUBFIELD_LEN);
+	WriteLE32(header + 16, member.size());
+	WriteLE32(header + 20, size);
+
+	WriteLE32(trailer + 0, crc32(0, data, size));
+	WriteLE32(trailer + 4, size);
+	return member;
+}
+
+bool BlockGZ::IsBlockMember(const std::uint8_t* header, size_t size)
+{
+	if (size < MEMBER_HEADER_SIZE)
+		return false;
+
+	if (header[0] != 0x1F || header[1] != 0x8B || header[2] != Z_DEFLATED || header[3] != GZ_FLAG_EXTRA)
+		return false;
+	if (ReadLE16(header + 10) != (4 + BLOCK_SUBFIELD_LEN))
+		return false;
+
+	return (header[12] == BLOCK_SUBFIELD_ID[0] && header[13] == BLOCK_SUBFIELD_ID[1] && ReadLE16(header + 14) == BLOCK_SUBFIELD_LEN);
+}
+
+bool BlockGZ::Decompress(const std::vector<std::uint8_t>& in, std::vector<std::uint8_t>& out)
+{
+	struct Member {
+		size_t inOffset;
+		size_t inSize;
+		size_t outOffset;
+		size_t outSize;
+	};
+
+	std::vector<Member> members;
+
+	size_t inOffset = 0;
+	size_t outOffset = 0;
+
+	while (inOffset < in.size()) {
+		if ((in.size() - inOffset) < (MEMBER_HEADER_SIZE + MEMBER_TRAILER_SIZE))
+			return false;
+
+		const std::uint8_t* header = in.data() + inOffset;
+
+		if (!IsBlockMember(header, in.size() - inOffset))
+			return false;
+
+		const size_t inSize = ReadLE32(header + 16);
+		const size_t outSize = ReadLE32(header + 20);
+
+		if (inSize < (MEMBER_HEADER_SIZE + MEMBER_TRAILER_SIZE) || inSize > (in.size() - inOffset))
+			return false;
+		if (outSize > MAX_BLOCK_RAW_SIZE)
+			return false;
+
+		members.push_back({inOffset, inSize, outOffset, outSize});
+
+		inOffset += inSize;
+		outOffset += outSize;
+	}
+
+	if (members.empty())
+		return false;
+
+	std::vector<std::uint8_t> buffer(outOffset);
+	std::atomic<bool> failed = {false};
+
+	for_mt(0, members.size(), [&](const int i) {
+		const Member& m = members[i];
+		const std::uint8_t* trailer = in.data() + m.inOffset + m.inSize - MEMBER_TRAILER_SIZE;
+
+		// inflate rejects a null output pointer even for empty blocks
+		std::uint8_t dummy = 0;
+
+		z_stream zstream;
+		std::memset(&zstream, 0, sizeof(zstream));
+		inflateInit2(&zstream, -MAX_WBITS);
+
+		zstream.next_in   = const_cast<Bytef*>(in.data() + m.inOffset + MEMBER_HEADER_SIZE);
+		zstream.avail_in  = m.inSize - MEMBER_HEADER_SIZE - MEMBER_TRAILER_SIZE;
+		zstream.next_out  = (m.outSize > 0)? buffer.data() + m.outOffset: &dummy;
+		zstream.avail_out = m.outSize;
+
+		const int ret = inflate(&zstream, Z_FINISH);
+		const size_t inflatedSize = zstream.total_out;
+
+		inflateEnd(&zstream);
+
+		if (ret != Z_STREAM_END || inflatedSize != m.outSize || ReadLE32(trailer + 4) != m.outSize) {
+			failed.store(true);
+			return;
+		}
+		if (ReadLE32(trailer) != crc32(0, zstream.next_out - m.outSize, m.outSize))
+			failed.store(true);
+	});
+
+	if (failed.load())
+		return false;
+
+	out = std::move(buffer);
+	return true;
+}
+
+
+
+CBlockGZWriteBuf::CBlockGZWriteBuf(std::ostream& sink_, int level_, size_t blockSize_)
+	: sink(sink_)
+	, blockSize(blockSize_)
+	// enough to keep every worker busy without buffering the whole stream
+	, maxJobsInFlight(std::max(4, ThreadPool::GetNumThreads() * 2))
+	, level(level_)
+{
+	assert(blockSize > 0 && blockSize <= MAX_BLOCK_RAW_SIZE);
+	SetPutBlock(0, 0);
+}
+
+CBlockGZWriteBuf::~CBlockGZWriteBuf()
+{
+	// pending jobs own their input and output, no need to wait for them
+}
+
+
+void CBlockGZWriteBuf::Hold(std::streamoff pos, std::streamoff size)
+{
+	assert(pos >= 0 && size > 0);
+
+	holdBegBlockIdx = pos / blockSize;
+	holdEndBlockIdx = (pos + size - 1) / blockSize + 1;
+
+	// can not hold anything that is already being compressed
+	assert(holdBegBlockIdx >= firstBlockIdx);
+	assert(holdBegBlockIdx >= (firstBlockIdx + blocks.size()) || !GetBlock(holdBegBlockIdx).submitted);
+}
+
+void CBlockGZWriteBuf::Release()
+{
+	holdBegBlockIdx = -1lu;
+	holdEndBlockIdx = 0;
+
+	SubmitBlocks();
+	WriteBlocks(false);
+}
+
+
+bool CBlockGZWriteBuf::Finish()
+{
+	if (finished)
+		return !failed;
+
+	SyncPutArea();
+	setp(nullptr, nullptr);
+
+	holdBegBlockIdx = -1lu;
+	holdEndBlockIdx = 0;
+	putBlockIdx = -1lu;
+
+	// an empty last block only exists if the stream ended on a block boundary
+	if (blocks.size() > 1 && blocks.back().size == 0) {
+		blocks.pop_back();
+		UpdateBufferedSize(-std::int64_t(blockSize));
+	}
+
+	SubmitBlocks();
+	WriteBlocks(true);
+
+	sink.flush();
+
+	failed |= !sink.good();
+	finished = true;
+	return !failed;
+}
+
+
+CBlockGZWriteBuf::int_type CBlockGZWriteBuf::overflow(int_type c)
+{
+	if (finished)
+		return traits_type::eof();
+
+	SyncPutArea();
+
+	if (!SetPutBlock(putBlockIdx + 1, 0))
+		return traits_type::eof();
+
+	if (traits_type::eq_int_type(c, traits_type::eof()))
+		return traits_type::not_eof(c);
+
+	*pptr() = traits_type::to_char_type(c);
+	pbump(1);
+	return c;
+}
+
+CBlockGZWriteBuf::pos_type CBlockGZWriteBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+	if (finished || (which & std::ios_base::out) == 0)
+		return pos_type(off_type(-1));
+
+	SyncPutArea();
+
+	const off_type curPos = putBlockIdx * blockSize + (pptr() - pbase());
+	const off_type endPos = (firstBlockIdx + blocks.size() - 1) * blockSize + blocks.back().size;
+
+	switch (dir) {
+		case std::ios_base::beg: { return seekpos(pos_type(off), which); } break;
+		case std::ios_base::end: { return seekpos(pos_type(endPos + off), which); } break;
+		default: break;
+	}
+
+	// tellp
+	if (off == 0)
+		return pos_type(curPos);
+
+	return seekpos(pos_type(curPos + off), which);
+}
+
+CBlockGZWriteBuf::pos_type CBlockGZWriteBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+	if (finished || (which & std::ios_base::out) == 0)
+		return pos_type(off_type(-1));
+
+	SyncPutArea();
+
+	const off_type endPos = (firstBlockIdx + blocks.size() - 1) * blockSize + blocks.back().size;
+
+	if (off_type(pos) < 0 || off_type(pos) > endPos)
+		return pos_type(off_type(-1));
+
+	size_t blockIdx = off_type(pos) / blockSize;
+	size_t blockOffset = off_type(pos) % blockSize;
+
+	// stay in a full last block rather than opening a new one
+	if (blockIdx == (firstBlockIdx + blocks.size()) && blockOffset == 0) {
+		blockIdx -= 1;
+		blockOffset = blockSize;
+	}
+
+	if (!SetPutBlock(blockIdx, blockOffset))
+		return pos_type(off_type(-1));
+
+	return pos;
+}
+
+
+void CBlockGZWriteBuf::SyncPutArea()
+{
+	if (pbase() == nullptr)
+		return;
+
+	Block& block = GetBlock(putBlockIdx);
+	block.size = std::max(block.size, size_t(pptr() - pbase()));
+}
+
+bool CBlockGZWriteBuf::SetPutBlock(size_t blockIdx, size_t blockOffset)
+{
+	if (blockIdx < firstBlockIdx)
+		return false;
+
+	if (blockIdx == (firstBlockIdx + blocks.size())) {
+		// never leave a gap
+		assert(blocks.empty() || blocks.back().size == blockSize);
+
+		blocks.emplace_back();
+		blocks.back().data.resize(blockSize);
+
+		UpdateBufferedSize(blockSize);
+	}
+
+	if (blockIdx >= (firstBlockIdx + blocks.size()))
+		return false;
+
+	Block& block = GetBlock(blockIdx);
+
+	if (block.submitted)
+		return false;
+
+	char* data = reinterpret_cast<char*>(block.data.data());
+
+	putBlockIdx = blockIdx;
+	setp(data, data + blockSize);
+	pbump(blockOffset);
+
+	SubmitBlocks();
+	WriteBlocks(false);
+	return true;
+}
+
+
+void CBlockGZWriteBuf::SubmitBlocks()
+{
+	for (size_t blockIdx = firstBlockIdx, endIdx = firstBlockIdx + blocks.size(); blockIdx < endIdx; ++blockIdx) {
+		Block& block = GetBlock(blockIdx);
+
+		if (block.submitted)
+			continue;
+		// the put block might still be written to, and so might the last one until Finish
+		if (blockIdx == putBlockIdx || (blockIdx == (endIdx - 1) && !finished && putBlockIdx != -1lu))
+			continue;
+		if (blockIdx >= holdBegBlockIdx && blockIdx < holdEndBlockIdx)
+			continue;
+
+		// the job owns the raw data, this block only keeps the result
+		block.member = ThreadPool::Enqueue([lvl = level, size = block.size, data = std::move(block.data)]() {
+			return BlockGZ::CompressBlock(data.data(), size, lvl);
+		});
+		block.submitted = true;
+	}
+
+	// bound the number of raw blocks queued up on the pool
+	size_t numRunning = 0;
+
+	for (Block& block: blocks) {
+		if (!block.submitted)
+			continue;
+		if (block.member.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			SetCompressed(block);
+			continue;
+		}
+
+		if ((numRunning += 1) > maxJobsInFlight) {
+			block.member.wait();
+			SetCompressed(block);
+		}
+	}
+}
+
+void CBlockGZWriteBuf::WriteBlocks(bool wait)
+{
+	while (!blocks.empty()) {
+		Block& block = blocks.front();
+
+		if (!block.submitted)
+			break;
+
+		// deferred futures (no worker threads) are run by get()
+		if (!wait && block.member.wait_for(std::chrono::seconds(0)) == std::future_status::timeout)
+			break;
+
+		const std::vector<std::uint8_t>& member = block.member.get();
+
+		SetCompressed(block);
+
+		if (!failed) {
+			sink.write(reinterpret_cast<const char*>(member.data()), member.size());
+			failed |= !sink.good();
+		}
+
+		rawSize += block.size;
+		compressedSize += member.size();
+
+		UpdateBufferedSize(-std::int64_t(member.size()));
+
+		blocks.pop_front();
+		firstBlockIdx += 1;
+	}
+}
+
+void CBlockGZWriteBuf::SetCompressed(Block& block)
+{
+	if (block.compressed)
+		return;
+
+	// the finished job has dropped its raw data, only the member remains
+	UpdateBufferedSize(std::int64_t(block.member.get().size()) - std::int64_t(blockSize));
+	block.compressed = true;
+}
+
+void CBlockGZWriteBuf::UpdateBufferedSize(std::int64_t delta)
+{
+	bufferedSize += delta;
+	peakBufferedSize = std::max(peakBufferedSize, bufferedSize);
+}
@@ -0,0 +1,129 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _BLOCK_GZ_H
+#define _BLOCK_GZ_H
+
+#include <cinttypes>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+/**
+ * Block-gzip container: a sequence of independently deflated gzip members,
+ * each of which records its own compressed and uncompressed size in a gzip
+ * extra-field. Any gzip reader (gzread, zcat, ...) sees one continuous
+ * stream, while BlockGZ::Decompress can locate the members up-front and
+ * inflate them in parallel.
+ */
+namespace BlockGZ {
+	static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+
+	/// gzip header (10) + XLEN (2) + block subfield (4 + 8)
+	static constexpr size_t MEMBER_HEADER_SIZE = 24;
+	/// CRC32 + ISIZE
+	static constexpr size_t MEMBER_TRAILER_SIZE = 8;
+
+	/// deflates <size> bytes into a complete gzip member
+	std::vector<std::uint8_t> CompressBlock(const std::uint8_t* data, size_t size, int level);
+
+	/**
+	 * Inflates a block-gzip buffer, one thread-pool job per member.
+	 * Returns false without touching <out> if <in> is not a block-gzip
+	 * stream (e.g. a plain gzip file) or any member fails its CRC check.
+	 */
+	bool Decompress(const std::vector<std::uint8_t>& in, std::vector<std::uint8_t>& out);
+
+	/// true if <data> starts with a block-gzip member header
+	bool IsBlockMember(const std::uint8_t* data, size_t size);
+}
+
+
+/**
+ * Output stream buffer that cuts everything written to it into fixed-size
+ * blocks and hands each finished block to the thread-pool for compression,
+ * so compressing overlaps with whatever is producing the data and only a
+ * few uncompressed blocks are ever resident.
+ *
+ * Seeking is supported within blocks that have not been compressed yet;
+ * writers that patch earlier data (e.g. the creg package header) must
+ * Hold() that range until they are done with it. Blocks are written out
+ * in order, so every block compressed after a held one stays buffered as
+ * a gzip member until Release(): peak memory is then roughly the held
+ * data's compressed size plus a few raw blocks.
+ */
+class CBlockGZWriteBuf : public std::streambuf
+{
+public:
+	CBlockGZWriteBuf(std::ostream& sink, int level, size_t blockSize = BlockGZ::DEFAULT_BLOCK_SIZE);
+	~CBlockGZWriteBuf() override;
+
+	CBlockGZWriteBuf(const CBlockGZWriteBuf&) = delete;
+	CBlockGZWriteBuf& operator = (const CBlockGZWriteBuf&) = delete;
+
+	/// keeps the blocks overlapping [pos, pos + size) seekable until Release()
+	void Hold(std::streamoff pos, std::streamoff size);
+	void Release();
+
+	/// compresses the remaining data and writes every block to the sink
+	bool Finish();
+
+	std::uint64_t GetRawSize() const { return rawSize; }
+	std::uint64_t GetCompressedSize() const { return compressedSize; }
+	/// largest number of (raw + compressed) bytes buffered at any one time
+	std::uint64_t GetPeakBufferedSize() const { return peakBufferedSize; }
+
+protected:
+	int_type overflow(int_type c) override;
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+private:
+	struct Block {
+		std::vector<std::uint8_t> data;
+		std::shared_future<std::vector<std::uint8_t>> member;
+
+		size_t size = 0;
+		bool submitted = false;
+		/// true once the buffered size counts the member instead of the raw data
+		bool compressed = false;
+	};
+
+	Block& GetBlock(size_t idx) { return blocks[idx - firstBlockIdx]; }
+
+	void SyncPutArea();
+	bool SetPutBlock(size_t idx, size_t offset);
+	void SubmitBlocks();
+	void WriteBlocks(bool wait);
+	void SetCompressed(Block& block);
+	void UpdateBufferedSize(std::int64_t delta);
+
+private:
+	std::ostream& sink;
+
+	/// blocks that were not written to <sink> yet, in stream order
+	std::deque<Block> blocks;
+
+	size_t blockSize;
+	size_t firstBlockIdx = 0;
+	size_t putBlockIdx = 0;
+	size_t maxJobsInFlight = 0;
+
+	size_t holdBegBlockIdx = -1lu;
+	size_t holdEndBlockIdx = 0;
+
+	int level;
+
+	std::uint64_t rawSize = 0;
+	std::uint64_t compressedSize = 0;
+
+	std::int64_t bufferedSize = 0;
+	std::int64_t peakBufferedSize = 0;
+
+	bool finished = false;
+	bool failed = false;
+};
+
+#endif // _BLOCK_GZ_H
@@ -4,9 +4,11 @@
 #include "GZFileHandler.h"
 
 #include <cassert>
+#include <cstdio>
 #include <string>
 #include <zlib.h>
 
+#include "BlockGZ.h"
 #include "FileQueryFlags.h"
 #include "FileSystem.h"
 
@@ -38,6 +40,9 @@ bool CGZFileHandler::ReadToBuffer(const std::string& path)
 {
 	assert(fileBuffer.empty());
 
+	if (ReadBlockGZToBuffer(path))
+		return true;
+
 	gzFile file = gzopen(path.c_str(), "rb");
 	if (file == Z_NULL)
 		return false;
@@ -62,11 +67,45 @@ bool CGZFileHandler::ReadToBuffer(const std::string& path)
 	return true;
 }
 
+bool CGZFileHandler::ReadBlockGZToBuffer(const std::string& path)
+{
+	FILE* file = std::fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return false;
+
+	std::uint8_t header[BlockGZ::MEMBER_HEADER_SIZE];
+	std::vector<std::uint8_t> compressed;
+
+	// only block-gzip files (e.g. savegames) are read in full up-front,
+	// anything else is left to gzread which also passes raw files through
+	if (std::fread(header, 1, sizeof(header), file) == sizeof(header) && BlockGZ::IsBlockMember(header, sizeof(header))) {
+		std::fseek(file, 0, SEEK_END);
+		compressed.resize(std::ftell(file));
+		std::fseek(file, 0, SEEK_SET);
+
+		if (std::fread(compressed.data(), 1, compressed.size(), file) != compressed.size())
+			compressed.clear();
+	}
+
+	std::fclose(file);
+
+	if (compressed.empty() || !BlockGZ::Decompress(compressed, fileBuffer))
+		return false;
+
+	fileSize = fileBuffer.size();
+	return true;
+}
+
 bool CGZFileHandler::UncompressBuffer()
 {
 	std::vector<std::uint8_t> compressed;
 	std::swap(compressed, fileBuffer);
 
+	if (BlockGZ::IsBlockMember(compressed.data(), compressed.size()) && BlockGZ::Decompress(compressed, fileBuffer)) {
+		fileSize = fileBuffer.size();
+		return true;
+	}
+
 
 	z_stream zstream;
 	zstream.opaque = Z_NULL;
@@ -86,7 +125,8 @@ bool CGZFileHandler::UncompressBuffer()
 		zstream.avail_out = BUFFER_SIZE;
 		zstream.next_out = unzipBuffer;
 		const int ret = inflate(&zstream, Z_NO_FLUSH);
-		if (ret != Z_OK) {
+		if (ret != Z_OK && ret != Z_STREAM_END) {
+			inflateEnd(&zstream);
 			fileBuffer.clear();
 			fileSize = -1;
 			return false;
@@ -95,8 +135,13 @@ bool CGZFileHandler::UncompressBuffer()
 		const size_t unzippedBytes = BUFFER_SIZE - zstream.avail_out;
 		fileBuffer.insert(fileBuffer.end(), unzipBuffer, unzipBuffer + unzippedBytes);
 
-		if (ret == Z_STREAM_END)
+		if (ret != Z_STREAM_END)
+			continue;
+		// concatenated gzip members form a single stream (like gzread)
+		if (zstream.avail_in == 0)
 			break;
+
+		inflateReset(&zstream);
 	}
 
 	inflateEnd(&zstream);
@@ -22,6 +22,7 @@ private:
 	bool TryReadFromRawFS(const std::string& fileName) override;
 	bool TryReadFromVFS(const std::string& fileName, int section) override;
 	bool ReadToBuffer(const std::string& path);
+	bool ReadBlockGZToBuffer(const std::string& path);
 	bool UncompressBuffer();
 };
 
@@ -0,0 +1,145 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include <fstream>
+
+#include "MemoryMappedFile.h"
+#include "System/Log/ILog.h"
+
+
+CMemoryMappedFile::CMemoryMappedFile(const std::string& filePath, bool copyOnWrite)
+	: writable(copyOnWrite)
+{
+	if (Map(filePath))
+		return;
+
+	Read(filePath);
+}
+
+
+bool CMemoryMappedFile::Map(const std::string& filePath)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, (writable? PAGE_WRITECOPY: PAGE_READONLY), 0, 0, nullptr);
+
+	if (mapping == nullptr) {
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, (writable? FILE_MAP_COPY: FILE_MAP_READ), 0, 0, 0);
+
+	if (view == nullptr) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mapHandle = mapping;
+
+	data = static_cast<std::uint8_t*>(view);
+	size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	const int fd = open(filePath.c_str(), O_RDONLY);
+
+	if (fd < 0)
+		return false;
+
+	struct stat info;
+
+	if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+		close(fd);
+		return false;
+	}
+
+	// MAP_PRIVATE turns writes into private page copies, the file itself is never modified
+	void* view = mmap(nullptr, static_cast<size_t>(info.st_size), (writable? (PROT_READ | PROT_WRITE): PROT_READ), MAP_PRIVATE, fd, 0);
+
+	// the mapping keeps its own reference to the file
+	close(fd);
+
+	if (view == MAP_FAILED)
+		return false;
+
+	// read-only contents are consumed front to back exactly once, writable
+	// views are kept around and accessed at random
+	if (!writable)
+		madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+	mapHandle = view;
+
+	data = static_cast<std::uint8_t*>(view);
+	size = static_cast<size_t>(info.st_size);
+#endif
+
+	return true;
+}
+
+bool CMemoryMappedFile::Read(const std::string& filePath)
+{
+	std::ifstream ifs(filePath, std::ios::in | std::ios::binary | std::ios::ate);
+
+	if (!ifs.good())
+		return false;
+
+	const std::streamoff fileSize = ifs.tellg();
+
+	if (fileSize <= 0)
+		return false;
+
+	buffer.resize(static_cast<size_t>(fileSize));
+	ifs.seekg(0, std::ios::beg);
+
+	if (!ifs.read(reinterpret_cast<char*>(buffer.data()), fileSize)) {
+		LOG_L(L_WARNING, "[MemoryMappedFile::%s] failed to read \"%s\"", __func__, filePath.c_str());
+		buffer.clear();
+		return false;
+	}
+
+	data = buffer.data();
+	size = buffer.size();
+	return true;
+}
+
+
+void CMemoryMappedFile::Close()
+{
+	if (IsMapped()) {
+	#ifdef _WIN32
+		UnmapViewOfFile(data);
+		CloseHandle(static_cast<HANDLE>(mapHandle));
+		CloseHandle(static_cast<HANDLE>(fileHandle));
+	#else
+		munmap(mapHandle, size);
+	#endif
+	}
+
+	buffer.clear();
+
+	data = nullptr;
+	size = 0;
+
+	fileHandle = nullptr;
+	mapHandle = nullptr;
+}
@@ -0,0 +1,57 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef MEMORY_MAPPED_FILE_H
+#define MEMORY_MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Read-only view of a file on the raw filesystem (no VFS), mapped into
+ * memory where the platform allows it. If mapping fails the file is read
+ * into a private buffer instead, so callers only have to check IsOpen().
+ *
+ * A copy-on-write view can additionally be modified in place: pages that
+ * are never written stay shared with the OS file cache (and thereby with
+ * every other process mapping the same file), written pages become private
+ * to this process and are never stored back to disk.
+ */
+class CMemoryMappedFile
+{
+public:
+	CMemoryMappedFile(const std::string& filePath, bool copyOnWrite = false);
+	~CMemoryMappedFile() { Close(); }
+
+	CMemoryMappedFile(const CMemoryMappedFile&) = delete;
+	CMemoryMappedFile& operator = (const CMemoryMappedFile&) = delete;
+
+	bool IsOpen() const { return (data != nullptr); }
+	bool IsMapped() const { return (IsOpen() && buffer.empty()); }
+
+	const std::uint8_t* GetData() const { return data; }
+	// nullptr unless opened as copy-on-write
+	std::uint8_t* GetWritableData() { return (writable? data: nullptr); }
+	size_t GetSize() const { return size; }
+
+	void Close();
+
+private:
+	bool Map(const std::string& filePath);
+	bool Read(const std::string& filePath);
+
+private:
+	std::uint8_t* data = nullptr;
+	size_t size = 0;
+
+	bool writable = false;
+
+	// fallback storage when the file could not be mapped
+	std::vector<std::uint8_t> buffer;
+
+	void* fileHandle = nullptr;
+	void* mapHandle = nullptr;
+};
+
+#endif // MEMORY_MAPPED_FILE_H
@@ -1,7 +1,8 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <fstream>
+#include <future>
 #include <sstream>
-#include <zlib.h>
 
 #include "ExternalAI/SkirmishAIHandler.h"
 #include "ExternalAI/EngineOutHandler.h"
@@ -42,16 +43,59 @@
 #include "Sim/Weapons/PlasmaRepulser.h"
 #include "System/SafeUtil.h"
 #include "System/Platform/errorhandler.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/FileSystem/BlockGZ.h"
 #include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/FileQueryFlags.h"
+#include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/GZFileHandler.h"
+#include "System/Threading/SpringThreading.h"
 #include "System/Threading/ThreadPool.h"
+#include "System/UnorderedMap.hpp"
 #include "System/creg/SerializeLuaState.h"
 #include "System/creg/Serializer.h"
 #include "System/Exceptions.h"
 #include "System/Log/ILog.h"
 
 #define MAX_STRING_SIZE (1 << 19) // 512kB excluding null-term
+// upper bound on creg's PackageHeader, patched after the package is written
+#define PACKAGE_HEADER_SIZE 64
+
+CONFIG(int, SaveGameCompressionLevel)
+	.defaultValue(5)
+	.minimumValue(0)
+	.maximumValue(9)
+	.description("zlib compression level for save-files. Blocks are compressed in parallel while the game state is written, higher levels trade save time for smaller files.");
+
+
+// save-files whose last blocks are still being written in the background
+static spring::mutex pendingSavesMutex;
+static spring::unordered_map<std::string, std::shared_future<void>> pendingSaves;
+
+static void WaitForPendingSave(const std::string& fileName)
+{
+	std::shared_future<void> pendingSave;
+
+	{
+		std::lock_guard<spring::mutex> lock(pendingSavesMutex);
+
+		const auto it = pendingSaves.find(fileName);
+
+		if (it == pendingSaves.end())
+			return;
+
+		pendingSave = std::move(it->second);
+		pendingSaves.erase(it);
+	}
+
+	pendingSave.wait();
+}
+
+static void AddPendingSave(const std::string& fileName, std::shared_future<void> pendingSave)
+{
+	std::lock_guard<spring::mutex> lock(pendingSavesMutex);
+	pendingSaves[fileName] = std::move(pendingSave);
+}
 
 
 CCregLoadSaveHandler::CCregLoadSaveHandler()
@@ -227,11 +271,26 @@ static void ReadString(std::istream& s, std::string& str)
 }
 
 
-static void SaveLuaState(CSplitLuaHandle* handle, creg::COutputStreamSerializer& os, std::stringstream& oss)
+static void SavePackage(creg::COutputStreamSerializer& os, std::ostream& oss, void* obj, creg::Class* cls)
+{
+	// when streaming into a compressor, the package header has to stay
+	// writable until SavePackage is done and seeks back to fill it in
+	CBlockGZWriteBuf* gzbuf = dynamic_cast<CBlockGZWriteBuf*>(oss.rdbuf());
+
+	if (gzbuf != nullptr)
+		gzbuf->Hold(oss.tellp(), PACKAGE_HEADER_SIZE);
+
+	os.SavePackage(&oss, obj, cls);
+
+	if (gzbuf != nullptr)
+		gzbuf->Release();
+}
+
+static void SaveLuaState(CSplitLuaHandle* handle, creg::COutputStreamSerializer& os, std::ostream& oss)
 {
 	CLuaStateCollector lsc;
 	lsc.Read(handle);
-	os.SavePackage(&oss, &lsc, lsc.GetClass());
+	SavePackage(os, oss, &lsc, lsc.GetClass());
 }
 
 
@@ -253,18 +312,10 @@ static void LoadLuaState(CSplitLuaHandle* handle, creg::CInputStreamSerializer&
 }
 
 
-void CCregLoadSaveHandler::SaveGame(const std::string& path)
+bool CCregLoadSaveHandler::SaveGameState(std::ostream& oss)
 {
 #ifdef USING_CREG
-	LOG("[LSH::%s] saving game to \"%s\"", __func__, path.c_str());
-
-	// NB: Selection leaves CObject reference as Unit's listener,
-	//     But isn't serialized - leak on load.
-	selectedUnitsHandler.ClearSelected();
-
 	try {
-		std::stringstream oss;
-
 		// write our own header. SavePackage() will add its own
 		WriteString(oss, SpringVersion::GetSync());
 		WriteString(oss, gameSetup->setupText);
@@ -286,7 +337,7 @@ void CCregLoadSaveHandler::SaveGame(const std::string& path)
 			// save creg state
 			const int gameStart = oss.tellp();
 			CGameStateCollector gsc;
-			os.SavePackage(&oss, &gsc, gsc.GetClass());
+			SavePackage(os, oss, &gsc, gsc.GetClass());
 			PrintSize("Game", ((int)oss.tellp()) - gameStart);
 
 
@@ -305,27 +356,8 @@ void CCregLoadSaveHandler::SaveGame(const std::string& path)
 			PrintSize("AIs", ((int)oss.tellp()) - aiStart);
 		}
 
-		{
-			gzFile file = gzopen(dataDirsAccess.LocateFile(path, FileQueryFlags::WRITE).c_str(), "wb5");
-
-			if (file == nullptr) {
-				LOG_L(L_ERROR, "[LSH::%s] could not open save-file", __func__);
-				return;
-			}
-
-			std::string data = oss.str();
-			std::function<void(gzFile, std::string&&)> func = [](gzFile file, std::string&& data) {
-				gzwrite(file, data.c_str(), data.size());
-				gzflush(file, Z_FINISH);
-				gzclose(file);
-			};
-
-			// gzFile is just a plain typedef (struct gzFile_s {}* gzFile), can be copied
-			// need to keep a reference to the future around or its destructor will block
-			ThreadPool::AddExtJob(std::move(std::async(std::launch::async, std::move(func), file, std::move(data))));
-		}
-
 		//FIXME add lua state
+		return true;
 	} catch (const content_error& ex) {
 		LOG_L(L_ERROR, "[LSH::%s] content error \"%s\"", __func__, ex.what());
 	} catch (const std::exception& ex) {
@@ -340,21 +372,110 @@ void CCregLoadSaveHandler::SaveGame(const std::string& path)
 #else //USING_CREG
 	LOG_L(L_ERROR, "[LSH::%s] creg is disabled", __func__);
 #endif //USING_CREG
+
+	return false;
+}
+
+void CCregLoadSaveHandler::SaveGame(const std::string& path)
+{
+	LOG("[LSH::%s] saving game to \"%s\"", __func__, path.c_str());
+
+	// NB: Selection leaves CObject reference as Unit's listener,
+	//     But isn't serialized - leak on load.
+	selectedUnitsHandler.ClearSelected();
+
+	struct SaveFile {
+		SaveFile(const std::string& name, int level)
+			: file(name, std::ios::out | std::ios::binary | std::ios::trunc)
+			, gzbuf(file, level)
+			, stream(&gzbuf)
+		{}
+
+		std::ofstream file;
+		CBlockGZWriteBuf gzbuf;
+		std::ostream stream;
+	};
+
+	// the state is compressed block by block while it is being serialized
+	// instead of first collecting all of it in memory; the save-file stays
+	// gzip-compatible, but can also be inflated in parallel when loading
+	const std::string fileName = dataDirsAccess.LocateFile(path, FileQueryFlags::WRITE);
+
+	// an earlier save to the same file may still be finishing
+	WaitForPendingSave(fileName);
+
+	const auto saveFile = std::make_shared<SaveFile>(fileName, configHandler->GetInt("SaveGameCompressionLevel"));
+
+	if (!saveFile->file.is_open()) {
+		LOG_L(L_ERROR, "[LSH::%s] could not open save-file", __func__);
+		return;
+	}
+
+	if (!SaveGameState(saveFile->stream)) {
+		saveFile->file.close();
+		FileSystem::Remove(fileName);
+		return;
+	}
+
+	const auto finished = std::make_shared<std::promise<void>>();
+
+	AddPendingSave(fileName, finished->get_future().share());
+
+	// compressing and writing the last few blocks does not need the game state anymore
+	// need to keep a reference to the future around or its destructor will block
+	ThreadPool::AddExtJob(std::move(std::async(std::launch::async, [saveFile, finished]() {
+		if (saveFile->gzbuf.Finish()) {
+			LOG("[LSH::SaveGame] wrote %.1f MB (%.1f MB uncompressed, peak %.1f MB buffered)",
+				saveFile->gzbuf.GetCompressedSize() / (1024.0f * 1024),
+				saveFile->gzbuf.GetRawSize() / (1024.0f * 1024),
+				saveFile->gzbuf.GetPeakBufferedSize() / (1024.0f * 1024)
+			);
+		} else {
+			LOG_L(L_ERROR, "[LSH::SaveGame] failed writing save-file");
+		}
+
+		saveFile->file.close();
+		finished->set_value();
+	})));
+}
+
+bool CCregLoadSaveHandler::SaveKeyFrame(std::ostream& oss)
+{
+	// keyframes are taken while the player is in control, so put the
+	// selection back afterwards instead of dropping it like SaveGame
+	const std::vector<int> selectedUnitIDs(selectedUnitsHandler.selectedUnits.begin(), selectedUnitsHandler.selectedUnits.end());
+
+	selectedUnitsHandler.ClearSelected();
+
+	const bool ret = SaveGameState(oss);
+
+	for (const int unitID: selectedUnitIDs) {
+		CUnit* unit = unitHandler.GetUnit(unitID);
+
+		if (unit != nullptr)
+			selectedUnitsHandler.AddUnit(unit);
+	}
+
+	return ret;
 }
 
 /// loads the data (map&mod-name,setup-script) needed by PreGame
 bool CCregLoadSaveHandler::LoadGameStartInfo(const std::string& path)
 {
-	CGZFileHandler saveFile(dataDirsAccess.LocateFile(FindSaveFile(path)), SPRING_VFS_RAW_FIRST);
+	const std::string fileName = dataDirsAccess.LocateFile(FindSaveFile(path));
+
+	// the game may have just been saved to it
+	WaitForPendingSave(fileName);
+
+	CGZFileHandler saveFile(fileName, SPRING_VFS_RAW_FIRST);
 
-	std::stringbuf* sbuf = iss.rdbuf();
 	std::string saveVersion;
 	std::string syncVersion = SpringVersion::GetSync();
+	std::string saveData;
 
-	char buf[4096];
-	int len;
-	while ((len = saveFile.Read(buf, sizeof(buf))) > 0)
-		sbuf->sputn(buf, len);
+	// the handler already holds the whole inflated file, avoid a second copy
+	saveFile.LoadStringData(saveData);
+	iss.str(std::move(saveData));
 
 	ReadString(iss, saveVersion);
 
@@ -373,11 +494,40 @@ bool CCregLoadSaveHandler::LoadGameStartInfo(const std::string& path)
 	return (saveVersion == syncVersion);
 }
 
+/// like LoadGameStartInfo, but keeps the demo's own setup-script
+bool CCregLoadSaveHandler::LoadKeyFrameStartInfo(std::string state)
+{
+	std::string saveVersion;
+	std::string syncVersion = SpringVersion::GetSync();
+
+	iss.str(std::move(state));
+
+	ReadString(iss, saveVersion);
+	ReadString(iss, scriptText);
+	ReadString(iss, modName);
+	ReadString(iss, mapName);
+
+	isKeyFrame = true;
+	return (saveVersion == syncVersion);
+}
+
 /// this should be called on frame 0 when the game has started
 void CCregLoadSaveHandler::LoadGame()
 {
 #ifdef USING_CREG
 	ENTER_SYNCED_CODE();
+
+	// keyframes were saved by the player who recorded the demo, the viewer
+	// has to stay who it is
+	const int myPlayerNum = gu->myPlayerNum;
+	const int myTeam = gu->myTeam;
+	const int myAllyTeam = gu->myAllyTeam;
+	const int myPlayingTeam = gu->myPlayingTeam;
+	const int myPlayingAllyTeam = gu->myPlayingAllyTeam;
+	const bool spectating = gu->spectating;
+	const bool spectatingFullView = gu->spectatingFullView;
+	const bool spectatingFullSelect = gu->spectatingFullSelect;
+
 	{
 		Sim::LoadComponents(iss);
 
@@ -399,6 +549,17 @@ void CCregLoadSaveHandler::LoadGame()
 		spring::SafeDelete(gsc);
 	}
 
+	if (isKeyFrame) {
+		gu->myPlayerNum = myPlayerNum;
+		gu->myTeam = myTeam;
+		gu->myAllyTeam = myAllyTeam;
+		gu->myPlayingTeam = myPlayingTeam;
+		gu->myPlayingAllyTeam = myPlayingAllyTeam;
+		gu->spectating = spectating;
+		gu->spectatingFullView = spectatingFullView;
+		gu->spectatingFullSelect = spectatingFullSelect;
+	}
+
 	LEAVE_SYNCED_CODE();
 #else //USING_CREG
 	LOG_L(L_ERROR, "Load failed: creg is disabled");
@@ -18,8 +18,17 @@ public:
 	void LoadAIData() override;
 	void SaveGame(const std::string& path) override;
 
+	/// demo keyframes, same contents as an uncompressed save-file
+	bool SaveKeyFrame(std::ostream& oss);
+	bool LoadKeyFrameStartInfo(std::string state);
+
+protected:
+	bool SaveGameState(std::ostream& oss);
+
 protected:
 	std::stringstream iss;
+
+	bool isKeyFrame = false;
 };
 
 #endif // CREG_LOAD_SAVE_HANDLER_H
@@ -9,3 +9,8 @@ CDemo::CDemo():
 {
 	memset(&fileHeader, 0, sizeof(DemoFileHeader));
 }
+
+std::string CDemo::GetKeyFramesName(const std::string& name)
+{
+	return (name.substr(0, name.find_last_of('.')) + "." DEMOFILE_KEYFRAMES_EXT);
+}
@@ -19,6 +19,9 @@ public:
 
 	const DemoFileHeader& GetFileHeader() const { return fileHeader; }
 
+	/// name of the file holding the keyframes of demo <name>
+	static std::string GetKeyFramesName(const std::string& name);
+
 protected:
 	DemoFileHeader fileHeader;
 	std::string demoName;
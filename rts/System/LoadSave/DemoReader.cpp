@@ -10,11 +10,17 @@
 CONFIG(bool, DisableDemoVersionCheck).defaultValue(false).description("Allow to play every replay file (may crash / cause undefined behaviour in replays)");
 #endif
 #include "System/Exceptions.h"
+#include "System/FileSystem/BlockGZ.h"
 #include "System/FileSystem/GZFileHandler.h"
 #include "System/FileSystem/FileSystem.h"
+#ifndef TOOLS
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/Platform/Misc.h"
+#endif
 #include "System/Log/ILog.h"
 #include "System/Net/RawPacket.h"
 
+#include <algorithm>
 #include <array>
 #include <climits>
 #include <stdexcept>
@@ -49,7 +55,9 @@ static bool CheckDemoHeader(const DemoFileHeader& fileHeader)
 }
 
 
-CDemoReader::CDemoReader(const std::string& filename, float curTime): playbackDemo(new CGZFileHandler(filename, SPRING_VFS_PWD_ALL))
+CDemoReader::CDemoReader(const std::string& filename, float curTime)
+	: playbackDemo(new CGZFileHandler(filename, SPRING_VFS_PWD_ALL))
+	, keyFramesName(GetKeyFramesName(filename))
 {
 	if (FileSystem::GetExtension(filename) != "sdfz")
 		throw content_error("Unknown demo extension: " + FileSystem::GetExtension(filename));
@@ -99,6 +107,8 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime): playbackDe
 		// (if this had still used CFileHandler that would have been easier ;-))
 		bytesRemaining = playbackDemoSize - curPos;
 	}
+
+	LoadIndex();
 	playbackDemo->Seek(curPos);
 }
 
@@ -200,3 +210,128 @@ void CDemoReader::LoadStats()
 
 	playbackDemo->Seek(curPos);
 }
+
+
+void CDemoReader::LoadIndex()
+{
+	// no trailer is written if Spring crashed while recording
+	if (fileHeader.demoStreamSize == 0)
+		return;
+
+	DemoIndexTrailer trailer;
+
+	if (playbackDemoSize < static_cast<int>(sizeof(trailer)))
+		return;
+
+	playbackDemo->Seek(playbackDemoSize - sizeof(trailer));
+
+	if (playbackDemo->Read(reinterpret_cast<char*>(&trailer), sizeof(trailer)) < sizeof(trailer))
+		return;
+	if (memcmp(trailer.magic, DEMOFILE_INDEX_MAGIC, sizeof(trailer.magic)) != 0)
+		return;
+
+	trailer.swab();
+
+	const std::int64_t indexPos = playbackDemoSize - std::int64_t(sizeof(trailer)) - trailer.frameIndexSize;
+	const std::int64_t streamEndPos = fileHeader.headerSize + fileHeader.scriptSize + fileHeader.demoStreamSize;
+
+	if (trailer.numFrames <= 0 || trailer.frameIndexSize != (trailer.numFrames * std::int64_t(sizeof(DemoFrameIndexEntry))) || indexPos < streamEndPos) {
+		LOG_L(L_WARNING, "[DemoReader::%s] ignoring corrupt demo index", __func__);
+		return;
+	}
+
+	frameIndex.resize(trailer.numFrames);
+	playbackDemo->Seek(indexPos);
+
+	if (playbackDemo->Read(reinterpret_cast<char*>(frameIndex.data()), trailer.frameIndexSize) < trailer.frameIndexSize) {
+		frameIndex.clear();
+		return;
+	}
+
+	for (DemoFrameIndexEntry& entry: frameIndex) {
+		entry.swab();
+	}
+
+	if (trailer.numKeyFrames > 0)
+		LoadKeyFrames(trailer);
+}
+
+void CDemoReader::LoadKeyFrames(const DemoIndexTrailer& trailer)
+{
+#ifndef TOOLS
+	// same lookup as for the demo itself, relative names are tried in the working directory first
+	if (!FileSystem::IsAbsolutePath(keyFramesName) && FileSystem::FileExists(Platform::GetOrigCWD() + keyFramesName)) {
+		keyFramesName = Platform::GetOrigCWD() + keyFramesName;
+	} else {
+		keyFramesName = dataDirsAccess.LocateFile(keyFramesName);
+	}
+#endif
+
+	std::ifstream file(keyFramesName, std::ios::in | std::ios::binary);
+
+	if (!file.is_open()) {
+		LOG_L(L_WARNING, "[DemoReader::%s] demo has %d keyframes but \"%s\" could not be opened", __func__, trailer.numKeyFrames, keyFramesName.c_str());
+		return;
+	}
+
+	// only the headers are read here, states are large and rarely needed
+	keyFrames.reserve(trailer.numKeyFrames);
+
+	for (std::int64_t pos = 0; static_cast<int>(keyFrames.size()) < trailer.numKeyFrames; ) {
+		DemoKeyFrameHeader keyFrameHeader;
+
+		file.seekg(pos);
+
+		if (!file.read(reinterpret_cast<char*>(&keyFrameHeader), sizeof(keyFrameHeader)))
+			break;
+
+		keyFrameHeader.swab();
+		pos += sizeof(keyFrameHeader);
+
+		if (keyFrameHeader.stateSize <= 0 || keyFrameHeader.rawStateSize <= 0 || (pos + keyFrameHeader.stateSize) > trailer.keyFrameSize)
+			break;
+
+		keyFrames.push_back({keyFrameHeader.frameNum, keyFrameHeader.stateSize, pos});
+		pos += keyFrameHeader.stateSize;
+	}
+
+	if (static_cast<int>(keyFrames.size()) != trailer.numKeyFrames) {
+		LOG_L(L_WARNING, "[DemoReader::%s] ignoring corrupt demo keyframes", __func__);
+		keyFrames.clear();
+	}
+}
+
+
+const CDemoReader::KeyFrame* CDemoReader::FindKeyFrame(int frameNum) const
+{
+	const auto pred = [](int frameNum, const KeyFrame& kf) { return (frameNum < kf.frameNum); };
+	const auto iter = std::upper_bound(keyFrames.begin(), keyFrames.end(), frameNum, pred);
+
+	if (iter == keyFrames.begin())
+		return nullptr;
+
+	return &*(iter - 1);
+}
+
+bool CDemoReader::ReadKeyFrameState(const KeyFrame& keyFrame, std::string& state)
+{
+	std::ifstream file(keyFramesName, std::ios::in | std::ios::binary);
+	std::vector<std::uint8_t> compressed(keyFrame.stateSize);
+	std::vector<std::uint8_t> inflated;
+
+	if (!file.seekg(keyFrame.statePos) || !file.read(reinterpret_cast<char*>(compressed.data()), compressed.size()))
+		return false;
+	if (!BlockGZ::Decompress(compressed, inflated))
+		return false;
+
+	state.assign(inflated.begin(), inflated.end());
+	return true;
+}
+
+
+void CDemoReader::ResetReadTime(float curTime)
+{
+	// same bookkeeping as on construction, as if the stream started here
+	demoTimeOffset = curTime - chunkHeader.modGameTime - 0.1f;
+	nextDemoReadTime = curTime - 0.01f;
+}
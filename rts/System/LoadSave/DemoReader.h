@@ -3,6 +3,7 @@
 #ifndef DEMO_READER
 #define DEMO_READER
 
+#include <cstdint>
 #include <fstream>
 #include <vector>
 
@@ -55,6 +56,37 @@ public:
 	/// Not needed for normal demo watching
 	void LoadStats();
 
+	struct KeyFrame {
+		int frameNum;
+		std::int64_t stateSize; ///< compressed size
+		std::int64_t statePos; ///< position of the state in the keyframes file
+	};
+
+	bool HasIndex() const { return (!frameIndex.empty()); }
+
+	/// last simulated frame covered by the index
+	int GetLastFrame() const { return (frameIndex.empty()? -1: frameIndex.back().frameNum); }
+
+	const std::vector<KeyFrame>& GetKeyFrames() const { return keyFrames; }
+
+	/**
+	@brief Find the latest keyframe at or before frameNum
+	@return nullptr if there is none
+	*/
+	const KeyFrame* FindKeyFrame(int frameNum) const;
+	/// reads and inflates the savestate of keyFrame
+	bool ReadKeyFrameState(const KeyFrame& keyFrame, std::string& state);
+
+	/**
+	@brief Continue reading in real time from the current position
+	@param curTime Time at which the next chunk should be read
+	*/
+	void ResetReadTime(float curTime);
+
+private:
+	void LoadIndex();
+	void LoadKeyFrames(const DemoIndexTrailer& trailer);
+
 private:
 	CFileHandler* playbackDemo;
 
@@ -70,6 +102,11 @@ private:
 	std::vector<PlayerStatistics> playerStats; // one stat per player
 	std::vector< std::vector<TeamStatistics> > teamStats; // many stats per team
 	std::vector<unsigned char> winningAllyTeams;
+
+	std::vector<DemoFrameIndexEntry> frameIndex;
+	std::vector<KeyFrame> keyFrames;
+
+	std::string keyFramesName;
 };
 
 #endif
@@ -8,9 +8,13 @@
 #include "DemoRecorder.h"
 #include "base64.h"
 #include "Game/GameVersion.h"
+#include "Net/Protocol/NetMessageTypes.h"
+#include "Sim/Misc/GlobalConstants.h"
 #include "Sim/Misc/TeamStatistics.h"
 #include "System/TimeUtil.h"
 #include "System/StringUtil.h"
+#include "System/Config/ConfigHandler.h"
+#include "System/FileSystem/BlockGZ.h"
 #include "System/FileSystem/DataDirsAccess.h"
 #include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/FileQueryFlags.h"
@@ -27,6 +31,15 @@
 #endif
 
 
+// a keyframe is a full savestate taken on the recording client (after it sent
+// the sync response for the frame), so that client stalls for as long as saving
+// the game takes whenever one is due; the server sees this as lag
+CONFIG(int, DemoKeyFrameInterval)
+	.defaultValue(0)
+	.minimumValue(0)
+	.description("Minutes of game time between savestates written next to recorded demos, which lets playback start from the nearest one. Each one blocks the game for as long as a full save does (can be seconds in large games). 0 disables keyframes.");
+
+
 // server and client memory-streams
 static std::string demoStreams[2];
 static spring::mutex demoMutex;
@@ -36,6 +49,12 @@ CDemoRecorder::CDemoRecorder(const std::string& mapName, const std::string& modN
 {
 	std::lock_guard<spring::mutex> lock(demoMutex);
 
+	// the server never simulates, only client demos can carry keyframes
+	if (!isServerDemo)
+		keyFrameInterval = configHandler->GetInt("DemoKeyFrameInterval") * 60 * GAME_SPEED;
+	if (keyFrameInterval > 0)
+		keyFrameLevel = configHandler->GetInt("SaveGameCompressionLevel");
+
 	SetStream();
 	SetName(mapName, modName);
 	SetFileHeader();
@@ -52,6 +71,7 @@ CDemoRecorder::~CDemoRecorder()
 	WriteWinnerList();
 	WritePlayerStats();
 	WriteTeamStats();
+	WriteIndex();
 	WriteFileHeader(true);
 	WriteDemoFile();
 }
@@ -127,6 +147,11 @@ void CDemoRecorder::SaveToDemo(const unsigned char* buf, const unsigned length,
 {
 	DemoStreamChunkHeader chunkHeader;
 
+	if (length > 0 && (buf[0] == NETMSG_NEWFRAME || buf[0] == NETMSG_KEYFRAME)) {
+		// frames are counted the same way CGameServer::SendDemoData does
+		frameIndex.push_back({static_cast<int>(frameIndex.size()), fileHeader.demoStreamSize});
+	}
+
 	chunkHeader.modGameTime = modGameTime;
 	chunkHeader.length = length;
 	chunkHeader.swab();
@@ -228,6 +253,71 @@ void CDemoRecorder::SetWinningAllyTeams(const std::vector<unsigned char>& winnin
 	winningAllyTeams = winningAllyTeamIDs;
 }
 
+/** @brief Write a savestate taken right after frameNum was simulated to the keyframes file */
+void CDemoRecorder::AddKeyFrame(int frameNum, const std::function<bool(std::ostream&)>& saveState)
+{
+	// the frame has to be indexed for playback to find where to resume
+	if (frameIndex.empty() || frameIndex.back().frameNum != frameNum) {
+		LOG_L(L_WARNING, "[DemoRecorder::%s] discarding keyframe for unindexed frame %d", __func__, frameNum);
+		return;
+	}
+
+	if (keyFrameFile == nullptr) {
+		keyFrameFile = std::make_unique<std::ofstream>(GetKeyFramesName(demoName), std::ios::out | std::ios::binary | std::ios::trunc);
+
+		if (!keyFrameFile->is_open()) {
+			LOG_L(L_ERROR, "[DemoRecorder::%s] could not open keyframes file, no more keyframes will be taken", __func__);
+			keyFrameFile.reset();
+			keyFrameInterval = 0;
+			return;
+		}
+	}
+
+	DemoKeyFrameHeader keyFrameHeader = {frameNum, 0, 0};
+
+	// placeholder, patched once the compressed size is known; whatever
+	// a failed keyframe left behind is overwritten by the next one
+	keyFrameFile->seekp(keyFrameFileSize);
+	keyFrameFile->write(reinterpret_cast<const char*>(&keyFrameHeader), sizeof(keyFrameHeader));
+
+	{
+		// only the compressed state is buffered, never the raw one
+		CBlockGZWriteBuf gzbuf(*keyFrameFile, keyFrameLevel);
+		std::ostream stream(&gzbuf);
+
+		if (!saveState(stream) || !gzbuf.Finish()) {
+			LOG_L(L_WARNING, "[DemoRecorder::%s] failed writing keyframe for frame %d", __func__, frameNum);
+			keyFrameFile->clear();
+			return;
+		}
+
+		keyFrameHeader.stateSize = gzbuf.GetCompressedSize();
+		keyFrameHeader.rawStateSize = gzbuf.GetRawSize();
+	}
+
+	const std::int64_t keyFrameEnd = keyFrameFile->tellp();
+
+	LOG("[DemoRecorder::%s] added keyframe for frame %d (%.1f MB, %.1f MB uncompressed)", __func__, frameNum,
+		keyFrameHeader.stateSize / (1024.0f * 1024),
+		keyFrameHeader.rawStateSize / (1024.0f * 1024)
+	);
+
+	keyFrameHeader.swab();
+	keyFrameFile->seekp(keyFrameFileSize);
+	keyFrameFile->write(reinterpret_cast<const char*>(&keyFrameHeader), sizeof(keyFrameHeader));
+	keyFrameFile->seekp(keyFrameEnd);
+	keyFrameFile->flush();
+
+	if (!keyFrameFile->good()) {
+		LOG_L(L_WARNING, "[DemoRecorder::%s] failed writing keyframe for frame %d", __func__, frameNum);
+		keyFrameFile->clear();
+		return;
+	}
+
+	keyFrameFileSize = keyFrameEnd;
+	numKeyFrames += 1;
+}
+
 /** @brief Write DemoFileHeader
 Write the DemoFileHeader at the start of the file and restores the original
 position in the file afterwards. */
@@ -311,3 +401,30 @@ void CDemoRecorder::WriteTeamStats()
 
 	teamStats.clear();
 }
+
+/** @brief Write frame index and DemoIndexTrailer at the end of the file. */
+void CDemoRecorder::WriteIndex()
+{
+	// keyframes are already on disk, only their extent is recorded
+	keyFrameFile.reset();
+
+	if (frameIndex.empty())
+		return;
+
+	DemoIndexTrailer trailer;
+	trailer.keyFrameSize = keyFrameFileSize;
+	trailer.numKeyFrames = numKeyFrames;
+	trailer.frameIndexSize = frameIndex.size() * sizeof(DemoFrameIndexEntry);
+	trailer.numFrames = frameIndex.size();
+	memcpy(trailer.magic, DEMOFILE_INDEX_MAGIC, sizeof(trailer.magic));
+	trailer.swab();
+
+	for (DemoFrameIndexEntry& entry: frameIndex) {
+		entry.swab();
+		demoStreams[isServerDemo].append(reinterpret_cast<const char*>(&entry), sizeof(DemoFrameIndexEntry));
+	}
+
+	demoStreams[isServerDemo].append(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+
+	frameIndex.clear();
+}
@@ -3,6 +3,10 @@
 #ifndef DEMO_RECORDER
 #define DEMO_RECORDER
 
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <sstream>
 #include <zlib.h>
@@ -39,6 +43,13 @@ public:
 		std::swap(teamStats, r.teamStats);
 		std::swap(winningAllyTeams, r.winningAllyTeams);
 
+		std::swap(frameIndex, r.frameIndex);
+		std::swap(keyFrameFile, r.keyFrameFile);
+		std::swap(keyFrameFileSize, r.keyFrameFileSize);
+		std::swap(numKeyFrames, r.numKeyFrames);
+		std::swap(keyFrameInterval, r.keyFrameInterval);
+		std::swap(keyFrameLevel, r.keyFrameLevel);
+
 		std::swap(isServerDemo, r.isServerDemo);
 		return *this;
 	}
@@ -62,12 +73,18 @@ public:
 	void SetTeamStats(int teamNum, const std::vector<TeamStatistics>& stats);
 	void SetWinningAllyTeams(const std::vector<unsigned char>& winningAllyTeams);
 
+	/// true if a savestate should be embedded after simulating frameNum
+	bool WantKeyFrame(int frameNum) const { return (keyFrameInterval > 0 && frameNum > 0 && (frameNum % keyFrameInterval) == 0); }
+	/// streams the savestate written by <saveState> into the keyframes file
+	void AddKeyFrame(int frameNum, const std::function<bool(std::ostream&)>& saveState);
+
 private:
 	unsigned int WriteFileHeader(bool updateStreamLength);
 	void SetFileHeader();
 	void WritePlayerStats();
 	void WriteTeamStats();
 	void WriteWinnerList();
+	void WriteIndex();
 	void WriteDemoFile();
 
 private:
@@ -77,6 +94,16 @@ private:
 	std::vector< std::vector<TeamStatistics> > teamStats;
 	std::vector<unsigned char> winningAllyTeams;
 
+	std::vector<DemoFrameIndexEntry> frameIndex;
+
+	// opened with the first keyframe, see DemoKeyFrameHeader
+	std::unique_ptr<std::ofstream> keyFrameFile;
+	std::int64_t keyFrameFileSize = 0;
+
+	int numKeyFrames = 0;
+	int keyFrameInterval = 0;
+	int keyFrameLevel = 0;
+
 	bool isServerDemo = false;
 };
 
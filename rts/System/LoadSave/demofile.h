@@ -17,6 +17,12 @@
 /** The first 16 bytes of each demofile. */
 #define DEMOFILE_MAGIC "spring demofile"
 
+/** The last 16 bytes of each demofile that carries an index. */
+#define DEMOFILE_INDEX_MAGIC "spring demoindex"
+
+/** Extension of the file next to a demo that holds its keyframes. */
+#define DEMOFILE_KEYFRAMES_EXT "sdfk"
+
 /**
  * The current demofile version. Only change on major modifications for which
  * appending stuff to DemoFileHeader is not sufficient.
@@ -40,6 +46,7 @@
  *         CTeam::Statistics for each team.
  *       - Array of all CTeam::Statistics (total number of items is the
  *         sum of the elements in the array of dwords).
+ *     - Optional index, see DemoIndexTrailer
  *
  * The header is designed to be extensible: it contains a version field and a
  * headerSize field to support this. The version field is a major version number
@@ -115,6 +122,78 @@ struct DemoStreamChunkHeader
 	}
 };
 
+/**
+ * @brief Spring demo frame index entry
+ *
+ * Maps a sim frame to the demo stream offset (relative to the start of the
+ * demo stream) of the chunk carrying the NETMSG_NEWFRAME or NETMSG_KEYFRAME
+ * that starts it. The first frame of a game is frame 0.
+ */
+struct DemoFrameIndexEntry
+{
+	int frameNum;
+	int streamOffset;
+
+	void swab() {
+		swabDWordInPlace(frameNum);
+		swabDWordInPlace(streamOffset);
+	}
+};
+
+/**
+ * @brief Spring demo keyframe header
+ *
+ * Keyframes are kept in a file of their own next to the demo, named like it
+ * but with the DEMOFILE_KEYFRAMES_EXT extension, so they can be written out
+ * as they are taken. It is a sequence of DemoKeyFrameHeader's, each followed
+ * by stateSize bytes of block-gzip compressed savestate (see BlockGZ), which
+ * inflates to rawStateSize bytes identical to the contents of a .ssf
+ * savegame taken right after frameNum was simulated.
+ * Playback resumes with the frame following frameNum.
+ */
+struct DemoKeyFrameHeader
+{
+	int frameNum;
+	std::int64_t stateSize;
+	std::int64_t rawStateSize;
+
+	void swab() {
+		swabDWordInPlace(frameNum);
+		swab64InPlace(stateSize);
+		swab64InPlace(rawStateSize);
+	}
+};
+
+/**
+ * @brief Spring demo index trailer (unstable)
+ *
+ * Demos can carry an index behind the statistics chunks, which readers that
+ * do not know about it never look at:
+ *
+ * - Frame index (frameIndexSize), numFrames DemoFrameIndexEntry's ordered
+ *   by frame
+ * - DemoIndexTrailer, always the last bytes of the file
+ *
+ * Readers locate it by checking the end of the file for the magic. The
+ * keyframes file belonging to the demo holds numKeyFrames keyframes in its
+ * first keyFrameSize bytes.
+ */
+struct DemoIndexTrailer
+{
+	std::int64_t keyFrameSize;
+	int numKeyFrames;
+	std::int64_t frameIndexSize;
+	int numFrames;
+	char magic[16];               ///< DEMOFILE_INDEX_MAGIC, not null-terminated
+
+	void swab() {
+		swab64InPlace(keyFrameSize);
+		swabDWordInPlace(numKeyFrames);
+		swab64InPlace(frameIndexSize);
+		swabDWordInPlace(numFrames);
+	}
+};
+
 #pragma pack(pop)
 
 #endif // DEMO_FILE_H
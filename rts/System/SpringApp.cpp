@@ -64,12 +64,14 @@
 #include "System/EventHandler.h"
 #include "System/Exceptions.h"
 #include "System/GlobalConfig.h"
+#include "System/SpringHash.h"
 #include "System/SpringMath.h"
 #include "System/MsgStrings.h"
 #include "System/SafeUtil.h"
 #include "System/SplashScreen.hpp"
 #include "System/SpringExitCode.h"
 #include "System/StartScriptGen.h"
+#include "System/StringUtil.h"
 #include "System/TimeProfiler.h"
 #include "System/UriParser.h"
 #include "System/LoadLock.h"
@@ -157,6 +159,11 @@ DEFINE_string_EX(calc_checksum,      "calc-checksum",      "",    "Calculate nam
  * the same port number is heavily reused across many replays. Forcing onlyLocal solves this. */
 DEFINE_bool_EX  (onlyLocal,              "only-local",     false, "Force OnlyLocal mode (no network listening sockets). Use for parallelized watching of multiplayer replays");
 
+/* Batch replay analysis: simulates the given demo as fast as possible instead of at game speed, writes per-frame
+ * statistics and sync checksums to the named file and quits when the demo ends. Implies only-local and names the
+ * infolog after the output path, so any number of instances can run side by side from the same write-dir. */
+DEFINE_string_EX(replay_stats,       "replay-stats",       "",    "Replay the given demo as fast as possible and write per-frame statistics (JSON lines) to this file");
+
 
 
 int spring::exitCode = spring::EXIT_CODE_SUCCESS;
@@ -574,12 +581,25 @@ void SpringApp::ParseCmdLine(int argc, char* argv[])
 
 	CTextureAtlas::SetDebug(FLAGS_textureatlas);
 
-	CGameSetup::forceOnlyLocal = FLAGS_onlyLocal;
+	CGameSetup::forceOnlyLocal = FLAGS_onlyLocal || !FLAGS_replay_stats.empty();
+
+	std::string logFileName;
+
+	if (!FLAGS_replay_stats.empty()) {
+		// resolve against the directory we were started from, not the write-dir
+		if (!FileSystem::IsAbsolutePath(FLAGS_replay_stats))
+			FLAGS_replay_stats = FileSystem::EnsurePathSepAtEnd(FileSystem::GetCwd()) + FLAGS_replay_stats;
+
+		// outputs with the same name in different directories must not share an infolog
+		const uint32_t pathHash = spring::LiteHash(FLAGS_replay_stats.data(), FLAGS_replay_stats.size());
+
+		logFileName = FileSystem::GetFilename(FLAGS_replay_stats) + "." + IntToString(pathHash, "%08x") + ".infolog.txt";
+	}
 
 	// if this fails, configHandler remains null
 	// logOutput's init depends on configHandler
 	FileSystemInitializer::PreInitializeConfigHandler(FLAGS_config, FLAGS_name, FLAGS_safemode);
-	FileSystemInitializer::InitializeLogOutput();
+	FileSystemInitializer::InitializeLogOutput(logFileName);
 }
 
 
@@ -598,6 +618,7 @@ CGameController* SpringApp::LoadDemoFile(const std::string& demoFile)
 {
 	clientSetup->isHost = true;
 	clientSetup->myPlayerName += " (spec)";
+	clientSetup->replayStatsFile = FLAGS_replay_stats;
 
 	pregame = new CPreGame(clientSetup);
 	pregame->AsyncExecute(&CPreGame::LoadDemoFile, demoFile);
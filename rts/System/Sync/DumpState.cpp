@@ -477,13 +477,11 @@ void DumpState(int newMinFrameNum, int newMaxFrameNum, int newFramePeriod, std::
 		}
 		file << "\n";
 
-		auto zzzThreads = cobEngine->GetSleepingThreadIDs(); //copied on purpose
+		const auto zzzThreads = cobEngine->GetSleepingThreadIDs().GetSorted();
 		file << "\t\tSleepingThreads: " << zzzThreads.size();
 		file << "\t\t\twts|ids:";
-		while (!zzzThreads.empty()) {
-			const auto& zt = zzzThreads.top();
+		for (const auto& zt: zzzThreads) {
 			file << " " << zt.wt << "|" << zt.id;
-			zzzThreads.pop();
 		}
 		file << "\n";
 	}
@@ -5,6 +5,8 @@
 
 #include "SyncChecker.h"
 
+#include <algorithm>
+
 // This cannot be included in the header file (SyncChecker.h) because include conflicts will occur.
 #include "System/Threading/ThreadPool.h"
 
@@ -12,6 +14,15 @@
 unsigned CSyncChecker::g_checksum;
 int CSyncChecker::inSyncedCode;
 
+std::array<unsigned, SYNC_SUBSYSTEM_COUNT> CSyncChecker::subsystemChecksums;
+
+std::array<int, MAX_SYNC_TREE_FRAMES> CSyncChecker::treeFrames = []() {
+	std::array<int, MAX_SYNC_TREE_FRAMES> frames;
+	frames.fill(-1);
+	return frames;
+}();
+std::array<SyncChecksumTree, MAX_SYNC_TREE_FRAMES> CSyncChecker::trees;
+
 void CSyncChecker::NewFrame()
 {
 	g_checksum = 0xfade1eaf;
@@ -20,6 +31,47 @@ void CSyncChecker::NewFrame()
 #endif // SYNC_HISTORY
 }
 
+unsigned CSyncChecker::EnterSubsystem()
+{
+	const unsigned outerChecksum = g_checksum;
+
+	// start a fresh chain so this subsystem's writes can be told apart
+	g_checksum = 0xfade1eaf;
+	return outerChecksum;
+}
+
+void CSyncChecker::LeaveSubsystem(SyncSubsystem subsystem, unsigned outerChecksum)
+{
+	const unsigned innerChecksum = g_checksum;
+
+	// a subsystem may be entered more than once per frame
+	subsystemChecksums[subsystem] = spring::LiteHash(&innerChecksum, sizeof(innerChecksum), subsystemChecksums[subsystem]);
+
+	g_checksum = spring::LiteHash(&innerChecksum, sizeof(innerChecksum), outerChecksum);
+}
+
+void CSyncChecker::SaveChecksumTree(int frameNum)
+{
+	const size_t idx = frameNum % MAX_SYNC_TREE_FRAMES;
+
+	treeFrames[idx] = frameNum;
+	trees[idx][0] = g_checksum;
+
+	std::copy(subsystemChecksums.begin(), subsystemChecksums.end(), trees[idx].begin() + 1);
+}
+
+bool CSyncChecker::GetChecksumTree(int frameNum, SyncChecksumTree& tree)
+{
+	const size_t idx = frameNum % MAX_SYNC_TREE_FRAMES;
+
+	// too old, overwritten by a later frame
+	if (frameNum < 0 || treeFrames[idx] != frameNum)
+		return false;
+
+	tree = trees[idx];
+	return true;
+}
+
 void CSyncChecker::debugSyncCheckThreading()
 {
 	assert(ThreadPool::GetThreadNum() == 0);
@@ -12,6 +12,40 @@
 
 static constexpr size_t MAX_SYNC_HISTORY = 2500000; // 10MB, ~= 10 seconds of typical midgame
 static constexpr size_t MAX_SYNC_HISTORY_FRAMES = 1000;
+static constexpr size_t MAX_SYNC_TREE_FRAMES = 1024; // ~= 34 seconds
+
+/**
+ * Parts of SimFrame that keep their own checksum, in the order they run.
+ * Writes outside of any subsystem only go into the root checksum.
+ */
+enum SyncSubsystem {
+	SYNC_SUBSYSTEM_LUA         = 0,
+	SYNC_SUBSYSTEM_UNITS       = 1,
+	SYNC_SUBSYSTEM_PATH        = 2,
+	SYNC_SUBSYSTEM_PROJECTILES = 3,
+	SYNC_SUBSYSTEM_FEATURES    = 4,
+	SYNC_SUBSYSTEM_SCRIPTS     = 5,
+	SYNC_SUBSYSTEM_LOS         = 6,
+	SYNC_SUBSYSTEM_COUNT       = 7,
+};
+
+/// root (the regular sync checksum) followed by one checksum per subsystem
+using SyncChecksumTree = std::array<unsigned, 1 + SYNC_SUBSYSTEM_COUNT>;
+
+static inline const char* GetSyncSubsystemName(unsigned subsystem)
+{
+	constexpr const char* names[SYNC_SUBSYSTEM_COUNT] = {
+		"lua",
+		"units",
+		"path",
+		"projectiles",
+		"features",
+		"scripts",
+		"los",
+	};
+
+	return ((subsystem < SYNC_SUBSYSTEM_COUNT)? names[subsystem]: "unknown");
+}
 
 /**
  * @brief sync checker class
@@ -34,6 +68,21 @@ class CSyncChecker {
 		 */
 		static unsigned GetChecksum() { return g_checksum; }
 		static void NewFrame();
+
+		/**
+		 * Writes between Enter- and LeaveSubsystem are hashed into a chain
+		 * of their own, which is folded into the root checksum on leaving.
+		 * The per-subsystem checksums are reset every SimFrame, so unlike
+		 * the root they tell which part of a single frame diverged.
+		 */
+		static unsigned EnterSubsystem();
+		static void LeaveSubsystem(SyncSubsystem subsystem, unsigned outerChecksum);
+		static void NewSimFrame() { subsystemChecksums.fill(0); }
+
+		/// remembers the checksum tree of the SimFrame that just finished
+		static void SaveChecksumTree(int frameNum);
+		static bool GetChecksumTree(int frameNum, SyncChecksumTree& tree);
+
 		static void debugSyncCheckThreading();
 		static void Sync(const void* p, unsigned size);
 		#ifdef SYNC_HISTORY
@@ -49,6 +98,11 @@ class CSyncChecker {
 		 */
 		static unsigned g_checksum;
 
+		static std::array<unsigned, SYNC_SUBSYSTEM_COUNT> subsystemChecksums;
+
+		static std::array<int, MAX_SYNC_TREE_FRAMES> treeFrames;
+		static std::array<SyncChecksumTree, MAX_SYNC_TREE_FRAMES> trees;
+
 		/**
 		 * @brief in synced code
 		 *
@@ -69,6 +123,20 @@ class CSyncChecker {
 #endif // SYNC_HISTORY
 };
 
+
+class CSyncSubsystemScope {
+public:
+	CSyncSubsystemScope(SyncSubsystem s): subsystem(s), outerChecksum(CSyncChecker::EnterSubsystem()) {}
+	~CSyncSubsystemScope() { CSyncChecker::LeaveSubsystem(subsystem, outerChecksum); }
+
+	CSyncSubsystemScope(const CSyncSubsystemScope&) = delete;
+	CSyncSubsystemScope& operator = (const CSyncSubsystemScope&) = delete;
+
+private:
+	SyncSubsystem subsystem;
+	unsigned outerChecksum;
+};
+
 #endif // SYNCDEBUG
 
 #endif // SYNCDEBUGGER_H
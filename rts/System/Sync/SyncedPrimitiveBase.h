@@ -71,6 +71,12 @@ namespace Sync {
 #  define LEAVE_SYNCED_CODE()
 #endif
 
+#ifdef SYNCCHECK
+#  define SCOPED_SYNC_SUBSYSTEM(s) CSyncSubsystemScope syncSubsystemScope(s)
+#else
+#  define SCOPED_SYNC_SUBSYSTEM(s)
+#endif
+
 #ifdef SYNCDEBUG
 #  define ASSERT_SYNCED(x) Sync::AssertDebugger(x, "assert(" #x ")")
 #else
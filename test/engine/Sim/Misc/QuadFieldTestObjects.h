@@ -0,0 +1,50 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef QUADFIELD_TEST_OBJECTS_H
+#define QUADFIELD_TEST_OBJECTS_H
+
+// Stand-ins for the object types QuadField.cpp dereferences in its unit,
+// feature, projectile and solid queries; included in place of the real
+// headers when built with QUADFIELD_TEST_OBJECTS. Members mirror the ones
+// of CWorldObject / CSolidObject the queries read.
+
+#include <array>
+
+#include "System/float3.h"
+#include "System/Threading/ThreadPool.h"
+
+class CWorldObject {
+public:
+	int id = -1;
+	int tempNum = 0;
+
+	float3 pos;
+	float radius = 0.0f;
+
+	std::array<int, ThreadPool::MAX_THREADS> mtTempNum = {};
+};
+
+class CSolidObject: public CWorldObject {
+public:
+	enum PhysicalState {
+		PSTATE_BIT_ONGROUND = (1 << 0),
+		PSTATE_BIT_INAIR    = (1 << 4),
+	};
+	enum CollidableState {
+		CSTATE_BIT_SOLIDOBJECTS = (1 << 0),
+		CSTATE_BIT_PROJECTILES  = (1 << 1),
+	};
+
+	bool HasPhysicalStateBit(unsigned int bit) const { return ((physicalState & bit) != 0); }
+	bool HasCollidableStateBit(unsigned int bit) const { return ((collidableState & bit) != 0); }
+
+public:
+	unsigned int physicalState = PSTATE_BIT_ONGROUND;
+	unsigned int collidableState = CSTATE_BIT_SOLIDOBJECTS | CSTATE_BIT_PROJECTILES;
+};
+
+class CUnit: public CSolidObject {};
+class CFeature: public CSolidObject {};
+class CProjectile: public CWorldObject {};
+
+#endif
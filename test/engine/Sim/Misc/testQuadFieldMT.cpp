@@ -0,0 +1,319 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Misc/QuadField.h"
+#include "Sim/Misc/GlobalConstants.h"
+#include "Sim/Misc/GlobalSynced.h"
+#include "System/Threading/ThreadPool.h"
+#include "System/Threading/SpringThreading.h"
+#include "System/Misc/SpringTime.h"
+#include "System/float3.h"
+#include "QuadFieldTestObjects.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <catch_amalgamated.hpp>
+
+
+// Catch is not threadsafe
+#define SAFE_CHECK( P )                \
+	do {                                     \
+		std::lock_guard<spring::mutex> _(m); \
+		CHECK( (P) );                  \
+	} while (0);
+
+struct do_once {
+	do_once() { Threading::DetectCores(); } // make GetMaxThreads() work
+};
+
+InitSpringTime ist;
+do_once doonce;
+
+static spring::mutex m;
+
+static CGlobalSynced globalSynced;
+CGlobalSynced* gs = &globalSynced;
+
+
+TEST_CASE("QueryVectorCacheNesting")
+{
+	QueryVectorCache<int> cache;
+	std::vector<std::vector<int>*> held;
+
+	const size_t initialVectors = cache.GetNumVectors();
+
+	// far deeper than the three slots the cache used to be limited to
+	for (int i = 0; i < 64; ++i) {
+		std::vector<int>* v = cache.ReserveVector(16);
+
+		REQUIRE(v != nullptr);
+		CHECK(v->empty());
+		CHECK(std::find(held.begin(), held.end(), v) == held.end());
+
+		v->push_back(i);
+		held.push_back(v);
+	}
+
+	CHECK(cache.GetNumVectors() == std::max<size_t>(initialVectors, 64));
+	CHECK(cache.GetNumFreeVectors() == cache.GetNumVectors() - 64);
+
+	// contents stay put while the arena grows
+	for (int i = 0; i < 64; ++i) {
+		CHECK(held[i]->size() == 1);
+		CHECK((*held[i])[0] == i);
+	}
+
+	std::shuffle(held.begin(), held.end(), std::mt19937(1));
+
+	for (std::vector<int>* v: held) {
+		cache.ReleaseVector(v);
+	}
+
+	CHECK(cache.GetNumFreeVectors() == cache.GetNumVectors());
+
+	// released vectors are recycled instead of growing the arena again
+	const size_t numVectors = cache.GetNumVectors();
+
+	for (int i = 0; i < 64; ++i) {
+		held[i] = cache.ReserveVector();
+	}
+
+	CHECK(cache.GetNumVectors() == numVectors);
+
+	cache.ReleaseAll();
+	CHECK(cache.GetNumFreeVectors() == numVectors);
+}
+
+
+TEST_CASE("QuadFieldQueryMT")
+{
+	static constexpr int WIDTH  = 32;
+	static constexpr int HEIGHT = 32;
+	static constexpr int NUM_QUERIES = 20000;
+	static constexpr int MAX_DEPTH = 6;
+
+	ThreadPool::SetThreadCount(ThreadPool::GetMaxThreads());
+	quadField.Init(int2(WIDTH, HEIGHT), SQUARE_SIZE);
+
+	const auto GenRay = [](std::mt19937& rng, float3& start, float3& dir, float& length) {
+		std::uniform_real_distribution<float> pos(0.0f, WIDTH * SQUARE_SIZE);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		start = float3(pos(rng), 0.0f, pos(rng));
+		dir = float3(unit(rng), 0.0f, unit(rng)).SafeNormalize();
+		length = pos(rng) * 0.5f;
+	};
+
+	std::atomic<int> numMismatches = {0};
+	std::atomic<int> numQueries = {0};
+
+	// every query holds on to its result while issuing nested queries on
+	// the same thread; results must neither alias nor get clobbered
+	const std::function<void(std::mt19937&, int, int)> RunNested = [&](std::mt19937& rng, int thread, int depth) {
+		float3 start;
+		float3 dir;
+		float length;
+		GenRay(rng, start, dir, length);
+
+		QuadFieldQuery qfq;
+		qfq.threadOwner = thread;
+		quadField.GetQuadsOnRay(qfq, start, dir, length);
+
+		const std::vector<int> expected = *qfq.quads;
+
+		if (depth < MAX_DEPTH)
+			RunNested(rng, thread, depth + 1);
+
+		QuadFieldQuery qfqRef;
+		qfqRef.threadOwner = thread;
+		quadField.GetQuadsOnRay(qfqRef, start, dir, length);
+
+		numMismatches += (qfq.quads == qfqRef.quads);
+		numMismatches += (*qfq.quads != expected);
+		numMismatches += (*qfqRef.quads != expected);
+		numQueries += 2;
+	};
+
+	for_mt(0, NUM_QUERIES, [&](const int i) {
+		const int thread = ThreadPool::GetThreadNum();
+		std::mt19937 rng(i);
+
+		SAFE_CHECK(thread >= 0);
+		SAFE_CHECK(thread < ThreadPool::MAX_THREADS);
+
+		RunNested(rng, thread, (i % MAX_DEPTH));
+	});
+
+	CHECK(numMismatches == 0);
+	CHECK(numQueries > NUM_QUERIES);
+
+	quadField.Kill();
+}
+
+
+TEST_CASE("QuadFieldObjectQueriesMT")
+{
+	static constexpr int WIDTH  = 128;
+	static constexpr int HEIGHT = 128;
+	static constexpr int NUM_UNITS = 2000;
+	static constexpr int NUM_FEATURES = 1000;
+	static constexpr int NUM_QUERIES = 4000;
+
+	ThreadPool::SetThreadCount(ThreadPool::GetMaxThreads());
+	quadField.Init(int2(WIDTH, HEIGHT), CQuadField::BASE_QUAD_SIZE);
+
+	float3::maxxpos = WIDTH * SQUARE_SIZE - 1;
+	float3::maxzpos = HEIGHT * SQUARE_SIZE - 1;
+
+	// GlobalSynced::ResetState() is not linked; objects start out with
+	// mtTempNum 0 so the first number handed out must not be 0 either
+	for (int i = 0; i < ThreadPool::MAX_THREADS; ++i) {
+		gs->GetMtTempNum(i);
+	}
+
+	std::uniform_real_distribution<float> posDist(0.0f, WIDTH * SQUARE_SIZE);
+	std::uniform_real_distribution<float> hgtDist(0.0f, 64.0f);
+	std::uniform_real_distribution<float> radDist(4.0f, 48.0f);
+
+	std::vector<CUnit> units(NUM_UNITS);
+	std::vector<CFeature> features(NUM_FEATURES);
+
+	{
+		std::mt19937 rng(1);
+
+		const auto Place = [&](CSolidObject& o, int id) {
+			o.id = id;
+			o.pos = float3(posDist(rng), hgtDist(rng), posDist(rng));
+			o.radius = radDist(rng);
+
+			if ((id % 5) == 0)
+				o.physicalState = CSolidObject::PSTATE_BIT_INAIR;
+		};
+
+		// objects are linked into every quad their footprint overlaps, as MovedUnit does
+		for (int i = 0; i < NUM_UNITS; ++i) {
+			Place(units[i], i);
+
+			QuadFieldQuery qfq;
+			quadField.GetQuads(qfq, units[i].pos, units[i].radius);
+
+			for (const int qi: *qfq.quads) {
+				const_cast<CQuadField::Quad&>(quadField.GetQuad(qi)).units.push_back(&units[i]);
+			}
+		}
+		for (int i = 0; i < NUM_FEATURES; ++i) {
+			Place(features[i], NUM_UNITS + i);
+
+			QuadFieldQuery qfq;
+			quadField.GetQuads(qfq, features[i].pos, features[i].radius);
+
+			for (const int qi: *qfq.quads) {
+				CQuadField::Quad& quad = const_cast<CQuadField::Quad&>(quadField.GetQuad(qi));
+
+				quad.features.push_back(&features[i]);
+				quad.featuresSoA.push_back(features[i].pos.x, features[i].pos.z, features[i].radius);
+			}
+		}
+	}
+
+	struct QueryResults {
+		std::vector<int> quads;
+		std::vector<int> unitsSpherical;
+		std::vector<int> unitsCylindrical;
+		std::vector<int> unitsRectangle;
+		std::vector<int> solids;
+
+		bool operator == (const QueryResults& r) const {
+			return
+				quads == r.quads &&
+				unitsSpherical == r.unitsSpherical &&
+				unitsCylindrical == r.unitsCylindrical &&
+				unitsRectangle == r.unitsRectangle &&
+				solids == r.solids;
+		}
+	};
+
+	const auto ToIDs = [](const auto* objects) {
+		std::vector<int> ids;
+		ids.reserve(objects->size());
+
+		for (const auto* o: *objects) {
+			ids.push_back(o->id);
+		}
+
+		return ids;
+	};
+
+	// all queries of one round are kept alive together so their results
+	// have to come from distinct vectors of the thread's arena
+	const auto RunQueries = [&](int i, int thread) {
+		std::mt19937 rng(i);
+		std::uniform_real_distribution<float> qrDist(8.0f, 256.0f);
+
+		const float3 pos = float3(posDist(rng), hgtDist(rng), posDist(rng));
+		const float radius = qrDist(rng);
+		const float3 mins = pos - radius;
+		const float3 maxs = pos + radius;
+		const unsigned int physicalStateBits = (i & 1)? unsigned(CSolidObject::PSTATE_BIT_ONGROUND): 0xFFFFFFFF;
+
+		QuadFieldQuery qfqQuads;
+		QuadFieldQuery qfqSpherical;
+		QuadFieldQuery qfqCylindrical;
+		QuadFieldQuery qfqRectangle;
+		QuadFieldQuery qfqSolids;
+
+		qfqQuads.threadOwner = thread;
+		qfqSpherical.threadOwner = thread;
+		qfqCylindrical.threadOwner = thread;
+		qfqRectangle.threadOwner = thread;
+		qfqSolids.threadOwner = thread;
+
+		quadField.GetQuads(qfqQuads, pos, radius);
+		quadField.GetUnitsExact(qfqSpherical, pos, radius, true);
+		quadField.GetUnitsExact(qfqCylindrical, pos, radius, false);
+		quadField.GetUnitsExact(qfqRectangle, mins, maxs);
+		quadField.GetSolidsExact(qfqSolids, pos, radius, physicalStateBits);
+
+		QueryResults results;
+		results.quads = *qfqQuads.quads;
+		results.unitsSpherical = ToIDs(qfqSpherical.units);
+		results.unitsCylindrical = ToIDs(qfqCylindrical.units);
+		results.unitsRectangle = ToIDs(qfqRectangle.units);
+		results.solids = ToIDs(qfqSolids.solids);
+		return results;
+	};
+
+	std::vector<QueryResults> expected(NUM_QUERIES);
+
+	for (int i = 0; i < NUM_QUERIES; ++i) {
+		expected[i] = RunQueries(i, 0);
+	}
+
+	// sanity check that the serial pass exercises every query type
+	const auto NumNonEmpty = [&](std::vector<int> QueryResults::* member) {
+		return std::count_if(expected.begin(), expected.end(), [&](const QueryResults& r) { return !(r.*member).empty(); });
+	};
+
+	CHECK(NumNonEmpty(&QueryResults::unitsSpherical) > 0);
+	CHECK(NumNonEmpty(&QueryResults::unitsCylindrical) > 0);
+	CHECK(NumNonEmpty(&QueryResults::unitsRectangle) > 0);
+	CHECK(NumNonEmpty(&QueryResults::solids) > 0);
+
+	std::atomic<int> numMismatches = {0};
+
+	for_mt(0, NUM_QUERIES, [&](const int i) {
+		const int thread = ThreadPool::GetThreadNum();
+
+		SAFE_CHECK(thread >= 0);
+		SAFE_CHECK(thread < ThreadPool::MAX_THREADS);
+
+		numMismatches += !(RunQueries(i, thread) == expected[i]);
+	});
+
+	CHECK(numMismatches == 0);
+
+	quadField.Kill();
+}
@@ -0,0 +1,240 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Misc/QuadFieldSoA.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <catch_amalgamated.hpp>
+
+namespace {
+	struct Footprint {
+		float x;
+		float z;
+		float r;
+	};
+
+	// one quad worth of objects, either packed into a small cluster
+	// (e.g. a wreck field) or spread out over the full quad
+	std::vector<Footprint> GenFootprints(size_t count, float spread, unsigned seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> pos(64.0f - spread * 0.5f, 64.0f + spread * 0.5f);
+		std::uniform_real_distribution<float> rad(4.0f, 16.0f);
+
+		std::vector<Footprint> fps;
+		fps.reserve(count);
+
+		for (size_t i = 0; i < count; ++i) {
+			fps.push_back({pos(rng), pos(rng), rad(rng)});
+		}
+
+		return fps;
+	}
+
+	// stand-in for a CFeature; the real object is ~1.5KB and individually pooled
+	struct FatObject {
+		Footprint fp;
+		char pad[1472 - sizeof(Footprint)];
+	};
+
+	// quad vectors reference objects in insertion order, not memory order
+	std::vector<std::unique_ptr<FatObject>> GenObjects(const std::vector<Footprint>& fps, unsigned seed)
+	{
+		std::vector<std::unique_ptr<FatObject>> objs;
+		objs.reserve(fps.size());
+
+		for (const Footprint& fp: fps) {
+			objs.emplace_back(new FatObject{fp, {}});
+		}
+
+		std::shuffle(objs.begin(), objs.end(), std::mt19937(seed));
+		return objs;
+	}
+
+	QuadFieldSoA GenSoA(const std::vector<Footprint>& fps)
+	{
+		QuadFieldSoA soa;
+
+		for (const Footprint& fp: fps) {
+			soa.push_back(fp.x, fp.z, fp.r);
+		}
+
+		return soa;
+	}
+
+	// same tests as CQuadField::Get*Exact perform on the object itself
+	size_t CountInCircleAoS(const std::vector<Footprint>& fps, float px, float pz, float radius)
+	{
+		size_t n = 0;
+
+		for (const Footprint& fp: fps) {
+			const float dx = px - fp.x;
+			const float dz = pz - fp.z;
+			const float tr = radius + fp.r;
+
+			n += ((dx * dx + dz * dz) < (tr * tr));
+		}
+
+		return n;
+	}
+
+	size_t CountInCircleObj(const std::vector<std::unique_ptr<FatObject>>& objs, float px, float pz, float radius)
+	{
+		size_t n = 0;
+
+		for (const auto& obj: objs) {
+			const Footprint& fp = obj->fp;
+			const float dx = px - fp.x;
+			const float dz = pz - fp.z;
+			const float tr = radius + fp.r;
+
+			n += ((dx * dx + dz * dz) < (tr * tr));
+		}
+
+		return n;
+	}
+
+	size_t CountInRectAoS(const std::vector<Footprint>& fps, float minx, float minz, float maxx, float maxz)
+	{
+		size_t n = 0;
+
+		for (const Footprint& fp: fps) {
+			if (fp.x < minx || fp.x > maxx)
+				continue;
+			if (fp.z < minz || fp.z > maxz)
+				continue;
+
+			n += 1;
+		}
+
+		return n;
+	}
+}
+
+
+TEST_CASE("QuadFieldSoAFilters")
+{
+	// deliberately not a multiple of any SIMD width so the scalar tail runs too
+	const std::vector<Footprint> fps = GenFootprints(1021, 128.0f, 1234);
+	QuadFieldSoA soa = GenSoA(fps);
+
+	std::mt19937 rng(4321);
+	std::uniform_real_distribution<float> pos(-32.0f, 160.0f);
+	std::uniform_real_distribution<float> rad(0.0f, 96.0f);
+
+	for (int n = 0; n < 1000; ++n) {
+		const float px = pos(rng);
+		const float pz = pos(rng);
+		const float pr = rad(rng);
+
+		std::vector<size_t> hits;
+		soa.ForEachInCircle(px, pz, pr, [&](size_t i) { hits.push_back(i); });
+
+		CHECK(hits.size() == CountInCircleAoS(fps, px, pz, pr));
+
+		// indices must be reported in storage order and pass the scalar test
+		for (size_t k = 0; k < hits.size(); ++k) {
+			const Footprint& fp = fps[hits[k]];
+			const float tr = pr + fp.r;
+
+			CHECK(((px - fp.x) * (px - fp.x) + (pz - fp.z) * (pz - fp.z)) < (tr * tr));
+			CHECK((k == 0 || hits[k - 1] < hits[k]));
+		}
+
+		hits.clear();
+		soa.ForEachInRect(px - pr, pz - pr, px + pr, pz + pr, [&](size_t i) { hits.push_back(i); });
+
+		CHECK(hits.size() == CountInRectAoS(fps, px - pr, pz - pr, px + pr, pz + pr));
+	}
+
+	// erase must mirror spring::VectorErase (swap with back)
+	std::vector<Footprint> ref = fps;
+
+	for (size_t i = 0; i < 100; ++i) {
+		const size_t idx = (i * 7919) % ref.size();
+
+		ref[idx] = ref.back();
+		ref.pop_back();
+		soa.erase(idx);
+	}
+
+	REQUIRE(soa.size() == ref.size());
+
+	for (size_t i = 0; i < ref.size(); ++i) {
+		size_t hits = 0;
+		soa.ForEachInRect(ref[i].x, ref[i].z, ref[i].x, ref[i].z, [&](size_t j) { hits += (j == i); });
+		CHECK(hits == 1);
+	}
+}
+
+
+TEST_CASE("QuadFieldSoABenchmark")
+{
+	// quad (128 elmos) populations; dense is a wreck field or forest whose
+	// objects no longer fit in cache, which is where the SoA layout pays off
+	const std::vector<Footprint> dense  = GenFootprints(4096, 128.0f, 1);
+	const std::vector<Footprint> sparse = GenFootprints( 64, 128.0f, 2);
+
+	const auto denseObjs  = GenObjects(dense , 1);
+	const auto sparseObjs = GenObjects(sparse, 2);
+
+	// built in the shuffled order so both sides see the same sequence
+	std::vector<Footprint> denseOrd;
+	std::vector<Footprint> sparseOrd;
+
+	for (const auto& obj: denseObjs) { denseOrd.push_back(obj->fp); }
+	for (const auto& obj: sparseObjs) { sparseOrd.push_back(obj->fp); }
+
+	const QuadFieldSoA denseSoA  = GenSoA(denseOrd);
+	const QuadFieldSoA sparseSoA = GenSoA(sparseOrd);
+
+	std::vector<float> queries(3 * 256);
+	{
+		std::mt19937 rng(3);
+		std::uniform_real_distribution<float> pos(0.0f, 128.0f);
+		std::uniform_real_distribution<float> rad(8.0f, 24.0f);
+
+		for (size_t i = 0; i < queries.size(); i += 3) {
+			queries[i + 0] = pos(rng);
+			queries[i + 1] = pos(rng);
+			queries[i + 2] = rad(rng);
+		}
+	}
+
+	const auto RunObj = [&](const std::vector<std::unique_ptr<FatObject>>& objs) {
+		size_t n = 0;
+		for (size_t i = 0; i < queries.size(); i += 3) {
+			n += CountInCircleObj(objs, queries[i], queries[i + 1], queries[i + 2]);
+		}
+		return n;
+	};
+	const auto RunSoA = [&](const QuadFieldSoA& soa) {
+		size_t n = 0;
+		for (size_t i = 0; i < queries.size(); i += 3) {
+			soa.ForEachInCircle(queries[i], queries[i + 1], queries[i + 2], [&](size_t) { n += 1; });
+		}
+		return n;
+	};
+
+	REQUIRE(RunObj(denseObjs) == RunSoA(denseSoA));
+	REQUIRE(RunObj(sparseObjs) == RunSoA(sparseSoA));
+
+	// each run performs 256 queries; queries/s = 256 / mean
+	// "Obj" is the pre-SoA behavior of dereferencing every object in a quad
+	BENCHMARK("Circle::Dense::Obj")  { return RunObj(denseObjs); };
+	BENCHMARK("Circle::Dense::SoA")  { return RunSoA(denseSoA); };
+	BENCHMARK("Circle::Sparse::Obj") { return RunObj(sparseObjs); };
+	BENCHMARK("Circle::Sparse::SoA") { return RunSoA(sparseSoA); };
+
+	BENCHMARK("Rect::Dense::SoA") {
+		size_t n = 0;
+		for (size_t i = 0; i < queries.size(); i += 3) {
+			const float r = queries[i + 2];
+			denseSoA.ForEachInRect(queries[i] - r, queries[i + 1] - r, queries[i] + r, queries[i + 1] + r, [&](size_t) { n += 1; });
+		}
+		return n;
+	};
+}
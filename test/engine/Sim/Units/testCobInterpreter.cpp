@@ -0,0 +1,1062 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Units/Scripts/CobInterpreter.h"
+#include "Sim/Units/Scripts/CobOpCodes.h"
+#include "Sim/Units/Scripts/CobProgram.h"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <catch_amalgamated.hpp>
+
+
+// the parts of CCobFile the interpreters use
+struct MockCobFile {
+	std::vector<int> code;
+	std::vector<CobProgram::Instr> program;
+	std::vector<std::string> scriptNames;
+	std::vector<int> scriptOffsets;
+	std::vector<int> scriptLengths;
+	std::array<int, COBFN_NumUnitFuncs> scriptIndex;
+	std::string name = "mock.cob";
+};
+
+struct MockThread;
+
+// stands in for CCobInstance, logs every call-out
+struct MockUnit {
+	enum AnimType {ATurn, ASpin, AMove};
+
+	void Log(const char* what, int a = 0, int b = 0, int c = 0, int d = 0) {
+		if (!record)
+			return;
+
+		trace.push_back(std::string(what) + " " + std::to_string(a) + " " + std::to_string(b) + " " + std::to_string(c) + " " + std::to_string(d));
+	}
+
+	void Spin(int piece, int axis, int speed, int accel) { Log("Spin", piece, axis, speed, accel); }
+	void StopSpin(int piece, int axis, int decel) { Log("StopSpin", piece, axis, decel); }
+	void Turn(int piece, int axis, int speed, int dest) { Log("Turn", piece, axis, speed, dest); }
+	void Move(int piece, int axis, int speed, int dest) { Log("Move", piece, axis, speed, dest); }
+	void MoveNow(int piece, int axis, int dest) { Log("MoveNow", piece, axis, dest); }
+	void TurnNow(int piece, int axis, int dest) { Log("TurnNow", piece, axis, dest); }
+
+	bool NeedsWait(AnimType type, int piece, int axis) {
+		Log("NeedsWait", type, piece, axis);
+		return (((numWaits++) % 3) != 0);
+	}
+
+	int GetUnitVal(int val, int p1, int p2, int p3, int p4) {
+		Log("GetUnitVal", val, p1, p2, p3 + p4);
+		return ((val * 7 + p1 * 3 + p2) & 63);
+	}
+	void SetUnitVal(int val, int param) { Log("SetUnitVal", val, param); }
+
+	void Explode(int piece, int flags) { Log("Explode", piece, flags); }
+	void PlayUnitSound(int snr, int attr) { Log("PlayUnitSound", snr, attr); }
+	bool EmitSfx(int type, int piece) { Log("EmitSfx", type, piece); return true; }
+	void Signal(int signal);
+	void AttachUnit(int piece, int unit) { Log("AttachUnit", piece, unit); }
+	void DropUnit(int unit) { Log("DropUnit", unit); }
+	void SetVisibility(int piece, bool visible) { Log("SetVisibility", piece, visible); }
+	void ShowFlare(int piece) { Log("ShowFlare", piece); }
+
+	MockThread* thread = nullptr;
+
+	std::vector<int> staticVars = std::vector<int>(4, 0);
+	std::vector<std::string> trace;
+
+	int numWaits = 0;
+
+	bool record = true;
+};
+
+// mirrors the interpreter-facing part of CCobThread
+struct MockThread {
+	enum State {Init, Sleep, Run, Dead, WaitTurn, WaitMove};
+
+	struct CallInfo {
+		int functionId = -1;
+		int returnAddr = -1;
+		int stackTop = -1;
+	};
+
+	MockThread(MockUnit* inst, MockCobFile* file): cobInst(inst), cobFile(file) {
+		cobInst->thread = this;
+	}
+
+	void Start(int functionId) {
+		state = Run;
+		pc = cobFile->scriptOffsets[functionId];
+
+		CallInfo& ci = PushCallStackRef();
+		ci.functionId = functionId;
+		ci.returnAddr = -1;
+		ci.stackTop = 0;
+	}
+
+	CallInfo& PushCallStackRef() { return callStack.emplace_back(); }
+	void PushDataStack(int v) { dataStack.push_back(v); }
+
+	int PopDataStack() {
+		if (dataStack.empty())
+			return 0;
+
+		const int ret = dataStack.back();
+		dataStack.pop_back();
+		return ret;
+	}
+
+	int LocalFunctionID() const { return callStack.back().functionId; }
+	int LocalReturnAddr() const { return callStack.back().returnAddr; }
+	int LocalStackFrame() const { return callStack.back().stackTop; }
+
+	void ShowError(const char* msg) { cobInst->Log(msg, pc); }
+
+	void PopArgs(int n) {
+		dataStack.resize(std::max(0, int(dataStack.size()) - n));
+	}
+
+	void LuaCall(int scriptId, int argCount) {
+		cobInst->Log("LuaCall", scriptId, argCount, (dataStack.empty()? 0: dataStack.back()));
+		PopArgs(argCount);
+
+		luaArgs[0] = 1;
+		luaArgs[1] = scriptId + argCount;
+		retCode = luaArgs[0];
+	}
+	void DeferredCall(int scriptId, int argCount) {
+		cobInst->Log("DeferredCall", scriptId, argCount, (dataStack.empty()? 0: dataStack.back()));
+		PopArgs(argCount);
+		retCode = 1;
+	}
+
+	void SleepFor(int time) {
+		cobInst->Log("Sleep", time, pc);
+		wakeTime = time;
+		state = Sleep;
+	}
+	void StartThread(int functionId, int argCount) {
+		cobInst->Log("StartThread", functionId, argCount, signalMask);
+		PopArgs(argCount);
+	}
+	int RandInt(int min, int max) {
+		rngState = rngState * 1103515245u + 12345u;
+		return (min + ((max >= min)? int((rngState >> 8) % unsigned(max - min + 1)): 0));
+	}
+
+	MockUnit* cobInst;
+	MockCobFile* cobFile;
+
+	int pc = 0;
+	int wakeTime = 0;
+	int paramCount = 0;
+	int retCode = -1;
+	int signalMask = 0;
+	int waitPiece = -1;
+	int waitAxis = -1;
+	int luaArgs[10] = {0};
+
+	unsigned int rngState = 1;
+
+	std::vector<CallInfo> callStack;
+	std::vector<int> dataStack;
+
+	State state = Init;
+};
+
+void MockUnit::Signal(int signal) {
+	Log("Signal", signal);
+
+	// CCobInstance::Signal kills every thread whose mask matches
+	if ((thread->signalMask & signal) != 0)
+		thread->state = MockThread::Dead;
+}
+
+
+
+// executes the raw CCobFile::code the way CCobThread::Tick did before the
+// program was pre-decoded; the reference CobInterpreter::Run is tested against
+template<typename Thread>
+static bool RunLegacy(Thread& t)
+{
+	using Inst = std::remove_pointer_t<decltype(t.cobInst)>;
+
+	#if 0
+	#define GET_LONG_PC() (t.cobFile->code[t.pc++])
+	#else
+	// mantis #5981
+	#define GET_LONG_PC() (t.cobFile->code.at(t.pc++))
+	#endif
+
+	int r1, r2, r3, r4, r5, r6;
+
+	while (t.state == Thread::Run) {
+		const int opcode = GET_LONG_PC();
+
+		switch (opcode) {
+			case PUSH_CONSTANT: {
+				r1 = GET_LONG_PC();
+				t.PushDataStack(r1);
+			} break;
+			case SLEEP: {
+				r1 = t.PopDataStack();
+				t.SleepFor(r1);
+				return true;
+			} break;
+			case SPIN: {
+				r1 = GET_LONG_PC();
+				r2 = GET_LONG_PC();
+				r3 = t.PopDataStack();         // speed
+				r4 = t.PopDataStack();         // accel
+				t.cobInst->Spin(r1, r2, r3, r4);
+			} break;
+			case STOP_SPIN: {
+				r1 = GET_LONG_PC();
+				r2 = GET_LONG_PC();
+				r3 = t.PopDataStack();         // decel
+
+				t.cobInst->StopSpin(r1, r2, r3);
+			} break;
+			case RETURN: {
+				t.retCode = t.PopDataStack();
+
+				if (t.LocalReturnAddr() == -1) {
+					t.state = Thread::Dead;
+
+					// leave values intact on stack in case caller wants to check them
+					// callStackSize -= 1;
+					return false;
+				}
+
+				// return to caller
+				t.pc = t.LocalReturnAddr();
+				if (t.dataStack.size() > t.LocalStackFrame())
+					t.dataStack.resize(t.LocalStackFrame());
+
+				t.callStack.pop_back();
+			} break;
+
+
+			case SHADE: {
+				r1 = GET_LONG_PC();
+			} break;
+			case DONT_SHADE: {
+				r1 = GET_LONG_PC();
+			} break;
+			case CACHE: {
+				r1 = GET_LONG_PC();
+			} break;
+			case DONT_CACHE: {
+				r1 = GET_LONG_PC();
+			} break;
+
+			case SIGNATURE_LUA: {
+				LOG_L(L_ERROR, "BAD ACCESS: Entered a lua method reference.");
+				t.state = Thread::Dead;
+				return false;
+			} break;
+
+			case BATCH_LUA: {
+				r1 = GET_LONG_PC();
+				r2 = GET_LONG_PC();
+				t.DeferredCall(r1, r2);
+			} break;
+
+			case CALL: {
+				r1 = GET_LONG_PC();
+				t.pc--;
+
+				if (t.cobFile->scriptNames[r1].find("lua_") == 0) {
+					t.cobFile->code[t.pc - 1] = LUA_CALL;
+
+					r1 = GET_LONG_PC();
+					r2 = GET_LONG_PC();
+					t.LuaCall(r1, r2);
+					break;
+				}
+
+				t.cobFile->code[t.pc - 1] = REAL_CALL;
+
+				// fall-through
+			}
+			case REAL_CALL: {
+				r1 = GET_LONG_PC();
+				r2 = GET_LONG_PC();
+
+				// do not call zero-length functions
+				if (t.cobFile->scriptLengths[r1] == 0)
+					break;
+
+				auto& ci = t.PushCallStackRef();
+				ci.functionId = r1;
+				ci.returnAddr = t.pc;
+				ci.stackTop = t.dataStack.size() - r2;
+
+				t.paramCount = r2;
+
+				// call cobFile->scriptNames[r1]
+				t.pc = t.cobFile->scriptOffsets[r1];
+			} break;
+			case LUA_CALL: {
+				r1 = GET_LONG_PC();
+				r2 = GET_LONG_PC();
+				t.LuaCall(r1, r2);
+			} break;
+
+
+			case POP_STATIC: {
+				r1 = GET_LONG_PC();
+				r2 = t.PopDataStack();
+
+				if (static_cast<size_t>(r1) < t.cobInst->staticVars.size())
+					t.cobInst->staticVars[r1] = r2;
+			} break;
+			case POP_STACK: {
+				t.PopDataStack();
+			} break;
+
+
+			case START: {
+				r1 = GET_LONG_PC();
+				r2 = GET_LONG_PC();
+
+				if (t.cobFile->scriptLengths[r1] == 0)
+					break;
+
+				t.StartThread(r1, r2);
+			} break;
+
+			case CREATE_LOCAL_VAR: {
+				if (t.paramCount == 0) {
+					t.PushDataStack(0);
+				} else {
+					t.paramCount--;
+				}
+			} break;
+			case GET_UNIT_VALUE: {
+				r1 = t.PopDataStack();
+				if ((r1 >= LUA0) && (r1 <= LUA9)) {
+					t.PushDataStack(t.luaArgs[r1 - LUA0]);
+					break;
+				}
+				r1 = t.cobInst->GetUnitVal(r1, 0, 0, 0, 0);
+				t.PushDataStack(r1);
+			} break;
+
+
+			case JUMP_NOT_EQUAL: {
+				r1 = GET_LONG_PC();
+				r2 = t.PopDataStack();
+
+				if (r2 == 0)
+					t.pc = r1;
+
+			} break;
+			case JUMP: {
+				r1 = GET_LONG_PC();
+				// this seem to be an error in the docs..
+				//r2 = cobFile->scriptOffsets[LocalFunctionID()] + r1;
+				t.pc = r1;
+			} break;
+
+
+			case POP_LOCAL_VAR: {
+				r1 = GET_LONG_PC();
+				r2 = t.PopDataStack();
+				t.dataStack[t.LocalStackFrame() + r1] = r2;
+			} break;
+			case PUSH_LOCAL_VAR: {
+				r1 = GET_LONG_PC();
+				r2 = t.dataStack[t.LocalStackFrame() + r1];
+				t.PushDataStack(r2);
+			} break;
+
+
+			case BITWISE_AND: {
+				r1 = t.PopDataStack();
+				r2 = t.PopDataStack();
+				t.PushDataStack(r1 & r2);
+			} break;
+			case BITWISE_OR: {
+				r1 = t.PopDataStack();
+				r2 = t.PopDataStack();
+				t.PushDataStack(r1 | r2);
+			} break;
+			case BITWISE_XOR: {
+				r1 = t.PopDataStack();
+				r2 = t.PopDataStack();
+				t.PushDataStack(r1 ^ r2);
+			} break;
+			case BITWISE_NOT: {
+				r1 = t.PopDataStack();
+				t.PushDataStack(~r1);
+			} break;
+
+			case EXPLODE: {
+				r1 = GET_LONG_PC();
+				r2 = t.PopDataStack();
+				t.cobInst->Explode(r1, r2);
+			} break;
+
+			case PLAY_SOUND: {
+				r1 = GET_LONG_PC();
+				r2 = t.PopDataStack();
+				t.cobInst->PlayUnitSound(r1, r2);
+			} break;
+
+			case PUSH_STATIC: {
+				r1 = GET_LONG_PC();
+
+				if (static_cast<size_t>(r1) < t.cobInst->staticVars.size())
+					t.PushDataStack(t.cobInst->staticVars[r1]);
+			} break;
+
+			case SET_NOT_EQUAL: {
+				r1 = t.PopDataStack();
+				r2 = t.PopDataStack();
+
+				t.PushDataStack(int(r1 != r2));
+			} break;
+			case SET_EQUAL: {
+				r1 = t.PopDataStack();
+				r2 = t.PopDataStack();
+
+				t.PushDataStack(int(r1 == r2));
+			} break;
+
+			case SET_LESS: {
+				r2 = t.PopDataStack();
+				r1 = t.PopDataStack();
+
+				t.PushDataStack(int(r1 < r2));
+			} break;
+			case SET_LESS_OR_EQUAL: {
+				r2 = t.PopDataStack();
+				r1 = t.PopDataStack();
+
+				t.PushDataStack(int(r1 <= r2));
+			} break;
+
+			case SET_GREATER: {
+				r2 = t.PopDataStack();
+				r1 = t.PopDataStack();
+
+				t.PushDataStack(int(r1 > r2));
+			} break;
+			case SET_GREATER_OR_EQUAL: {
+				r2 = t.PopDataStack();
+				r1 = t.PopDataStack();
+
+				t.PushDataStack(int(r1 >= r2));
+			} break;
+
+			case RAND: {
+				r2 = t.PopDataStack();
+				r1 = t.PopDataStack();
+				r3 = t.RandInt(r1, r2);
+				t.PushDataStack(r3);
+			} break;
+			case EMIT_SFX: {
+				r1 = t.PopDataStack();
+				r2 = GET_LONG_PC();
+				t.cobInst->EmitSfx(r1, r2);
+			} break;
+			case MUL: {
+				r1 = t.PopDataStack();
+				r2 = t.PopDataStack();
+				t.PushDataStack(r1 * r2);
+			} break;
+
+
+			case SIGNAL: {
+				r1 = t.PopDataStack();
+				t.cobInst->Signal(r1);
+			} break;
+			case SET_SIGNAL_MASK: {
+				r1 = t.PopDataStack();
+				t.signalMask = r1;
+			} break;
+
+
+			case TURN: {
+				r2 = t.PopDataStack();
+				r1 = t.PopDataStack();
+				r3 = GET_LONG_PC(); // piece
+				r4 = GET_LONG_PC(); // axis
+
+				t.cobInst->Turn(r3, r4, r1, r2);
+			} break;
+			case GET: {
+				r5 = t.PopDataStack();
+				r4 = t.PopDataStack();
+				r3 = t.PopDataStack();
+				r2 = t.PopDataStack();
+				r1 = t.PopDataStack();
+				if ((r1 >= LUA0) && (r1 <= LUA9)) {
+					t.PushDataStack(t.luaArgs[r1 - LUA0]);
+					break;
+				}
+				r6 = t.cobInst->GetUnitVal(r1, r2, r3, r4, r5);
+				t.PushDataStack(r6);
+			} break;
+			case ADD: {
+				r2 = t.PopDataStack();
+				r1 = t.PopDataStack();
+				t.PushDataStack(r1 + r2);
+			} break;
+			case SUB: {
+				r2 = t.PopDataStack();
+				r1 = t.PopDataStack();
+				r3 = r1 - r2;
+				t.PushDataStack(r3);
+			} break;
+
+			case DIV: {
+				r2 = t.PopDataStack();
+				r1 = t.PopDataStack();
+
+				if (r2 != 0) {
+					r3 = r1 / r2;
+				} else {
+					r3 = 1000; // infinity!
+					t.ShowError("division by zero");
+				}
+				t.PushDataStack(r3);
+			} break;
+			case MOD: {
+				r2 = t.PopDataStack();
+				r1 = t.PopDataStack();
+
+				if (r2 != 0) {
+					t.PushDataStack(r1 % r2);
+				} else {
+					t.PushDataStack(0);
+					t.ShowError("modulo division by zero");
+				}
+			} break;
+
+
+			case MOVE: {
+				r1 = GET_LONG_PC();
+				r2 = GET_LONG_PC();
+				r4 = t.PopDataStack();
+				r3 = t.PopDataStack();
+				t.cobInst->Move(r1, r2, r3, r4);
+			} break;
+			case MOVE_NOW: {
+				r1 = GET_LONG_PC();
+				r2 = GET_LONG_PC();
+				r3 = t.PopDataStack();
+				t.cobInst->MoveNow(r1, r2, r3);
+			} break;
+			case TURN_NOW: {
+				r1 = GET_LONG_PC();
+				r2 = GET_LONG_PC();
+				r3 = t.PopDataStack();
+				t.cobInst->TurnNow(r1, r2, r3);
+			} break;
+
+
+			case WAIT_TURN: {
+				r1 = GET_LONG_PC();
+				r2 = GET_LONG_PC();
+
+				if (t.cobInst->NeedsWait(Inst::ATurn, r1, r2)) {
+					t.state = Thread::WaitTurn;
+					t.waitPiece = r1;
+					t.waitAxis = r2;
+					return true;
+				}
+			} break;
+			case WAIT_MOVE: {
+				r1 = GET_LONG_PC();
+				r2 = GET_LONG_PC();
+
+				if (t.cobInst->NeedsWait(Inst::AMove, r1, r2)) {
+					t.state = Thread::WaitMove;
+					t.waitPiece = r1;
+					t.waitAxis = r2;
+					return true;
+				}
+			} break;
+
+
+			case SET: {
+				r2 = t.PopDataStack();
+				r1 = t.PopDataStack();
+
+				if ((r1 >= LUA0) && (r1 <= LUA9)) {
+					t.luaArgs[r1 - LUA0] = r2;
+					break;
+				}
+
+				t.cobInst->SetUnitVal(r1, r2);
+			} break;
+
+
+			case ATTACH: {
+				r3 = t.PopDataStack();
+				r2 = t.PopDataStack();
+				r1 = t.PopDataStack();
+				t.cobInst->AttachUnit(r2, r1);
+			} break;
+			case DROP: {
+				r1 = t.PopDataStack();
+				t.cobInst->DropUnit(r1);
+			} break;
+
+			// like bitwise ops, but only on values 1 and 0
+			case LOGICAL_NOT: {
+				r1 = t.PopDataStack();
+				t.PushDataStack(int(r1 == 0));
+			} break;
+			case LOGICAL_AND: {
+				r1 = t.PopDataStack();
+				r2 = t.PopDataStack();
+				t.PushDataStack(int(r1 && r2));
+			} break;
+			case LOGICAL_OR: {
+				r1 = t.PopDataStack();
+				r2 = t.PopDataStack();
+				t.PushDataStack(int(r1 || r2));
+			} break;
+			case LOGICAL_XOR: {
+				r1 = t.PopDataStack();
+				r2 = t.PopDataStack();
+				t.PushDataStack(int((!!r1) ^ (!!r2)));
+			} break;
+
+
+			case HIDE: {
+				r1 = GET_LONG_PC();
+				t.cobInst->SetVisibility(r1, false);
+			} break;
+
+			case SHOW: {
+				r1 = GET_LONG_PC();
+
+				int i;
+				for (i = 0; i < MAX_WEAPONS_PER_UNIT; ++i)
+					if (t.LocalFunctionID() == t.cobFile->scriptIndex[COBFN_FirePrimary + COBFN_Weapon_Funcs * i])
+						break;
+
+				// if true, we are in a Fire-script and should show a special flare effect
+				if (i < MAX_WEAPONS_PER_UNIT) {
+					t.cobInst->ShowFlare(r1);
+				} else {
+					t.cobInst->SetVisibility(r1, true);
+				}
+			} break;
+
+			default: {
+				const char* name = t.cobFile->name.c_str();
+				const char* func = t.cobFile->scriptNames[t.LocalFunctionID()].c_str();
+
+				LOG_L(L_ERROR, "[COBThread::Tick] unknown opcode %x (in %s:%s at %x)", opcode, name, func, t.pc - 1);
+
+				t.state = Thread::Dead;
+				return false;
+			} break;
+		}
+	}
+
+	#undef GET_LONG_PC
+
+	// can arrive here as dead, through CCobInstance::Signal()
+	return (t.state != Thread::Dead);
+}
+
+
+
+// resumes the thread until it dies, returns everything it did
+template<bool legacy>
+static std::vector<std::string> Execute(MockCobFile file, int functionId)
+{
+	MockUnit unit;
+	MockThread thread(&unit, &file);
+
+	thread.Start(functionId);
+
+	for (int resumes = 0; resumes < 1000; resumes++) {
+		thread.state = MockThread::Run;
+
+		const bool alive = legacy? RunLegacy(thread): CobInterpreter::Run(thread);
+
+		unit.Log("Yield", thread.state, thread.pc, thread.retCode, thread.waitPiece * 16 + thread.waitAxis);
+
+		if (!alive)
+			break;
+	}
+
+	for (const int v: thread.dataStack) {
+		unit.Log("Stack", v);
+	}
+	for (const int v: unit.staticVars) {
+		unit.Log("Static", v);
+	}
+	for (const int v: thread.luaArgs) {
+		unit.Log("LuaArg", v);
+	}
+
+	return unit.trace;
+}
+
+static MockCobFile MakeFile(const std::vector<std::vector<int>>& functions, const std::vector<std::string>& names)
+{
+	MockCobFile file;
+	file.scriptIndex.fill(-1);
+	file.scriptNames = names;
+
+	for (const auto& func: functions) {
+		file.scriptOffsets.push_back(file.code.size());
+		file.scriptLengths.push_back(func.size());
+		file.code.insert(file.code.end(), func.begin(), func.end());
+	}
+
+	// CCobFile pads the code the same way
+	file.code.resize(file.code.size() + 4, 0);
+	file.program = CobProgram::Decode(file.code, file.scriptNames);
+	return file;
+}
+
+
+
+/**
+ * Generates random but well-formed COB functions: every expression pushes
+ * exactly one value and every statement leaves the stack balanced, so local
+ * variable slots are always valid and neither interpreter hits undefined
+ * behaviour. Stored values are kept small so arithmetic never overflows.
+ */
+class CScriptGenerator {
+public:
+	CScriptGenerator(unsigned int seed): rng(seed) {}
+
+	std::vector<int> MakeFunction(int numLocals, bool allowCalls) {
+		code.clear();
+
+		this->numLocals = numLocals;
+		this->allowCalls = allowCalls;
+
+		for (int i = 0; i < numLocals; i++) {
+			Emit({CREATE_LOCAL_VAR});
+		}
+		for (int i = 0, n = Rand(3, 12); i < n; i++) {
+			Statement(0);
+		}
+
+		Expression(0);
+		Emit({RETURN});
+		return code;
+	}
+
+private:
+	int Rand(int min, int max) { return std::uniform_int_distribution<int>(min, max)(rng); }
+	int Const() { return Rand(-50, 50); }
+
+	void Emit(std::initializer_list<int> words) { code.insert(code.end(), words); }
+
+	void Bounded() {
+		// keep stored values within [-99, 99]
+		Emit({PUSH_CONSTANT, 100, MOD});
+	}
+
+	void Expression(int depth) {
+		const int kind = Rand(0, (depth >= 2)? 3: 8);
+
+		switch (kind) {
+			case 0: { Emit({PUSH_CONSTANT, Const()}); } break;
+			case 1: { Emit({PUSH_LOCAL_VAR, Rand(0, numLocals - 1)}); } break;
+			// an out-of-range PUSH_STATIC pushes nothing, which would unbalance the stack
+			case 2: { Emit({PUSH_STATIC, Rand(0, 3)}); } break;
+			case 3: {
+				Emit({PUSH_CONSTANT, Rand(0, 20)});
+				Emit({GET_UNIT_VALUE});
+			} break;
+			case 4:
+			case 5:
+			case 6: {
+				static constexpr int BINARY_OPS[] = {
+					ADD, SUB, MUL, DIV, MOD, BITWISE_AND, BITWISE_OR, BITWISE_XOR,
+					SET_LESS, SET_LESS_OR_EQUAL, SET_GREATER, SET_GREATER_OR_EQUAL, SET_EQUAL, SET_NOT_EQUAL,
+					LOGICAL_AND, LOGICAL_OR, LOGICAL_XOR, RAND,
+				};
+
+				Expression(depth + 1);
+				Expression(depth + 1);
+				Emit({BINARY_OPS[Rand(0, std::size(BINARY_OPS) - 1)]});
+			} break;
+			case 7: {
+				Expression(depth + 1);
+				Emit({(Rand(0, 1) == 0)? BITWISE_NOT: LOGICAL_NOT});
+			} break;
+			case 8: {
+				// GET, sometimes reading back a Lua result
+				Emit({PUSH_CONSTANT, (Rand(0, 3) == 0)? Rand(LUA0, LUA9): Rand(0, 20)});
+				for (int i = 0; i < 4; i++) {
+					Expression(depth + 1);
+				}
+				Emit({GET});
+			} break;
+		}
+	}
+
+	void Statement(int depth) {
+		const int kind = Rand(0, (depth >= 2)? 17: 20);
+
+		const int piece = Rand(0, 7);
+		const int axis = Rand(0, 2);
+
+		switch (kind) {
+			// constant forms, these get fused
+			case 0: { Emit({PUSH_CONSTANT, Const(), PUSH_CONSTANT, Const(), TURN, piece, axis}); } break;
+			case 1: { Emit({PUSH_CONSTANT, Const(), PUSH_CONSTANT, Const(), MOVE, piece, axis}); } break;
+			case 2: { Emit({PUSH_CONSTANT, Const(), PUSH_CONSTANT, Const(), SPIN, piece, axis}); } break;
+			case 3: { Emit({PUSH_CONSTANT, Const(), (Rand(0, 1) == 0)? TURN_NOW: MOVE_NOW, piece, axis}); } break;
+			case 4: { Emit({PUSH_CONSTANT, Rand(0, 200), SLEEP}); } break;
+			case 5: { Emit({PUSH_CONSTANT, (Rand(0, 2) == 0)? Rand(LUA0, LUA9): Rand(0, 40), PUSH_CONSTANT, Const(), SET}); } break;
+
+			// and the general ones
+			case 6: {
+				Expression(0);
+				Expression(0);
+				Emit({(Rand(0, 1) == 0)? TURN: MOVE, piece, axis});
+			} break;
+			case 7: {
+				Expression(0);
+				Emit({STOP_SPIN, piece, axis});
+			} break;
+			case 8: {
+				Emit({PUSH_CONSTANT, (Rand(0, 2) == 0)? Rand(LUA0, LUA9): Rand(0, 40)});
+				Expression(0);
+				Bounded();
+				Emit({SET});
+			} break;
+			case 9: {
+				Expression(0);
+				Bounded();
+				Emit({POP_LOCAL_VAR, Rand(0, numLocals - 1)});
+			} break;
+			case 10: {
+				Expression(0);
+				Bounded();
+				Emit({POP_STATIC, Rand(0, 5)});
+			} break;
+			case 11: { Emit({(Rand(0, 1) == 0)? WAIT_TURN: WAIT_MOVE, piece, axis}); } break;
+			case 12: {
+				Emit({PUSH_CONSTANT, 1 << Rand(0, 3)});
+				Emit({(Rand(0, 3) == 0)? SIGNAL: SET_SIGNAL_MASK});
+			} break;
+			case 13: {
+				Expression(0);
+				Emit({EMIT_SFX, piece});
+			} break;
+			case 14: {
+				Expression(0);
+				Emit({(Rand(0, 1) == 0)? EXPLODE: PLAY_SOUND, piece});
+			} break;
+			case 15: { Emit({(Rand(0, 1) == 0)? SHOW: HIDE, piece}); } break;
+			case 16: {
+				Expression(0);
+				Emit({SLEEP});
+			} break;
+			case 17: {
+				if (!allowCalls)
+					break;
+
+				// Helper (two args) or lua_Foo (one arg), both through CALL
+				const bool lua = (Rand(0, 1) == 0);
+
+				for (int i = 0, n = lua? 1: 2; i < n; i++) {
+					Expression(0);
+				}
+
+				Emit({CALL, lua? 2: 1, lua? 1: 2});
+			} break;
+
+			// control flow
+			case 18: {
+				// if (expr) { ... } else { ... }
+				Expression(0);
+				Emit({JUMP_NOT_EQUAL, 0});
+				const size_t elseJump = code.size() - 1;
+
+				Statement(depth + 1);
+				Emit({JUMP, 0});
+				const size_t endJump = code.size() - 1;
+
+				code[elseJump] = Offset();
+				Statement(depth + 1);
+				code[endJump] = Offset();
+			} break;
+			case 19: {
+				// for (i = 0; i < n; i++) { ... }, the counter is the last local
+				const int var = numLocals - 1;
+
+				Emit({PUSH_CONSTANT, 0, POP_LOCAL_VAR, var});
+				const int loop = Offset();
+
+				Emit({PUSH_LOCAL_VAR, var, PUSH_CONSTANT, Rand(1, 4), SET_LESS, JUMP_NOT_EQUAL, 0});
+				const size_t exitJump = code.size() - 1;
+
+				// the body must not touch the counter
+				numLocals -= 1;
+				Statement(depth + 1);
+				Statement(depth + 1);
+				numLocals += 1;
+
+				Emit({PUSH_LOCAL_VAR, var, PUSH_CONSTANT, 1, ADD, POP_LOCAL_VAR, var, JUMP, loop});
+				code[exitJump] = Offset();
+			} break;
+			case 20: {
+				Expression(0);
+				Emit({START, 1, 1});
+			} break;
+		}
+	}
+
+	// functions are placed back to back, jumps are absolute
+	int Offset() const { return baseOffset + code.size(); }
+
+public:
+	int baseOffset = 0;
+
+private:
+	std::mt19937 rng;
+	std::vector<int> code;
+
+	int numLocals = 1;
+	bool allowCalls = false;
+};
+
+
+
+TEST_CASE("CobInterpreterFusion")
+{
+	const MockCobFile file = MakeFile({{
+		PUSH_CONSTANT, 10, PUSH_CONSTANT, 20, TURN, 3, 1,
+		PUSH_CONSTANT, 1, PUSH_CONSTANT, 2, SET,
+		PUSH_CONSTANT, 33, SLEEP,
+		PUSH_CONSTANT, 0, RETURN,
+	}}, {"Main"});
+
+	CHECK(file.program.size() == (file.code.size() + 1));
+
+	CHECK(file.program[ 0].op == CobProgram::OP_TURN_CONST);
+	CHECK(file.program[ 0].next == 7);
+	CHECK(file.program[ 7].op == CobProgram::OP_SET_CONST);
+	CHECK(file.program[12].op == CobProgram::OP_SLEEP_CONST);
+	CHECK(file.program[15].op == CobProgram::OP_PUSH_CONSTANT);
+
+	// offsets inside a fused run still decode on their own
+	CHECK(file.program[ 2].op == CobProgram::OP_PUSH_CONSTANT);
+	CHECK(file.program[ 4].op == CobProgram::OP_TURN);
+	CHECK(file.program[ 5].op == CobProgram::OP_UNKNOWN);
+
+	CHECK(file.program.back().op == CobProgram::OP_END);
+	CHECK(Execute<false>(file, 0) == Execute<true>(file, 0));
+}
+
+TEST_CASE("CobInterpreterEdgeCases")
+{
+	// jumping into the middle of a fused run
+	MockCobFile file = MakeFile({{
+		PUSH_CONSTANT, 5, JUMP, 6,
+		PUSH_CONSTANT, 10, PUSH_CONSTANT, 20, TURN, 3, 1,
+		PUSH_CONSTANT, 0, RETURN,
+	}}, {"Main"});
+
+	CHECK(Execute<false>(file, 0) == Execute<true>(file, 0));
+
+	// calls into Lua and into zero-length functions
+	file = MakeFile({
+		{PUSH_CONSTANT, 7, CALL, 2, 1, PUSH_CONSTANT, 1, PUSH_CONSTANT, 2, CALL, 1, 2, PUSH_CONSTANT, LUA1, GET_UNIT_VALUE, RETURN},
+		{},
+		{SIGNATURE_LUA},
+	}, {"Main", "Empty", "lua_Foo"});
+
+	CHECK(Execute<false>(file, 0) == Execute<true>(file, 0));
+
+	// division by zero, killed by its own signal
+	file = MakeFile({{
+		PUSH_CONSTANT, 4, SET_SIGNAL_MASK,
+		PUSH_CONSTANT, 1, PUSH_CONSTANT, 0, DIV, POP_STACK,
+		PUSH_CONSTANT, 4, SIGNAL,
+		PUSH_CONSTANT, 1, PUSH_CONSTANT, 2, TURN, 3, 1,
+		PUSH_CONSTANT, 0, RETURN,
+	}}, {"Main"});
+
+	CHECK(Execute<false>(file, 0) == Execute<true>(file, 0));
+
+	// unknown opcode
+	file = MakeFile({{PUSH_CONSTANT, 1, 0x12345678, RETURN}}, {"Main"});
+
+	CHECK(Execute<false>(file, 0) == Execute<true>(file, 0));
+}
+
+TEST_CASE("CobInterpreterDeterminism")
+{
+	for (unsigned int seed = 1; seed <= 2000; seed++) {
+		CScriptGenerator gen(seed);
+
+		// loops nest two deep and each takes a local as counter, leave at least one for the body
+		const std::vector<int> main = gen.MakeFunction(3, true);
+
+		gen.baseOffset = main.size();
+		// the first two locals are its arguments
+		const std::vector<int> helper = gen.MakeFunction(4, false);
+
+		const MockCobFile file = MakeFile({main, helper, {SIGNATURE_LUA}}, {"Main", "Helper", "lua_Foo"});
+
+		const std::vector<std::string> legacyTrace = Execute<true>(file, 0);
+		const std::vector<std::string> decodedTrace = Execute<false>(file, 0);
+
+		INFO("seed " << seed);
+		REQUIRE(legacyTrace == decodedTrace);
+	}
+}
+
+
+TEST_CASE("CobInterpreterBenchmark", "[.][benchmark]")
+{
+	using Clock = std::chrono::steady_clock;
+
+	// one step of a typical walk script: a handful of constant turns and moves, then sleep
+	std::vector<int> walk;
+
+	for (int i = 0; i < 12; i++) {
+		walk.insert(walk.end(), {PUSH_CONSTANT, i * 100, PUSH_CONSTANT, i * 10, TURN, i % 8, i % 3});
+		walk.insert(walk.end(), {PUSH_CONSTANT, i * 50, PUSH_CONSTANT, i * 5, MOVE, i % 8, 1});
+	}
+	walk.insert(walk.end(), {PUSH_CONSTANT, 1, PUSH_CONSTANT, 2, SET, PUSH_CONSTANT, 33, SLEEP, JUMP, 0});
+
+	const MockCobFile file = MakeFile({walk}, {"Walk"});
+
+	const auto Measure = [&](auto run) {
+		MockCobFile copy = file;
+		MockUnit unit;
+		MockThread thread(&unit, &copy);
+
+		// the call-out log is not what is being measured
+		unit.record = false;
+		thread.Start(0);
+
+		const auto t0 = Clock::now();
+
+		for (int i = 0; i < 1000000; i++) {
+			thread.state = MockThread::Run;
+			run(thread);
+		}
+
+		return std::chrono::duration<float, std::milli>(Clock::now() - t0).count();
+	};
+
+	const float legacyTime = Measure([](MockThread& t) { return RunLegacy(t); });
+	const float decodedTime = Measure([](MockThread& t) { return CobInterpreter::Run(t); });
+
+	std::printf("[CobInterpreterBenchmark] 1000000 walk steps: legacy %.1f ms, decoded %.1f ms\n", legacyTime, decodedTime);
+}
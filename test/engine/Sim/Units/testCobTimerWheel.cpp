@@ -0,0 +1,278 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Units/Scripts/CobTimerWheel.h"
+
+#include <chrono>
+#include <cstdio>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <catch_amalgamated.hpp>
+
+
+using SleepingThread = CCobTimerWheel::SleepingThread;
+
+// the scheduler CCobEngine used before, including its lazy dropping of dead threads
+struct ReferenceQueue {
+	struct Comp {
+		bool operator() (const SleepingThread& a, const SleepingThread& b) const {
+			return a.wt > b.wt || (a.wt == b.wt && a.id > b.id);
+		}
+	};
+
+	void Push(int id, int wt) { queue.push({id, wt}); }
+	// dead threads are dropped lazily in PopDue instead
+	void Remove(int /*id*/) {}
+
+	template<typename IsAsleep>
+	bool PopDue(int time, SleepingThread& st, const IsAsleep& isAsleep) {
+		while (!queue.empty()) {
+			st = queue.top();
+
+			if (!isAsleep(st.id)) {
+				queue.pop();
+				continue;
+			}
+			if (st.wt >= time)
+				return false;
+
+			queue.pop();
+			return true;
+		}
+
+		return false;
+	}
+
+	std::priority_queue<SleepingThread, std::vector<SleepingThread>, Comp> queue;
+};
+
+struct WheelQueue {
+	void Push(int id, int wt) { wheel.Push(id, wt); }
+	void Remove(int id) { wheel.Remove(id); }
+
+	template<typename IsAsleep>
+	bool PopDue(int time, SleepingThread& st, const IsAsleep& isAsleep) {
+		while (wheel.PopDue(time, st)) {
+			if (isAsleep(st.id))
+				return true;
+		}
+
+		return false;
+	}
+
+	CCobTimerWheel wheel;
+};
+
+
+// mimics CCobEngine::WakeSleepingThreads driving a population of threads
+// that sleep, re-sleep (also for zero or negative times), die and spawn
+template<typename Queue>
+static std::vector<SleepingThread> Simulate(unsigned int seed, int numThreads, int numTicks)
+{
+	std::mt19937 rng(seed);
+	std::vector<SleepingThread> trace;
+	std::unordered_map<int, int> asleep; // id -> wake-time
+
+	Queue queue;
+
+	int currentTime = 0;
+	int threadCounter = 0;
+
+	const auto RandSleep = [&]() {
+		switch (rng() % 8) {
+			case 0: return 0;
+			case 1: return -int(rng() % 50);
+			case 2: return int(rng() % 100000);
+			case 3: return int(rng() % 5000000);
+			default: return int(rng() % 1000);
+		}
+	};
+	const auto Sleep = [&](int id, int time) {
+		asleep[id] = currentTime + time;
+		queue.Push(id, currentTime + time);
+	};
+	const auto Kill = [&](int id) {
+		if (asleep.erase(id) == 0)
+			return;
+
+		queue.Remove(id);
+	};
+	const auto IsAsleep = [&](int id) { return (asleep.find(id) != asleep.end()); };
+
+	for (int i = 0; i < numThreads; i++) {
+		Sleep(threadCounter++, RandSleep());
+	}
+
+	for (int tick = 0; tick < numTicks; tick++) {
+		currentTime += 33;
+
+		SleepingThread st;
+
+		while (queue.PopDue(currentTime, st, IsAsleep)) {
+			asleep.erase(st.id);
+			trace.push_back(st);
+
+			switch (rng() % 16) {
+				case 0: {
+					// finished
+				} break;
+				case 1: {
+					Kill(rng() % threadCounter);
+					Sleep(st.id, RandSleep());
+				} break;
+				case 2: {
+					Sleep(threadCounter++, RandSleep());
+					Sleep(st.id, RandSleep());
+				} break;
+				case 3: {
+					// sleeps again before the current time, woken in this same pass
+					Sleep(st.id, -int(rng() % 100) - 33);
+				} break;
+				default: {
+					Sleep(st.id, RandSleep());
+				} break;
+			}
+		}
+
+		// threads also die while asleep, e.g. through signals
+		for (int i = rng() % 4; i > 0; i--) {
+			Kill(rng() % threadCounter);
+		}
+	}
+
+	return trace;
+}
+
+
+TEST_CASE("CobTimerWheelOrder")
+{
+	for (unsigned int seed = 0; seed < 200; seed++) {
+		const auto refTrace = Simulate<ReferenceQueue>(seed, 1 + seed * 7, 400);
+		const auto wheelTrace = Simulate<WheelQueue>(seed, 1 + seed * 7, 400);
+
+		CAPTURE(seed);
+		REQUIRE(refTrace.size() == wheelTrace.size());
+
+		for (size_t i = 0; i < refTrace.size(); i++) {
+			CAPTURE(i);
+			REQUIRE(refTrace[i].id == wheelTrace[i].id);
+			REQUIRE(refTrace[i].wt == wheelTrace[i].wt);
+		}
+	}
+}
+
+TEST_CASE("CobTimerWheelEdgeCases")
+{
+	CCobTimerWheel wheel;
+	SleepingThread st;
+
+	SECTION("extreme wake-times") {
+		wheel.Push(1, INT32_MAX);
+		wheel.Push(2, INT32_MIN);
+		wheel.Push(3, 0);
+		wheel.Push(4, -1);
+
+		CHECK(wheel.size() == 4);
+		CHECK((wheel.PopDue(INT32_MIN, st)) == false);
+
+		REQUIRE(wheel.PopDue(0, st));
+		CHECK(st.id == 2);
+		REQUIRE(wheel.PopDue(0, st));
+		CHECK(st.id == 4);
+		CHECK((wheel.PopDue(0, st)) == false);
+
+		REQUIRE(wheel.PopDue(INT32_MAX, st));
+		CHECK(st.id == 3);
+		CHECK((wheel.PopDue(INT32_MAX, st)) == false);
+		CHECK(wheel.size() == 1);
+
+		CHECK(wheel.GetSorted().front().id == 1);
+	}
+	SECTION("ties come out by ID") {
+		for (int id: {5, 3, 9, 1, 7}) {
+			wheel.Push(id, 100);
+		}
+
+		REQUIRE(wheel.PopDue(101, st));
+		CHECK(st.id == 1);
+
+		// pushed behind the cursor while the slot is being drained
+		wheel.Push(2, 100);
+		wheel.Push(0, 50);
+
+		for (int id: {0, 2, 3, 5, 7, 9}) {
+			REQUIRE(wheel.PopDue(101, st));
+			CHECK(st.id == id);
+		}
+
+		CHECK(wheel.empty());
+	}
+	SECTION("removal") {
+		for (int id = 0; id < 10; id++) {
+			wheel.Push(id, id * 1000);
+		}
+
+		REQUIRE(wheel.PopDue(1, st));
+		CHECK(st.id == 0);
+
+		CHECK(wheel.Remove(3));
+		CHECK(!wheel.Remove(3));
+		CHECK(!wheel.Remove(0));
+		CHECK(wheel.size() == 8);
+
+		for (int id: {1, 2, 4, 5, 6, 7, 8, 9}) {
+			REQUIRE(wheel.PopDue(100000, st));
+			CHECK(st.id == id);
+		}
+
+		CHECK(wheel.empty());
+	}
+}
+
+TEST_CASE("CobTimerWheelBenchmark", "[.][benchmark]")
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr int numThreads = 100000;
+	constexpr int numTicks = 900;
+
+	const auto Run = [&](auto&& queue) {
+		std::mt19937 rng(1234);
+		std::vector<int> sleeps(4096);
+		SleepingThread st;
+
+		// short-sleep loops, mostly a few frames long as in typical unit scripts
+		for (int& s: sleeps) {
+			s = 33 * (1 + rng() % 30) + rng() % 33;
+		}
+
+		int currentTime = 0;
+		size_t numWoken = 0;
+
+		const auto t0 = Clock::now();
+
+		for (int i = 0; i < numThreads; i++) {
+			queue.Push(i, sleeps[i & 4095]);
+		}
+
+		for (int tick = 0; tick < numTicks; tick++) {
+			currentTime += 33;
+
+			while (queue.PopDue(currentTime, st, [](int) { return true; })) {
+				queue.Push(st.id, currentTime + sleeps[(st.id + tick) & 4095]);
+				numWoken++;
+			}
+		}
+
+		const float ms = std::chrono::duration<float, std::milli>(Clock::now() - t0).count();
+		return std::make_pair(ms, numWoken);
+	};
+
+	const auto [refTime, refWoken] = Run(ReferenceQueue{});
+	const auto [wheelTime, wheelWoken] = Run(WheelQueue{});
+
+	CHECK(refWoken == wheelWoken);
+	std::printf("[CobTimerWheelBenchmark] %d threads, %d ticks, %zu wake-ups: priority_queue %.1f ms, timer wheel %.1f ms\n", numThreads, numTicks, refWoken, refTime, wheelTime);
+}
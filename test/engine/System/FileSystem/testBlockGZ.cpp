@@ -0,0 +1,335 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/FileSystem/BlockGZ.h"
+#include "System/Threading/ThreadPool.h"
+#include "System/Platform/Threading.h"
+#include "System/Misc/SpringTime.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include <catch_amalgamated.hpp>
+
+
+struct do_once {
+	do_once() {
+		Threading::DetectCores(); // make GetMaxThreads() work
+		ThreadPool::SetThreadCount(ThreadPool::GetMaxThreads());
+	}
+};
+
+InitSpringTime ist;
+do_once doonce;
+
+
+// loosely resembles serialized game state: runs of small ints, floats and repeated class names
+static std::string MakePayload(size_t size, unsigned int seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> smallInt(0, 255);
+	std::uniform_real_distribution<float> coord(0.0f, 8192.0f);
+
+	static const char* names[] = {"CUnit", "CFeature", "CWeapon", "CCommandAI", "CGroundMoveType"};
+
+	std::string data;
+	data.reserve(size + 64);
+
+	while (data.size() < size) {
+		const float pos[3] = {coord(rng), coord(rng), coord(rng)};
+		const int id = smallInt(rng);
+
+		data.append(names[id % 5]);
+		data.append(reinterpret_cast<const char*>(&id), sizeof(id));
+		data.append(reinterpret_cast<const char*>(pos), sizeof(pos));
+		data.append(16, char(id & 3));
+	}
+
+	data.resize(size);
+	return data;
+}
+
+static std::string WriteBlockGZ(const std::string& payload, size_t blockSize)
+{
+	std::ostringstream sink;
+
+	CBlockGZWriteBuf gzbuf(sink, 1, blockSize);
+	std::ostream stream(&gzbuf);
+
+	stream.write(payload.data(), payload.size());
+
+	CHECK(stream.good());
+	CHECK(gzbuf.Finish());
+	CHECK(gzbuf.GetRawSize() == payload.size());
+	CHECK(gzbuf.GetCompressedSize() == sink.str().size());
+	return sink.str();
+}
+
+static bool DecompressBlockGZ(const std::string& compressed, std::string& out)
+{
+	std::vector<std::uint8_t> in(compressed.begin(), compressed.end());
+	std::vector<std::uint8_t> raw;
+
+	if (!BlockGZ::Decompress(in, raw))
+		return false;
+
+	out.assign(raw.begin(), raw.end());
+	return true;
+}
+
+// inflates every concatenated member the way gzread does
+static std::string InflateGzip(const std::string& compressed)
+{
+	std::string out;
+
+	z_stream zstream;
+	std::memset(&zstream, 0, sizeof(zstream));
+	inflateInit2(&zstream, 15 + 16);
+
+	zstream.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+	zstream.avail_in = compressed.size();
+
+	char buf[8192];
+
+	while (true) {
+		zstream.next_out  = reinterpret_cast<Bytef*>(buf);
+		zstream.avail_out = sizeof(buf);
+
+		const int ret = inflate(&zstream, Z_NO_FLUSH);
+		REQUIRE((ret == Z_OK || ret == Z_STREAM_END));
+
+		out.append(buf, sizeof(buf) - zstream.avail_out);
+
+		if (ret != Z_STREAM_END)
+			continue;
+		if (zstream.avail_in == 0)
+			break;
+
+		inflateReset(&zstream);
+	}
+
+	inflateEnd(&zstream);
+	return out;
+}
+
+
+
+TEST_CASE("BlockGZRoundTrip")
+{
+	for (const size_t size: {size_t(0), size_t(1), size_t(4096), size_t(65536), size_t(65536 * 7 + 123)}) {
+		const std::string payload = MakePayload(size, size + 1);
+		const std::string compressed = WriteBlockGZ(payload, 65536);
+
+		std::string decompressed;
+
+		REQUIRE(DecompressBlockGZ(compressed, decompressed));
+		CHECK(decompressed == payload);
+	}
+}
+
+TEST_CASE("BlockGZGzipCompatible")
+{
+	const std::string payload = MakePayload(65536 * 5 + 17, 7);
+	const std::string compressed = WriteBlockGZ(payload, 65536);
+
+	// any gzip reader sees a single stream
+	CHECK(InflateGzip(compressed) == payload);
+
+	// but plain gzip files are not mistaken for block-gzip ones
+	std::string plain(compressBound(payload.size()) + 64, 0);
+	{
+		z_stream zstream;
+		std::memset(&zstream, 0, sizeof(zstream));
+		deflateInit2(&zstream, 1, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+
+		zstream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(payload.data()));
+		zstream.avail_in  = payload.size();
+		zstream.next_out  = reinterpret_cast<Bytef*>(plain.data());
+		zstream.avail_out = plain.size();
+
+		REQUIRE(deflate(&zstream, Z_FINISH) == Z_STREAM_END);
+		plain.resize(zstream.total_out);
+		deflateEnd(&zstream);
+	}
+
+	std::string decompressed;
+	CHECK(!DecompressBlockGZ(plain, decompressed));
+	CHECK(InflateGzip(plain) == payload);
+}
+
+TEST_CASE("BlockGZCorruption")
+{
+	const std::string payload = MakePayload(65536 * 3, 11);
+	std::string compressed = WriteBlockGZ(payload, 65536);
+	std::string decompressed;
+
+	// flip a bit inside the deflated data of the second member
+	compressed[compressed.size() / 2] ^= 0x10;
+	CHECK(!DecompressBlockGZ(compressed, decompressed));
+
+	// truncated
+	compressed = WriteBlockGZ(payload, 65536);
+	compressed.resize(compressed.size() - 1);
+	CHECK(!DecompressBlockGZ(compressed, decompressed));
+}
+
+TEST_CASE("BlockGZHeldSeek")
+{
+	// mimics creg::COutputStreamSerializer::SavePackage, which writes a
+	// placeholder header and overwrites it once the package is complete
+	std::string expected;
+	std::ostringstream sink;
+
+	{
+		CBlockGZWriteBuf gzbuf(sink, 1, 4096);
+		std::ostream stream(&gzbuf);
+
+		for (int package = 0; package < 8; ++package) {
+			const std::string header(64, 'H');
+			const std::string body = MakePayload(4096 * 3 + package * 1000, package);
+
+			// place some headers across block boundaries
+			const std::string filler(package * 700, 'f');
+			stream.write(filler.data(), filler.size());
+
+			const std::streamoff start = stream.tellp();
+
+			gzbuf.Hold(start, header.size());
+			stream.write(std::string(header.size(), 0).data(), header.size());
+			stream.write(body.data(), body.size());
+
+			const std::streamoff end = stream.tellp();
+
+			CHECK(end == std::streamoff(start + header.size() + body.size()));
+
+			stream.seekp(start);
+			stream.write(header.data(), header.size());
+			stream.seekp(end);
+			gzbuf.Release();
+
+			REQUIRE(stream.good());
+
+			expected += filler + header + body;
+		}
+
+		CHECK(gzbuf.Finish());
+	}
+
+	std::string decompressed;
+
+	REQUIRE(DecompressBlockGZ(sink.str(), decompressed));
+	CHECK(decompressed == expected);
+}
+
+TEST_CASE("BlockGZHeldPeakBuffered")
+{
+	// a held header keeps everything after it from being written out; only
+	// the compressed members may pile up, not the raw blocks behind them
+	static constexpr size_t BLOCK_SIZE = 4096;
+
+	const size_t maxJobsInFlight = std::max(4, ThreadPool::GetNumThreads() * 2);
+	const std::string payload = MakePayload(BLOCK_SIZE * 8 * (maxJobsInFlight + 3), 3);
+
+	std::ostringstream sink;
+
+	CBlockGZWriteBuf gzbuf(sink, 1, BLOCK_SIZE);
+	std::ostream stream(&gzbuf);
+
+	gzbuf.Hold(0, 64);
+	stream.write(payload.data(), payload.size());
+	gzbuf.Release();
+
+	REQUIRE(stream.good());
+	CHECK(gzbuf.Finish());
+
+	// held and put blocks, the jobs in flight and one waited on
+	const size_t maxRawBuffered = (maxJobsInFlight + 3) * BLOCK_SIZE;
+
+	CHECK(gzbuf.GetPeakBufferedSize() <= (gzbuf.GetCompressedSize() + maxRawBuffered));
+	CHECK(gzbuf.GetPeakBufferedSize() < gzbuf.GetRawSize());
+}
+
+
+TEST_CASE("BlockGZBenchmark", "[.][benchmark]")
+{
+	using Clock = std::chrono::steady_clock;
+
+	const std::string payload = MakePayload(256 << 20, 1);
+
+	std::printf("[BlockGZBenchmark] %d threads, %.1f MB payload\n", ThreadPool::GetNumThreads(), payload.size() / (1024.0f * 1024));
+
+	{
+		// previous save path: collect everything in a stringstream, then gzip it in one go
+		const auto t0 = Clock::now();
+
+		std::stringstream oss;
+		oss.write(payload.data(), payload.size());
+
+		const std::string data = oss.str();
+		const auto t1 = Clock::now();
+
+		std::string compressed(compressBound(data.size()) + 64, 0);
+
+		z_stream zstream;
+		std::memset(&zstream, 0, sizeof(zstream));
+		deflateInit2(&zstream, 5, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+
+		zstream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+		zstream.avail_in  = data.size();
+		zstream.next_out  = reinterpret_cast<Bytef*>(compressed.data());
+		zstream.avail_out = compressed.size();
+
+		deflate(&zstream, Z_FINISH);
+		compressed.resize(zstream.total_out);
+		deflateEnd(&zstream);
+
+		const auto t2 = Clock::now();
+
+		std::printf("\tgzip(5)      : serialize %7.1f ms, total %7.1f ms, %7.1f MB, peak buffered %7.1f MB\n",
+			std::chrono::duration<float, std::milli>(t1 - t0).count(),
+			std::chrono::duration<float, std::milli>(t2 - t0).count(),
+			compressed.size() / (1024.0f * 1024),
+			// stringstream contents, its copy handed to the writer, and the output
+			(data.size() * 2 + compressed.size()) / (1024.0f * 1024)
+		);
+	}
+
+	for (const int level: {1, 5}) {
+		const auto t0 = Clock::now();
+
+		std::ostringstream sink;
+		CBlockGZWriteBuf gzbuf(sink, level);
+		std::ostream stream(&gzbuf);
+
+		// feed it in chunks like the serializer does
+		for (size_t i = 0; i < payload.size(); i += 4096) {
+			stream.write(payload.data() + i, std::min<size_t>(4096, payload.size() - i));
+		}
+
+		const auto t1 = Clock::now();
+		gzbuf.Finish();
+		const auto t2 = Clock::now();
+
+		std::printf("\tblockgz(%d)   : serialize %7.1f ms, total %7.1f ms, %7.1f MB, peak buffered %7.1f MB\n",
+			level,
+			std::chrono::duration<float, std::milli>(t1 - t0).count(),
+			std::chrono::duration<float, std::milli>(t2 - t0).count(),
+			gzbuf.GetCompressedSize() / (1024.0f * 1024),
+			gzbuf.GetPeakBufferedSize() / (1024.0f * 1024)
+		);
+
+		const auto t3 = Clock::now();
+		std::string decompressed;
+		DecompressBlockGZ(sink.str(), decompressed);
+		const auto t4 = Clock::now();
+
+		std::printf("\tblockgz(%d)   : parallel load %7.1f ms\n", level, std::chrono::duration<float, std::milli>(t4 - t3).count());
+		CHECK(decompressed == payload);
+	}
+}
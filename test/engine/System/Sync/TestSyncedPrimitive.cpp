@@ -38,3 +38,63 @@ TEST_CASE("ImplicitConversions")
 
 	LEAVE_SYNCED_CODE();
 }
+
+
+static SyncChecksumTree SimulateFrame(int frameNum, int projectileValue)
+{
+	CSyncChecker::NewSimFrame();
+
+	ENTER_SYNCED_CODE();
+
+	SyncedSint unscoped = frameNum;
+	{
+		SCOPED_SYNC_SUBSYSTEM(SYNC_SUBSYSTEM_UNITS);
+		SyncedSint unitValue = 1;
+		unitValue += frameNum;
+	}
+	{
+		SCOPED_SYNC_SUBSYSTEM(SYNC_SUBSYSTEM_PROJECTILES);
+		SyncedSint projectile = projectileValue;
+		(void) projectile;
+	}
+	(void) unscoped;
+
+	LEAVE_SYNCED_CODE();
+
+	CSyncChecker::SaveChecksumTree(frameNum);
+
+	SyncChecksumTree tree;
+	CHECK(CSyncChecker::GetChecksumTree(frameNum, tree));
+	return tree;
+}
+
+TEST_CASE("SyncChecksumTree")
+{
+	// two "clients" simulating the same frames, the second one diverging in a projectile
+	CSyncChecker::NewFrame();
+	const SyncChecksumTree a0 = SimulateFrame(0, 5);
+	const SyncChecksumTree a1 = SimulateFrame(1, 5);
+
+	CSyncChecker::NewFrame();
+	const SyncChecksumTree b0 = SimulateFrame(0, 5);
+	const SyncChecksumTree b1 = SimulateFrame(1, 6);
+	const SyncChecksumTree b2 = SimulateFrame(2, 5);
+
+	CHECK(a0 == b0);
+
+	// root and the diverging subsystem differ, everything else matches
+	CHECK(a1[0] != b1[0]);
+	CHECK(a1[1 + SYNC_SUBSYSTEM_UNITS] == b1[1 + SYNC_SUBSYSTEM_UNITS]);
+	CHECK(a1[1 + SYNC_SUBSYSTEM_PROJECTILES] != b1[1 + SYNC_SUBSYSTEM_PROJECTILES]);
+	CHECK(a1[1 + SYNC_SUBSYSTEM_LOS] == b1[1 + SYNC_SUBSYSTEM_LOS]);
+
+	// subsystem checksums only cover their own frame, the root keeps running
+	CHECK(b2[1 + SYNC_SUBSYSTEM_PROJECTILES] == a1[1 + SYNC_SUBSYSTEM_PROJECTILES]);
+	CHECK(b2[0] != a1[0]);
+
+	// only the most recent frames are kept
+	SyncChecksumTree tree;
+	CHECK(!CSyncChecker::GetChecksumTree(2 + MAX_SYNC_TREE_FRAMES, tree));
+	SimulateFrame(2 + MAX_SYNC_TREE_FRAMES, 5);
+	CHECK(!CSyncChecker::GetChecksumTree(2, tree));
+}